@@ -31,6 +31,15 @@ extern "C" {
 #define CLI_TEST                 (0)
 #define CLI_ASSERT               (0)
 
+/* Crc module */
+#define CRC_ENABLE               (1)
+#define CRC_ENABLE_HW            (1)
+#define CRC_NIBBLE_TABLE         (0)
+#define CRC_RTOS                 (1)
+#define CRC_DEBUG                (0)
+#define CRC_TEST                 (0)
+#define CRC_ASSERT               (0)
+
 /* Debug module */
 #define DEBUG_ENABLE             (1)
 #define DEBUG_ENABLE_UART        (1)
@@ -73,6 +82,7 @@ extern "C" {
 #define MEM_FRAM_ENABLE_MSP      (0)
 #define MEM_FRAM_ADDR_MASK       (0x3FFFF)
 #define MEM_FRAM_ADDR_WIDTH      (18)
+#define MEM_SPIFLASH_DMA         (1)
 
 /* Mqtt module */
 #define MQTT_ENABLE              (0)
@@ -24,6 +24,7 @@ extern "C" {
 #include <time.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -43,6 +44,7 @@ extern "C" {
 /* User common library */
 #include "Include/Include.h"
 #include "Cli/Cli.h"
+#include "Crc/Crc.h"
 #include "Debug/Debug.h"
 #include "Gpio/Gpio.h"
 #include "Mem/Mem.h"
@@ -75,6 +77,7 @@ extern "C" {
 #include "User/Drv/Mem.h"
 #include "User/Drv/Net.h"
 #include "User/Drv/Pwr.h"
+#include "User/Drv/Pwr/PwrTrans.h"
 #include "User/Drv/Pwr/Pwr1Prot.h"
 #include "User/Drv/Pwr/Pwr2Prot.h"
 #include "User/Drv/Stc.h"
@@ -83,6 +86,10 @@ extern "C" {
 #include "User/Cli.h"
 #include "User/Com.h"
 #include "User/Data.h"
+#include "User/DataLog.h"
+#include "User/EvtLog.h"
+#include "User/Hist.h"
+#include "User/Nv.h"
 #include "User/Sys.h"
 
 #ifdef __cplusplus
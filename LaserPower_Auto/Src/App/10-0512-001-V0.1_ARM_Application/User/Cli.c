@@ -11,6 +11,11 @@
     --------------------
     01a, 17Nov23, Karl Created
     01b, 24Nov23, Karl Added reset and upgrade
+    01c, 19Oct26, Karl Pending config committed before reset
+    01d, 19Oct26, Karl Reset sent to the event log
+    01e, 19Oct26, Karl Historian page flushed before reset
+    01f, 19Oct26, Karl Persistent counters flushed before reset
+    01g, 19Oct26, agent Reset answered before the flushes
 */
 
 /* Includes */
@@ -184,6 +189,13 @@ CLI_CMD_EXPORT(encli, enable cli, prvCliCmdEncli)
 static void prvCliCmdReset(cli_printf cliprintf, int argc, char **argv) {
     CHECK_CLI();
 
+    /* Before the flushes, the counters alone may hold the bus up to a second */
+    cliprintf("resetting\n");
+    DataCommit();
+    EvtLog(EVT_RESET, 1, 0, 0, 0);
+    EvtLogFlush();
+    HistFlush();
+    NvFlush();
     NVIC_SystemReset();
 }
 CLI_CMD_EXPORT(reset, system reset, prvCliCmdReset)
@@ -24,6 +24,14 @@
     01m, 24Jan24, Karl Added version check in prvCmdParaConfig and prvCmdModuleCtrl
     01n, 26Jan24, Karl Added usSwInfo in RCmdStatusInfo_t
     01o, 01Mar24, Karl Added RS485 test
+    01p, 19Oct26, Karl Added rCmdStcInfo
+    01q, 19Oct26, Karl Added rCmdCanDiag
+    01r, 19Oct26, Karl Pending config committed before reset
+    01s, 19Oct26, Karl Added iCmdEvtRead
+    01t, 19Oct26, Karl Historian page flushed before reset
+    01u, 19Oct26, Karl Persistent counters flushed before reset
+    01v, 19Oct26, agent iCmdEvtRead packet ends on a read returning no record
+    01w, 19Oct26, agent Reset reply sent before the flushes
 */
 
 /* Includes */
@@ -81,11 +89,15 @@ enum {
     iCmdUpgradeEnable  = 0x05,
     iCmdCli            = 0x06,
     iCmdEncrypt        = 0x07,
+    iCmdEvtRead        = 0x08,
     rCmdReply          = 0x81,
     rCmdStatusInfo     = 0x82,
     rCmdDiagInfo       = 0x83,
     rCmdCli            = 0x84,
     rCmdSysPara        = 0x85,
+    rCmdStcInfo        = 0x86,
+    rCmdCanDiag        = 0x87,
+    rCmdEvtLog         = 0x88,
 };
 
 enum {
@@ -149,6 +161,13 @@ typedef struct {
 typedef struct {
     char cCode[20];
 } ICmdEncrypt_t;
+
+typedef struct {
+    uint32_t ulSeq;    /* First record, older than kept starts at the oldest */
+    uint32_t ulStart;  /* RTC seconds, both ends included */
+    uint32_t ulEnd;
+    uint8_t  ucPktMax; /* rCmdEvtLog packets sent for this request */
+} ICmdEvtRead_t;
 char decimalArray[NUM_PAIRS * DECIMAL_CHAR_LENGTH];
 
 typedef struct {
@@ -210,6 +229,47 @@ typedef struct {
     uint16_t usModEn;
 } RCmdSysPara_t;
 
+typedef struct {
+    uint8_t  ucAddr;
+    uint8_t  ucWeight;
+    uint16_t usRate;
+    uint32_t ulSwVer;
+    int16_t  sTempH;
+} RCmdStcNode_t;
+
+/* Variable length, ucNum entries of xNode follow */
+typedef struct {
+    uint8_t       ucNum;
+    RCmdStcNode_t xNode[STC_DEV_MAX];
+} RCmdStcInfo_t;
+
+/* Can bus and power module request statistics, counters since boot */
+typedef struct {
+    uint16_t usRxFps;
+    uint16_t usTxFps;
+    uint8_t  ucLoad;            /* % */
+    uint8_t  ucLoadMax;
+    uint8_t  ucTec;
+    uint8_t  ucRec;
+    uint8_t  ucLec;
+    uint8_t  ucBusOff;
+    uint32_t ulBusOffCnt;
+    uint32_t ulTxErrCnt;
+    uint32_t ulRxLostCnt;       /* Ring and fifo overflows */
+    uint32_t ulPwrReqCnt;       /* All power modules */
+    uint32_t ulPwrTimeoutCnt;
+    uint32_t ulPwrLatMax;       /* us */
+    uint32_t ulPwrLatHist[PWR_TRANS_HIST];
+} RCmdCanDiag_t;
+
+#define EVT_PER_PKT 7
+typedef struct {
+    uint32_t ulNext; /* ulSeq of the next iCmdEvtRead */
+    uint8_t  ucMore; /* Records left after ulNext */
+    uint8_t  ucNum;
+    EvtRec_t xRec[EVT_PER_PKT];
+} RCmdEvtLog_t;
+
 enum { REPLY_OK, REPLY_ERR };
 #pragma pack(pop)
 
@@ -223,11 +283,14 @@ static void     prvCmdModuleCtrl    (uint8_t ucSrcAddr, const uint8_t *pucCont,
 static void     prvCmdUpgradeEnable (uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
 static void     prvCmdCli           (uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
 static void     prvCmdEncrypt       (uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
+static void     prvCmdEvtRead       (uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
 static void     prvSend             (uint8_t *pucData, uint8_t ucDataSize, uint8_t ucCmd, void *pvInfo);
 static void     prvSendReply        (uint8_t ucStatus, void *pvInfo);
 static void     prvSendStatusInfo   (void *pvInfo);
 static void     prvSendDiagInfo     (void *pvInfo);
 static void     prvSendSysPara      (void *pvInfo);
+static void     prvSendStcInfo      (void *pvInfo);
+static void     prvSendCanDiag      (void *pvInfo);
 static Status_t prvProtPktProc      (const void *pvHead, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
 static Bool_t   prvProtPktChk       (const void *pvStart, uint32_t ulLength);
 static Status_t prvUartRecv         (uint8_t *pucBuf, uint16_t usLength, void *pvIsrPara);
@@ -392,6 +455,12 @@ static void prvCmdQueryInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t
     case rCmdSysPara:
         prvSendSysPara(pvInfo);
         break;
+    case rCmdStcInfo:
+        prvSendStcInfo(pvInfo);
+        break;
+    case rCmdCanDiag:
+        prvSendCanDiag(pvInfo);
+        break;
     default:
         prvSendReply(REPLY_ERR, pvInfo);
         break;
@@ -409,7 +478,13 @@ static void prvCmdSysReset(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t u
     const ICmdSysReset_t *pxData = (const ICmdSysReset_t *)pucCont;
 
     if (pxData->ulMark == 0x1234ABCD) {
+        /* Sent before the flushes, the counters alone may hold the bus up to a second */
         prvSendReply(REPLY_OK, pvInfo);
+        DataCommit();
+        EvtLog(EVT_RESET, 0, 0, 0, 0);
+        EvtLogFlush();
+        HistFlush();
+        NvFlush();
         NVIC_SystemReset();
     }
     else {
@@ -674,6 +749,39 @@ static void prvCmdEncrypt(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ul
     }
 }
 
+static void prvCmdEvtRead(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo) {
+    TRACE("iCmdEvtRead\n");
+
+    if (ulLength != sizeof(ICmdEvtRead_t)) {
+        TRACE("    Wrong length\n");
+        return;
+    }
+
+    const ICmdEvtRead_t *pxData = (const ICmdEvtRead_t *)pucCont;
+    RCmdEvtLog_t        *pxRsp  = (RCmdEvtLog_t *)GET_CONT_BUFFER();
+    uint32_t             ulSeq  = pxData->ulSeq;
+    uint8_t              ucPkt  = 0;
+
+    /* Staged records reach the flash first */
+    EvtLogFlush();
+    do {
+        uint32_t ulNum = 0;
+        uint32_t ulGot;
+        /* A sector with no record in the time range also ends the packet, ulNext resumes it */
+        while ((ulNum < EVT_PER_PKT) && (ulSeq != EvtLogEnd())) {
+            if ((STATUS_OK != EvtLogRead(ulSeq, pxData->ulStart, pxData->ulEnd, &pxRsp->xRec[ulNum],
+                                         EVT_PER_PKT - ulNum, &ulGot, &ulSeq)) || (ulGot == 0)) {
+                break;
+            }
+            ulNum += ulGot;
+        }
+        pxRsp->ulNext = ulSeq;
+        pxRsp->ucMore = (ulSeq != EvtLogEnd()) ? 1 : 0;
+        pxRsp->ucNum  = ulNum;
+        prvSend(GET_CONT_BUFFER(), offsetof(RCmdEvtLog_t, xRec) + ulNum * sizeof(EvtRec_t), rCmdEvtLog, pvInfo);
+    } while (pxRsp->ucMore && (++ucPkt < pxData->ucPktMax));
+}
+
 static void prvSend(uint8_t *pucData, uint8_t ucDataSize, uint8_t ucCmd, void *pvInfo) {
     uint8_t *pucBuffer = GET_SEND_BUFFER();
     Head_t  *pxHead    = GET_HEAD_BUFFER();
@@ -808,6 +916,60 @@ static void prvSendSysPara(void *pvInfo) {
     prvSend(GET_CONT_BUFFER(), ucDataSize, rCmdSysPara, pvInfo);
 }
 
+static void prvSendStcInfo(void *pvInfo) {
+    RCmdStcInfo_t *pxData = (RCmdStcInfo_t *)GET_CONT_BUFFER();
+    uint32_t       ulMask = StcGetDevMask();
+    StcDevInfo_t   xInfo;
+
+    /* One entry per node on the bus */
+    pxData->ucNum = 0;
+    for (uint8_t n = 0; n < STC_DEV_MAX; n++) {
+        if ((ulMask & (1UL << n)) && (STATUS_OK == StcGetDevInfo((StcDev_t)n, &xInfo))) {
+            RCmdStcNode_t *pxNode = &pxData->xNode[pxData->ucNum++];
+            pxNode->ucAddr        = xInfo.ucAddr;
+            pxNode->ucWeight      = xInfo.ucWeight;
+            pxNode->usRate        = xInfo.usRate;
+            pxNode->ulSwVer       = xInfo.ulSwVer;
+            pxNode->sTempH        = xInfo.sTempH;
+        }
+    }
+    prvSend(GET_CONT_BUFFER(), 1 + pxData->ucNum * sizeof(RCmdStcNode_t), rCmdStcInfo, pvInfo);
+}
+
+static void prvSendCanDiag(void *pvInfo) {
+    RCmdCanDiag_t *pxData = (RCmdCanDiag_t *)GET_CONT_BUFFER();
+    CanStat_t      xCan;
+    PwrTransStat_t xPwr;
+
+    CanGetStat(&xCan);
+    memset(pxData, 0, sizeof(RCmdCanDiag_t));
+    pxData->usRxFps     = xCan.usRxFps;
+    pxData->usTxFps     = xCan.usTxFps;
+    pxData->ucLoad      = xCan.ucLoad;
+    pxData->ucLoadMax   = xCan.ucLoadMax;
+    pxData->ucTec       = xCan.ucTec;
+    pxData->ucRec       = xCan.ucRec;
+    pxData->ucLec       = xCan.ucLec;
+    pxData->ucBusOff    = xCan.ucBusOff;
+    pxData->ulBusOffCnt = xCan.ulBusOffCnt;
+    pxData->ulTxErrCnt  = xCan.ulTxErrCnt;
+    pxData->ulRxLostCnt = xCan.ulRingOvfCnt + xCan.ulFifoOvfCnt;
+
+    /* Summed over the modules */
+    for (uint8_t n = 0; n < PWR_TRANS_DEV_NUM; n++) {
+        PwrTransGetStat(n, &xPwr);
+        pxData->ulPwrReqCnt += xPwr.ulReqCnt;
+        pxData->ulPwrTimeoutCnt += xPwr.ulTimeoutCnt;
+        if (xPwr.ulLatMax > pxData->ulPwrLatMax) {
+            pxData->ulPwrLatMax = xPwr.ulLatMax;
+        }
+        for (uint8_t h = 0; h < PWR_TRANS_HIST; h++) {
+            pxData->ulPwrLatHist[h] += xPwr.ulLatHist[h];
+        }
+    }
+    prvSend(GET_CONT_BUFFER(), sizeof(RCmdCanDiag_t), rCmdCanDiag, pvInfo);
+}
+
 static Status_t prvProtPktProc(const void *pvHead, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo) {
     Head_t *p = (Head_t *)pvHead;
 
@@ -846,6 +1008,9 @@ static Status_t prvProtPktProc(const void *pvHead, const uint8_t *pucCont, uint3
     case iCmdEncrypt:
         prvCmdEncrypt(p->ucSrcAddr, pucCont, ulLength, pvInfo);
         break;
+    case iCmdEvtRead:
+        prvCmdEvtRead(p->ucSrcAddr, pucCont, ulLength, pvInfo);
+        break;
     default:
         break;
     }
@@ -1325,7 +1490,13 @@ static void prvCmdSysReset(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t u
     const ICmdSysReset_t *pxData = (const ICmdSysReset_t *)pucCont;
 
     if (pxData->ulMark == 0x1234ABCD) {
+        /* Sent before the flushes, the counters alone may hold the bus up to a second */
         prvSendReply(REPLY_OK, pvInfo);
+        DataCommit();
+        EvtLog(EVT_RESET, 0, 0, 0, 0);
+        EvtLogFlush();
+        HistFlush();
+        NvFlush();
         NVIC_SystemReset();
     }
     else {
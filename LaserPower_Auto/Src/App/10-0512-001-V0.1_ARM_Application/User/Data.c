@@ -21,6 +21,13 @@
     01j, 23Jan24, Karl Added th_SysDebug
     01k, 24Jan24, Karl Added trial version control
     01l, 21Feb24, Karl Added net parameters
+    01m, 19Oct26, Karl Stored in the data log, legacy pages migrated once
+    01n, 19Oct26, Karl Saves committed by a background task, added cfg_commit
+    01o, 19Oct26, Karl CRC from the Crc module
+    01p, 19Oct26, Karl Commits sent to the event log
+    01q, 19Oct26, agent A log image failing the CRC falls back to an older save, not the legacy pages
+    01r, 19Oct26, agent CLI prints the commit counters with %lu
+    01s, 19Oct26, agent tDCommit stack from its deepest path, without the task a save commits in place
 */
 
 /* Includes */
@@ -42,7 +49,12 @@
     #define ASSERT(...)
 #endif /* DATA_ASSERT */
 
+/* Local defines */
+#define COMMIT_QUIET    500     /* ms without a change before the commit */
+#define COMMIT_STACK    448     /* Words, deepest path 1368 bytes on the host plus the frame, 25% up */
+
 /* Forward declaration */
+static void prvDataCommitTask(void *pvPara);
 static Bool_t prvChkCrc(uint8_t *pucData, uint16_t usLength);
 static uint8_t prvCalcCrc(uint8_t *pucData, uint16_t usLength);
 
@@ -50,13 +62,37 @@ static uint8_t prvCalcCrc(uint8_t *pucData, uint16_t usLength);
 Data_t g_xData;
 uint16_t g_usMaxCurAd;
 
+/* Local variables */
+static osMutexId s_xCommitMutex = NULL;
+static TaskHandle_t s_xCommitTask = NULL;
+static volatile Bool_t s_bDirty = FALSE;
+static volatile uint32_t s_ulDirtyTick = 0;
+static uint32_t s_ulReqCnt = 0;
+static uint32_t s_ulCommitCnt = 0;
+static uint32_t s_ulCommitLast = 0;    /* us */
+
 /* Functions */
 Status_t AppDataInit(void)
 {
+    Status_t xRet = STATUS_OK;
+
     TRACE("AppDataInit\r\n");
+    if (NULL == s_xCommitMutex) {
+        osMutexDef(DataCommitMutex);
+        s_xCommitMutex = osMutexCreate(osMutex(DataCommitMutex));
+    }
+    if (NULL == s_xCommitTask) {
+        if (pdPASS != xTaskCreate(prvDataCommitTask, "tDCommit", COMMIT_STACK, NULL, tskIDLE_PRIORITY + 1,
+                                  &s_xCommitTask)) {
+            TRACE("AppDataInit: create tDCommit task failed\r\n");
+            s_xCommitTask = NULL;
+            xRet = STATUS_ERR;
+        }
+    }
+    DataLogInit(sizeof(Data_t));
     DataLoad(&g_xData);
     th_MaxCurAd = CUR_TO_ADC(th_MaxCur * 0.1);
-    return STATUS_OK;
+    return xRet;
 }
 
 Status_t AppDataTerm(void)
@@ -68,32 +104,53 @@ Status_t AppDataTerm(void)
 Status_t DataLoad(OUT Data_t *pxData)
 {
     Data_t xData;
+    Bool_t bLog = FALSE;
+    
+    /* Read from the log, an image failing the CRC steps back a save at a time */
+    if (STATUS_OK == DataLogLoad(&xData, sizeof(Data_t))) {
+        bLog = TRUE;
+        for (uint32_t ulBack = 0; ; ulBack++) {
+            if ((FLASH_DATA_HEAD == xData.ucHead) && (prvChkCrc((uint8_t*)&xData, sizeof(xData)))) {
+                if (pxData) {
+                    *pxData = xData;
+                }
+                if (ulBack != 0) {
+                    TRACE("DataLoad: %d saves back\r\n", ulBack);
+                    DataLogSave(&xData, sizeof(Data_t));
+                }
+                return STATUS_OK;
+            }
+            if (STATUS_OK != DataLogLoadPrev(&xData, sizeof(Data_t))) {
+                break;
+            }
+        }
+    }
     
-    /* Read from page1 */
+    /* Read from page1, written before the log, only until the log holds an image */
     MemFlashRead(FLASH_SAVE_PAGE1, sizeof(Data_t), (uint8_t*)&xData);
     TRACE("DataLoad = %d\r\n",(0x00 == xData.ucHead));
-    if ((FLASH_DATA_HEAD == xData.ucHead) && (prvChkCrc((uint8_t*)&xData, sizeof(xData)))) {
+    if (!bLog && (FLASH_DATA_HEAD == xData.ucHead) && (prvChkCrc((uint8_t*)&xData, sizeof(xData)))) {
         if (pxData) {
             *pxData = xData;
         }
-        
+        DataLogSave(&xData, sizeof(Data_t));
         return STATUS_OK;
     }
 
     /* Read from page2 */
     MemFlashRead(FLASH_SAVE_PAGE2, sizeof(Data_t), (uint8_t*)&xData);
-    if ((FLASH_DATA_HEAD == xData.ucHead) && (prvChkCrc((uint8_t*)&xData, sizeof(xData)))) {
+    if (!bLog && (FLASH_DATA_HEAD == xData.ucHead) && (prvChkCrc((uint8_t*)&xData, sizeof(xData)))) {
         if (pxData) {
             *pxData = xData;
         }
+        DataLogSave(&xData, sizeof(Data_t));
         return STATUS_OK;
     }
 
     /* Init FLASH data */
     Data_t xDataInit = APP_DATA_INIT;
     xDataInit.ucCrc = prvCalcCrc((uint8_t*)&xDataInit, sizeof(Data_t) - 1);
-    MemFlashWrite(FLASH_SAVE_PAGE1, sizeof(Data_t), (uint8_t*)&xDataInit);
-    MemFlashWrite(FLASH_SAVE_PAGE2, sizeof(Data_t), (uint8_t*)&xDataInit);
+    DataLogSave(&xDataInit, sizeof(Data_t));
     if (pxData) {
         *pxData = xDataInit;
     }
@@ -109,18 +166,82 @@ Status_t DataSave(IN Data_t *pxData)
     pxData->ucHead = FLASH_DATA_HEAD;
     memcpy(&xData, pxData, sizeof(Data_t));
     xData.ucCrc = prvCalcCrc((uint8_t*)&xData, sizeof(Data_t) - 1);
-    MemFlashWrite(FLASH_SAVE_PAGE1, sizeof(Data_t), (uint8_t*)&xData);
-    MemFlashWrite(FLASH_SAVE_PAGE2, sizeof(Data_t), (uint8_t*)&xData);
     
-    return STATUS_OK;
+    /* Only the changed bytes reach the flash, no erase per save */
+    return DataLogSave(&xData, sizeof(Data_t));
 }
 
 Status_t DataSaveDirect(void)
 {
-    DataSave(&g_xData);
+    /* Only marks g_xData, the commit task writes it once the setters go quiet */
+    taskENTER_CRITICAL();
+    s_bDirty = TRUE;
+    s_ulDirtyTick = osKernelSysTick();
+    s_ulReqCnt++;
+    taskEXIT_CRITICAL();
+    
+    if ((NULL == s_xCommitTask) || (taskSCHEDULER_NOT_STARTED == xTaskGetSchedulerState())) {
+        return DataCommit();
+    }
+    xTaskNotifyGive(s_xCommitTask);
     return STATUS_OK;
 }
 
+Status_t DataCommit(void)
+{
+    Data_t xData;
+    Status_t xRet;
+    uint32_t ulCyc = TimeCycGet();
+    
+    osMutexWait(s_xCommitMutex, osWaitForever);
+    
+    taskENTER_CRITICAL();
+    if (!s_bDirty) {
+        taskEXIT_CRITICAL();
+        osMutexRelease(s_xCommitMutex);
+        return STATUS_OK;
+    }
+    xData = g_xData;
+    s_bDirty = FALSE;
+    taskEXIT_CRITICAL();
+    
+    xRet = DataSave(&xData);
+    if (STATUS_OK != xRet) {
+        /* Retried by the next commit */
+        s_bDirty = TRUE;
+    }
+    s_ulCommitCnt++;
+    EvtLog(EVT_CFG_COMMIT, xRet, 0, 0, 0);
+    s_ulCommitLast = TimeCycToUs(TimeCycGet() - ulCyc);
+    
+    osMutexRelease(s_xCommitMutex);
+    
+    return xRet;
+}
+
+Bool_t DataPending(void)
+{
+    return s_bDirty;
+}
+
+static void prvDataCommitTask(void *pvPara)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        
+        /* Every setter of a provisioning script restarts the window, one commit for all */
+        while (s_bDirty) {
+            int32_t lLeft = (int32_t)(s_ulDirtyTick + COMMIT_QUIET - osKernelSysTick());
+            if (lLeft > 0) {
+                osDelay(lLeft);
+            }
+            else if (STATUS_OK != DataCommit()) {
+                osDelay(COMMIT_QUIET);
+            }
+        }
+    }
+}
+
 static Bool_t prvChkCrc(uint8_t *pucData, uint16_t usLength)
 {
     /* CRC */
@@ -130,25 +251,8 @@ static Bool_t prvChkCrc(uint8_t *pucData, uint16_t usLength)
 
 static uint8_t prvCalcCrc(uint8_t *pucData, uint16_t usLength) 
 {
-    /* REFERENCE: https://www.devcoons.com/crc8/ */
     /* CRC-8/MAXIM */
-    
-    uint8_t ucCrc = 0x00;
-    uint8_t ucTmp, ucSum;
-    
-    for(uint16_t n = 0; n < usLength; n++) {
-        ucTmp = pucData[n];
-        for (uint8_t m = 0; m < 8; m++) {
-            ucSum = (ucCrc ^ ucTmp) & 0x01;
-            ucCrc >>= 1;
-            if (ucSum) {
-                ucCrc ^= 0x8C;
-            }
-            ucTmp >>= 1;
-        }
-    }
-    
-    return ucCrc;
+    return Crc8Maxim(CRC8_MAXIM_INIT, pucData, usLength);
 }
 
 static void prvCliCmdCfgShow(cli_printf cliprintf, int argc, char** argv)
@@ -738,6 +842,23 @@ static void prvCliCmdCfgSetPdLight(cli_printf cliprintf, int argc, char** argv)
 }
 CLI_CMD_EXPORT(cfg_set_pd_light, set pd light value, prvCliCmdCfgSetPdLight)
 
+static void prvCliCmdCfgCommit(cli_printf cliprintf, int argc, char** argv)
+{
+    CHECK_CLI();
+    
+    Bool_t bPending = DataPending();
+    
+    if (STATUS_OK != DataCommit()) {
+        cliprintf("commit failed\n");
+        return;
+    }
+    cliprintf("SET CNT     : %lu\n", (unsigned long)s_ulReqCnt);
+    cliprintf("COMMIT CNT  : %lu\n", (unsigned long)s_ulCommitCnt);
+    cliprintf("COMMIT LAST : %lu us\n", (unsigned long)s_ulCommitLast);
+    cliprintf("ok, %s\n", bPending ? "pending changes written" : "nothing pending");
+}
+CLI_CMD_EXPORT(cfg_commit, write pending config changes now, prvCliCmdCfgCommit)
+
 static void Data_test(cli_printf cliprintf, int argc, char** argv)
 {
     CHECK_CLI();
@@ -21,6 +21,8 @@
     01j, 23Jan24, Karl Added th_SysDebug
     01k, 24Jan24, Karl Added trial version control
     01l, 21Feb24, Karl Added net parameters
+    01m, 19Oct26, Karl Stored in the data log
+    01n, 19Oct26, Karl Added DataCommit and DataPending
 */
 
 #ifndef __DATA_H__
@@ -186,7 +188,11 @@ Status_t AppDataTerm(void);
 
 Status_t DataLoad(OUT Data_t *pxData);
 Status_t DataSave(IN Data_t *pxData);
+/* Marks g_xData changed, written in the background after a quiet window */
 Status_t DataSaveDirect(void);
+/* Writes pending changes now, call before a reset */
+Status_t DataCommit(void);
+Bool_t   DataPending(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,530 @@
+/*
+    DataLog.c
+
+    Implementation File for App Data Log Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, Karl CRC from the Crc module
+    01c, 19Oct26, agent Commit record per save, sequence checked by its complement
+    01d, 19Oct26, agent CLI prints the save counters with %lu
+    01e, 19Oct26, agent tDLog stack from its deepest path, its creation checked
+*/
+
+/* Includes */
+#include "Include.h"
+
+/* Debug config */
+#if DATA_DEBUG
+    #undef TRACE
+    #define TRACE(...)  DebugPrintf(__VA_ARGS__)
+#else
+    #undef TRACE
+    #define TRACE(...)
+#endif /* DATA_DEBUG */
+#if DATA_ASSERT
+    #undef ASSERT
+    #define ASSERT(a)   while(!(a)){DebugPrintf("ASSERT failed: %s %d\n", __FILE__, __LINE__);}
+#else
+    #undef ASSERT
+    #define ASSERT(...)
+#endif /* DATA_ASSERT */
+
+/*
+    Each sector starts with a Sector_t, then records up to the first erased byte.
+    The first records of a sector are a full snapshot of the image, the later ones
+    the bytes changed by each save. The snapshot and every save end with a commit
+    record, replay applies the records of a save only once it reaches its commit,
+    so a save cut by a reset leaves the image of the save before. Only the newest
+    sector is replayed at boot, the older ones are kept as a fallback until the
+    background task erases them, one sector ahead of the writer, so a rotation
+    programs without erasing.
+*/
+
+/* Local defines */
+#define LOG_MAGIC           0x474F4C44  /* "DLOG" */
+#define SEQ_FREE            0xFFFFFFFF  /* Erased, not taken yet */
+#define REC_SNAP            0x5A
+#define REC_DELTA           0xA5
+#define REC_COMMIT          0xC3        /* No data, ends a snapshot or a save */
+#define REC_FREE            0xFF
+#define REC_HEAD            sizeof(RecHead_t)
+#define REC_CRC             2
+#define REC_MAX             64          /* Data bytes per record */
+#define REC_GAP             4           /* Equal bytes merged into a record rather than a new head */
+#define SECTOR_ADDR(s)      (DATA_LOG_ADDR + (uint32_t)(s) * DATA_LOG_SECTOR)
+#define NO_SECTOR           0xFF
+#define TASK_STACK          288         /* Words, deepest path 856 bytes on the host plus the frame, 25% up */
+/* A sequence write cut by a reset leaves the sector neither free nor taken */
+#define SECTOR_FREE(x)      (((x).ulMagic == LOG_MAGIC) && ((x).ulSeq == SEQ_FREE) && ((x).ulSeqInv == SEQ_FREE))
+#define SECTOR_TAKEN(x)     (((x).ulMagic == LOG_MAGIC) && ((x).ulSeq != SEQ_FREE) && ((x).ulSeqInv == ~(x).ulSeq))
+#define COMMIT_ALL          0xFFFFFFFF
+
+/* Local types */
+#pragma pack(push)
+#pragma pack(1)
+typedef struct {
+    uint32_t ulMagic;
+    uint32_t ulEraseCnt;
+    uint32_t ulSeq;         /* SEQ_FREE until the sector is taken */
+    uint32_t ulSeqInv;      /* ~ulSeq, programmed with it */
+}Sector_t;
+
+typedef struct {
+    uint8_t  ucMark;
+    uint8_t  ucLen;
+    uint16_t usOfs;         /* In the image */
+}RecHead_t;
+#pragma pack(pop)
+
+/* Forward declarations */
+static void     prvDataLogTask(void *pvPara);
+static Status_t prvReplay(uint8_t ucSector, uint32_t ulCommitMax, uint8_t *pucImg, uint32_t *pulWrOfs,
+                          uint32_t *pulCommit);
+static uint8_t  prvOlder(uint32_t ulLimit, uint32_t *pulSeq);
+static Status_t prvAppend(uint8_t ucMark, uint32_t ulOfs, uint32_t ulLen, const uint8_t *pucData);
+static void     prvRotate(const uint8_t *pucImg);
+static void     prvErase(uint8_t ucSector);
+static void     prvCacheRead(uint32_t ulAddr, uint32_t ulLen, uint8_t *pucData);
+
+/* Local variables */
+static Bool_t        s_bInit = FALSE;
+static Bool_t        s_bImg  = FALSE;       /* s_ucImg holds a valid image */
+static osMutexId     s_xMutex;
+static TaskHandle_t  s_xTask = NULL;
+static uint8_t       s_ucImg[DATA_LOG_IMG_MAX]; /* As in flash */
+static uint8_t       s_ucStage[DATA_LOG_IMG_MAX]; /* Replay, records not committed yet */
+static uint32_t      s_ulImgSize = 0;
+static uint8_t       s_ucActive  = NO_SECTOR;
+static uint32_t      s_ulSeq     = 0;
+static uint32_t      s_ulWrOfs   = DATA_LOG_SECTOR; /* Next record in the active sector */
+static uint32_t      s_ulEraseCnt[DATA_LOG_SECTOR_NUM];
+static Bool_t        s_bFree[DATA_LOG_SECTOR_NUM];
+static uint8_t       s_ucCache[256];        /* Boot replay reads */
+static uint32_t      s_ulCacheAddr = 0;
+static Bool_t        s_bCache = FALSE;
+static uint8_t       s_ucPrevSector = NO_SECTOR; /* Image last returned by a load */
+static uint32_t      s_ulPrevSeq    = 0;
+static uint32_t      s_ulPrevCommit = 0;
+/* Statistics */
+static uint32_t      s_ulLoadTime  = 0;     /* us */
+static uint32_t      s_ulSaveCnt   = 0;
+static uint32_t      s_ulSaveLast  = 0;     /* us */
+static uint32_t      s_ulSaveMax   = 0;
+static uint32_t      s_ulDeltaByte = 0;     /* Flash bytes of delta records */
+static uint32_t      s_ulSnapByte  = 0;     /* Flash bytes of the snapshot */
+static uint32_t      s_ulRotateCnt = 0;
+
+/* Functions */
+Status_t DataLogInit(uint32_t ulImgSize)
+{
+    if (s_bInit) {
+        return s_bImg ? STATUS_OK : STATUS_ERR;
+    }
+    if ((ulImgSize == 0) || (ulImgSize > DATA_LOG_IMG_MAX)) {
+        return STATUS_ERR;
+    }
+
+    uint32_t ulCyc = TimeCycGet();
+    Sector_t xSector[DATA_LOG_SECTOR_NUM];
+    uint32_t ulCntMax = 0;
+
+    osMutexDef(DataLogMutex);
+    s_xMutex    = osMutexCreate(osMutex(DataLogMutex));
+    s_ulImgSize = ulImgSize;
+
+    for (uint8_t s = 0; s < DATA_LOG_SECTOR_NUM; s++) {
+        MemFlashRead(SECTOR_ADDR(s), sizeof(Sector_t), (uint8_t *)&xSector[s]);
+        s_bFree[s]      = FALSE;
+        s_ulEraseCnt[s] = 0;
+        if (xSector[s].ulMagic != LOG_MAGIC) {
+            continue;
+        }
+        s_ulEraseCnt[s] = xSector[s].ulEraseCnt;
+        if (xSector[s].ulEraseCnt > ulCntMax) {
+            ulCntMax = xSector[s].ulEraseCnt;
+        }
+        if (SECTOR_FREE(xSector[s])) {
+            s_bFree[s] = TRUE;
+        }
+        else if (SECTOR_TAKEN(xSector[s]) && (xSector[s].ulSeq > s_ulSeq)) {
+            s_ulSeq    = xSector[s].ulSeq;
+            s_ucActive = s;
+        }
+    }
+    for (uint8_t s = 0; s < DATA_LOG_SECTOR_NUM; s++) {
+        /* Unknown history, assume the worst worn */
+        if (xSector[s].ulMagic != LOG_MAGIC) {
+            s_ulEraseCnt[s] = ulCntMax;
+        }
+    }
+
+    /* Newest first, a rotation cut by a reset leaves a sector without its snapshot */
+    uint32_t ulLimit = SEQ_FREE;
+    uint8_t  ucBest;
+    while (NO_SECTOR != (ucBest = prvOlder(ulLimit, &ulLimit))) {
+        uint32_t ulWrOfs;
+        uint32_t ulCommit;
+        if (STATUS_OK == prvReplay(ucBest, COMMIT_ALL, s_ucImg, &ulWrOfs, &ulCommit)) {
+            /* Appended to only if it is the newest, else the next save rotates */
+            if (ucBest == s_ucActive) {
+                s_ulWrOfs = ulWrOfs;
+            }
+            s_ucPrevSector = ucBest;
+            s_ulPrevSeq    = ulLimit;
+            s_ulPrevCommit = ulCommit;
+            s_bImg = TRUE;
+            break;
+        }
+    }
+    if (s_ucActive == NO_SECTOR) {
+        s_ucActive = DATA_LOG_SECTOR_NUM - 1;
+    }
+
+    s_ulLoadTime = TimeCycToUs(TimeCycGet() - ulCyc);
+    TRACE("DataLogInit: sector %d, seq %d, %d us\n", s_ucActive, s_ulSeq, s_ulLoadTime);
+
+    /* Without the task a rotation erases the next sector itself */
+    if (pdPASS != xTaskCreate(prvDataLogTask, "tDLog", TASK_STACK, NULL, tskIDLE_PRIORITY, &s_xTask)) {
+        TRACE("DataLogInit: create tDLog task failed\n");
+        s_xTask = NULL;
+    }
+    s_bInit = TRUE;
+
+    return s_bImg ? STATUS_OK : STATUS_ERR;
+}
+
+Status_t DataLogLoad(OUT void *pvImg, uint32_t ulImgSize)
+{
+    if (!s_bInit || !s_bImg || (ulImgSize != s_ulImgSize)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    memcpy(pvImg, s_ucImg, ulImgSize);
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+Status_t DataLogLoadPrev(OUT void *pvImg, uint32_t ulImgSize)
+{
+    Status_t xRet = STATUS_ERR;
+    uint32_t ulWrOfs;
+    uint32_t ulCommit;
+
+    if (!s_bInit || !s_bImg || (ulImgSize != s_ulImgSize)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    while (s_ucPrevSector != NO_SECTOR) {
+        /* The commit count of a sector includes its snapshot, which is never stepped over */
+        if (s_ulPrevCommit > 1) {
+            s_ulPrevCommit--;
+            xRet = prvReplay(s_ucPrevSector, s_ulPrevCommit, (uint8_t *)pvImg, &ulWrOfs, &ulCommit);
+            break;
+        }
+        s_ucPrevSector = prvOlder(s_ulPrevSeq, &s_ulPrevSeq);
+        if ((s_ucPrevSector != NO_SECTOR) &&
+            (STATUS_OK == prvReplay(s_ucPrevSector, COMMIT_ALL, (uint8_t *)pvImg, &ulWrOfs, &s_ulPrevCommit))) {
+            xRet = STATUS_OK;
+            break;
+        }
+        s_ulPrevCommit = 0;
+    }
+    osMutexRelease(s_xMutex);
+
+    return xRet;
+}
+
+Status_t DataLogSave(IN const void *pvImg, uint32_t ulImgSize)
+{
+    const uint8_t *pucImg = (const uint8_t *)pvImg;
+    uint32_t       ulCyc  = TimeCycGet();
+
+    if (!s_bInit || (ulImgSize != s_ulImgSize)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    if (!s_bImg) {
+        prvRotate(pucImg);
+        s_bImg = TRUE;
+    }
+
+    /* One record per run of changed bytes, short equal gaps are cheaper inside a run */
+    uint32_t n      = 0;
+    Bool_t   bDelta = FALSE;
+    while (n < ulImgSize) {
+        if (pucImg[n] == s_ucImg[n]) {
+            n++;
+            continue;
+        }
+        uint32_t ulEnd  = n + 1;
+        uint32_t ulSame = 0;
+        for (uint32_t m = n + 1; (m < ulImgSize) && ((m - n) < REC_MAX); m++) {
+            if (pucImg[m] != s_ucImg[m]) {
+                ulEnd  = m + 1;
+                ulSame = 0;
+            }
+            else if (++ulSame > REC_GAP) {
+                break;
+            }
+        }
+        if (STATUS_OK != prvAppend(REC_DELTA, n, ulEnd - n, &pucImg[n])) {
+            /* Sector full, the new snapshot carries every change */
+            prvRotate(pucImg);
+            bDelta = FALSE;
+            break;
+        }
+        memcpy(&s_ucImg[n], &pucImg[n], ulEnd - n);
+        n      = ulEnd;
+        bDelta = TRUE;
+    }
+    if (bDelta && (STATUS_OK != prvAppend(REC_COMMIT, 0, 0, NULL))) {
+        /* The deltas are never replayed without their commit */
+        prvRotate(s_ucImg);
+    }
+
+    ulCyc        = TimeCycToUs(TimeCycGet() - ulCyc);
+    s_ulSaveLast = ulCyc;
+    if (ulCyc > s_ulSaveMax) {
+        s_ulSaveMax = ulCyc;
+    }
+    s_ulSaveCnt++;
+
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+/* Keeps the sector after the active one erased */
+static void prvDataLogTask(void *pvPara)
+{
+    while (1) {
+        osMutexWait(s_xMutex, osWaitForever);
+        uint8_t ucNext = (s_ucActive + 1) % DATA_LOG_SECTOR_NUM;
+        if (!s_bFree[ucNext]) {
+            prvErase(ucNext);
+        }
+        osMutexRelease(s_xMutex);
+
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+/*
+    Applies the snapshot and then the saves of a sector to pucImg, up to ulCommitMax
+    commits. The snapshot is the first commit, STATUS_ERR if the sector holds none.
+*/
+static Status_t prvReplay(uint8_t ucSector, uint32_t ulCommitMax, uint8_t *pucImg, uint32_t *pulWrOfs,
+                          uint32_t *pulCommit)
+{
+    uint8_t    ucRec[REC_HEAD + REC_MAX + REC_CRC];
+    RecHead_t *pxHead   = (RecHead_t *)ucRec;
+    uint32_t   ulBase   = SECTOR_ADDR(ucSector);
+    uint32_t   ulOfs    = sizeof(Sector_t);
+    uint32_t   ulSnap   = 0;    /* Snapshot bytes found, in order from 0 */
+    uint32_t   ulCommit = 0;
+    Bool_t     bStaged  = FALSE;
+
+    s_bCache = FALSE;
+    while ((ulCommit < ulCommitMax) && ((ulOfs + REC_HEAD + REC_CRC) <= DATA_LOG_SECTOR)) {
+        prvCacheRead(ulBase + ulOfs, REC_HEAD, ucRec);
+        if (pxHead->ucMark == REC_FREE) {
+            break;
+        }
+        uint32_t ulLen = REC_HEAD + pxHead->ucLen + REC_CRC;
+        if (((pxHead->ucMark != REC_SNAP) && (pxHead->ucMark != REC_DELTA) && (pxHead->ucMark != REC_COMMIT)) ||
+            (pxHead->ucLen > REC_MAX) || ((ulOfs + ulLen) > DATA_LOG_SECTOR)) {
+            /* Nothing after a broken head can be trusted, the sector is closed */
+            ulOfs = DATA_LOG_SECTOR;
+            break;
+        }
+        prvCacheRead(ulBase + ulOfs, ulLen, ucRec);
+
+        /* A record cut by a reset is the last one written, the sector is closed there */
+        uint16_t usCrc = ucRec[REC_HEAD + pxHead->ucLen] | ((uint16_t)ucRec[REC_HEAD + pxHead->ucLen + 1] << 8);
+        if ((usCrc != Crc16Ccitt(CRC16_CCITT_INIT, ucRec, REC_HEAD + pxHead->ucLen)) ||
+            ((pxHead->usOfs + pxHead->ucLen) > s_ulImgSize)) {
+            ulOfs = DATA_LOG_SECTOR;
+            break;
+        }
+        ulOfs += ulLen;
+
+        if (pxHead->ucMark == REC_COMMIT) {
+            if (ulSnap < s_ulImgSize) {
+                break;
+            }
+            memcpy(pucImg, s_ucStage, s_ulImgSize);
+            bStaged = FALSE;
+            ulCommit++;
+            continue;
+        }
+        if (pxHead->ucMark == REC_SNAP) {
+            if ((pxHead->usOfs != ulSnap) || (ulCommit != 0)) {
+                break;
+            }
+            ulSnap += pxHead->ucLen;
+        }
+        else if (ulSnap < s_ulImgSize) {
+            break;
+        }
+        memcpy(&s_ucStage[pxHead->usOfs], &ucRec[REC_HEAD], pxHead->ucLen);
+        bStaged = TRUE;
+    }
+
+    /* Records of a save not committed would be committed by the next one, rotate instead */
+    *pulWrOfs  = bStaged ? DATA_LOG_SECTOR : ulOfs;
+    *pulCommit = ulCommit;
+    return (ulCommit != 0) ? STATUS_OK : STATUS_ERR;
+}
+
+/* Newest taken sector older than ulLimit, NO_SECTOR if none */
+static uint8_t prvOlder(uint32_t ulLimit, uint32_t *pulSeq)
+{
+    Sector_t xSector;
+    uint8_t  ucBest = NO_SECTOR;
+    uint32_t ulSeq  = 0;
+
+    for (uint8_t s = 0; s < DATA_LOG_SECTOR_NUM; s++) {
+        MemFlashRead(SECTOR_ADDR(s), sizeof(Sector_t), (uint8_t *)&xSector);
+        if (SECTOR_TAKEN(xSector) && (xSector.ulSeq < ulLimit) &&
+            ((ucBest == NO_SECTOR) || (xSector.ulSeq > ulSeq))) {
+            ucBest = s;
+            ulSeq  = xSector.ulSeq;
+        }
+    }
+    if (ucBest != NO_SECTOR) {
+        *pulSeq = ulSeq;
+    }
+    return ucBest;
+}
+
+static Status_t prvAppend(uint8_t ucMark, uint32_t ulOfs, uint32_t ulLen, const uint8_t *pucData)
+{
+    uint8_t    ucRec[REC_HEAD + REC_MAX + REC_CRC];
+    RecHead_t *pxHead = (RecHead_t *)ucRec;
+    uint32_t   ulSize = REC_HEAD + ulLen + REC_CRC;
+
+    if ((s_ulWrOfs + ulSize) > DATA_LOG_SECTOR) {
+        return STATUS_ERR;
+    }
+
+    pxHead->ucMark = ucMark;
+    pxHead->ucLen  = ulLen;
+    pxHead->usOfs  = ulOfs;
+    if (ulLen != 0) {
+        memcpy(&ucRec[REC_HEAD], pucData, ulLen);
+    }
+    uint16_t usCrc = Crc16Ccitt(CRC16_CCITT_INIT, ucRec, REC_HEAD + ulLen);
+    ucRec[REC_HEAD + ulLen]     = usCrc & 0xFF;
+    ucRec[REC_HEAD + ulLen + 1] = usCrc >> 8;
+
+    MemFlashProgram(SECTOR_ADDR(s_ucActive) + s_ulWrOfs, ulSize, ucRec);
+    s_ulWrOfs += ulSize;
+    if (ucMark == REC_DELTA) {
+        s_ulDeltaByte += ulSize;
+    }
+
+    return STATUS_OK;
+}
+
+/* Takes the next sector and starts it with a snapshot of pucImg */
+static void prvRotate(const uint8_t *pucImg)
+{
+    uint8_t  ucNext = (s_ucActive + 1) % DATA_LOG_SECTOR_NUM;
+    uint32_t ulSeq[2];
+
+    if (!s_bFree[ucNext]) {
+        /* The background erase has not run yet */
+        prvErase(ucNext);
+    }
+    ulSeq[0] = s_ulSeq + 1;
+    ulSeq[1] = ~ulSeq[0];
+    MemFlashProgram(SECTOR_ADDR(ucNext) + offsetof(Sector_t, ulSeq), sizeof(ulSeq), (uint8_t *)ulSeq);
+    s_bFree[ucNext] = FALSE;
+    s_ucActive      = ucNext;
+    s_ulSeq         = ulSeq[0];
+    s_ulWrOfs       = sizeof(Sector_t);
+
+    for (uint32_t n = 0; n < s_ulImgSize; n += REC_MAX) {
+        prvAppend(REC_SNAP, n, ((s_ulImgSize - n) < REC_MAX) ? (s_ulImgSize - n) : REC_MAX, &pucImg[n]);
+    }
+    prvAppend(REC_COMMIT, 0, 0, NULL);
+    if (pucImg != s_ucImg) {
+        memcpy(s_ucImg, pucImg, s_ulImgSize);
+    }
+    s_ulSnapByte = s_ulWrOfs - sizeof(Sector_t);
+    s_ulRotateCnt++;
+
+    if ((s_xTask != NULL) && (xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED)) {
+        xTaskNotifyGive(s_xTask);
+    }
+}
+
+static void prvErase(uint8_t ucSector)
+{
+    Sector_t xSector;
+
+    MemFlashErase(SECTOR_ADDR(ucSector), DATA_LOG_SECTOR);
+    xSector.ulMagic    = LOG_MAGIC;
+    xSector.ulEraseCnt = s_ulEraseCnt[ucSector] + 1;
+    xSector.ulSeq      = SEQ_FREE;
+    xSector.ulSeqInv   = SEQ_FREE;
+    MemFlashProgram(SECTOR_ADDR(ucSector), sizeof(xSector), (uint8_t *)&xSector);
+    s_ulEraseCnt[ucSector] = xSector.ulEraseCnt;
+    s_bFree[ucSector]      = TRUE;
+    TRACE("DataLog erase sector %d, %d times\n", ucSector, xSector.ulEraseCnt);
+}
+
+/* Records never span more than the cache, one flash read per cache fill */
+static void prvCacheRead(uint32_t ulAddr, uint32_t ulLen, uint8_t *pucData)
+{
+    if (!s_bCache || (ulAddr < s_ulCacheAddr) || ((ulAddr + ulLen) > (s_ulCacheAddr + sizeof(s_ucCache)))) {
+        MemFlashRead(ulAddr, sizeof(s_ucCache), s_ucCache);
+        s_ulCacheAddr = ulAddr;
+        s_bCache      = TRUE;
+    }
+    memcpy(pucData, &s_ucCache[ulAddr - s_ulCacheAddr], ulLen);
+}
+
+static void prvCliCmdDataLogStat(cli_printf cliprintf, int argc, char** argv)
+{
+    CHECK_CLI();
+
+    if (!s_bInit) {
+        cliprintf("data log not initialized\n");
+        return;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    cliprintf("LOAD TIME     : %lu us\n", (unsigned long)s_ulLoadTime);
+    cliprintf("SAVE CNT      : %lu\n", (unsigned long)s_ulSaveCnt);
+    cliprintf("SAVE LAST     : %lu us\n", (unsigned long)s_ulSaveLast);
+    cliprintf("SAVE MAX      : %lu us\n", (unsigned long)s_ulSaveMax);
+    cliprintf("ROTATE CNT    : %lu\n", (unsigned long)s_ulRotateCnt);
+    cliprintf("ACTIVE        : sector %d, seq %lu, %lu / %d bytes\n", s_ucActive, (unsigned long)s_ulSeq,
+              (unsigned long)s_ulWrOfs, DATA_LOG_SECTOR);
+    for (uint8_t s = 0; s < DATA_LOG_SECTOR_NUM; s++) {
+        cliprintf("SECTOR %d      : %lu erases%s\n", s, (unsigned long)s_ulEraseCnt[s], s_bFree[s] ? ", free" : "");
+    }
+
+    /* Projection from the average save of this boot */
+    if ((s_ulSaveCnt != 0) && (s_ulDeltaByte != 0)) {
+        uint32_t ulPerSave = (s_ulDeltaByte + s_ulSaveCnt - 1) / s_ulSaveCnt;
+        uint32_t ulRoom    = DATA_LOG_SECTOR - sizeof(Sector_t) - s_ulSnapByte;
+        cliprintf("BYTES/SAVE    : %lu\n", (unsigned long)ulPerSave);
+        cliprintf("SAVES/ERASE   : %lu, each sector erased once every %lu saves\n", (unsigned long)(ulRoom / ulPerSave),
+                  (unsigned long)(ulRoom / ulPerSave * DATA_LOG_SECTOR_NUM));
+    }
+    osMutexRelease(s_xMutex);
+}
+CLI_CMD_EXPORT(data_log_stat, show config log statistics, prvCliCmdDataLogStat)
@@ -0,0 +1,45 @@
+/*
+    DataLog.h
+
+    Head File for App Data Log Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent Added DataLogLoadPrev
+*/
+
+#ifndef __DATA_LOG_H__
+#define __DATA_LOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include "Include/Include.h"
+
+/* Defines */
+#define DATA_LOG_ADDR       (1024*256)      /* SPI flash, clear of FLASH_SAVE_PAGE1/2 */
+#define DATA_LOG_SECTOR     4096            /* Erase unit */
+#define DATA_LOG_SECTOR_NUM 8
+#define DATA_LOG_IMG_MAX    256             /* Largest image kept */
+
+/* Functions */
+/* Rebuilds the image from the newest sector, STATUS_ERR if the log holds none */
+Status_t DataLogInit(uint32_t ulImgSize);
+Status_t DataLogLoad(OUT void *pvImg, uint32_t ulImgSize);
+/* Each call steps one save back from the image loaded last, STATUS_ERR past the oldest */
+Status_t DataLogLoadPrev(OUT void *pvImg, uint32_t ulImgSize);
+/* Appends the bytes that differ from the last save, no erase on this path */
+Status_t DataLogSave(IN const void *pvImg, uint32_t ulImgSize);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __DATA_LOG_H__ */
@@ -10,6 +10,15 @@
     modification history
     --------------------
     01a, 15Nov23, Karl Created
+    01b, 19Oct26, Karl CanRxNotify called once per frame
+    01c, 19Oct26, Karl Added acceptance filters, receive ring and CanRead
+    01d, 19Oct26, Karl Added interrupt driven transmit queue over all three mailboxes
+    01e, 19Oct26, Karl Added bus load, error counter and bus-off monitor
+    01f, 19Oct26, Karl Bus-off and error passive sent to the event log
+    01g, 19Oct26, agent Stale mailboxes aborted by CanMonUpdate, not only on a full queue
+    01h, 19Oct26, agent CLI prints the receive counters with %lu
+    01i, 19Oct26, agent CLI prints the transmit counters with %lu
+    01j, 19Oct26, agent CLI prints the bus-off and error passive counters with %lu
 */
 
 /* Includes */
@@ -36,22 +45,43 @@
 #endif /* CAN_ASSERT */
 
 /* Local defines */
+#define RX_MASK (CAN_RX_RING - 1)
+#define TX_BOX  3
 
 /* Local types */
 
 /* Forward declarations */
+static void     prvRxIsr(uint8_t ucFifo);
+static void     prvTxFill(void);
+static void     prvTxLoad(uint8_t ucBox, const CanMsgTx_t *pxMsg);
+static void     prvTxAbortStale(void);
+static uint32_t prvTxKey(const CanMsgTx_t *pxMsg);
+static uint32_t prvFrameBits(uint32_t ulIr, uint32_t ulDtr);
 
 /* Local variables */
 static CAN_HandleTypeDef s_hCan;
-static CanTxMsgTypeDef   s_xTxMsg;
-static CanRxMsgTypeDef   s_xRxMsg;
+static CanMsgTx_t        s_xTxQ[CAN_TX_QUEUE]; /* Sorted by prvTxKey, same key in send order */
+static uint8_t           s_ucTxNum = 0;
+static Bool_t            s_bTxBusy[TX_BOX];
+static Bool_t            s_bTxAbort[TX_BOX];
+static uint32_t          s_ulTxKey[TX_BOX];
+static uint32_t          s_ulTxTick[TX_BOX];
+static SemaphoreHandle_t s_xTxSem = NULL;
+static CanMsgRx_t        s_xRxRing[CAN_RX_RING];
+static volatile uint32_t s_ulRxHead = 0; /* Written by the isr only */
+static volatile uint32_t s_ulRxTail = 0; /* Written by the reader only */
+static SemaphoreHandle_t s_xRxSem   = NULL;
+static CanStat_t         s_xStat;
+static volatile Bool_t   s_bBusOff   = FALSE;
+static uint32_t          s_ulMonTick = 0; /* Rate window start */
+static uint32_t          s_ulMonRx   = 0;
+static uint32_t          s_ulMonTx   = 0;
+static uint32_t          s_ulMonBit  = 0;
 
 /* Functions */
 Status_t DrvCanInit(void)
 {
     s_hCan.Instance = CAN1;
-    s_hCan.pRxMsg   = &s_xRxMsg;
-    s_hCan.pTxMsg   = &s_xTxMsg;
 
     s_hCan.Init.Prescaler = 36;
     s_hCan.Init.Mode      = CAN_MODE_NORMAL;
@@ -59,27 +89,23 @@ Status_t DrvCanInit(void)
     s_hCan.Init.BS1       = CAN_BS1_6TQ;
     s_hCan.Init.BS2       = CAN_BS2_1TQ;
     s_hCan.Init.TTCM      = DISABLE;
-    s_hCan.Init.ABOM      = DISABLE;
+    s_hCan.Init.ABOM      = ENABLE;
     s_hCan.Init.AWUM      = DISABLE;
     s_hCan.Init.NART      = DISABLE;
     s_hCan.Init.RFLM      = DISABLE;
     s_hCan.Init.TXFP      = DISABLE;
     HAL_CAN_Init(&s_hCan);
 
-    CAN_FilterConfTypeDef xFilterConfig;
-    xFilterConfig.FilterNumber         = 0;
-    xFilterConfig.FilterMode           = CAN_FILTERMODE_IDMASK;
-    xFilterConfig.FilterScale          = CAN_FILTERSCALE_32BIT;
-    xFilterConfig.FilterIdHigh         = 0x0000;
-    xFilterConfig.FilterIdLow          = 0x0000;
-    xFilterConfig.FilterMaskIdHigh     = 0x0000;
-    xFilterConfig.FilterMaskIdLow      = 0x0000;
-    xFilterConfig.FilterFIFOAssignment = 0;
-    xFilterConfig.FilterActivation     = ENABLE;
-    xFilterConfig.BankNumber           = 14;
-    HAL_CAN_ConfigFilter(&s_hCan, &xFilterConfig);
+    /* Nothing is accepted until the protocols set their filters, see CanSetFilter */
+    s_xRxSem = xSemaphoreCreateBinary();
+    s_xTxSem = xSemaphoreCreateBinary();
+    memset(&s_xStat, 0, sizeof(s_xStat));
 
-    HAL_CAN_Receive_IT(&s_hCan, CAN_FIFO0);
+    /* Frames are taken straight from the fifo mailboxes, see prvRxIsr, and refilled from the tx isr */
+    __HAL_CAN_ENABLE_IT(&s_hCan, CAN_IT_FMP0 | CAN_IT_FMP1 | CAN_IT_TME);
+    /* Bus-off is left by the hardware after 128 x 11 recessive bits, see ABOM */
+    __HAL_CAN_ENABLE_IT(&s_hCan, CAN_IT_BOF | CAN_IT_EPV | CAN_IT_ERR);
+    s_ulMonTick = osKernelSysTick();
 
     return STATUS_OK;
 }
@@ -92,30 +118,154 @@ Status_t DrvCanTerm(void)
 
 Status_t CanSend(IN CanMsgTx_t *pxMsg, uint16_t usWaitMs)
 {
-    s_hCan.pTxMsg->StdId = pxMsg->StdId;
-    s_hCan.pTxMsg->ExtId = pxMsg->ExtId;
-    s_hCan.pTxMsg->RTR   = pxMsg->RTR;
-    s_hCan.pTxMsg->IDE   = pxMsg->IDE;
-    s_hCan.pTxMsg->DLC   = pxMsg->DLC;
-    if (s_hCan.pTxMsg->DLC > 8)
+    uint32_t ulStart = osKernelSysTick();
+    uint32_t ulKey   = prvTxKey(pxMsg);
+
+    while (1)
     {
-        s_hCan.pTxMsg->DLC = 8;
+        taskENTER_CRITICAL();
+        if (s_ucTxNum < CAN_TX_QUEUE)
+        {
+            /* Behind every frame of the same or higher priority */
+            uint8_t q = s_ucTxNum;
+            while ((q > 0) && (prvTxKey(&s_xTxQ[q - 1]) > ulKey))
+            {
+                s_xTxQ[q] = s_xTxQ[q - 1];
+                q--;
+            }
+            s_xTxQ[q] = *pxMsg;
+            if (s_xTxQ[q].DLC > 8)
+            {
+                s_xTxQ[q].DLC = 8;
+            }
+            s_ucTxNum++;
+            prvTxFill();
+            s_xStat.ucTxDepth = s_ucTxNum;
+            if (s_ucTxNum > s_xStat.ucTxDepthMax)
+            {
+                s_xStat.ucTxDepthMax = s_ucTxNum;
+            }
+            taskEXIT_CRITICAL();
+            return STATUS_OK;
+        }
+        prvTxAbortStale();
+        taskEXIT_CRITICAL();
+
+        uint32_t ulUsed = osKernelSysTick() - ulStart;
+        if (ulUsed >= usWaitMs)
+        {
+            s_xStat.ulTxFullCnt++;
+            return STATUS_ERR;
+        }
+        xSemaphoreTake(s_xTxSem, usWaitMs - ulUsed);
     }
-    for (uint8_t n = 0; n < s_hCan.pTxMsg->DLC; n++)
+}
+
+Status_t CanSetFilter(uint8_t ucBank, uint32_t ulExtId, uint32_t ulMask, uint8_t ucFifo)
+{
+    if (ucBank >= CAN_FLT_NUM)
     {
-        s_hCan.pTxMsg->Data[n] = pxMsg->Data[n];
+        return STATUS_ERR;
     }
 
-    return HAL_CAN_Transmit(&s_hCan, usWaitMs);
+    /* 32 bit register layout: EXID[28:0] IDE RTR 0, only extended data frames pass */
+    uint32_t ulId = (ulExtId << 3) | CAN_ID_EXT | CAN_RTR_DATA;
+    uint32_t ulMk = (ulMask << 3) | CAN_ID_EXT | CAN_RTR_REMOTE;
+
+    CAN_FilterConfTypeDef xFilterConfig;
+    xFilterConfig.FilterNumber         = ucBank;
+    xFilterConfig.FilterMode           = CAN_FILTERMODE_IDMASK;
+    xFilterConfig.FilterScale          = CAN_FILTERSCALE_32BIT;
+    xFilterConfig.FilterIdHigh         = (ulId >> 16) & 0xFFFF;
+    xFilterConfig.FilterIdLow          = (ulId >> 0) & 0xFFFF;
+    xFilterConfig.FilterMaskIdHigh     = (ulMk >> 16) & 0xFFFF;
+    xFilterConfig.FilterMaskIdLow      = (ulMk >> 0) & 0xFFFF;
+    xFilterConfig.FilterFIFOAssignment = (ucFifo == CAN_FIFO1) ? CAN_FILTER_FIFO1 : CAN_FILTER_FIFO0;
+    xFilterConfig.FilterActivation     = (ulMask != 0) ? ENABLE : DISABLE;
+    xFilterConfig.BankNumber           = CAN_FLT_NUM;
+    return (HAL_CAN_ConfigFilter(&s_hCan, &xFilterConfig) == HAL_OK) ? STATUS_OK : STATUS_ERR;
 }
 
-Status_t CanRead(OUT CanMsgRx_t *pxMsg, uint16_t usWaitMs)
+Status_t CanRead(OUT CanMsgRx_t *pxMsg, uint32_t ulId, uint32_t ulMask, uint16_t usWaitMs)
 {
-    /* TODO: CanRead not implemented! */
+    uint32_t ulStart = osKernelSysTick();
+
+    while (1)
+    {
+        while (s_ulRxTail != s_ulRxHead)
+        {
+            const CanMsgRx_t *px     = &s_xRxRing[s_ulRxTail & RX_MASK];
+            uint32_t          ulRxId = (px->IDE == CAN_ID_EXT) ? px->ExtId : px->StdId;
+            Bool_t            bMatch = ((ulRxId & ulMask) == (ulId & ulMask)) ? TRUE : FALSE;
+            if (bMatch)
+            {
+                *pxMsg = *px;
+            }
+            else
+            {
+                s_xStat.ulDropCnt++;
+            }
+            /* Slot copied out before it is handed back to the isr */
+            __DMB();
+            s_ulRxTail++;
+            if (bMatch)
+            {
+                return STATUS_OK;
+            }
+        }
+
+        uint32_t ulUsed = osKernelSysTick() - ulStart;
+        if (ulUsed >= usWaitMs)
+        {
+            return STATUS_ERR;
+        }
+        xSemaphoreTake(s_xRxSem, usWaitMs - ulUsed);
+    }
+}
+
+Status_t CanGetStat(CanStat_t *pxStat)
+{
+    taskENTER_CRITICAL();
+    *pxStat = s_xStat;
+    taskEXIT_CRITICAL();
     return STATUS_OK;
 }
 
-__weak void CanRxNotify(uint32_t ulPwr2Addr, CanMsgRx_t *pxMsg) { /* Do nothing */ }
+void CanMonUpdate(void)
+{
+    uint32_t ulEsr = s_hCan.Instance->ESR;
+    uint32_t ulNow = osKernelSysTick();
+    uint32_t ulEl  = ulNow - s_ulMonTick;
+
+    taskENTER_CRITICAL();
+    s_xStat.ucTec    = (ulEsr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos;
+    s_xStat.ucRec    = (ulEsr & CAN_ESR_REC) >> CAN_ESR_REC_Pos;
+    s_xStat.ucLec    = (ulEsr & CAN_ESR_LEC) >> CAN_ESR_LEC_Pos;
+    s_xStat.ucBusOff = (ulEsr & CAN_ESR_BOFF) ? 1 : 0;
+    if (s_bBusOff && !(ulEsr & CAN_ESR_BOFF))
+    {
+        s_bBusOff = FALSE;
+        s_xStat.ulBusOffRecCnt++;
+    }
+    /* Unacknowledged frames block their mailbox even while the queue has room */
+    prvTxAbortStale();
+
+    if (ulEl >= CAN_MON_PRD)
+    {
+        s_xStat.usRxFps = (s_xStat.ulRxCnt - s_ulMonRx) * 1000 / ulEl;
+        s_xStat.usTxFps = (s_xStat.ulTxCnt - s_ulMonTx) * 1000 / ulEl;
+        s_xStat.ucLoad  = (s_xStat.ulBitCnt - s_ulMonBit) * 100 / (CAN_BIT_RATE / 1000 * ulEl);
+        if (s_xStat.ucLoad > s_xStat.ucLoadMax)
+        {
+            s_xStat.ucLoadMax = s_xStat.ucLoad;
+        }
+        s_ulMonTick = ulNow;
+        s_ulMonRx   = s_xStat.ulRxCnt;
+        s_ulMonTx   = s_xStat.ulTxCnt;
+        s_ulMonBit  = s_xStat.ulBitCnt;
+    }
+    taskEXIT_CRITICAL();
+}
 
 void HAL_CAN_MspInit(CAN_HandleTypeDef *pxCan)
 {
@@ -136,6 +286,12 @@ void HAL_CAN_MspInit(CAN_HandleTypeDef *pxCan)
         /* Interrupt init */
         HAL_NVIC_SetPriority(CAN1_RX0_IRQn, 5, 0);
         HAL_NVIC_EnableIRQ(CAN1_RX0_IRQn);
+        HAL_NVIC_SetPriority(CAN1_RX1_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(CAN1_RX1_IRQn);
+        HAL_NVIC_SetPriority(CAN1_TX_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(CAN1_TX_IRQn);
+        HAL_NVIC_SetPriority(CAN1_SCE_IRQn, 5, 0);
+        HAL_NVIC_EnableIRQ(CAN1_SCE_IRQn);
     }
 }
 
@@ -149,23 +305,229 @@ void HAL_CAN_MspDeInit(CAN_HandleTypeDef *pxCan)
         HAL_GPIO_DeInit(GPIOA, GPIO_PIN_11 | GPIO_PIN_12);
         /* Interrupt deinit */
         HAL_NVIC_DisableIRQ(CAN1_RX0_IRQn);
+        HAL_NVIC_DisableIRQ(CAN1_RX1_IRQn);
+        HAL_NVIC_DisableIRQ(CAN1_TX_IRQn);
+        HAL_NVIC_DisableIRQ(CAN1_SCE_IRQn);
     }
 }
 
-void HAL_CAN_RxCpltCallback(CAN_HandleTypeDef *pxCan)
+void CAN1_TX_IRQHandler(void)
 {
-    CanRxNotify(PWR2_M2_ADDR, pxCan->pRxMsg);
-    CanRxNotify(PWR2_M1_ADDR, pxCan->pRxMsg);
-    CanRxNotify(PWR2_M3_ADDR, pxCan->pRxMsg);
-    /* Restart receive */
-#if 0
-    HAL_CAN_Receive_IT(&s_hCan, CAN_FIFO0);
-#else
-    __HAL_CAN_ENABLE_IT(&s_hCan, CAN_IT_FMP0);
-#endif
+    CAN_TypeDef *pxCan                    = s_hCan.Instance;
+    uint32_t     ulTsr                    = pxCan->TSR;
+    BaseType_t   xHigherPriorityTaskWoken = pdFALSE;
+
+    for (uint8_t n = 0; n < TX_BOX; n++)
+    {
+        uint32_t ulRqcp = CAN_TSR_RQCP0 << (8 * n);
+        if (!(ulTsr & ulRqcp))
+        {
+            continue;
+        }
+        if (ulTsr & (CAN_TSR_TXOK0 << (8 * n)))
+        {
+            s_xStat.ulTxCnt++;
+            s_xStat.ulBitCnt += prvFrameBits(pxCan->sTxMailBox[n].TIR, pxCan->sTxMailBox[n].TDTR);
+        }
+        else if (s_bTxAbort[n])
+        {
+            s_xStat.ulTxAbortCnt++;
+        }
+        else
+        {
+            s_xStat.ulTxErrCnt++;
+        }
+        if (ulTsr & (CAN_TSR_ALST0 << (8 * n)))
+        {
+            s_xStat.ulTxArbCnt++;
+        }
+        /* Clears RQCP, TXOK, ALST and TERR of this mailbox */
+        pxCan->TSR    = ulRqcp;
+        s_bTxBusy[n]  = FALSE;
+        s_bTxAbort[n] = FALSE;
+    }
+
+    prvTxFill();
+    s_xStat.ucTxDepth = s_ucTxNum;
+
+    xSemaphoreGiveFromISR(s_xTxSem, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-void CAN1_RX0_IRQHandler(void) { HAL_CAN_IRQHandler(&s_hCan); }
+void CAN1_SCE_IRQHandler(void)
+{
+    CAN_TypeDef *pxCan = s_hCan.Instance;
+    uint32_t     ulEsr = pxCan->ESR;
+
+    if (ulEsr & CAN_ESR_BOFF)
+    {
+        if (!s_bBusOff)
+        {
+            s_bBusOff = TRUE;
+            s_xStat.ulBusOffCnt++;
+            EvtLog(EVT_CAN_BUS_OFF, (ulEsr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos, (ulEsr & CAN_ESR_REC) >> CAN_ESR_REC_Pos, 0, 0);
+        }
+    }
+    else if (ulEsr & CAN_ESR_EPVF)
+    {
+        s_xStat.ulErrPassCnt++;
+        EvtLog(EVT_CAN_ERR_PASSIVE, (ulEsr & CAN_ESR_TEC) >> CAN_ESR_TEC_Pos, (ulEsr & CAN_ESR_REC) >> CAN_ESR_REC_Pos, 0, 0);
+    }
+    pxCan->MSR = CAN_MSR_ERRI;
+}
+
+void CAN1_RX0_IRQHandler(void) { prvRxIsr(CAN_FIFO0); }
+
+void CAN1_RX1_IRQHandler(void) { prvRxIsr(CAN_FIFO1); }
+
+/* Both fifos share one priority, so the ring has a single writer */
+static void prvRxIsr(uint8_t ucFifo)
+{
+    CAN_FIFOMailBox_TypeDef *pxBox                    = &s_hCan.Instance->sFIFOMailBox[ucFifo];
+    BaseType_t               xHigherPriorityTaskWoken = pdFALSE;
+
+    while (__HAL_CAN_MSG_PENDING(&s_hCan, ucFifo) != 0)
+    {
+        uint32_t ulCyc  = TimeCycGet();
+        uint32_t ulHead = s_ulRxHead;
+        s_xStat.ulBitCnt += prvFrameBits(pxBox->RIR, pxBox->RDTR);
+        if ((ulHead - s_ulRxTail) >= CAN_RX_RING)
+        {
+            s_xStat.ulRingOvfCnt++;
+            __HAL_CAN_FIFO_RELEASE(&s_hCan, ucFifo);
+            continue;
+        }
+
+        CanMsgRx_t *px = &s_xRxRing[ulHead & RX_MASK];
+        uint32_t    ul = pxBox->RIR;
+        px->IDE        = ul & CAN_ID_EXT;
+        px->RTR        = ul & CAN_RTR_REMOTE;
+        px->StdId      = (ul >> 21) & 0x7FF;
+        px->ExtId      = (ul >> 3) & 0x1FFFFFFF;
+        ul             = pxBox->RDTR;
+        px->DLC        = ul & 0x0F;
+        px->FMI        = (ul >> 8) & 0xFF;
+        px->FIFONumber = ucFifo;
+        ul             = pxBox->RDLR;
+        px->Data[0]    = ul >> 0;
+        px->Data[1]    = ul >> 8;
+        px->Data[2]    = ul >> 16;
+        px->Data[3]    = ul >> 24;
+        ul             = pxBox->RDHR;
+        px->Data[4]    = ul >> 0;
+        px->Data[5]    = ul >> 8;
+        px->Data[6]    = ul >> 16;
+        px->Data[7]    = ul >> 24;
+        __HAL_CAN_FIFO_RELEASE(&s_hCan, ucFifo);
+
+        /* Slot complete before the reader can see it */
+        __DMB();
+        s_ulRxHead = ulHead + 1;
+        s_xStat.ulRxCnt++;
+
+        ulCyc             = TimeCycToUs(TimeCycGet() - ulCyc);
+        s_xStat.ulIsrLast = ulCyc;
+        if (ulCyc > s_xStat.ulIsrMax)
+        {
+            s_xStat.ulIsrMax = ulCyc;
+        }
+    }
+
+    if (__HAL_CAN_GET_FLAG(&s_hCan, (ucFifo == CAN_FIFO0) ? CAN_FLAG_FOV0 : CAN_FLAG_FOV1))
+    {
+        __HAL_CAN_CLEAR_FLAG(&s_hCan, (ucFifo == CAN_FIFO0) ? CAN_FLAG_FOV0 : CAN_FLAG_FOV1);
+        s_xStat.ulFifoOvfCnt++;
+    }
+
+    xSemaphoreGiveFromISR(s_xRxSem, &xHigherPriorityTaskWoken);
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+/* Called with the tx isr masked or from it */
+static void prvTxFill(void)
+{
+    for (uint8_t b = 0; (b < TX_BOX) && (s_ucTxNum > 0); b++)
+    {
+        if (s_bTxBusy[b])
+        {
+            continue;
+        }
+
+        /* Lowest key first, but one frame per key in the mailboxes, the hardware would reorder equal ids */
+        uint8_t q;
+        for (q = 0; q < s_ucTxNum; q++)
+        {
+            uint32_t ulKey = prvTxKey(&s_xTxQ[q]);
+            Bool_t   bBusy = FALSE;
+            for (uint8_t m = 0; m < TX_BOX; m++)
+            {
+                if (s_bTxBusy[m] && (s_ulTxKey[m] == ulKey))
+                {
+                    bBusy = TRUE;
+                }
+            }
+            if (!bBusy)
+            {
+                break;
+            }
+        }
+        if (q == s_ucTxNum)
+        {
+            return;
+        }
+
+        prvTxLoad(b, &s_xTxQ[q]);
+        s_ucTxNum--;
+        for (; q < s_ucTxNum; q++)
+        {
+            s_xTxQ[q] = s_xTxQ[q + 1];
+        }
+    }
+}
+
+static void prvTxLoad(uint8_t ucBox, const CanMsgTx_t *pxMsg)
+{
+    CAN_TxMailBox_TypeDef *pxBox = &s_hCan.Instance->sTxMailBox[ucBox];
+
+    s_bTxBusy[ucBox]  = TRUE;
+    s_bTxAbort[ucBox] = FALSE;
+    s_ulTxKey[ucBox]  = prvTxKey(pxMsg);
+    s_ulTxTick[ucBox] = osKernelSysTick();
+
+    pxBox->TIR  = (pxMsg->IDE == CAN_ID_EXT) ? ((pxMsg->ExtId << 3) | CAN_ID_EXT) : (pxMsg->StdId << 21);
+    pxBox->TIR |= pxMsg->RTR;
+    pxBox->TDTR = pxMsg->DLC;
+    pxBox->TDLR = ((uint32_t)pxMsg->Data[3] << 24) | ((uint32_t)pxMsg->Data[2] << 16) | ((uint32_t)pxMsg->Data[1] << 8) |
+                  ((uint32_t)pxMsg->Data[0] << 0);
+    pxBox->TDHR = ((uint32_t)pxMsg->Data[7] << 24) | ((uint32_t)pxMsg->Data[6] << 16) | ((uint32_t)pxMsg->Data[5] << 8) |
+                  ((uint32_t)pxMsg->Data[4] << 0);
+    pxBox->TIR |= CAN_TI0R_TXRQ;
+}
+
+/* A frame nobody acknowledges is retried forever, free its mailbox */
+static void prvTxAbortStale(void)
+{
+    for (uint8_t b = 0; b < TX_BOX; b++)
+    {
+        if (s_bTxBusy[b] && !s_bTxAbort[b] && ((osKernelSysTick() - s_ulTxTick[b]) >= CAN_TX_TIMEOUT))
+        {
+            s_bTxAbort[b] = TRUE;
+            s_hCan.Instance->TSR = CAN_TSR_ABRQ0 << (8 * b);
+        }
+    }
+}
+
+/* Arbitration order, a standard id lands on the top 11 bits of an extended one */
+static uint32_t prvTxKey(const CanMsgTx_t *pxMsg)
+{
+    return (pxMsg->IDE == CAN_ID_EXT) ? pxMsg->ExtId : (pxMsg->StdId << 18);
+}
+
+/* Nominal frame length with the interframe space, from the mailbox id and length registers */
+static uint32_t prvFrameBits(uint32_t ulIr, uint32_t ulDtr)
+{
+    return ((ulIr & CAN_ID_EXT) ? 67 : 47) + 8 * (ulDtr & 0x0F);
+}
 
 static uint8_t *prvParseHexStr(const char *pcStr, uint8_t *pucLength)
 {
@@ -271,3 +633,45 @@ static void prvCliCmdCanSend(cli_printf cliprintf, int argc, char **argv)
     return;
 }
 CLI_CMD_EXPORT(can_send, send can data, prvCliCmdCanSend)
+
+static void prvCliCmdCanStat(cli_printf cliprintf, int argc, char **argv)
+{
+    CHECK_CLI();
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "clear")))
+    {
+        taskENTER_CRITICAL();
+        memset(&s_xStat, 0, sizeof(s_xStat));
+        s_bBusOff   = FALSE;
+        s_ulMonTick = osKernelSysTick();
+        s_ulMonRx   = 0;
+        s_ulMonTx   = 0;
+        s_ulMonBit  = 0;
+        taskEXIT_CRITICAL();
+        cliprintf("can statistics cleared\n");
+        return;
+    }
+
+    CanStat_t x;
+    CanGetStat(&x);
+    cliprintf("RX       CNT : %lu\n", (unsigned long)x.ulRxCnt);
+    cliprintf("RING OVF CNT : %lu\n", (unsigned long)x.ulRingOvfCnt);
+    cliprintf("FIFO OVF CNT : %lu\n", (unsigned long)x.ulFifoOvfCnt);
+    cliprintf("DROP     CNT : %lu\n", (unsigned long)x.ulDropCnt);
+    cliprintf("ISR LAST     : %lu us\n", (unsigned long)x.ulIsrLast);
+    cliprintf("ISR MAX      : %lu us\n", (unsigned long)x.ulIsrMax);
+    cliprintf("TX       CNT : %lu\n", (unsigned long)x.ulTxCnt);
+    cliprintf("TX ERR   CNT : %lu\n", (unsigned long)x.ulTxErrCnt);
+    cliprintf("TX ABORT CNT : %lu\n", (unsigned long)x.ulTxAbortCnt);
+    cliprintf("TX ARB   CNT : %lu\n", (unsigned long)x.ulTxArbCnt);
+    cliprintf("TX FULL  CNT : %lu\n", (unsigned long)x.ulTxFullCnt);
+    cliprintf("TX DEPTH     : %d (max %d)\n", x.ucTxDepth, x.ucTxDepthMax);
+    cliprintf("RX FPS       : %d\n", x.usRxFps);
+    cliprintf("TX FPS       : %d\n", x.usTxFps);
+    cliprintf("BUS LOAD     : %d %% (max %d %%)\n", x.ucLoad, x.ucLoadMax);
+    cliprintf("TEC/REC/LEC  : %d/%d/%d\n", x.ucTec, x.ucRec, x.ucLec);
+    cliprintf("BUS OFF      : %d\n", x.ucBusOff);
+    cliprintf("BUS OFF  CNT : %lu (recovered %lu)\n", (unsigned long)x.ulBusOffCnt, (unsigned long)x.ulBusOffRecCnt);
+    cliprintf("ERR PASS CNT : %lu\n", (unsigned long)x.ulErrPassCnt);
+}
+CLI_CMD_EXPORT(can_stat, show can traffic and error statistics, prvCliCmdCanStat)
@@ -10,6 +10,10 @@
     modification history
     --------------------
     01a, 15Nov23, Karl Created
+    01b, 19Oct26, Karl CanRxNotify called once per frame
+    01c, 19Oct26, Karl Added acceptance filters, receive ring and CanRead
+    01d, 19Oct26, Karl Added interrupt driven transmit queue
+    01e, 19Oct26, Karl Added bus load and error counter monitor
 */
 
 #ifndef __CAN_H__
@@ -19,18 +23,63 @@
 extern "C" {
 #endif /* __cplusplus */
 
+/* Defines */
+#define CAN_RX_RING       32 /* Frames, power of 2 */
+#define CAN_TX_QUEUE      16 /* Frames waiting for a mailbox */
+#define CAN_TX_TIMEOUT    50 /* ms in a mailbox before it is aborted */
+#define CAN_BIT_RATE      125000
+#define CAN_MON_PRD       1000 /* ms, frame rate and bus load window */
+/* Filter banks, CAN1 owns 0 ~ 13 */
+#define CAN_FLT_PWR1      0
+#define CAN_FLT_PWR2      1 /* One bank per module, 1 ~ 3 */
+#define CAN_FLT_NUM       14
+
 /* Types */
 typedef CanTxMsgTypeDef CanMsgTx_t;
 typedef CanRxMsgTypeDef CanMsgRx_t;
 
+typedef struct
+{
+    uint32_t ulRxCnt;      /* Frames put in the ring */
+    uint32_t ulRingOvfCnt; /* Frames lost, ring full */
+    uint32_t ulFifoOvfCnt; /* Frames lost, hardware fifo full */
+    uint32_t ulDropCnt;    /* Frames skipped by CanRead id filtering */
+    uint32_t ulIsrLast;    /* Receive isr time per frame (us) */
+    uint32_t ulIsrMax;
+    uint32_t ulTxCnt;      /* Frames sent */
+    uint32_t ulTxErrCnt;   /* Mailboxes completed with a transmit error */
+    uint32_t ulTxAbortCnt; /* Mailboxes aborted after CAN_TX_TIMEOUT */
+    uint32_t ulTxArbCnt;   /* Completions reporting arbitration lost */
+    uint32_t ulTxFullCnt;  /* CanSend failed, queue full */
+    uint8_t  ucTxDepth;    /* Frames in the queue */
+    uint8_t  ucTxDepthMax;
+    uint32_t ulBitCnt;     /* Bits of the frames sent and received, stuffing not counted */
+    uint32_t ulBusOffCnt;  /* Bus-off entries */
+    uint32_t ulBusOffRecCnt; /* Automatic recoveries seen by CanMonUpdate */
+    uint32_t ulErrPassCnt; /* Error passive entries */
+    uint16_t usRxFps;      /* Over the last CAN_MON_PRD */
+    uint16_t usTxFps;
+    uint8_t  ucLoad;       /* Bus load (%) */
+    uint8_t  ucLoadMax;
+    uint8_t  ucTec;        /* Error counters and last error code, sampled by CanMonUpdate */
+    uint8_t  ucRec;
+    uint8_t  ucLec;
+    uint8_t  ucBusOff;
+} CanStat_t;
+
 /* Functions */
 Status_t DrvCanInit(void);
 Status_t DrvCanTerm(void);
 
+/* Queued by identifier priority, usWaitMs is the wait for queue space */
 Status_t CanSend(IN CanMsgTx_t *pxMsg, uint16_t usWaitMs);
-Status_t CanRead(OUT CanMsgRx_t *pxMsg, uint16_t usWaitMs);
-
-void     CanRxNotify(uint32_t ulPwr2Addr, CanMsgRx_t *pxMsg);
+/* Extended id filter into FIFO0/FIFO1, ulMask 0 disables the bank */
+Status_t CanSetFilter(uint8_t ucBank, uint32_t ulExtId, uint32_t ulMask, uint8_t ucFifo);
+/* One reader at a time, frames not matching (id & ulMask) are dropped */
+Status_t CanRead(OUT CanMsgRx_t *pxMsg, uint32_t ulId, uint32_t ulMask, uint16_t usWaitMs);
+Status_t CanGetStat(CanStat_t *pxStat);
+/* Samples the error counters, aborts stale mailboxes and closes the rate window, call it periodically */
+void     CanMonUpdate(void);
 
 #ifdef __cplusplus
 }
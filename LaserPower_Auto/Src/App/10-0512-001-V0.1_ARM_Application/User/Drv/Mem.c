@@ -11,6 +11,11 @@
     --------------------
     01a, 17Nov23, Karl Created
     01b, 27Nov23, Karl Added MemFlashRead and MemFlashWrite
+    01c, 19Oct26, Karl Added MemFlashProgram and MemFlashErase
+    01d, 19Oct26, Karl Added mem_bench
+    01e, 19Oct26, Karl Added mem_stat
+    01f, 19Oct26, agent CLI prints the erase and program counts with %lu
+    01g, 19Oct26, agent mem_bench prints its figures with %lu
 */
 
 /* Includes */
@@ -72,6 +77,20 @@ Status_t MemFlashWrite(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData)
     return MemEraseWrite(s_xMem, ulAddr, ulLength, pucData);
 }
 
+Status_t MemFlashProgram(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData)
+{
+    return MemWrite(s_xMem, ulAddr, ulLength, pucData);
+}
+
+Status_t MemFlashErase(uint32_t ulAddr, uint32_t ulLength)
+{
+    MemSpiFlashErase_t xErase;
+    
+    xErase.ulAddr = ulAddr;
+    xErase.ulLength = ulLength;
+    return MemCtrl(s_xMem, MEM_CTRL_OP_SPIFLASH_ERASE, (uint32_t)(&xErase));
+}
+
 static uint8_t* prvParseHexStr(const char* pcStr, uint8_t *pucLength)
 {
     static uint8_t ucBuffer[80];
@@ -163,6 +182,20 @@ static void prvCliCmdMemWrite(cli_printf cliprintf, int argc, char** argv)
 }
 CLI_CMD_EXPORT(mem_write, write to fram, prvCliCmdMemWrite)
 
+static void prvCliCmdMemStat(cli_printf cliprintf, int argc, char** argv)
+{
+    MemSpiFlashStat_t xStat;
+    
+    CHECK_CLI();
+    
+    MemCtrl(s_xMem, MEM_CTRL_OP_SPIFLASH_STAT, (uint32_t)(&xStat));
+    cliprintf("SECTOR ERASED  : %lu\n", (unsigned long)xStat.ulEraseCnt);
+    cliprintf("ERASE AVOIDED  : %lu\n", (unsigned long)xStat.ulEraseSkipCnt);
+    cliprintf("BYTE PROGRAMMED: %lu\n", (unsigned long)xStat.ulProgBytes);
+    cliprintf("BYTE UNCHANGED : %lu\n", (unsigned long)xStat.ulSkipBytes);
+}
+CLI_CMD_EXPORT(mem_stat, show spi flash erase and program counts, prvCliCmdMemStat)
+
 
 #if MEM_TEST
 static void prvCliCmdMemTest(cli_printf cliprintf, int argc, char** argv)
@@ -346,3 +379,67 @@ static void prvCliCmdMemTest(cli_printf cliprintf, int argc, char** argv)
 }
 CLI_CMD_EXPORT(mem_test, memory flash test, prvCliCmdMemTest)
 #endif /* MEM_TEST */
+
+#if MEM_TEST && MEM_SPIFLASH_DMA
+#define MEM_BENCH_ADDR  (1024*768)  /* Unused, between the event log and the historian */
+#define MEM_BENCH_SIZE  (64*1024)
+#define MEM_BENCH_BUF   (4096)
+
+static uint32_t prvBlockCyc(void)
+{
+    uint32_t ulCyc = 0;
+    MemCtrl(s_xMem, MEM_CTRL_OP_SPIFLASH_BLOCK_CYC, (uint32_t)(&ulCyc));
+    return ulCyc;
+}
+
+/* CPU time is the elapsed time less the time blocked in the driver, run it on an idle system */
+static void prvCliCmdMemBench(cli_printf cliprintf, int argc, char** argv)
+{
+    static uint8_t ucData[MEM_BENCH_BUF];
+    static const char *pcOp[] = {"erase", "write", "read"};
+    uint32_t ulCyc, ulBlock, ulUs, ulErrCnt;
+    
+    CHECK_CLI();
+    
+    cliprintf("%-8s%-8s%10s%12s\n", "MODE", "OP", "KB/s", "CPU us/KB");
+    for (uint32_t ulDma = 0; ulDma < 2; ulDma++) {
+        MemCtrl(s_xMem, MEM_CTRL_OP_SPIFLASH_DMA, ulDma);
+        for (uint32_t ulOp = 0; ulOp < 3; ulOp++) {
+            for (uint32_t n = 0; n < MEM_BENCH_BUF; n++) {
+                ucData[n] = (1 == ulOp) ? n : 0;
+            }
+            ulBlock = prvBlockCyc();
+            ulCyc   = TimeCycGet();
+            for (uint32_t ulOff = 0; ulOff < MEM_BENCH_SIZE; ulOff += MEM_BENCH_BUF) {
+                if (0 == ulOp) {
+                    MemFlashErase(MEM_BENCH_ADDR + ulOff, MEM_BENCH_BUF);
+                }
+                else if (1 == ulOp) {
+                    MemFlashProgram(MEM_BENCH_ADDR + ulOff, MEM_BENCH_BUF, ucData);
+                }
+                else {
+                    MemFlashRead(MEM_BENCH_ADDR + ulOff, MEM_BENCH_BUF, ucData);
+                }
+            }
+            ulCyc   = TimeCycGet() - ulCyc;
+            ulBlock = prvBlockCyc() - ulBlock;
+            ulUs    = TimeCycToUs(ulCyc);
+            cliprintf("%-8s%-8s%10lu%12lu\n", ulDma ? "dma" : "polled", pcOp[ulOp],
+                      (unsigned long)((MEM_BENCH_SIZE / 1024) * 1000000 / (ulUs ? ulUs : 1)),
+                      (unsigned long)(TimeCycToUs(ulCyc - ulBlock) / (MEM_BENCH_SIZE / 1024)));
+        }
+        /* The last block read back */
+        ulErrCnt = 0;
+        for (uint32_t n = 0; n < MEM_BENCH_BUF; n++) {
+            if (ucData[n] != (n & 0xFF)) {
+                ulErrCnt++;
+            }
+        }
+        if (ulErrCnt) {
+            cliprintf("%s read back %lu bytes wrong\n", ulDma ? "dma" : "polled", (unsigned long)ulErrCnt);
+        }
+    }
+    MemCtrl(s_xMem, MEM_CTRL_OP_SPIFLASH_DMA, TRUE);
+}
+CLI_CMD_EXPORT(mem_bench, spi flash polled and dma throughput, prvCliCmdMemBench)
+#endif /* MEM_TEST && MEM_SPIFLASH_DMA */
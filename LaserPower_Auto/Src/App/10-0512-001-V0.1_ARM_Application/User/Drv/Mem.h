@@ -11,6 +11,7 @@
     --------------------
     01a, 17Nov23, Karl Created
     01b, 27Nov23, Karl Added MemFlashRead and MemFlashWrite
+    01c, 19Oct26, Karl Added MemFlashProgram and MemFlashErase
 */
 
 #ifndef ___MEM_H__
@@ -36,6 +37,9 @@ Status_t DrvMemTerm(void);
 
 Status_t MemFlashRead(uint32_t ulAddr, uint32_t ulLength, OUT uint8_t *pucData);
 Status_t MemFlashWrite(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData);
+/* Program only, the range must be erased */
+Status_t MemFlashProgram(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData);
+Status_t MemFlashErase(uint32_t ulAddr, uint32_t ulLength);
 
 #ifdef __cplusplus
 }
@@ -20,6 +20,10 @@
     01i, 08Jan24, Karl Added th_AdVolPara in ADC_TO_VOL definition
     01j, 17Jan24, Karl Added PwrSetVolDef
     01k, 20Jan24, Karl Added PWR_STATUS
+    01l, 19Oct26, Karl Responses dispatched to PwrTrans, added PWR_UPDATE_PRD
+    01m, 19Oct26, Karl Removed CanRxNotify, PwrTrans reads the can receive ring
+    01n, 19Oct26, Karl PwrDataGet passes any module address to Pwr2DataGet
+    01o, 19Oct26, Karl Samples the can monitor every refresh
 */
 
 /* Includes */
@@ -41,6 +45,9 @@
     #define ASSERT(...)
 #endif /* PWR_DEBUG */
 
+/* Local defines */
+#define PWR_UPDATE_PRD  200     /* ms */
+
 /* Forward declarations */
 static void prvPwrTask(void* pvPara);
 
@@ -122,13 +129,7 @@ int32_t PwrDataGet(uint32_t ulPwr2Addr, PwrDataType_t xType)
 
 #if PWR2_ENABLE
     if (s_bEnPwr2) {
-        switch (ulPwr2Addr)
-        {
-            case PWR2_M2_ADDR: return Pwr2DataGet(PWR2_M2_ADDR, xType); break;
-            case PWR2_M1_ADDR: return Pwr2DataGet(PWR2_M1_ADDR, xType); break;
-            case PWR2_M3_ADDR: return Pwr2DataGet(PWR2_M3_ADDR, xType); break;
-        }
-        
+        return Pwr2DataGet(ulPwr2Addr, xType);
     }
 #endif /* PWR2_ENABLE */
     
@@ -155,6 +156,8 @@ Status_t PwrSetVolDef(float fV)
 static void prvPwrTask(void* pvPara)
 {
     while (1) {
+        uint32_t ulStart = osKernelSysTick();
+        
     #if PWR1_ENABLE
         if (s_bEnPwr1) {
             Pwr1Update();
@@ -167,30 +170,12 @@ static void prvPwrTask(void* pvPara)
         }
     #endif /* PWR2_ENABLE */
     
-        osDelay(1000);
-    }
-}
-
-/* Overwrite CanRxNotify function in 'Drv\Can.h/c' */
-void CanRxNotify(uint32_t ulPwr2Addr, CanMsgRx_t *pxMsg)
-{
-#if PWR1_ENABLE
-    if (s_bEnPwr1) {
-        Pwr1CanRxNotify(pxMsg);
-    }
-#endif /* PWR1_ENABLE */
-
-#if PWR2_ENABLE
-    if (s_bEnPwr2) {
-        switch (ulPwr2Addr)
-        {
-            case PWR2_M2_ADDR: Pwr2CanRxNotify(PWR2_M2_ADDR, pxMsg);break;
-            case PWR2_M1_ADDR: Pwr2CanRxNotify(PWR2_M1_ADDR, pxMsg);break;
-            case PWR2_M3_ADDR: Pwr2CanRxNotify(PWR2_M3_ADDR, pxMsg);break;
-        }
-        
+        CanMonUpdate();
+    
+        /* Keep the refresh period, always give up the cpu at least one tick */
+        uint32_t ulUsed = osKernelSysTick() - ulStart;
+        osDelay((ulUsed < PWR_UPDATE_PRD) ? (PWR_UPDATE_PRD - ulUsed) : 1);
     }
-#endif /* PWR2_ENABLE */
 }
 
 static void prvCliCmdPwrMEnable(cli_printf cliprintf, int argc, char** argv)
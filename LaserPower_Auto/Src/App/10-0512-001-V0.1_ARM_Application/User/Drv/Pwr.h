@@ -20,6 +20,7 @@
     01i, 08Jan24, Karl Added th_AdVolPara in ADC_TO_VOL definition
     01j, 17Jan24, Karl Added PwrSetVolDef
     01k, 20Jan24, Karl Added PWR_STATUS
+    01l, 19Oct26, Karl Added PWR_DATA_NUM
 */
 
 #ifndef __POWER1_H__
@@ -95,6 +96,7 @@ typedef enum {
     PWR_INPUT_VOL,
     PWR_OUTPUT_CUR,
     PWR_STATUS,
+    PWR_DATA_NUM,
 } PwrDataType_t;
 
 /* Functions */
@@ -16,6 +16,9 @@
     01e, 27Dec23, Karl Added Pwr1DataGet
     01f, 17Jan24, Karl Added Pwr1SetVolDef
     01g, 20Jan24, Karl Added PWR_STATUS
+    01h, 19Oct26, Karl Pipelined value polling over PwrTrans
+    01i, 19Oct26, Karl Added can acceptance filter
+    01j, 19Oct26, Karl Polled values and Pwr1DataGet taken from registry tables
 */
 
 /* Includes */
@@ -48,7 +51,9 @@
 #define SEND_DELAY              5
 #define BYTE_ENDIAN_UINT16(a)   (((a) & 0xFF) << 8) | (((a) & 0xFF00) >> 8)
 #define BYTE_ENDIAN_UINT32(a)   (((a) & 0xFF) << 24) | (((a) & 0xFF00) << 8) | (((a) & 0xFF0000) >> 8) | (((a) & 0xFF000000) >> 24)
-#define WAIT_MS                 50
+#define WAIT_MS                 50      /* Per request */
+#define PWR_DEV                 0       /* PwrTrans statistics slot */
+#define VALUE_NUM               20
 
 /* Local types */
 #pragma pack(push)
@@ -77,19 +82,48 @@ typedef struct {
 }_Data_t;
 #pragma pack(pop)
 
+/* Value type polled every ucPrd refreshes */
+typedef struct {
+    uint16_t usValueType;
+    uint8_t  ucPrd;
+}Reg_t;
+
+/* Value of Pwr1DataGet, usValueType 0 if the module has none */
+typedef struct {
+    uint16_t usValueType;
+    bool     bFloat;
+    uint8_t  ucMul;
+}Val_t;
+
 /* Forward declarations */
-static Status_t prvProcRequestByteDataResp(_Data_t xData);
-static Status_t prvProcConfigByteDataResp(_Data_t xData);
+static void     prvProcRequestByteDataResp(uint8_t ucDev, const uint8_t *pucData, uint8_t ucDlc);
+static Status_t prvConfig(uint16_t usValueType, uint32_t ulValue);
 static Status_t prvSetVol(float fV);
 static Status_t prvSetVolDef(float fV);
 static Status_t prvSetOnOff(uint8_t ucOnOff);
-static Status_t prvGetData(uint16_t usValueType);
+static void     prvTransInit(PwrTrans_t *pxTrans, uint8_t ucMsgType, uint16_t usValueType, uint32_t ulValue);
 
 /* Local variables */
 static bool          s_bInit = false;
 static float         s_fData[65];
 static uint32_t      s_ulData[65];
-static QueueHandle_t s_xQueue = NULL;
+static PwrTrans_t    s_xTrans[VALUE_NUM];
+static PwrTrans_t    s_xBatch[VALUE_NUM];   /* Those due this refresh */
+static uint32_t      s_ulRefresh = 0;
+/* Measurements every refresh, limits and ratings every 5 */
+static const Reg_t   s_xReg[VALUE_NUM] = {
+    {0x0001, 1}, {0x0002, 1}, {0x0003, 5}, {0x0004, 1}, {0x0005, 1},
+    {0x0006, 5}, {0x0007, 1}, {0x0008, 1}, {0x0009, 5}, {0x000A, 1},
+    {0x000C, 1}, {0x000D, 1}, {0x000E, 1}, {0x000F, 5}, {0x0010, 1},
+    {0x0011, 5}, {0x0012, 5}, {0x0013, 5}, {0x0014, 5}, {0x0040, 1},
+};
+/* Indexed by PwrDataType_t */
+static const Val_t   s_xVal[PWR_DATA_NUM] = {
+    {0x0001, true,  10},    /* PWR_OUTPUT_VOL, 0.1V */
+    {0x0000, false, 0 },    /* PWR_INPUT_VOL */
+    {0x0000, false, 0 },    /* PWR_OUTPUT_CUR */
+    {0x0040, false, 1 },    /* PWR_STATUS */
+};
 static uint32_t      s_ulTxCnt = 0;
 static uint32_t      s_ulRxCnt = 0;
 static uint32_t      s_ulErrCnt = 0;
@@ -100,7 +134,22 @@ Status_t Pwr1ProtInit(void)
     if (!s_bInit) {
         memset(s_fData, 0, sizeof(s_fData));
         memset(s_ulData, 0, sizeof(s_ulData));
-        s_xQueue = xQueueCreate(1/*Queue length*/, 1/*Queue item size*/);
+        PwrTransInit();
+        
+        /* Protocol 0x60 frames to the monitor */
+        Id_t xId, xMask;
+        xId.All           = 0;
+        xId.Bit.DstAddr   = MONITOR_ADDR;
+        xId.Bit.Fix2      = 0x60;
+        xMask.All         = 0;
+        xMask.Bit.DstAddr = 0xFF;
+        xMask.Bit.Fix2    = 0x1FF;
+        CanSetFilter(CAN_FLT_PWR1, xId.All, xMask.All, CAN_FIFO1);
+        
+        for (uint8_t n = 0; n < VALUE_NUM; n++) {
+            prvTransInit(&s_xTrans[n], 0x01, s_xReg[n].usValueType, 0);
+            s_xTrans[n].pfnDone = prvProcRequestByteDataResp;
+        }
         s_bInit = true;
     }
     return STATUS_OK;
@@ -114,80 +163,24 @@ Status_t Pwr1ProtTerm(void)
 
 Status_t Pwr1Update(void)
 {
-    prvGetData(0x0001);
-    prvGetData(0x0002);
-    prvGetData(0x0003);
-    prvGetData(0x0004);
-    prvGetData(0x0005);
-    prvGetData(0x0006);
-    prvGetData(0x0007);
-    prvGetData(0x0008);
-    prvGetData(0x0009);
-    prvGetData(0x000A);
-    prvGetData(0x000C);
-    prvGetData(0x000D);
-    prvGetData(0x000E);
-    prvGetData(0x000F);
-    prvGetData(0x0010);
-    prvGetData(0x0011);
-    prvGetData(0x0012);
-    prvGetData(0x0013);
-    prvGetData(0x0014);
-    prvGetData(0x0040);
-    return STATUS_OK;
-}
-
-void Pwr1CanRxNotify(CanMsgRx_t *pxMsg)
-{
-#if 0
-    TRACE("RX: 0x%08X - %02X %02X %02X %02X %02X %02X %02X %02X\n", pxMsg->ExtId, \
-                                                                    pxMsg->Data[0], pxMsg->Data[1], pxMsg->Data[2], pxMsg->Data[3], \
-                                                                    pxMsg->Data[4], pxMsg->Data[5], pxMsg->Data[6], pxMsg->Data[7]);
-#endif
-    
-    s_ulRxCnt++;
-    
-    if (pxMsg->IDE != CAN_ID_EXT) {
-        return;
-    }
-    
-    if (pxMsg->DLC != 8) {
-        return;
-    }
-    
-    _Data_t xData;
-    memcpy(&xData, pxMsg->Data, 8);
+    uint32_t ulDone = 0;
+    uint32_t ulNum  = 0;
     
-    if (xData.Err) {
-        /* Wrong frame format */
-        return;
+    /* Values not due keep their last reading */
+    for (uint8_t n = 0; n < VALUE_NUM; n++) {
+        if ((s_ulRefresh % s_xReg[n].ucPrd) == 0) {
+            s_xBatch[ulNum++] = s_xTrans[n];
+        }
     }
+    s_ulRefresh++;
     
-    if (xData.ErrType != 0xF0) {
-        /* 0xF0: Ok; 0xF1: Wrong address; 0xF2: Invalid command; */
-        return;
+    PwrTransRun(s_xBatch, ulNum, WAIT_MS, &ulDone);
+    for (uint8_t n = 0; n < ulNum; n++) {
+        (ulDone & (1UL << n)) ? s_ulRxCnt++ : s_ulErrCnt++;
     }
+    s_ulTxCnt += ulNum;
     
-    uint8_t m = xData.MsgType;
-    BaseType_t xHigherPriorityTaskWoken;
-    switch (xData.MsgType) {
-    case 0x41:  /* Request byte data response */
-        prvProcRequestByteDataResp(xData);
-        xQueueSendToBackFromISR(s_xQueue, &m, &xHigherPriorityTaskWoken);
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-        break;
-    case 0x42:  /* Request bit data response */
-        /* Do nothing */
-        break;
-    case 0x43:  /* Config byte data response */
-        prvProcConfigByteDataResp(xData);
-        xQueueSendToBackFromISR(s_xQueue, &m, &xHigherPriorityTaskWoken);
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-        break;
-    default:
-        /* Do nothing */
-        break;
-    }
+    return (ulDone == ((1UL << ulNum) - 1)) ? STATUS_OK : STATUS_ERR;
 }
 
 Status_t Pwr1Output(uint8_t ucOnOff)
@@ -197,21 +190,15 @@ Status_t Pwr1Output(uint8_t ucOnOff)
 
 int32_t Pwr1DataGet(PwrDataType_t xType)
 {
-    int32_t r = 0;
-    
-    switch (xType) {
-    case PWR_OUTPUT_VOL:
-        r = (int32_t)(s_fData[1] * 10); /* 0.1V */
-        break;
-    case PWR_STATUS:
-        r = s_ulData[0x0040];
-        break;
-    default:
-        r = 0;
-        break;
+    if ((xType >= PWR_DATA_NUM) || (s_xVal[xType].usValueType == 0)) {
+        return 0;
     }
     
-    return r;
+    const Val_t *px = &s_xVal[xType];
+    if (px->bFloat) {
+        return (int32_t)(s_fData[px->usValueType] * px->ucMul);
+    }
+    return (int32_t)(s_ulData[px->usValueType] * px->ucMul);
 }
 
 Status_t Pwr1SetVolDef(float fV)
@@ -219,8 +206,15 @@ Status_t Pwr1SetVolDef(float fV)
     return prvSetVolDef(fV);
 }
 
-static Status_t prvProcRequestByteDataResp(_Data_t xData)
+static void prvProcRequestByteDataResp(uint8_t ucDev, const uint8_t *pucData, uint8_t ucDlc)
 {
+    _Data_t xData;
+    
+    if (ucDlc != 8) {
+        return;
+    }
+    memcpy(&xData, pucData, 8);
+    
     uint32_t ulValue = BYTE_ENDIAN_UINT32(xData.Value);
     uint16_t usValueType = BYTE_ENDIAN_UINT16(xData.ValueType);
     switch (usValueType) {
@@ -251,144 +245,54 @@ static Status_t prvProcRequestByteDataResp(_Data_t xData)
         /* Do nothing */
         break;
     }
-    
-    return STATUS_OK;
 }
 
-static Status_t prvProcConfigByteDataResp(_Data_t xData)
+/* Config byte data, acknowledged by a 0x43 response of the same value type */
+static Status_t prvConfig(uint16_t usValueType, uint32_t ulValue)
 {
-    /* XXX: Do nothing */
-    return STATUS_OK;
+    PwrTrans_t xTrans;
+    uint32_t   ulDone = 0;
+    
+    prvTransInit(&xTrans, 0x03, usValueType, ulValue);
+    xTrans.ucKeyLen = 2;    /* MsgType and ok only, as before */
+    PwrTransRun(&xTrans, 1, WAIT_MS, &ulDone);
+    s_ulTxCnt++;
+    
+    if (ulDone) {
+        s_ulRxCnt++;
+        return STATUS_OK;
+    }
+    s_ulErrCnt++;
+    return STATUS_ERR;
 }
 
 static Status_t prvSetVol(float fV)
 {
-    Id_t xId;
-    xId.Bit.Fix1    = 3;
-    xId.Bit.Cnt     = 0;
-    xId.Bit.SrcAddr = MONITOR_ADDR;
-    xId.Bit.DstAddr = PWR_ADDR;
-    xId.Bit.Ptp     = 1;
-    xId.Bit.Fix2    = 0x60;
-    xId.Bit.Fix3    = 0;
-    
     uint32_t ulTmp;
     memcpy(&ulTmp, &fV, sizeof(ulTmp));
     ulTmp = BYTE_ENDIAN_UINT32(ulTmp);
     
-    _Data_t xData;
-    xData.Err       = 0;
-    xData.MsgType   = 0x03;
-    xData.ErrType   = 0;
-    xData.ValueType = BYTE_ENDIAN_UINT16(0x0021);
-    xData.Value     = ulTmp;
-    
-    CanMsgTx_t xMsg;
-    xMsg.StdId = xId.All;
-    xMsg.ExtId = xId.All;
-    xMsg.IDE   = CAN_ID_EXT;
-    xMsg.RTR   = CAN_RTR_DATA;
-    xMsg.DLC   = 8;
-    memcpy(xMsg.Data, &xData, sizeof(xData));
-    CanSend(&xMsg, SEND_DELAY);
-    s_ulTxCnt++;
-    
-    uint8_t r;
-    if(xQueueReceive(s_xQueue, &r, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (0x43 == r) {
-            return STATUS_OK;
-        }
-    }
-    s_ulErrCnt++;
-    return STATUS_ERR;
+    return prvConfig(0x0021, ulTmp);
 }
 
 static Status_t prvSetVolDef(float fV)
 {
-    Id_t xId;
-    xId.Bit.Fix1    = 3;
-    xId.Bit.Cnt     = 0;
-    xId.Bit.SrcAddr = MONITOR_ADDR;
-    xId.Bit.DstAddr = PWR_ADDR;
-    xId.Bit.Ptp     = 1;
-    xId.Bit.Fix2    = 0x60;
-    xId.Bit.Fix3    = 0;
-    
     uint32_t ulTmp;
     memcpy(&ulTmp, &fV, sizeof(ulTmp));
     ulTmp = BYTE_ENDIAN_UINT32(ulTmp);
     
-    _Data_t xData;
-    xData.Err       = 0;
-    xData.MsgType   = 0x03;
-    xData.ErrType   = 0;
-    xData.ValueType = BYTE_ENDIAN_UINT16(0x0024);
-    xData.Value     = ulTmp;
-    
-    CanMsgTx_t xMsg;
-    xMsg.StdId = xId.All;
-    xMsg.ExtId = xId.All;
-    xMsg.IDE   = CAN_ID_EXT;
-    xMsg.RTR   = CAN_RTR_DATA;
-    xMsg.DLC   = 8;
-    memcpy(xMsg.Data, &xData, sizeof(xData));
-    CanSend(&xMsg, SEND_DELAY);
-    s_ulTxCnt++;
-    
-    uint8_t r;
-    if(xQueueReceive(s_xQueue, &r, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (0x43 == r) {
-            return STATUS_OK;
-        }
-    }
-    
-    s_ulErrCnt++;
-    return STATUS_ERR;
+    return prvConfig(0x0024, ulTmp);
 }
 
 static Status_t prvSetOnOff(uint8_t ucOnOff)
 {
-    Id_t xId;
-    xId.Bit.Fix1    = 3;
-    xId.Bit.Cnt     = 0;
-    xId.Bit.SrcAddr = MONITOR_ADDR;
-    xId.Bit.DstAddr = PWR_ADDR;
-    xId.Bit.Ptp     = 1;
-    xId.Bit.Fix2    = 0x60;
-    xId.Bit.Fix3    = 0;
-    
     uint32_t ulTmp;
     ulTmp = ucOnOff;    /* TODO: Check me carefully! */
     
-    _Data_t xData;
-    xData.Err       = 0;
-    xData.MsgType   = 0x03;
-    xData.ErrType   = 0;
-    xData.ValueType = BYTE_ENDIAN_UINT16(0x0030);
-    xData.Value     = ulTmp;
-    
-    CanMsgTx_t xMsg;
-    xMsg.StdId = xId.All;
-    xMsg.ExtId = xId.All;
-    xMsg.IDE   = CAN_ID_EXT;
-    xMsg.RTR   = CAN_RTR_DATA;
-    xMsg.DLC   = 8;
-    memcpy(xMsg.Data, &xData, sizeof(xData));
-    CanSend(&xMsg, SEND_DELAY);
-    s_ulTxCnt++;
-    
-    uint8_t r;
-    if(xQueueReceive(s_xQueue, &r, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (0x43 == r) {
-            return STATUS_OK;
-        }
-    }
-    
-    s_ulErrCnt++;
-    return STATUS_ERR;
+    return prvConfig(0x0030, ulTmp);
 }
 
-static Status_t prvGetData(uint16_t usValueType)
+static void prvTransInit(PwrTrans_t *pxTrans, uint8_t ucMsgType, uint16_t usValueType, uint32_t ulValue)
 {
     Id_t xId;
     xId.Bit.Fix1    = 3;
@@ -401,36 +305,28 @@ static Status_t prvGetData(uint16_t usValueType)
     
     _Data_t xData;
     xData.Err       = 0;
-    xData.MsgType   = 0x01;
+    xData.MsgType   = ucMsgType;
     xData.ErrType   = 0;
     xData.ValueType = BYTE_ENDIAN_UINT16(usValueType);
-    xData.Value     = 0;
-    
-    CanMsgTx_t xMsg;
-    xMsg.StdId = xId.All;
-    xMsg.ExtId = xId.All;
-    xMsg.IDE   = CAN_ID_EXT;
-    xMsg.RTR   = CAN_RTR_DATA;
-    xMsg.DLC   = 8;
-    memcpy(xMsg.Data, &xData, sizeof(xData));
-    CanSend(&xMsg, SEND_DELAY);
-    s_ulTxCnt++;
-
-#if 0
-    TRACE("TX: 0x%08X - %02X %02X %02X %02X %02X %02X %02X %02X\n", xMsg.ExtId, \
-                                                                    xMsg.Data[0], xMsg.Data[1], xMsg.Data[2], xMsg.Data[3], \
-                                                                    xMsg.Data[4], xMsg.Data[5], xMsg.Data[6], xMsg.Data[7]);
-#endif
-
-    uint8_t r;
-    if(xQueueReceive(s_xQueue, &r, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (0x41 == r) {
-            return STATUS_OK;
-        }
-    }
-    
-    s_ulErrCnt++;
-    return STATUS_ERR;
+    xData.Value     = ulValue;
+    
+    memset(pxTrans, 0, sizeof(*pxTrans));
+    pxTrans->xReq.StdId = xId.All;
+    pxTrans->xReq.ExtId = xId.All;
+    pxTrans->xReq.IDE   = CAN_ID_EXT;
+    pxTrans->xReq.RTR   = CAN_RTR_DATA;
+    pxTrans->xReq.DLC   = 8;
+    memcpy(pxTrans->xReq.Data, &xData, sizeof(xData));
+    
+    /* Any source id, the response is told apart by its data: MsgType, 0xF0 (ok), ValueType */
+    pxTrans->ulRspId   = 0;
+    pxTrans->ulRspMask = 0;
+    pxTrans->ucKey[0]  = ucMsgType | 0x40;
+    pxTrans->ucKey[1]  = 0xF0;
+    pxTrans->ucKey[2]  = (usValueType >> 8) & 0xFF;
+    pxTrans->ucKey[3]  = (usValueType >> 0) & 0xFF;
+    pxTrans->ucKeyLen  = 4;
+    pxTrans->ucDev     = PWR_DEV;
 }
 
 static void prvCliCmdPwr1SetVol(cli_printf cliprintf, int argc, char** argv)
@@ -16,6 +16,7 @@
     01e, 27Dec23, Karl Added Pwr1DataGet
     01f, 17Jan24, Karl Added Pwr1SetVolDef
     01g, 20Jan24, Karl Added PWR_STATUS
+    01h, 19Oct26, Karl Removed Pwr1CanRxNotify, responses go through PwrTrans
 */
 
 #ifndef __PWR1_PROT_H__
@@ -30,7 +31,6 @@ Status_t Pwr1ProtInit(void);
 Status_t Pwr1ProtTerm(void);
 
 Status_t Pwr1Update(void);
-void     Pwr1CanRxNotify(CanMsgRx_t *pxMsg);
 
 Status_t Pwr1Output(uint8_t ucOnOff);
 
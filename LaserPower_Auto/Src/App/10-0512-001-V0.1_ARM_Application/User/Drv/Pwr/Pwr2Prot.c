@@ -16,12 +16,15 @@
     01e, 17Jan24, Karl Added Pwr2SetVolDef
     01f, 20Jan24, Karl Added PWR_STATUS
     01g, 27Jun24, Jasper Added Three-machine parallel operation.
+    01h, 19Oct26, Karl Pipelined module polling over PwrTrans
+    01i, 19Oct26, Karl Published data as a double buffered snapshot, readers never block
+    01j, 19Oct26, Karl Added per module can acceptance filters
+    01k, 19Oct26, Karl Modules, registers and values taken from registry tables
 */
 
 /* Includes */
 #include "Include.h"
 
-#define PWR2_RTOS 1
 /* Pragmas */
 #pragma diag_suppress 177   /* warning: #177-D: function "FUNC" was set but never used */
 
@@ -41,21 +44,6 @@
     #define ASSERT(...)
 #endif /* PWR_DEBUG */
 
-#if PWR2_RTOS
-static osMutexId s_xPwr2Mutex;
-#define PWR2_MUTEX_INIT()                                                                                            \
-    do {                                                                                                               \
-        osMutexDef(Pwr2Mutex);                                                                                          \
-        s_xPwr2Mutex = osMutexCreate(osMutex(Pwr2Mutex));                                                                \
-    } while (0)
-#define PWR2_LOCK()   osMutexWait(s_xPwr2Mutex, osWaitForever)
-#define PWR2_UNLOCK() osMutexRelease(s_xPwr2Mutex)
-#else
-#define PWR2_MUTEX_INIT()
-#define PWR2_LOCK()
-#define PWR2_UNLOCK()
-#endif /* SW_I2C_RTOS */
-
 /* Local defines */
 //#define PWR_ADDR                1
 #define SEND_DELAY              5
@@ -63,7 +51,13 @@ static osMutexId s_xPwr2Mutex;
 #define ID_MASK                 0xFFFFFFF8
 #define BYTE_ENDIAN_UINT16(a)   (((a) && 0xFF) << 8) | (((a) && 0xFF00) >> 8)
 #define BYTE_ENDIAN_UINT32(a)   (((a) & 0xFF) << 24) | (((a) & 0xFF00) << 8) | (((a) & 0xFF0000) >> 8) | (((a) & 0xFF000000) >> 24)
-#define WAIT_MS                 50
+#define WAIT_MS                 50      /* Per request */
+#define MOD_NUM                 3
+#define REG_NUM                 5
+#define TRANS_NUM               (MOD_NUM * REG_NUM)
+#define NO_MOD                  0xFF        /* s_ucModIdx of an address not in the rack */
+#define RSP_ID                  0x18000080  /* All responses, or'ed with the module address */
+#define RSP_MASK                0x1F0000FF
 
 /* Local types */
 #pragma pack(push)
@@ -88,54 +82,121 @@ typedef struct {
     int16_t  sTemp;     /* 0.1*/
 }_Data_t;
 
-typedef struct {
-    uint32_t ulId;
-    uint8_t  ucData[8];
-}Msg_t;
 #pragma pack(pop)
 
+/* Module in the rack */
+typedef struct {
+    uint8_t        ucAddr;
+    bool           bZero;       /* Unanswered registers read 0, a silent module must not look alive */
+}Mod_t;
+
+/* Register polled every ucPrd refreshes, the ids are or'ed with the module address */
+typedef struct {
+    uint32_t       ulReqId;
+    uint8_t        ucReqDlc;
+    uint8_t        ucCmd;       /* Data[0] of request and response if ucReqDlc != 0 */
+    uint32_t       ulRspId;
+    uint8_t        ucPrd;
+    PwrTransDone_t pfnDone;
+}Reg_t;
+
+/* Value of Pwr2DataGet, the _Data_t field at ucOfs times ucMul / ucDiv */
+typedef struct {
+    uint8_t        ucOfs;
+    uint8_t        ucMul;
+    uint8_t        ucDiv;
+}Val_t;
+
+/* One refresh of all modules */
+typedef struct {
+    _Data_t xMod[MOD_NUM];              /* Indexed like s_xMod */
+}Snap_t;
+
 /* Forward declarations */
 /* GROUP - 1 */
 /* 趨 */
 static Status_t prvSetOutput(uint32_t ulPwr2Addr, uint32_t ulCur, uint32_t ulVol);
 /* ȡģϢ */
-static Status_t prvGetStatus(uint32_t ulPwr2Addr);
+static void     prvDoneStatus(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc);
 /* ģ鿪ػ */
 static Status_t prvSetOnOff(uint32_t ulPwr2Addr, uint8_t ucOnOff);
 /* GROUP - 2 */
 /* ȡ趨ѹ */
-static Status_t prvGetCfgVol(uint32_t ulPwr2Addr);
+static void     prvDoneCfgVol(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc);
 /* ȡ趨 */
-static Status_t prvGetCfgCur(uint32_t ulPwr2Addr);
+static void     prvDoneCfgCur(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc);
 /* ȡѹ(3) */
-static Status_t prvGetInputVol(uint32_t ulPwr2Addr);
+static void     prvDoneInputVol(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc);
 /* ȡ¶ */
-static Status_t prvGetEnvTemp(uint32_t ulPwr2Addr);
+static void     prvDoneEnvTemp(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc);
 /* GROUP - 3 */
 /* ģ */
 static Status_t prvSetCurShare(uint8_t ucOnOff);
 /* ģַѰ */
 static Status_t prvSearchModule(uint8_t ucAddr);
+static void     prvSnapGet(uint8_t ucMod, _Data_t *pxData);
+static void     prvTransInit(PwrTrans_t *pxTrans, uint32_t ulPwr2Addr, uint32_t ulReqId, uint8_t ucReqDlc, uint32_t ulRspId, PwrTransDone_t pfnDone);
 
 /* Local variables */
 static bool          s_bInit = false;
 
 //static _Data_t       s_xData;
-static _Data_t       s_M2_xData;
-static _Data_t       s_M1_xData;
-static _Data_t       s_M3_xData;
-
-static QueueHandle_t s_xQueue;
+static Snap_t        s_xSnap[2];
+static volatile uint32_t s_ulSnapVer = 0;       /* s_xSnap[s_ulSnapVer & 1] is published */
+static Snap_t       *s_pxBuild = &s_xSnap[1];   /* The other one, filled by the refresh */
+
+static const Mod_t   s_xMod[MOD_NUM] = {
+    {PWR2_M2_ADDR, false},
+    {PWR2_M1_ADDR, true },
+    {PWR2_M3_ADDR, false},
+};
+static const Reg_t   s_xReg[REG_NUM] = {
+    {0x1907C080, 8, 0x01, 0x1807C080, 1, prvDoneStatus},
+    {0x19010080, 0, 0x00, 0x18010080, 5, prvDoneCfgVol},
+    {0x19010880, 0, 0x00, 0x18010880, 5, prvDoneCfgCur},
+    {0x1907A080, 8, 0x31, 0x1807A080, 1, prvDoneInputVol},
+    {0x19008080, 0, 0x00, 0x18008080, 5, prvDoneEnvTemp},
+};
+/* Indexed by PwrDataType_t */
+static const Val_t   s_xVal[PWR_DATA_NUM] = {
+    {offsetof(_Data_t, usOutVol),  1, 1 },  /* PWR_OUTPUT_VOL, 0.1V */
+    {offsetof(_Data_t, usInVca),   1, 1 },  /* PWR_INPUT_VOL */
+    {offsetof(_Data_t, usOutCur),  1, 10},  /* PWR_OUTPUT_CUR, A */
+    {offsetof(_Data_t, ucStatus0), 1, 1 },  /* PWR_STATUS, ucStatus1 in the high byte */
+};
+static uint8_t       s_ucModIdx[ADDR_MASK + 1]; /* Module address to s_xMod index */
+static PwrTrans_t    s_xTrans[TRANS_NUM];       /* Every register of every module */
+static PwrTrans_t    s_xBatch[TRANS_NUM];       /* Those due this refresh */
+static uint32_t      s_ulRefresh = 0;
+static const uint8_t s_ucZero[8] = {0};
 
 /* Functions */
 Status_t Pwr2ProtInit(void)
 {
     if (!s_bInit) {
-        PWR2_MUTEX_INIT();
-        memset(&s_M2_xData, 0, sizeof(s_M2_xData));
-        memset(&s_M1_xData, 0, sizeof(s_M1_xData));
-        memset(&s_M3_xData, 0, sizeof(s_M3_xData));
-        s_xQueue = xQueueCreate(1/*Queue length*/, sizeof(Msg_t)/*Queue item size*/);
+        memset(s_xSnap, 0, sizeof(s_xSnap));
+        memset(s_ucModIdx, NO_MOD, sizeof(s_ucModIdx));
+        PwrTransInit();
+        
+        /* One filter bank per module, spread over both fifos */
+        for (uint8_t m = 0; m < MOD_NUM; m++) {
+            s_ucModIdx[s_xMod[m].ucAddr] = m;
+            CanSetFilter(CAN_FLT_PWR2 + m, RSP_ID | s_xMod[m].ucAddr, RSP_MASK, (m & 1) ? CAN_FIFO1 : CAN_FIFO0);
+        }
+        
+        /* Register by register across the modules, the requests in flight go to different modules */
+        uint32_t n = 0;
+        for (uint8_t r = 0; r < REG_NUM; r++) {
+            for (uint8_t m = 0; m < MOD_NUM; m++) {
+                PwrTrans_t *px = &s_xTrans[n++];
+                prvTransInit(px, s_xMod[m].ucAddr, s_xReg[r].ulReqId, s_xReg[r].ucReqDlc, s_xReg[r].ulRspId, s_xReg[r].pfnDone);
+                if (s_xReg[r].ucReqDlc) {
+                    px->xReq.Data[0] = s_xReg[r].ucCmd;
+                    px->ucKey[0]     = s_xReg[r].ucCmd;
+                    px->ucKeyLen     = 1;
+                }
+            }
+        }
         s_bInit = true;
         
     }
@@ -150,92 +211,44 @@ Status_t Pwr2ProtTerm(void)
 
 Status_t Pwr2Update(void)
 {
-    
-    PWR2_LOCK();
-    TRACE("PWR_MUTEX\n");
-#if 1
-    prvGetStatus(PWR2_M2_ADDR);
-    prvGetCfgVol(PWR2_M2_ADDR);
-    prvGetCfgCur(PWR2_M2_ADDR);
-    prvGetInputVol(PWR2_M2_ADDR);
-    prvGetEnvTemp(PWR2_M2_ADDR);
-#endif
-
-#if 1
-    memset(&s_M1_xData, 0, sizeof(s_M1_xData));
-    prvGetStatus(PWR2_M1_ADDR);
-    prvGetCfgVol(PWR2_M1_ADDR);
-    prvGetCfgCur(PWR2_M1_ADDR);
-    prvGetInputVol(PWR2_M1_ADDR);
-    prvGetEnvTemp(PWR2_M1_ADDR);
-#endif
-
-    
-#if 1
-    prvGetStatus(PWR2_M3_ADDR);
-    prvGetCfgVol(PWR2_M3_ADDR);
-    prvGetCfgCur(PWR2_M3_ADDR);
-    prvGetInputVol(PWR2_M3_ADDR);
-    prvGetEnvTemp(PWR2_M3_ADDR);
-#endif
-    
-    PWR2_UNLOCK();
-    TRACE("PWR_UNLOCK\n");
-    return STATUS_OK;
-}
-
-void Pwr2CanRxNotify(uint32_t ulPwr2Addr, CanMsgRx_t *pxMsg)
-{
-    if (pxMsg->IDE != CAN_ID_EXT) {
-        return;
-    }
-    
-    if ((pxMsg->ExtId & ADDR_MASK) != ulPwr2Addr) {
-        return;
-    }
-    
-    /* "ȡ趨"صĳΪ6, Ϊ8 */
-    if ((pxMsg->DLC != 8) && (pxMsg->DLC != 6)) {
-        return;
+    Status_t xRet  = STATUS_OK;
+    uint32_t ulNum = 0;
+    
+    /* Readers keep the published copy while the requests are on the bus */
+    const Snap_t *pxLive = &s_xSnap[s_ulSnapVer & 1];
+    s_pxBuild  = &s_xSnap[(s_ulSnapVer + 1) & 1];
+    *s_pxBuild = *pxLive;
+    
+    /* Registers not due keep their last value */
+    for (uint32_t n = 0; n < TRANS_NUM; n++) {
+        if ((s_ulRefresh % s_xReg[n / MOD_NUM].ucPrd) == 0) {
+            s_xBatch[ulNum++] = s_xTrans[n];
+        }
     }
-    
-    
-    Bool_t bNotify = FALSE;
-    switch(pxMsg->ExtId & ID_MASK) {
-    case 0x1807C080:
-        switch (pxMsg->Data[0]) {
-        case 0:     /* ģ鷵 */
-        case 1:     /* ģ鷵״̬ */
-        case 2:     /* ģظػ */
-            bNotify = TRUE;
-            break;
-        default:
-            ASSERT(0);
-            break;
+    s_ulRefresh++;
+    
+    for (uint32_t b = 0; b < ulNum; b += PWR_TRANS_MAX) {
+        uint32_t ulCnt  = ((ulNum - b) < PWR_TRANS_MAX) ? (ulNum - b) : PWR_TRANS_MAX;
+        uint32_t ulDone = 0;
+        PwrTransRun(&s_xBatch[b], ulCnt, WAIT_MS, &ulDone);
+        for (uint32_t n = 0; n < ulCnt; n++) {
+            const PwrTrans_t *px = &s_xBatch[b + n];
+            if (ulDone & (1UL << n)) {
+                continue;
+            }
+            xRet = STATUS_ERR;
+            if (s_xMod[s_ucModIdx[px->ucDev]].bZero) {
+                px->pfnDone(px->ucDev, s_ucZero, sizeof(s_ucZero));
+            }
         }
-        break;
-    
-    
-    case 0x18010080:    /* ģ鷵صѹֵ */
-    case 0x18010880:    /* ģ鷵ֵ */
-    case 0x1807A080:    /* ģ鷵ѹ */
-    case 0x18008080:    /* ģ鷵ػ¶ */
-        bNotify = TRUE;
-        break;
-    
-    default:
-        break;
     }
     
-    if (bNotify) {
-        Msg_t m;
-        m.ulId = pxMsg->ExtId;
-        memcpy(m.ucData, pxMsg->Data, 8);
-        
-        BaseType_t xHigherPriorityTaskWoken;
-        xQueueSendToBackFromISR(s_xQueue, &m, &xHigherPriorityTaskWoken);
-        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
-    }
+    /* Publish, the copy is complete before the version moves */
+    __DMB();
+    s_ulSnapVer++;
+    TRACE("PWR2 SNAP %d\n", s_ulSnapVer);
+    
+    return xRet;
 }
 
 Status_t Pwr2Output(uint32_t ulPwr2Addr, uint8_t ucOnOff)
@@ -245,59 +258,16 @@ Status_t Pwr2Output(uint32_t ulPwr2Addr, uint8_t ucOnOff)
 
 int32_t Pwr2DataGet(uint32_t ulAddr, PwrDataType_t xType)
 {
-    PWR2_LOCK();
-    int32_t r = 0;
-    switch (ulAddr)
-    {
-    case PWR2_M1_ADDR: 
-    switch (xType) {
-        case PWR_OUTPUT_VOL:
-            r = s_M1_xData.usOutVol; /* 0.1V */
-            break;
-        case PWR_STATUS:
-            r = (s_M1_xData.ucStatus1 << 8) | s_M1_xData.ucStatus0;
-            break;
-        case PWR_INPUT_VOL:
-            r = s_M1_xData.usInVca; /* 0.1V */
-            break;
-        case PWR_OUTPUT_CUR:
-            r = s_M1_xData.usOutCur * 0.1;
-            break;
-        default:
-            r = 0;
-            break;
-    }break;
-    case PWR2_M2_ADDR: 
-        switch (xType) {
-            case PWR_OUTPUT_VOL:
-                r = s_M2_xData.usOutVol; /* 0.1V */
-                break;
-            case PWR_STATUS:
-                r = (s_M2_xData.ucStatus1 << 8) | s_M2_xData.ucStatus0;
-                break;
-            default:
-                r = 0;
-                break;
-        }break;
+    _Data_t  x;
+    uint16_t usRaw;
     
-    case PWR2_M3_ADDR: 
-        switch (xType) {
-            case PWR_OUTPUT_VOL:
-                r = s_M3_xData.usOutVol; /* 0.1V */
-                break;
-            case PWR_STATUS:
-                r = (s_M3_xData.ucStatus1 << 8) | s_M3_xData.ucStatus0;
-                break;
-            default:
-                r = 0;
-                break;
-        }break;        
+    if (!s_bInit || (ulAddr > ADDR_MASK) || (s_ucModIdx[ulAddr] == NO_MOD) || (xType >= PWR_DATA_NUM)) {
+        return 0;
     }
-    PWR2_UNLOCK();
-    
-//    memset(&s_M1_xData, 0, sizeof(s_M1_xData));
+    prvSnapGet(s_ucModIdx[ulAddr], &x);
+    memcpy(&usRaw, (uint8_t *)&x + s_xVal[xType].ucOfs, sizeof(usRaw));
     
-    return r;
+    return (int32_t)usRaw * s_xVal[xType].ucMul / s_xVal[xType].ucDiv;
 }
 
 Status_t Pwr2SetVolDef(float fV)
@@ -328,248 +298,97 @@ Status_t Pwr2SetVolDef(float fV)
 /* 趨 */
 static Status_t prvSetOutput(uint32_t ulPwr2Addr, uint32_t ulCur, uint32_t ulVol)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x1907C080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 8;
+    PwrTrans_t xTrans;
+    uint32_t   ulDone = 0;
+    prvTransInit(&xTrans, ulPwr2Addr, 0x1907C080, 8, 0x1807C080, NULL);
     /* CMD */
-    xMsg.Data[0] = 0;
+    xTrans.xReq.Data[0] = 0;
     /* (mA) */
-    xMsg.Data[1] = (ulCur & 0xFF0000) >> 16;
-    xMsg.Data[2] = (ulCur & 0xFF00) >> 8;
-    xMsg.Data[3] = (ulCur & 0xFF) >> 0;
+    xTrans.xReq.Data[1] = (ulCur & 0xFF0000) >> 16;
+    xTrans.xReq.Data[2] = (ulCur & 0xFF00) >> 8;
+    xTrans.xReq.Data[3] = (ulCur & 0xFF) >> 0;
     /* ѹ(mV) */
-    xMsg.Data[4] = (ulVol & 0xFF000000) >> 24;
-    xMsg.Data[5] = (ulVol & 0xFF0000) >> 16;
-    xMsg.Data[6] = (ulVol & 0xFF00) >> 8;
-    xMsg.Data[7] = (ulVol & 0xFF) >> 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (((m.ulId & ID_MASK) == 0x1807C080) && (m.ucData[0] == 0) && (m.ucData[1] == 0xFF)) {
-            return STATUS_OK;
-        }
-    }
-    
-    return STATUS_ERR;
+    xTrans.xReq.Data[4] = (ulVol & 0xFF000000) >> 24;
+    xTrans.xReq.Data[5] = (ulVol & 0xFF0000) >> 16;
+    xTrans.xReq.Data[6] = (ulVol & 0xFF00) >> 8;
+    xTrans.xReq.Data[7] = (ulVol & 0xFF) >> 0;
+    /* ACK: CMD, 0xFF */
+    xTrans.ucKey[0] = 0;
+    xTrans.ucKey[1] = 0xFF;
+    xTrans.ucKeyLen = 2;
+    PwrTransRun(&xTrans, 1, WAIT_MS, &ulDone);
+    
+    return ulDone ? STATUS_OK : STATUS_ERR;
 }
 
 /* ȡģϢ */
-static Status_t prvGetStatus(uint32_t ulPwr2Addr)
+static void prvDoneStatus(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x1907C080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 8;
-    /* CMD */
-    xMsg.Data[0] = 1;
-    /* NOUSE */
-    xMsg.Data[1] = 0;
-    xMsg.Data[2] = 0;
-    xMsg.Data[3] = 0;
-    xMsg.Data[4] = 0;
-    xMsg.Data[5] = 0;
-    xMsg.Data[6] = 0;
-    xMsg.Data[7] = 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (((m.ulId & ID_MASK) == 0x1807C080) && (m.ucData[0] == 1)) {
-            switch (ulPwr2Addr)
-            {
-                case PWR2_M2_ADDR: 
-                    s_M2_xData.usOutCur  = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M2_xData.usOutVol  = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M2_xData.ucStatus1 = m.ucData[6];
-                    s_M2_xData.ucStatus0 = m.ucData[7];
-                    break;
-                case PWR2_M1_ADDR: 
-                    s_M1_xData.usOutCur  = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M1_xData.usOutVol  = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M1_xData.ucStatus1 = m.ucData[6];
-                    s_M1_xData.ucStatus0 = m.ucData[7];
-                    break;
-                case PWR2_M3_ADDR: 
-                    s_M3_xData.usOutCur  = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M3_xData.usOutVol  = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M3_xData.ucStatus1 = m.ucData[6];
-                    s_M3_xData.ucStatus0 = m.ucData[7];
-                    break;
-            }
-            return STATUS_OK;
-        }
+    if (ucDlc != 8) {
+        return;
     }
-    return STATUS_ERR;
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usOutCur  = ((uint16_t)pucData[2] << 8) | (uint16_t)pucData[3];
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usOutVol  = ((uint16_t)pucData[4] << 8) | (uint16_t)pucData[5];
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].ucStatus1 = pucData[6];
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].ucStatus0 = pucData[7];
 }
 
 /* ģ鿪ػ */
 static Status_t prvSetOnOff(uint32_t ulPwr2Addr, uint8_t ucOnOff)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x1907C080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 8;
+    PwrTrans_t xTrans;
+    uint32_t   ulDone = 0;
+    prvTransInit(&xTrans, ulPwr2Addr, 0x1907C080, 8, 0x1807C080, NULL);
     /* CMD */
-    xMsg.Data[0] = 2;
+    xTrans.xReq.Data[0] = 2;
     /* NOUSE */
-    xMsg.Data[1] = 0;
-    xMsg.Data[2] = 0;
-    xMsg.Data[3] = 0;
-    xMsg.Data[4] = 0;
-    xMsg.Data[5] = 0;
-    xMsg.Data[6] = 0;
-    xMsg.Data[7] = ucOnOff ? 0x55 : 0xAA;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (((m.ulId & ID_MASK) == 0x1807C080) && (m.ucData[0] == 2) && (m.ucData[1] == 0xFF)) {
-            return STATUS_OK;
-        }
-    }
-    
-    return STATUS_ERR;
+    xTrans.xReq.Data[7] = ucOnOff ? 0x55 : 0xAA;
+    /* ACK: CMD, 0xFF */
+    xTrans.ucKey[0] = 2;
+    xTrans.ucKey[1] = 0xFF;
+    xTrans.ucKeyLen = 2;
+    PwrTransRun(&xTrans, 1, WAIT_MS, &ulDone);
+    
+    return ulDone ? STATUS_OK : STATUS_ERR;
 }
 
 /* ȡ趨ѹ */
-static Status_t prvGetCfgVol(uint32_t ulPwr2Addr)
+static void prvDoneCfgVol(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x19010080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if ((m.ulId & ID_MASK) == 0x18010080) {
-            switch (ulPwr2Addr)
-            {
-                case PWR2_M2_ADDR: s_M2_xData.usCfgVol = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];break;
-                case PWR2_M1_ADDR: s_M1_xData.usCfgVol = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];break;
-                case PWR2_M3_ADDR: s_M3_xData.usCfgVol = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];break;
-            }
-            
-            return STATUS_OK;
-        }
+    if (ucDlc != 8) {
+        return;
     }
-    
-    return STATUS_ERR;
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usCfgVol = ((uint16_t)pucData[6] << 8) | (uint16_t)pucData[7];
 }
 
 /* ȡ趨 */
-static Status_t prvGetCfgCur(uint32_t ulPwr2Addr)
+static void prvDoneCfgCur(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x19010880 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if ((m.ulId & ID_MASK) == 0x18010880) {
-            switch (ulPwr2Addr)
-            {
-                case PWR2_M2_ADDR: s_M2_xData.usCfgCur = ((uint16_t)m.ucData[0] << 8) | (uint16_t)m.ucData[1];break;
-                case PWR2_M1_ADDR: s_M1_xData.usCfgCur = ((uint16_t)m.ucData[0] << 8) | (uint16_t)m.ucData[1];break;
-                case PWR2_M3_ADDR: s_M3_xData.usCfgCur = ((uint16_t)m.ucData[0] << 8) | (uint16_t)m.ucData[1];break;
-            }
-            
-            return STATUS_OK;
-        }
+    /* "ȡ趨"صĳΪ6 */
+    if ((ucDlc != 8) && (ucDlc != 6)) {
+        return;
     }
-    
-    return STATUS_ERR;
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usCfgCur = ((uint16_t)pucData[0] << 8) | (uint16_t)pucData[1];
 }
 
 /* ȡѹֵ */
-static Status_t prvGetInputVol(uint32_t ulPwr2Addr)
+static void prvDoneInputVol(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x1907A080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 8;
-    /* CMD */
-    xMsg.Data[0] = 0x31;
-    /* NOUSE */
-    xMsg.Data[1] = 0;
-    xMsg.Data[2] = 0;
-    xMsg.Data[3] = 0;
-    xMsg.Data[4] = 0;
-    xMsg.Data[5] = 0;
-    xMsg.Data[6] = 0;
-    xMsg.Data[7] = 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if (((m.ulId & ID_MASK) == 0x1807A080) && (m.ucData[0] == 0x31)) {
-            switch (ulPwr2Addr)
-            {
-                case PWR2_M2_ADDR: 
-                    s_M2_xData.usInVab = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M2_xData.usInVbc = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M2_xData.usInVca = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];
-                    break;
-                case PWR2_M1_ADDR: 
-                    s_M1_xData.usInVab = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M1_xData.usInVbc = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M1_xData.usInVca = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];
-                    break;
-                case PWR2_M3_ADDR: 
-                    s_M3_xData.usInVab = ((uint16_t)m.ucData[2] << 8) | (uint16_t)m.ucData[3];
-                    s_M3_xData.usInVbc = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];
-                    s_M3_xData.usInVca = ((uint16_t)m.ucData[6] << 8) | (uint16_t)m.ucData[7];
-                    break;
-            }
-            return STATUS_OK;
-        }
+    if (ucDlc != 8) {
+        return;
     }
-    return STATUS_ERR;
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usInVab = ((uint16_t)pucData[2] << 8) | (uint16_t)pucData[3];
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usInVbc = ((uint16_t)pucData[4] << 8) | (uint16_t)pucData[5];
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].usInVca = ((uint16_t)pucData[6] << 8) | (uint16_t)pucData[7];
 }
 
 /* ȡ¶ */
-static Status_t prvGetEnvTemp(uint32_t ulPwr2Addr)
+static void prvDoneEnvTemp(uint8_t ucAddr, const uint8_t *pucData, uint8_t ucDlc)
 {
-    CanMsgTx_t xMsg;
-    xMsg.StdId   = 0;
-    xMsg.ExtId   = 0x19008080 | ulPwr2Addr;
-    xMsg.IDE     = CAN_ID_EXT;
-    xMsg.RTR     = CAN_RTR_DATA;
-    xMsg.DLC     = 0;
-    CanSend(&xMsg, SEND_DELAY);
-    
-    Msg_t m;
-    if(xQueueReceive(s_xQueue, &m, pdMS_TO_TICKS(WAIT_MS)) == pdPASS) {
-        if ((m.ulId & ID_MASK) == 0x18008080) {
-            switch (ulPwr2Addr)
-            {
-                case PWR2_M2_ADDR: s_M2_xData.sTemp = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];break;
-                case PWR2_M1_ADDR: s_M1_xData.sTemp = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];break;
-                case PWR2_M3_ADDR: s_M3_xData.sTemp = ((uint16_t)m.ucData[4] << 8) | (uint16_t)m.ucData[5];break;
-            }
-            
-            return STATUS_OK;
-        }
+    if (ucDlc != 8) {
+        return;
     }
-    
-    return STATUS_ERR;
+    s_pxBuild->xMod[s_ucModIdx[ucAddr]].sTemp = ((uint16_t)pucData[4] << 8) | (uint16_t)pucData[5];
 }
 
 /* ģ */
@@ -614,6 +433,33 @@ static Status_t prvSearchModule(uint8_t ucAddr)
     return STATUS_OK;
 }
 
+/* Lock free, retried if a refresh was published meanwhile */
+static void prvSnapGet(uint8_t ucMod, _Data_t *pxData)
+{
+    uint32_t ulVer;
+    
+    do {
+        ulVer = s_ulSnapVer;
+        __DMB();
+        *pxData = s_xSnap[ulVer & 1].xMod[ucMod];
+        __DMB();
+    } while (ulVer != s_ulSnapVer);
+}
+
+static void prvTransInit(PwrTrans_t *pxTrans, uint32_t ulPwr2Addr, uint32_t ulReqId, uint8_t ucReqDlc, uint32_t ulRspId, PwrTransDone_t pfnDone)
+{
+    memset(pxTrans, 0, sizeof(*pxTrans));
+    pxTrans->xReq.StdId = 0;
+    pxTrans->xReq.ExtId = ulReqId | ulPwr2Addr;
+    pxTrans->xReq.IDE   = CAN_ID_EXT;
+    pxTrans->xReq.RTR   = CAN_RTR_DATA;
+    pxTrans->xReq.DLC   = ucReqDlc;
+    pxTrans->ulRspId    = ulRspId | ulPwr2Addr;
+    pxTrans->ulRspMask  = ID_MASK | ADDR_MASK;
+    pxTrans->ucDev      = ulPwr2Addr;
+    pxTrans->pfnDone    = pfnDone;
+}
+
 static void prvCliCmdPwr2SetCurVol(cli_printf cliprintf, int argc, char** argv)
 {
     if (!s_bInit) {
@@ -717,44 +563,24 @@ static void prvCliCmdPwr2Status(cli_printf cliprintf, int argc, char** argv)
         return;
     }
     
-    cliprintf("PWR_M1_STATUS :\n");
-    cliprintf("         : %.1f A\n", s_M1_xData.usOutCur * 0.1);
-    cliprintf("    ѹ     : %.1f V\n", s_M1_xData.usOutVol * 0.1);
-    cliprintf("    ״̬1        : 0x%02X\n", s_M1_xData.ucStatus1);
-    cliprintf("    ״̬0        : 0x%02X\n", s_M1_xData.ucStatus0);
-    cliprintf("    趨     : %.1f A\n", s_M1_xData.usCfgCur * 0.1);
-    cliprintf("    趨ѹ     : %.1f V\n", s_M1_xData.usCfgVol * 0.1);
-    cliprintf("    ѹ(Vab): %.1f V\n", s_M1_xData.usInVab / 32.);
-    cliprintf("    ѹ(Vbc): %.1f V\n", s_M1_xData.usInVbc / 32.);
-    cliprintf("    ѹ(Vca): %.1f V\n", s_M1_xData.usInVca / 32.);
-    cliprintf("    ¶     : %.1f \n",s_M1_xData.sTemp * 0.1);
-    cliprintf("\n");
-    
-    cliprintf("PWR_M2_STATUS :\n");
-    cliprintf("         : %.1f A\n", s_M2_xData.usOutCur * 0.1);
-    cliprintf("    ѹ     : %.1f V\n", s_M2_xData.usOutVol * 0.1);
-    cliprintf("    ״̬1        : 0x%02X\n", s_M2_xData.ucStatus1);
-    cliprintf("    ״̬0        : 0x%02X\n", s_M2_xData.ucStatus0);
-    cliprintf("    趨     : %.1f A\n", s_M2_xData.usCfgCur * 0.1);
-    cliprintf("    趨ѹ     : %.1f V\n", s_M2_xData.usCfgVol * 0.1);
-    cliprintf("    ѹ(Vab): %.1f V\n", s_M2_xData.usInVab / 32.);
-    cliprintf("    ѹ(Vbc): %.1f V\n", s_M2_xData.usInVbc / 32.);
-    cliprintf("    ѹ(Vca): %.1f V\n", s_M2_xData.usInVca / 32.);
-    cliprintf("    ¶     : %.1f \n",s_M2_xData.sTemp * 0.1);
-    cliprintf("\n");
-    
-    cliprintf("PWR_M3_STATUS :\n");
-    cliprintf("         : %.1f A\n", s_M3_xData.usOutCur * 0.1);
-    cliprintf("    ѹ     : %.1f V\n", s_M3_xData.usOutVol * 0.1);
-    cliprintf("    ״̬1        : 0x%02X\n", s_M3_xData.ucStatus1);
-    cliprintf("    ״̬0        : 0x%02X\n", s_M3_xData.ucStatus0);
-    cliprintf("    趨     : %.1f A\n", s_M3_xData.usCfgCur * 0.1);
-    cliprintf("    趨ѹ     : %.1f V\n", s_M3_xData.usCfgVol * 0.1);
-    cliprintf("    ѹ(Vab): %.1f V\n", s_M3_xData.usInVab / 32.);
-    cliprintf("    ѹ(Vbc): %.1f V\n", s_M3_xData.usInVbc / 32.);
-    cliprintf("    ѹ(Vca): %.1f V\n", s_M3_xData.usInVca / 32.);
-    cliprintf("    ¶     : %.1f \n",s_M3_xData.sTemp * 0.1);
-    cliprintf("\n");
-
+    for (uint8_t a = 0; a <= ADDR_MASK; a++) {
+        if (s_ucModIdx[a] == NO_MOD) {
+            continue;
+        }
+        _Data_t x;
+        prvSnapGet(s_ucModIdx[a], &x);
+        cliprintf("PWR_M%d_STATUS :\n", a);
+        cliprintf("         : %.1f A\n", x.usOutCur * 0.1);
+        cliprintf("    ѹ     : %.1f V\n", x.usOutVol * 0.1);
+        cliprintf("    ״̬1        : 0x%02X\n", x.ucStatus1);
+        cliprintf("    ״̬0        : 0x%02X\n", x.ucStatus0);
+        cliprintf("    趨     : %.1f A\n", x.usCfgCur * 0.1);
+        cliprintf("    趨ѹ     : %.1f V\n", x.usCfgVol * 0.1);
+        cliprintf("    ѹ(Vab): %.1f V\n", x.usInVab / 32.);
+        cliprintf("    ѹ(Vbc): %.1f V\n", x.usInVbc / 32.);
+        cliprintf("    ѹ(Vca): %.1f V\n", x.usInVca / 32.);
+        cliprintf("    ¶     : %.1f \n",x.sTemp * 0.1);
+        cliprintf("\n");
+    }
 }
 CLI_CMD_EXPORT(pwr2_status, show power(18kw) status, prvCliCmdPwr2Status)
@@ -15,6 +15,7 @@
     01d, 08Jan24, Karl Added pwr2_set_vol_def
     01e, 17Jan24, Karl Added Pwr2SetVolDef
     01f, 20Jan24, Karl Added PWR_STATUS
+    01g, 19Oct26, Karl Removed Pwr2CanRxNotify, responses go through PwrTrans
 */
 
 #ifndef __PWR2_PROT_H__
@@ -37,7 +38,6 @@ Status_t Pwr2ProtInit(void);
 Status_t Pwr2ProtTerm(void);
 
 Status_t Pwr2Update(void);
-void     Pwr2CanRxNotify(uint32_t ulPwr2Addr, CanMsgRx_t *pxMsg);
 
 Status_t Pwr2Output(uint32_t ulPwr2Addr, uint8_t ucOnOff);
 
@@ -0,0 +1,305 @@
+/*
+    PwrTrans.c
+
+    Implementation File for Pwr Trans Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, Karl Responses taken with CanRead, matched in task context
+    01c, 19Oct26, Karl Added latency histogram
+    01d, 19Oct26, Karl Lost and recovered devices sent to the event log
+    01e, 19Oct26, agent CLI prints the transaction counters with %lu
+    01f, 19Oct26, agent CLI prints the latency histogram with %lu
+*/
+
+/* Includes */
+#include "Include.h"
+
+/* Debug config */
+#if PWR_DEBUG
+#undef TRACE
+#define TRACE(...) DebugPrintf(__VA_ARGS__)
+#else
+#undef TRACE
+#define TRACE(...)
+#endif /* PWR_DEBUG */
+#if PWR_DEBUG
+#undef ASSERT
+#define ASSERT(a)                                                                                                      \
+    while (!(a)) {                                                                                                     \
+        DebugPrintf("ASSERT failed: %s %d\n", __FILE__, __LINE__);                                                     \
+    }
+#else
+#undef ASSERT
+#define ASSERT(...)
+#endif /* PWR_DEBUG */
+
+/* Local defines */
+#define SEND_DELAY 5
+
+/* Forward declarations */
+static Bool_t   prvSend(uint32_t n, uint32_t ulTimeoutMs);
+static void     prvExpire(uint32_t ulNow);
+static uint32_t prvWaitTick(uint32_t ulNow);
+static uint32_t prvBitCnt(uint32_t ulBits);
+static void     prvMatch(const CanMsgRx_t *pxMsg);
+
+/* Local variables */
+static Bool_t                     s_bInit = FALSE;
+static osMutexId                  s_xMutex;
+static const PwrTrans_t          *s_pxTbl = NULL;
+static uint32_t                   s_ulPend = 0; /* In flight, bit n is pxTbl[n] */
+static uint32_t                   s_ulDone = 0; /* Answered, bit n is pxTbl[n] */
+static uint32_t                   s_ulDeadline[PWR_TRANS_MAX]; /* Tick */
+static uint32_t                   s_ulSendCyc[PWR_TRANS_MAX];
+static uint8_t                    s_ucRsp[PWR_TRANS_MAX][8];
+static uint8_t                    s_ucRspDlc[PWR_TRANS_MAX];
+static PwrTransStat_t             s_xStat[PWR_TRANS_DEV_NUM];
+static uint32_t                   s_ulRunLast = 0; /* Last batch time (us) */
+static uint32_t                   s_ulRunMax  = 0;
+static Bool_t                     s_bLost[PWR_TRANS_DEV_NUM]; /* Timed out since its last response */
+static const uint32_t             s_ulHistEdge[PWR_TRANS_HIST - 1] = {1000, 2000, 5000, 10000, 20000, 50000, 100000}; /* us */
+
+/* Functions */
+Status_t PwrTransInit(void) {
+    if (!s_bInit) {
+        osMutexDef(PwrTransMutex);
+        s_xMutex = osMutexCreate(osMutex(PwrTransMutex));
+        memset(s_xStat, 0, sizeof(s_xStat));
+        s_bInit = TRUE;
+    }
+    return STATUS_OK;
+}
+
+Status_t PwrTransRun(const PwrTrans_t *pxTbl, uint32_t ulNum, uint32_t ulTimeoutMs, uint32_t *pulDone) {
+    uint32_t ulNext = 0;
+    uint32_t ulCyc  = TimeCycGet();
+
+    if (!s_bInit || (pxTbl == NULL) || (ulNum == 0) || (ulNum > PWR_TRANS_MAX)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    /* Drop late responses of the previous batch, they would match the new requests */
+    CanMsgRx_t xMsg;
+    while (CanRead(&xMsg, 0, 0, 0) == STATUS_OK) {
+    }
+    s_ulPend = 0;
+    s_ulDone = 0;
+    s_pxTbl  = pxTbl;
+
+    while (1) {
+        /* Keep the window full, responses are matched by id and key, not by order */
+        while ((ulNext < ulNum) && (prvBitCnt(s_ulPend) < PWR_TRANS_WIN)) {
+            prvSend(ulNext++, ulTimeoutMs);
+        }
+
+        prvExpire(osKernelSysTick());
+        if ((s_ulPend == 0) && (ulNext >= ulNum)) {
+            break;
+        }
+        if (s_ulPend != 0) {
+            /* Back on every response, so a free slot is refilled at once */
+            if (CanRead(&xMsg, 0, 0, prvWaitTick(osKernelSysTick())) == STATUS_OK) {
+                prvMatch(&xMsg);
+            }
+        }
+    }
+    s_pxTbl = NULL;
+
+    /* Handlers run here, in task context and in table order */
+    for (uint32_t n = 0; n < ulNum; n++) {
+        if ((s_ulDone & (1UL << n)) && (pxTbl[n].pfnDone != NULL)) {
+            pxTbl[n].pfnDone(pxTbl[n].ucDev, s_ucRsp[n], s_ucRspDlc[n]);
+        }
+    }
+    if (pulDone != NULL) {
+        *pulDone = s_ulDone;
+    }
+
+    ulCyc       = TimeCycToUs(TimeCycGet() - ulCyc);
+    s_ulRunLast = ulCyc;
+    if (ulCyc > s_ulRunMax) {
+        s_ulRunMax = ulCyc;
+    }
+
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+Status_t PwrTransGetStat(uint8_t ucDev, PwrTransStat_t *pxStat) {
+    if ((ucDev >= PWR_TRANS_DEV_NUM) || (pxStat == NULL)) {
+        return STATUS_ERR;
+    }
+    taskENTER_CRITICAL();
+    *pxStat = s_xStat[ucDev];
+    taskEXIT_CRITICAL();
+    return STATUS_OK;
+}
+
+static Bool_t prvSend(uint32_t n, uint32_t ulTimeoutMs) {
+    const PwrTrans_t *px = &s_pxTbl[n];
+
+    if (px->ucDev < PWR_TRANS_DEV_NUM) {
+        s_xStat[px->ucDev].ulReqCnt++;
+    }
+
+    s_ulDeadline[n] = osKernelSysTick() + pdMS_TO_TICKS(ulTimeoutMs);
+    s_ulSendCyc[n]  = TimeCycGet();
+    s_ulPend |= (1UL << n);
+
+    if (CanSend((CanMsgTx_t *)&px->xReq, SEND_DELAY) != STATUS_OK) {
+        /* Let it run out, counted as a timeout like a lost response */
+        TRACE("pwr trans send failed: 0x%08X\n", px->xReq.ExtId);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void prvExpire(uint32_t ulNow) {
+    uint32_t ulPend = s_ulPend;
+
+    for (uint32_t n = 0; ulPend != 0; n++, ulPend >>= 1) {
+        if (!(ulPend & 1) || ((int32_t)(s_ulDeadline[n] - ulNow) > 0)) {
+            continue;
+        }
+        s_ulPend &= ~(1UL << n);
+        if (s_pxTbl[n].ucDev < PWR_TRANS_DEV_NUM) {
+            s_xStat[s_pxTbl[n].ucDev].ulTimeoutCnt++;
+            /* Logged once, an absent module times out every poll */
+            if (!s_bLost[s_pxTbl[n].ucDev]) {
+                s_bLost[s_pxTbl[n].ucDev] = TRUE;
+                EvtLog(EVT_PWR_LOST, s_pxTbl[n].ucDev, s_pxTbl[n].xReq.ExtId, 0, 0);
+            }
+        }
+    }
+}
+
+static uint32_t prvWaitTick(uint32_t ulNow) {
+    uint32_t ulPend = s_ulPend;
+    uint32_t ulWait = 0xFFFFFFFF;
+
+    /* Until the nearest deadline */
+    for (uint32_t n = 0; ulPend != 0; n++, ulPend >>= 1) {
+        if (ulPend & 1) {
+            int32_t lLeft = (int32_t)(s_ulDeadline[n] - ulNow);
+            if (lLeft <= 0) {
+                return 0;
+            }
+            if ((uint32_t)lLeft < ulWait) {
+                ulWait = lLeft;
+            }
+        }
+    }
+    return (ulWait == 0xFFFFFFFF) ? 0 : ulWait;
+}
+
+/* Responses are matched by id and key, not by order */
+static void prvMatch(const CanMsgRx_t *pxMsg) {
+    uint32_t ulPend = s_ulPend;
+
+    if (pxMsg->IDE != CAN_ID_EXT) {
+        return;
+    }
+
+    for (uint32_t n = 0; ulPend != 0; n++, ulPend >>= 1) {
+        const PwrTrans_t *px = &s_pxTbl[n];
+        if (!(ulPend & 1)) {
+            continue;
+        }
+        if ((pxMsg->ExtId & px->ulRspMask) != px->ulRspId) {
+            continue;
+        }
+        if ((pxMsg->DLC < px->ucKeyLen) || (memcmp(pxMsg->Data, px->ucKey, px->ucKeyLen) != 0)) {
+            continue;
+        }
+
+        uint8_t ucDlc = (pxMsg->DLC > 8) ? 8 : pxMsg->DLC;
+        memcpy(s_ucRsp[n], pxMsg->Data, ucDlc);
+        s_ucRspDlc[n] = ucDlc;
+        s_ulPend &= ~(1UL << n);
+        s_ulDone |= (1UL << n);
+
+        if (px->ucDev < PWR_TRANS_DEV_NUM) {
+            PwrTransStat_t *pxStat = &s_xStat[px->ucDev];
+            uint32_t        ulLat  = TimeCycToUs(TimeCycGet() - s_ulSendCyc[n]);
+            pxStat->ulLatLast      = ulLat;
+            pxStat->ulLatSum += ulLat;
+            if (ulLat > pxStat->ulLatMax) {
+                pxStat->ulLatMax = ulLat;
+            }
+            uint8_t h = 0;
+            while ((h < PWR_TRANS_HIST - 1) && (ulLat >= s_ulHistEdge[h])) {
+                h++;
+            }
+            pxStat->ulLatHist[h]++;
+            pxStat->ulRspCnt++;
+            if (s_bLost[px->ucDev]) {
+                s_bLost[px->ucDev] = FALSE;
+                EvtLog(EVT_PWR_BACK, px->ucDev, 0, 0, 0);
+            }
+        }
+        return;
+    }
+}
+
+static uint32_t prvBitCnt(uint32_t ulBits) {
+    uint32_t ulCnt = 0;
+    while (ulBits) {
+        ulBits &= ulBits - 1;
+        ulCnt++;
+    }
+    return ulCnt;
+}
+
+static void prvCliCmdPwrTransStat(cli_printf cliprintf, int argc, char **argv) {
+    CHECK_CLI();
+
+    if (!s_bInit) {
+        cliprintf("enable the device first\n");
+        return;
+    }
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "clear"))) {
+        taskENTER_CRITICAL();
+        memset(s_xStat, 0, sizeof(s_xStat));
+        s_ulRunMax = 0;
+        taskEXIT_CRITICAL();
+        cliprintf("pwr trans statistics cleared\n");
+        return;
+    }
+
+    for (uint8_t n = 0; n < PWR_TRANS_DEV_NUM; n++) {
+        PwrTransStat_t x;
+        PwrTransGetStat(n, &x);
+        if (x.ulReqCnt == 0) {
+            continue;
+        }
+        cliprintf("PWR DEV-%d :\n", n);
+        cliprintf("    REQ     CNT : %lu\n", (unsigned long)x.ulReqCnt);
+        cliprintf("    RSP     CNT : %lu\n", (unsigned long)x.ulRspCnt);
+        cliprintf("    TIMEOUT CNT : %lu\n", (unsigned long)x.ulTimeoutCnt);
+        cliprintf("    LAT LAST    : %lu us\n", (unsigned long)x.ulLatLast);
+        cliprintf("    LAT MAX     : %lu us\n", (unsigned long)x.ulLatMax);
+        cliprintf("    LAT AVG     : %lu us\n", (unsigned long)(x.ulRspCnt ? (x.ulLatSum / x.ulRspCnt) : 0));
+        for (uint8_t h = 0; h < PWR_TRANS_HIST; h++) {
+            if (h < PWR_TRANS_HIST - 1) {
+                cliprintf("    LAT < %3lu ms : %lu\n", (unsigned long)(s_ulHistEdge[h] / 1000),
+                          (unsigned long)x.ulLatHist[h]);
+            } else {
+                cliprintf("    LAT >=%3lu ms : %lu\n", (unsigned long)(s_ulHistEdge[h - 1] / 1000),
+                          (unsigned long)x.ulLatHist[h]);
+            }
+        }
+    }
+    cliprintf("BATCH LAST  : %lu us\n", (unsigned long)s_ulRunLast);
+    cliprintf("BATCH MAX   : %lu us\n", (unsigned long)s_ulRunMax);
+}
+CLI_CMD_EXPORT(pwr_trans_stat, show power can transaction statistics, prvCliCmdPwrTransStat)
@@ -0,0 +1,69 @@
+/*
+    PwrTrans.h
+
+    Head File for Pwr Trans Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, Karl Removed PwrTransRxNotify, responses taken with CanRead
+    01c, 19Oct26, Karl Added latency histogram
+*/
+
+#ifndef __PWR_TRANS_H__
+#define __PWR_TRANS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "Include/Include.h"
+#include "User/Drv/Can.h"
+
+/* Defines */
+#define PWR_TRANS_WIN     4  /* Requests in flight */
+#define PWR_TRANS_MAX     32 /* Transactions per batch */
+#define PWR_TRANS_DEV_NUM 4  /* Statistics slots, Pwr1 uses 0, Pwr2 its module address */
+#define PWR_TRANS_KEY_LEN 4
+#define PWR_TRANS_HIST    8  /* Latency buckets: < 1, 2, 5, 10, 20, 50, 100 ms and the rest */
+
+/* Types */
+/* Response handler, runs in task context once the batch is over */
+typedef void (*PwrTransDone_t)(uint8_t ucDev, const uint8_t *pucData, uint8_t ucDlc);
+
+typedef struct {
+    CanMsgTx_t     xReq;
+    uint32_t       ulRspId;                   /* Expected response, compared after ulRspMask */
+    uint32_t       ulRspMask;
+    uint8_t        ucKey[PWR_TRANS_KEY_LEN]; /* Leading response bytes, register or command echo */
+    uint8_t        ucKeyLen;
+    uint8_t        ucDev;
+    PwrTransDone_t pfnDone;                   /* NULL if only the answer counts */
+} PwrTrans_t;
+
+/* Per module statistics */
+typedef struct {
+    uint32_t ulReqCnt;     /* Requests sent */
+    uint32_t ulRspCnt;     /* Responses matched */
+    uint32_t ulTimeoutCnt; /* Requests without response */
+    uint32_t ulLatLast;    /* Last request to response latency (us) */
+    uint32_t ulLatMax;     /* Maximum latency (us) */
+    uint32_t ulLatSum;     /* Sum of latency (us) */
+    uint32_t ulLatHist[PWR_TRANS_HIST];
+} PwrTransStat_t;
+
+/* Functions */
+Status_t PwrTransInit(void);
+/* Runs a batch, bit n of *pulDone is set if pxTbl[n] got its response */
+Status_t PwrTransRun(const PwrTrans_t *pxTbl, uint32_t ulNum, uint32_t ulTimeoutMs, uint32_t *pulDone);
+Status_t PwrTransGetStat(uint8_t ucDev, PwrTransStat_t *pxStat);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* __PWR_TRANS_H__ */
@@ -16,6 +16,22 @@
     01e, 30Nov23, Karl Added AdcToTemp
     01f, 04Dec23, Karl Added StcGetTempH and StcGetTempL
     01g, 17Jan24, Karl Added StcGetTempHFrom
+    01h, 19Oct26, Karl Added cached group aggregates and StcGetSeq
+    01i, 19Oct26, Karl Pipelined bus polling with response notification
+    01j, 19Oct26, Karl Added bus baud rate negotiation and link statistics
+    01k, 19Oct26, Karl Added broadcast synchronized sampling
+    01l, 19Oct26, Karl Added node side filtered samples with noise metric
+    01m, 19Oct26, Karl Added node pushed alarms
+    01n, 19Oct26, Karl Added node discovery and per node polling weight
+    01o, 19Oct26, Karl Timeouts and lost nodes sent to the event log
+    01p, 19Oct26, agent Alarm thresholds kept pending till acknowledged, retried with back-off
+    01q, 19Oct26, agent Sample tick moved to the end of the broadcast, where the nodes latch
+    01r, 19Oct26, agent CLI prints the poll statistics with %lu
+    01s, 19Oct26, agent CLI prints the baud and link counters with %lu
+    01t, 19Oct26, agent CLI prints the alarm counters with %lu
+    01u, 19Oct26, agent CLI prints the cycle time and node mask with %lu
+    01v, 19Oct26, agent StcGetTempH, StcGetTempL and stc_get_info over the nodes on the bus
+    01w, 19Oct26, agent Pushed alarm statistics updated and read in a critical section, prvGetTemp table ends
 */
 
 /* Includes */
@@ -45,11 +61,24 @@
 
 /* Local defines */
 #define PD_REVERSE   1
-#define DEV_NUM      3
+#define DEV_NUM      STC_DEV_MAX
+#define DEV_MASK_DEF ((STC_EN_DEV1 << 0) | (STC_EN_DEV2 << 1) | (STC_EN_DEV3 << 2))
 #define MAX_MSG_SIZE 128
 #define RS485_RD()   GpioSetOutput(RS485a_EN, 1)
 #define RS485_WT()   GpioSetOutput(RS485a_EN, 0)
-static int16_t s_xStcValue[30] = {0};
+#define CHAN_NUM     (DEV_NUM * 10)
+#define TEMP_NUM     12 /* T1 ~ T12 */
+#define PD_LEAK_ST   12 /* PD1 ~ PD2 */
+#define PD_LEAK_NUM  2
+#define PD_LIGHT     14 /* PD3 */
+#define STC_VALUE(n) (s_xTemp[(n) / 10].sTemp[(n) % 10])
+#define BAUD_OP_PROBE 0
+#define BAUD_OP_SET   1
+#define ADDR_BCAST    0xFF
+#define SYNC_RSP_LEN  40 /* rCmdSyncTemp frame length */
+#define SYNC_CMD_LEN  17 /* iCmdSyncSample frame length */
+#define ALARM_RSP_LEN 19 /* rCmdAlarm frame length */
+#define ALARM_CFG_FAIL_MAX 8 /* Back-off stops doubling after it */
 
 /* Local types */
 #pragma pack(push)
@@ -57,8 +86,15 @@ static int16_t s_xStcValue[30] = {0};
 enum {
     iCmdQueryInfo = 0x01,
     iCmdSysReset  = 0x02,
+    iCmdBaudCfg   = 0x03,
+    iCmdSyncSample= 0x04,
+    iCmdAlarmCfg  = 0x05,
     rCmdTempInfo  = 0x81,
     rCmdDiagInfo  = 0x82,
+    rCmdBaudInfo  = 0x83,
+    rCmdSyncTemp  = 0x84,
+    rCmdAlarmInfo = 0x85,
+    rCmdAlarm     = 0x86,
 };
 
 typedef struct {
@@ -78,30 +114,120 @@ typedef struct {
     int16_t sTemp[10]; /* Raw AD value */
 } TempInfo_t;
 
+typedef struct {
+    uint8_t ucNoise[10]; /* Peak to peak AD counts within one oversampling block */
+} NoiseInfo_t;
+
 typedef struct {
     uint32_t ulSwVer;
     uint32_t ulRunTime;
     uint32_t ulAdcErrCnt;
 } DiagInfo_t;
+
+typedef struct {
+    uint8_t ucMask; /* Supported rates, bit n is StcBaud_t n */
+    uint8_t ucIdx;  /* Rate in use, or the one switched to after this frame */
+} BaudInfo_t;
+
+typedef struct {
+    uint16_t usOtTh;   /* Over temperature if raw value <= it */
+    uint16_t usPdTh;   /* PD leak if raw value >= it */
+    uint16_t usOtMask; /* Node channels checked for over temperature */
+    uint16_t usPdMask; /* Node channels checked for PD leak */
+} AlarmCfg_t;
+
+typedef struct {
+    uint8_t  ucSeq;    /* Broadcast the alarm window belongs to */
+    uint8_t  ucFlags;  /* StcAlarm_t */
+    uint8_t  ucAge;    /* Time since detection (ms) */
+    uint8_t  ucChan;
+    uint16_t usOtMask;
+    uint16_t usPdMask;
+    int16_t  sValue;
+} AlarmInfo_t;
 #pragma pack(pop)
 
 /* Forward declarations */
 static void     prvStcTask(void *pvPara);
+static Bool_t   prvQuery(uint8_t ucAddr, uint8_t ucCmd);
+static Bool_t   prvQueryBaud(uint8_t ucAddr, uint8_t ucOp, uint8_t ucIdx);
+static void     prvWaitBegin(uint8_t ucAddr, uint8_t ucCmd);
+static Bool_t   prvWaitEnd(uint8_t ucAddr);
+static void     prvRttRecord(StcBusStat_t *pxStat, uint32_t ulRtt);
+static uint32_t prvSyncQuery(void);
+static Bool_t   prvScan(uint8_t ucAddr);
+static void     prvDiscover(void);
+static void     prvRescan(void);
+static void     prvSetDevMask(uint32_t ulMask);
+static Bool_t   prvDevEn(uint8_t n);
+static Bool_t   prvTempChan(uint8_t n);
+static Bool_t   prvDevDue(uint8_t n);
 static void     prvSendCmdQueryInfo(uint8_t ucAddr, uint8_t ucCmd);
 static void     prvSendCmdSysReset(uint8_t ucAddr);
+static void     prvSendCmdBaudCfg(uint8_t ucAddr, uint8_t ucOp, uint8_t ucIdx);
+static void     prvSendCmdSyncSample(uint8_t ucSeq, uint8_t ucSlotMs, uint8_t ucAlmOfs, uint8_t ucAlmSlot, uint16_t usRspMask,
+                                     uint16_t usAlmMask);
+static void     prvSendCmdAlarmCfg(uint8_t ucAddr, const AlarmCfg_t *pxCfg);
 static void     prvCmdTempInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
 static void     prvCmdDiagInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
+static void     prvCmdBaudInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
+static void     prvCmdSyncTemp(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
+static void     prvCmdAlarmInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
+static void     prvCmdAlarm(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength);
+static void     prvAlarmCfg(void);
+static void     prvSetBaud(uint8_t ucIdx);
+static void     prvBaudNegotiate(void);
+static void     prvWinReset(void);
+static void     prvWinUpdate(uint32_t ulWinMs);
 static Status_t prvProtPktProc(const void *pvHead, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo);
 static Bool_t   prvProtPktChk(const void *pvStart, uint32_t ulLength);
 static Status_t prvUartRecv(uint8_t *pucBuf, uint16_t usLength, void *pvIsrPara);
 static int16_t  prvGetTemp(uint16_t usAdc);
+static void     prvUpdateAggr(void);
+static void     prvCalcAggr(uint8_t ucSt, uint8_t ucNum, StcAggr_t *pxAggr);
 
 /* Local variables */
 static UartHandle_t s_xUart = NULL;
 static ProtHandle_t s_xProt = NULL;
 static TempInfo_t   s_xTemp[DEV_NUM];
 static DiagInfo_t   s_xDiag[DEV_NUM];
+static NoiseInfo_t  s_xNoise[DEV_NUM];
 static Bool_t       s_bQueryDiagInfo = FALSE;
+static StcAggr_t    s_xAggr[STC_GRP_NUM];
+static uint8_t      s_ucAggrTempNum = 0;
+static volatile uint32_t s_ulSeq    = 0;
+static TaskHandle_t s_xTask         = NULL;
+static volatile uint8_t s_ucWaitAddr = 0;
+static volatile uint8_t s_ucWaitCmd  = 0;
+static StcBusStat_t s_xBusStat[DEV_NUM];
+static uint32_t     s_ulWinRspCnt[DEV_NUM];
+static uint32_t     s_ulDevMask    = 0; /* Nodes on the bus, bit n is STC-(n+1) */
+static uint32_t     s_ulLostMask   = 0; /* Missed their last sync slot */
+static uint8_t      s_ucDevWeight[DEV_NUM];
+static uint32_t     s_ulCycCnt     = 0;
+static uint8_t      s_ucScanAddr   = 0;
+static uint32_t     s_ulScanTick   = 0;
+static Bool_t       s_bScan        = FALSE;
+static uint32_t     s_ulWaitCyc = 0;
+static const uint32_t s_ulBaud[STC_BAUD_NUM] = {115200, 230400, 460800, 921600};
+static BaudInfo_t   s_xBaudInfo[DEV_NUM];
+static uint8_t      s_ucBaudIdx    = STC_BAUD_115200;
+static Bool_t       s_bBaudNeg     = FALSE;
+static uint32_t     s_ulCleanWin   = 0;
+static uint32_t     s_ulWinReqCnt  = 0;
+static uint32_t     s_ulWinErrCnt  = 0;
+static uint32_t     s_ulWinBytes   = 0;
+static StcLinkStat_t s_xLinkStat;
+static uint8_t      s_ucSyncSeq    = 0;
+static volatile uint32_t s_ulSyncPend = 0; /* Devices yet to answer the broadcast, bit n is STC-(n+1) */
+static uint32_t     s_ulSyncTick   = 0;
+static uint32_t     s_ulSampleTick = 0;
+static AlarmCfg_t   s_xAlmCfg[DEV_NUM]; /* As acknowledged by the nodes */
+static StcAlarmStat_t s_xAlmStat[DEV_NUM];
+static uint32_t     s_ulAlmCfgTick = 0;
+static uint32_t     s_ulAlmCfgPend = 0; /* Thresholds not acknowledged yet, bit n is STC-(n+1) */
+static uint8_t      s_ucAlmCfgFail[DEV_NUM]; /* Unanswered pushes in a row */
+static uint32_t     s_ulAlmCfgRetry[DEV_NUM]; /* Tick of the last unanswered push */
 
 /* Functions */
 Status_t DrvStcInit(void) {
@@ -112,6 +238,24 @@ Status_t DrvStcInit(void) {
     s_xProt              = NULL;
     memset(s_xTemp, 0, sizeof(s_xTemp));
     memset(s_xDiag, 0, sizeof(s_xDiag));
+    memset(s_xNoise, 0, sizeof(s_xNoise));
+    memset(s_xBusStat, 0, sizeof(s_xBusStat));
+    memset(s_ulWinRspCnt, 0, sizeof(s_ulWinRspCnt));
+    memset(s_xBaudInfo, 0, sizeof(s_xBaudInfo));
+    memset(&s_xLinkStat, 0, sizeof(s_xLinkStat));
+    memset(s_xAlmCfg, 0, sizeof(s_xAlmCfg));
+    memset(s_xAlmStat, 0, sizeof(s_xAlmStat));
+    memset(s_ucAlmCfgFail, 0, sizeof(s_ucAlmCfgFail));
+    s_ulAlmCfgPend          = 0;
+    memset(s_ucDevWeight, STC_DEV_WEIGHT, sizeof(s_ucDevWeight));
+    s_ulDevMask             = DEV_MASK_DEF;
+    s_xLinkStat.ucDevNum    = STC_EN_DEV1 + STC_EN_DEV2 + STC_EN_DEV3;
+    s_ucBaudIdx             = STC_BAUD_115200;
+    s_xLinkStat.ulBaud      = s_ulBaud[STC_BAUD_115200];
+    s_xLinkStat.ucBaudMask  = 1 << STC_BAUD_115200;
+    s_xLinkStat.ucBaudCap   = STC_BAUD_MAX_IDX;
+    s_bBaudNeg              = STC_BAUD_NEG ? TRUE : FALSE;
+    prvUpdateAggr();
 
     ProtInit();
     s_xProt = ProtCreate();
@@ -126,9 +270,9 @@ Status_t DrvStcInit(void) {
     UartConfigCb(s_xUart, prvUartRecv, UartIsrCb, UartDmaRxIsrCb, UartDmaTxIsrCb, NULL);
     UartConfigRxDma(s_xUart, DMA1_Channel6, DMA1_Channel6_IRQn);
     UartConfigTxDma(s_xUart, DMA1_Channel7, DMA1_Channel7_IRQn);
-    UartConfigCom(s_xUart, USART2, 115200, USART2_IRQn);
+    UartConfigCom(s_xUart, USART2, s_ulBaud[STC_BAUD_115200], USART2_IRQn);
 
-    xTaskCreate(prvStcTask, "tStc", 256, NULL, tskIDLE_PRIORITY, NULL);
+    xTaskCreate(prvStcTask, "tStc", 256, NULL, tskIDLE_PRIORITY, &s_xTask);
 
     RS485_RD();
 
@@ -148,102 +292,183 @@ int16_t StcGetPd(StcDev_t xDev, StcTempNode_t xTempNode) {
     return s_xTemp[xDev].sTemp[xTempNode];
 }
 
+uint8_t StcGetNoise(StcDev_t xDev, StcTempNode_t xTempNode) {
+    return s_xNoise[xDev].ucNoise[xTempNode];
+}
+
 int16_t StcGetTempH(void) {
     int16_t sTempH = 687;
 
-#if STC_EN_DEV1
-    for (uint8_t n = 0; n < 10; n++) {
-        if (sTempH > s_xTemp[0].sTemp[n]) {
-            sTempH = s_xTemp[0].sTemp[n];
+    for (uint8_t n = 0; n < CHAN_NUM; n++) {
+        if (prvDevEn(n / 10) && prvTempChan(n) && (sTempH > STC_VALUE(n))) {
+            sTempH = STC_VALUE(n);
         }
     }
-#endif /* STC_EN_DEV1 */
 
-#if STC_EN_DEV2
-    for (uint8_t n = 0; n < 2; n++) {
-        if (sTempH > s_xTemp[1].sTemp[n]) {
-            sTempH = s_xTemp[1].sTemp[n];
+    return sTempH;
+}
+
+int16_t StcGetTempL(void) {
+    int16_t sTempL = 2;
+
+    for (uint8_t n = 0; n < CHAN_NUM; n++) {
+        if (prvDevEn(n / 10) && prvTempChan(n) && (sTempL < STC_VALUE(n))) {
+            sTempL = STC_VALUE(n);
         }
     }
-#endif /* STC_EN_DEV2 */
 
-#if STC_EN_DEV3
-    for (uint8_t n = 0; n < 4; n++) {
-        if (sTempH > s_xTemp[2].sTemp[n]) {
-            sTempH = s_xTemp[2].sTemp[n];
-        }
+    return sTempL;
+}
+
+int16_t StcGetTempHFrom(uint8_t st, uint8_t ed) {
+    StcAggr_t xAggr;
+
+    if ((st > ed) || (ed >= CHAN_NUM)) {
+        return 687;
     }
-#endif /* STC_EN_DEV3 */
+    prvCalcAggr(st, ed - st + 1, &xAggr);
 
-    return sTempH;
+    return xAggr.sMin;
 }
 
-int16_t StcGetTempL(void) {
-    int16_t sTempL = 2;
+int16_t StcGetPdHFrom(void) {
+    return StcGetTempHGrp(STC_GRP_PD);
+}
 
-#if STC_EN_DEV1
-    for (uint8_t n = 0; n < 10; n++) {
-        if (sTempL < s_xTemp[0].sTemp[n]) {
-            sTempL = s_xTemp[0].sTemp[n];
-        }
+int16_t StcGetPdLight(void) {
+    return STC_VALUE(PD_LIGHT);
+}
+
+int16_t StcGetTempHGrp(StcGrp_t xGrp) {
+    if (xGrp >= STC_GRP_NUM) {
+        return 0;
+    }
+    if (s_ucAggrTempNum != th_TempNum) {
+        /* Group boundary changed by configuration */
+        taskENTER_CRITICAL();
+        prvUpdateAggr();
+        taskEXIT_CRITICAL();
     }
-#endif /* STC_EN_DEV1 */
 
-#if STC_EN_DEV2
-    for (uint8_t n = 0; n < 10; n++) {
-        if (sTempL < s_xTemp[1].sTemp[n]) {
-            sTempL = s_xTemp[1].sTemp[n];
-        }
+    /* Lowest raw AD value is the highest temperature, PD is the other way round */
+    return (xGrp == STC_GRP_PD) ? s_xAggr[xGrp].sMax : s_xAggr[xGrp].sMin;
+}
+
+Status_t StcGetAggr(StcGrp_t xGrp, StcAggr_t *pxAggr) {
+    if ((xGrp >= STC_GRP_NUM) || (NULL == pxAggr)) {
+        return STATUS_ERR;
     }
-#endif /* STC_EN_DEV2 */
 
-#if STC_EN_DEV3
-    for (uint8_t n = 0; n < 4; n++) {
-        if (sTempL < s_xTemp[2].sTemp[n]) {
-            sTempL = s_xTemp[2].sTemp[n];
-        }
+    taskENTER_CRITICAL();
+    if (s_ucAggrTempNum != th_TempNum) {
+        prvUpdateAggr();
     }
-#endif /* STC_EN_DEV3 */
+    *pxAggr = s_xAggr[xGrp];
+    taskEXIT_CRITICAL();
 
-    return sTempL;
+    return STATUS_OK;
 }
 
-int16_t StcGetTempHFrom(uint8_t st, uint8_t ed) {
-    int16_t sTempH = 687;
-    uint8_t index  = 0;
-#if 1
-    for (uint8_t i = 0; i <= 2; i++) {
-        for (uint8_t n = 0; n <= 9; n++) {
-            s_xStcValue[index++] = s_xTemp[i].sTemp[n];
-        }
+uint32_t StcGetSeq(void) {
+    return s_ulSeq;
+}
+
+uint32_t StcGetSampleTick(void) {
+    return s_ulSampleTick;
+}
+
+Status_t StcGetBusStat(StcDev_t xDev, StcBusStat_t *pxStat) {
+    if ((xDev >= DEV_NUM) || (NULL == pxStat)) {
+        return STATUS_ERR;
     }
-#endif
 
-    for (index = st; index <= ed; index++) {
-        if (sTempH > s_xStcValue[index]) {
-            sTempH = s_xStcValue[index];
+    taskENTER_CRITICAL();
+    *pxStat = s_xBusStat[xDev];
+    taskEXIT_CRITICAL();
+
+    return STATUS_OK;
+}
+
+Status_t StcGetLinkStat(StcLinkStat_t *pxStat) {
+    if (NULL == pxStat) {
+        return STATUS_ERR;
+    }
+
+    taskENTER_CRITICAL();
+    *pxStat = s_xLinkStat;
+    taskEXIT_CRITICAL();
+
+    return STATUS_OK;
+}
+
+uint8_t StcGetAlarm(void) {
+    uint32_t ulNow   = osKernelSysTick();
+    uint8_t  ucFlags = 0;
+
+    taskENTER_CRITICAL();
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (s_xAlmStat[n].ulCnt && ((ulNow - s_xAlmStat[n].ulTick) < STC_ALARM_HOLD_MS)) {
+            ucFlags |= s_xAlmStat[n].ucFlags;
         }
     }
+    taskEXIT_CRITICAL();
 
-    return sTempH;
+    return ucFlags;
 }
 
-int16_t StcGetPdHFrom(void) {
-    int16_t sPdH = 0;
+Status_t StcGetAlarmStat(StcDev_t xDev, StcAlarmStat_t *pxStat) {
+    if ((xDev >= DEV_NUM) || (NULL == pxStat)) {
+        return STATUS_ERR;
+    }
+
+    taskENTER_CRITICAL();
+    *pxStat = s_xAlmStat[xDev];
+    taskEXIT_CRITICAL();
+
+    return STATUS_OK;
+}
+
+uint32_t StcGetDevMask(void) {
+    return s_ulDevMask;
+}
+
+uint8_t StcGetDevNum(void) {
+    return s_xLinkStat.ucDevNum;
+}
+
+Status_t StcGetDevInfo(StcDev_t xDev, StcDevInfo_t *pxInfo) {
+    if ((xDev >= DEV_NUM) || (NULL == pxInfo)) {
+        return STATUS_ERR;
+    }
 
-    for (uint8_t index = 12; index <= 13; index++) {
-        if (sPdH < s_xStcValue[index]) {
-            sPdH = s_xStcValue[index];
+    taskENTER_CRITICAL();
+    pxInfo->ucAddr   = xDev + 1;
+    pxInfo->ucWeight = s_ucDevWeight[xDev];
+    pxInfo->usRate   = s_xBusStat[xDev].usRate;
+    pxInfo->ulSwVer  = s_xDiag[xDev].ulSwVer;
+    pxInfo->sTempH   = 687;
+    for (uint8_t n = 0; n < 10; n++) {
+        if (pxInfo->sTempH > s_xTemp[xDev].sTemp[n]) {
+            pxInfo->sTempH = s_xTemp[xDev].sTemp[n];
         }
     }
+    taskEXIT_CRITICAL();
 
-    return sPdH;
+    return STATUS_OK;
 }
 
-int16_t StcGetPdLight(void) {
-    int16_t sPdH = 0;
-    sPdH = s_xStcValue[14];
-    return sPdH;
+Status_t StcSetWeight(StcDev_t xDev, uint8_t ucWeight) {
+    if ((xDev >= DEV_NUM) || (0 == ucWeight)) {
+        return STATUS_ERR;
+    }
+
+    s_ucDevWeight[xDev] = ucWeight;
+
+    return STATUS_OK;
+}
+
+void StcScan(void) {
+    s_bScan = TRUE;
 }
 
 int16_t AdcToTemp(uint16_t usAdc) {
@@ -251,75 +476,318 @@ int16_t AdcToTemp(uint16_t usAdc) {
 }
 
 static void prvStcTask(void *pvPara) {
-#define INTERVAL 10
-    uint16_t n = 0;
+    uint32_t ulWinTick = osKernelSysTick();
+
+#if STC_DISCOVERY
+    s_bScan = TRUE;
+#endif /* STC_DISCOVERY */
+
     while (1) {
-        uint16_t offset = 0;
-        uint16_t delay  = STC_QUERY_TASK_DELAY;
+        uint32_t ulStart = osKernelSysTick();
+
+#if STC_DISCOVERY
+        /* Full scan at boot or on request, otherwise one absent address now and then */
+        if (s_bScan) {
+            s_bScan = FALSE;
+            prvDiscover();
+            s_ulScanTick = osKernelSysTick();
+        }
+        else if ((osKernelSysTick() - s_ulScanTick) >= STC_SCAN_PRD) {
+            prvRescan();
+            s_ulScanTick = osKernelSysTick();
+        }
+#endif /* STC_DISCOVERY */
+
+#if STC_BAUD_NEG
+        /* Bus rate only changes between two poll cycles */
+        if (s_bBaudNeg) {
+            s_bBaudNeg = FALSE;
+            prvBaudNegotiate();
+            prvWinReset();
+            ulWinTick = osKernelSysTick();
+        }
+#endif /* STC_BAUD_NEG */
+
+        uint32_t ulCyc = TimeCycGet();
+
+#if STC_ALARM_PUSH
+        prvAlarmCfg();
+#endif /* STC_ALARM_PUSH */
 
         /* Query temp info */
-        if ((n % (STC_QUERY_TEMP_PRD / STC_QUERY_TASK_DELAY)) == 0) {
-#if STC_EN_DEV1
-            prvSendCmdQueryInfo(1, rCmdTempInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV1 */
-#if STC_EN_DEV2
-            prvSendCmdQueryInfo(2, rCmdTempInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV2 */
-#if STC_EN_DEV3
-            prvSendCmdQueryInfo(3, rCmdTempInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV3 */
-        }
-
-        /* Query diag info */
-#if 0 /* Periodic query */
-        if ((n % (STC_QUERY_DIAG_PRD / STC_QUERY_TASK_DELAY)) == 0) {
-#if STC_EN_DEV1
-            prvSendCmdQueryInfo(1, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV1 */
-#if STC_EN_DEV2
-            prvSendCmdQueryInfo(2, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV2 */
-#if STC_EN_DEV3
-            prvSendCmdQueryInfo(3, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV3 */
+#if STC_SYNC_SAMPLE
+        uint32_t ulMiss = prvSyncQuery();
+#else
+        uint32_t ulMiss = 0xFFFFFFFF;
+#endif /* STC_SYNC_SAMPLE */
+
+        /* Poll one by one whoever missed its slot, next device is addressed as soon as the previous one answered */
+        for (uint8_t n = 0; n < DEV_NUM; n++) {
+            if (prvDevEn(n) && prvDevDue(n) && (ulMiss & (1UL << n))) {
+                prvQuery(n + 1, rCmdTempInfo);
+            }
         }
-#endif
-#if 1 /* Oneshot query */
+        s_ulCycCnt++;
+
+        /* Cycle time against node count, see stc_bus_stat */
+        ulCyc                 = TimeCycToUs(TimeCycGet() - ulCyc);
+        s_xLinkStat.ulCycLast = ulCyc;
+        if (ulCyc > s_xLinkStat.ulCycMax) {
+            s_xLinkStat.ulCycMax = ulCyc;
+        }
+
+        /* Oneshot query diag info */
         if (s_bQueryDiagInfo) {
-#if STC_EN_DEV1
-            prvSendCmdQueryInfo(1, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV1 */
-#if STC_EN_DEV2
-            prvSendCmdQueryInfo(2, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV2 */
-#if STC_EN_DEV3
-            prvSendCmdQueryInfo(3, rCmdDiagInfo);
-            osDelay(INTERVAL);
-            offset += INTERVAL;
-#endif /* STC_EN_DEV3 */
+            for (uint8_t n = 0; n < DEV_NUM; n++) {
+                if (prvDevEn(n)) {
+                    prvQuery(n + 1, rCmdDiagInfo);
+                }
+            }
             s_bQueryDiagInfo = FALSE;
         }
-#endif
-        n++;
-        (offset > STC_QUERY_TASK_DELAY) ? (delay = 0) : (delay -= offset);
-        osDelay(delay);
+
+        /* Achieved refresh rate, bus utilization and error rate */
+        if ((osKernelSysTick() - ulWinTick) >= STC_RATE_WINDOW) {
+            prvWinUpdate(osKernelSysTick() - ulWinTick);
+            ulWinTick = osKernelSysTick();
+        }
+
+        /* Keep the minimum cycle period, always give up the cpu at least one tick */
+        uint32_t ulUsed = osKernelSysTick() - ulStart;
+        osDelay((ulUsed < STC_QUERY_TEMP_PRD) ? (STC_QUERY_TEMP_PRD - ulUsed) : 1);
+    }
+}
+
+static Bool_t prvQuery(uint8_t ucAddr, uint8_t ucCmd) {
+    prvWaitBegin(ucAddr, ucCmd);
+    prvSendCmdQueryInfo(ucAddr, ucCmd);
+    return prvWaitEnd(ucAddr);
+}
+
+static Bool_t prvQueryBaud(uint8_t ucAddr, uint8_t ucOp, uint8_t ucIdx) {
+    prvWaitBegin(ucAddr, rCmdBaudInfo);
+    prvSendCmdBaudCfg(ucAddr, ucOp, ucIdx);
+    return prvWaitEnd(ucAddr);
+}
+
+static void prvWaitBegin(uint8_t ucAddr, uint8_t ucCmd) {
+    /* Drop a completion left over from a late response */
+    ulTaskNotifyTake(pdTRUE, 0);
+    s_ucWaitCmd  = ucCmd;
+    s_ucWaitAddr = ucAddr;
+
+    s_xBusStat[ucAddr - 1].ulReqCnt++;
+    s_ulWaitCyc = TimeCycGet();
+}
+
+static Bool_t prvWaitEnd(uint8_t ucAddr) {
+    StcBusStat_t *pxStat = &s_xBusStat[ucAddr - 1];
+    uint32_t      ulRtt;
+
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STC_RSP_TIMEOUT)) == 0) {
+        EvtLog(EVT_STC_TIMEOUT, ucAddr, s_ucWaitCmd, 0, 0);
+        s_ucWaitAddr = 0;
+        pxStat->ulTimeoutCnt++;
+        return FALSE;
+    }
+
+    ulRtt = TimeCycToUs(TimeCycGet() - s_ulWaitCyc);
+    prvRttRecord(pxStat, ulRtt);
+
+    return TRUE;
+}
+
+static void prvRttRecord(StcBusStat_t *pxStat, uint32_t ulRtt) {
+    pxStat->ulRttLast = ulRtt;
+    pxStat->ulRttSum += ulRtt;
+    if (ulRtt > pxStat->ulRttMax) {
+        pxStat->ulRttMax = ulRtt;
+    }
+    pxStat->ulRspCnt++;
+}
+
+static uint32_t prvSyncQuery(void) {
+    uint32_t ulExp = 0;
+    uint32_t ulMiss;
+    uint8_t  ucNum = 0;
+    uint8_t  ucSlot;
+    uint8_t  ucAlmOfs  = 0;
+    uint8_t  ucAlmSlot = 0;
+    uint32_t ulCmdMs   = (SYNC_CMD_LEN * 10 * 1000 + s_xLinkStat.ulBaud - 1) / s_xLinkStat.ulBaud;
+
+    /* Only nodes due this cycle answer, their slots are packed in address order */
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (prvDevEn(n) && prvDevDue(n)) {
+            ulExp |= 1UL << n;
+            ucNum++;
+            s_xBusStat[n].ulReqCnt++;
+        }
+    }
+
+    /* Slot holds one response frame at the current rate plus a margin for node timer jitter */
+    ucSlot = (uint8_t)((SYNC_RSP_LEN * 10 * 1000 + s_xLinkStat.ulBaud - 1) / s_xLinkStat.ulBaud + STC_SYNC_GUARD_MS);
+#if STC_ALARM_PUSH
+    /* Alarm window follows the last slot, one short slot per node on the bus whether due or not */
+    ucAlmOfs  = ucSlot * ucNum;
+    ucAlmSlot = (uint8_t)((ALARM_RSP_LEN * 10 * 1000 + s_xLinkStat.ulBaud - 1) / s_xLinkStat.ulBaud + STC_SYNC_GUARD_MS);
+#endif /* STC_ALARM_PUSH */
+
+    /* Drop a completion left over from a late response */
+    ulTaskNotifyTake(pdTRUE, 0);
+    s_ucSyncSeq++;
+    s_ulSyncPend = ulExp;
+    s_ulWaitCyc  = TimeCycGet();
+    s_ulSyncTick = osKernelSysTick();
+    prvSendCmdSyncSample(s_ucSyncSeq, ucSlot, ucAlmOfs, ucAlmSlot, (uint16_t)ulExp, (uint16_t)s_ulDevMask);
+
+    if (ulExp) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ucSlot * ucNum + STC_RSP_TIMEOUT));
+    }
+
+    taskENTER_CRITICAL();
+    ulMiss       = s_ulSyncPend;
+    s_ulSyncPend = 0;
+    taskEXIT_CRITICAL();
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (ulMiss & (1UL << n)) {
+            s_xBusStat[n].ulTimeoutCnt++;
+        }
+    }
+    /* Only the changes reach the event log */
+    if ((ulMiss & ~s_ulLostMask) || (s_ulLostMask & ulExp & ~ulMiss)) {
+        for (uint8_t n = 0; n < DEV_NUM; n++) {
+            if ((ulMiss & ~s_ulLostMask) & (1UL << n)) {
+                EvtLog(EVT_STC_LOST, n + 1, 0, 0, 0);
+            }
+            else if ((s_ulLostMask & ulExp & ~ulMiss) & (1UL << n)) {
+                EvtLog(EVT_STC_BACK, n + 1, 0, 0, 0);
+            }
+        }
+        s_ulLostMask = (s_ulLostMask & ~ulExp) | ulMiss;
     }
+    /* Node uart isrs latch the values on the last byte of the broadcast */
+    if (ulMiss != ulExp) {
+        s_ulSampleTick = s_ulSyncTick + ulCmdMs;
+    }
+
+#if STC_ALARM_PUSH
+    /* Keep off the bus till the alarm window is over, the nodes time their slots from that same last byte */
+    uint32_t ulEnd = s_ulSyncTick + ulCmdMs + ucAlmOfs + ucAlmSlot * s_xLinkStat.ucDevNum;
+    int32_t  lLeft = (int32_t)(ulEnd - osKernelSysTick());
+    if (lLeft > 0) {
+        osDelay(lLeft);
+    }
+#endif /* STC_ALARM_PUSH */
+
+    return ulMiss;
+}
+
+static Bool_t prvScan(uint8_t ucAddr) {
+    /* Like prvQuery but short and without statistics, most addresses are empty */
+    ulTaskNotifyTake(pdTRUE, 0);
+    s_ucWaitCmd  = rCmdDiagInfo;
+    s_ucWaitAddr = ucAddr;
+    prvSendCmdQueryInfo(ucAddr, rCmdDiagInfo);
+
+    if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STC_SCAN_TIMEOUT)) == 0) {
+        s_ucWaitAddr = 0;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+static void prvDiscover(void) {
+    uint32_t ulMask = 0;
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (prvScan(n + 1)) {
+            ulMask |= 1UL << n;
+        }
+    }
+    TRACE("Scan: mask 0x%04X\n", ulMask);
+
+    if (0 == ulMask) {
+        /* Bus not up yet, poll the boards this build expects and pick up the rest later */
+        ulMask = DEV_MASK_DEF;
+    }
+    prvSetDevMask(ulMask);
+}
+
+static void prvRescan(void) {
+    uint8_t ucOld = s_ucBaudIdx;
+    uint8_t n;
+    Bool_t  bFound;
+
+    /* Next absent address, round robin. Nodes only answer, nothing else tells of a new one */
+    for (n = 0; n < DEV_NUM; n++) {
+        s_ucScanAddr = (s_ucScanAddr % DEV_NUM) + 1;
+        if (!prvDevEn(s_ucScanAddr - 1)) {
+            break;
+        }
+    }
+    if (n == DEV_NUM) {
+        return;
+    }
+
+    /* A node powered up later listens at the default rate, the others ignore the frame */
+    if (ucOld != STC_BAUD_115200) {
+        prvSetBaud(STC_BAUD_115200);
+    }
+    bFound = prvScan(s_ucScanAddr);
+    if (ucOld != STC_BAUD_115200) {
+        prvSetBaud(ucOld);
+    }
+    if (!bFound) {
+        return;
+    }
+    TRACE("Scan: found STC-%d\n", s_ucScanAddr);
+
+    if (ucOld != STC_BAUD_115200) {
+        /* Bring the others back to the default rate, negotiated up again together with the new one */
+        for (n = 0; n < DEV_NUM; n++) {
+            if (prvDevEn(n)) {
+                prvQueryBaud(n + 1, BAUD_OP_SET, STC_BAUD_115200);
+            }
+        }
+        prvSetBaud(STC_BAUD_115200);
+    }
+    prvSetDevMask(s_ulDevMask | (1UL << (s_ucScanAddr - 1)));
+}
+
+static void prvSetDevMask(uint32_t ulMask) {
+    uint8_t ucNum = 0;
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (ulMask & (1UL << n)) {
+            ucNum++;
+        }
+    }
+    s_ulDevMask          = ulMask;
+    s_xLinkStat.ucDevNum = ucNum;
+    memset(s_xAlmCfg, 0, sizeof(s_xAlmCfg));
+    memset(s_ucAlmCfgFail, 0, sizeof(s_ucAlmCfgFail));
+    s_ulAlmCfgTick = osKernelSysTick() - STC_ALARM_CFG_PRD;
+
+#if STC_BAUD_NEG
+    /* Common rate has to cover the new set */
+    s_bBaudNeg = TRUE;
+#endif /* STC_BAUD_NEG */
+}
+
+static Bool_t prvDevEn(uint8_t n) {
+    return (s_ulDevMask & (1UL << n)) ? TRUE : FALSE;
+}
+
+/* T1 ~ T12 on STC-1 and STC-2, the PDs after them, every channel of a node discovered behind them */
+static Bool_t prvTempChan(uint8_t n) {
+    return ((n < TEMP_NUM) || (n >= 20)) ? TRUE : FALSE;
+}
+
+static Bool_t prvDevDue(uint8_t n) {
+    /* Stagger by address so nodes with the same weight do not bunch up in one cycle */
+    return (((s_ulCycCnt + n) % s_ucDevWeight[n]) == 0) ? TRUE : FALSE;
 }
 
 static void prvSendCmdQueryInfo(uint8_t ucAddr, uint8_t ucCmd) {
@@ -350,6 +818,7 @@ static void prvSendCmdQueryInfo(uint8_t ucAddr, uint8_t ucCmd) {
     c[7] = sum;
 
     UartBlkSend(s_xUart, c, LEN1, 50);
+    s_xLinkStat.ulTxBytes += LEN1;
 
     /* Enable RS485 read */
     RS485_RD();
@@ -386,20 +855,374 @@ static void prvSendCmdSysReset(uint8_t ucAddr) {
     c[10] = sum;
 
     UartBlkSend(s_xUart, c, LEN2, 50);
+    s_xLinkStat.ulTxBytes += LEN2;
+
+    /* Enable RS485 read */
+    RS485_RD();
+}
+
+static void prvSendCmdBaudCfg(uint8_t ucAddr, uint8_t ucOp, uint8_t ucIdx) {
+#define LEN3 11
+    static uint8_t c[LEN3];
+    uint8_t        i = 0, n = 0, sum = 0;
+
+    /* Enable RS485 write */
+    RS485_WT();
+
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN3;
+    c[i++] = iCmdBaudCfg;
+    c[i++] = 0;
+    c[i++] = ucAddr;
+    /* Content */
+    c[i++] = ucOp;
+    c[i++] = ucIdx;
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN3; n++) {
+        sum += c[n];
+    }
+    sum  = 0xFF - sum;
+    c[8] = sum;
+
+    UartBlkSend(s_xUart, c, LEN3, 50);
+    s_xLinkStat.ulTxBytes += LEN3;
+
+    /* Enable RS485 read */
+    RS485_RD();
+}
+
+static void prvSendCmdSyncSample(uint8_t ucSeq, uint8_t ucSlotMs, uint8_t ucAlmOfs, uint8_t ucAlmSlot, uint16_t usRspMask,
+                                 uint16_t usAlmMask) {
+#define LEN4 SYNC_CMD_LEN
+    static uint8_t c[LEN4];
+    uint8_t        i = 0, n = 0, sum = 0;
+
+    /* Enable RS485 write */
+    RS485_WT();
+
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN4;
+    c[i++] = iCmdSyncSample;
+    c[i++] = 0;
+    c[i++] = ADDR_BCAST;
+    /* Content */
+    c[i++] = ucSeq;
+    c[i++] = ucSlotMs;
+    c[i++] = ucAlmOfs;
+    c[i++] = ucAlmSlot;
+    c[i++] = usRspMask & 0xFF;
+    c[i++] = (usRspMask >> 8) & 0xFF;
+    c[i++] = usAlmMask & 0xFF;
+    c[i++] = (usAlmMask >> 8) & 0xFF;
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN4; n++) {
+        sum += c[n];
+    }
+    sum   = 0xFF - sum;
+    c[14] = sum;
+
+    UartBlkSend(s_xUart, c, LEN4, 50);
+    s_xLinkStat.ulTxBytes += LEN4;
+
+    /* Enable RS485 read */
+    RS485_RD();
+}
+
+static void prvSendCmdAlarmCfg(uint8_t ucAddr, const AlarmCfg_t *pxCfg) {
+#define LEN5 17
+    static uint8_t c[LEN5];
+    uint8_t        i = 0, n = 0, sum = 0;
+
+    /* Enable RS485 write */
+    RS485_WT();
+
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN5;
+    c[i++] = iCmdAlarmCfg;
+    c[i++] = 0;
+    c[i++] = ucAddr;
+    /* Content */
+    memcpy(&c[i], pxCfg, sizeof(AlarmCfg_t));
+    i += sizeof(AlarmCfg_t);
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN5; n++) {
+        sum += c[n];
+    }
+    sum   = 0xFF - sum;
+    c[14] = sum;
+
+    UartBlkSend(s_xUart, c, LEN5, 50);
+    s_xLinkStat.ulTxBytes += LEN5;
 
     /* Enable RS485 read */
     RS485_RD();
 }
 
+static void prvAlarmCfg(void) {
+    static AlarmCfg_t xCfg[DEV_NUM];
+    uint8_t    ucTempNum = th_TempNum;
+    Bool_t     bPrd      = FALSE;
+
+    /* Same channels and thresholds as prvChkAPwr, split per node */
+    if (ucTempNum > TEMP_NUM) {
+        ucTempNum = TEMP_NUM;
+    }
+    memset(xCfg, 0, sizeof(xCfg));
+    for (uint8_t n = 0; n < TEMP_NUM; n++) {
+        if ((n < ucTempNum) ? th_ModEn.TEMP1 : th_ModEn.TEMP2) {
+            xCfg[n / 10].usOtMask |= 1 << (n % 10);
+        }
+    }
+    if (th_ModEn.PD) {
+        for (uint8_t n = PD_LEAK_ST; n < PD_LEAK_ST + PD_LEAK_NUM; n++) {
+            xCfg[n / 10].usPdMask |= 1 << (n % 10);
+        }
+    }
+
+    /* Nodes forget it on reset, refresh it now and then */
+    if ((osKernelSysTick() - s_ulAlmCfgTick) >= STC_ALARM_CFG_PRD) {
+        s_ulAlmCfgTick = osKernelSysTick();
+        bPrd           = TRUE;
+    }
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        uint32_t ulBit = 1UL << n;
+        if (!prvDevEn(n)) {
+            continue;
+        }
+        xCfg[n].usOtTh = th_OtCutTh;
+        xCfg[n].usPdTh = th_PdWarnL1;
+        if (bPrd || memcmp(&xCfg[n], &s_xAlmCfg[n], sizeof(AlarmCfg_t))) {
+            s_ulAlmCfgPend |= ulBit;
+        }
+        if (!(s_ulAlmCfgPend & ulBit)) {
+            continue;
+        }
+        /* Unanswered, next cycle first and then twice as late each time, at most once per refresh period */
+        if (s_ucAlmCfgFail[n]) {
+            uint32_t ulWait = (uint32_t)STC_QUERY_TEMP_PRD << (s_ucAlmCfgFail[n] - 1);
+            if ((osKernelSysTick() - s_ulAlmCfgRetry[n]) < ((ulWait < STC_ALARM_CFG_PRD) ? ulWait : STC_ALARM_CFG_PRD)) {
+                continue;
+            }
+        }
+        prvWaitBegin(n + 1, rCmdAlarmInfo);
+        prvSendCmdAlarmCfg(n + 1, &xCfg[n]);
+        /* s_xAlmCfg is what the node answered with, copied by prvCmdAlarmInfo */
+        if (prvWaitEnd(n + 1)) {
+            s_ulAlmCfgPend &= ~ulBit;
+            s_ucAlmCfgFail[n] = 0;
+        }
+        else {
+            /* Lost, or older node firmware without alarms */
+            if (s_ucAlmCfgFail[n] < ALARM_CFG_FAIL_MAX) {
+                s_ucAlmCfgFail[n]++;
+            }
+            s_ulAlmCfgRetry[n] = osKernelSysTick();
+        }
+    }
+}
+
+static void prvSetBaud(uint8_t ucIdx) {
+    UartStopIt(s_xUart);
+    UartConfigCom(s_xUart, USART2, s_ulBaud[ucIdx], USART2_IRQn);
+    s_ucBaudIdx        = ucIdx;
+    s_xLinkStat.ulBaud = s_ulBaud[ucIdx];
+
+    /* Nodes switch 1ms after their acknowledge has been sent */
+    osDelay(2);
+}
+
+static void prvBaudNegotiate(void) {
+    uint8_t ucMask = (1 << STC_BAUD_NUM) - 1;
+    uint8_t ucOld  = s_ucBaudIdx;
+    uint8_t ucIdx;
+    Bool_t  bOk    = TRUE;
+
+    /* Probe supported rates at the current rate */
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        if (prvDevEn(n)) {
+            if (!prvQueryBaud(n + 1, BAUD_OP_PROBE, 0)) {
+                TRACE("Baud: probe failed on STC-%d\n", n + 1);
+                s_xLinkStat.ulNegFailCnt++;
+                if (s_ucBaudIdx > s_xLinkStat.ucBaudCap) {
+                    /* Nodes fall back to the default rate by themselves without valid frames */
+                    prvSetBaud(STC_BAUD_115200);
+                    s_xLinkStat.ulDownCnt++;
+                }
+                return;
+            }
+            ucMask &= s_xBaudInfo[n].ucMask;
+        }
+    }
+    s_xLinkStat.ucBaudMask = ucMask;
+
+    /* Highest common rate within the cap */
+    for (ucIdx = s_xLinkStat.ucBaudCap; ucIdx > STC_BAUD_115200; ucIdx--) {
+        if (ucMask & (1 << ucIdx)) {
+            break;
+        }
+    }
+    if (ucIdx == ucOld) {
+        return;
+    }
+
+    /* Nodes acknowledge at the old rate, then switch */
+    for (uint8_t n = 0; (n < DEV_NUM) && bOk; n++) {
+        if (prvDevEn(n)) {
+            if (!prvQueryBaud(n + 1, BAUD_OP_SET, ucIdx) || (s_xBaudInfo[n].ucIdx != ucIdx)) {
+                TRACE("Baud: set failed on STC-%d\n", n + 1);
+                bOk = FALSE;
+            }
+        }
+    }
+
+    /* Verify the new rate with a normal poll */
+    if (bOk) {
+        prvSetBaud(ucIdx);
+        for (uint8_t n = 0; (n < DEV_NUM) && bOk; n++) {
+            if (prvDevEn(n) && !prvQuery(n + 1, rCmdTempInfo)) {
+                TRACE("Baud: verify failed on STC-%d\n", n + 1);
+                bOk = FALSE;
+            }
+        }
+    }
+
+    if (!bOk) {
+        /* Bus may be split between rates, start over from the default one */
+        s_xLinkStat.ulNegFailCnt++;
+        if (ucIdx > ucOld) {
+            s_xLinkStat.ucBaudCap = ucIdx - 1;
+        }
+        prvSetBaud(STC_BAUD_115200);
+        ucIdx = STC_BAUD_115200;
+    }
+
+    if (ucIdx > ucOld) {
+        s_xLinkStat.ulUpCnt++;
+    }
+    else if (ucIdx < ucOld) {
+        s_xLinkStat.ulDownCnt++;
+    }
+    TRACE("Baud: %d\n", s_xLinkStat.ulBaud);
+}
+
 static void prvCmdTempInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
     TRACE("rCmdTempInfo\n");
 
-    if (ulLength != sizeof(TempInfo_t)) {
+    /* Older node firmware sends no noise */
+    if ((ulLength != sizeof(TempInfo_t)) && (ulLength != (sizeof(TempInfo_t) + sizeof(NoiseInfo_t)))) {
         TRACE("    Wrong length\n");
         return;
     }
 
-    memcpy(&s_xTemp[ucSrcAddr - 1], pucCont, ulLength);
+    memcpy(&s_xTemp[ucSrcAddr - 1], pucCont, sizeof(TempInfo_t));
+    if (ulLength > sizeof(TempInfo_t)) {
+        memcpy(&s_xNoise[ucSrcAddr - 1], pucCont + sizeof(TempInfo_t), sizeof(NoiseInfo_t));
+    }
+    prvUpdateAggr();
+    s_ulSeq++;
+}
+
+static void prvUpdateAggr(void) {
+    uint8_t ucTempNum = th_TempNum;
+
+    /* Temperature group 1: T1 ~ T(TempNum), group 2: T(TempNum + 1) ~ T12 */
+    if (ucTempNum > TEMP_NUM) {
+        ucTempNum = TEMP_NUM;
+    }
+    prvCalcAggr(0, ucTempNum, &s_xAggr[STC_GRP_TEMP1]);
+    prvCalcAggr(ucTempNum, TEMP_NUM - ucTempNum, &s_xAggr[STC_GRP_TEMP2]);
+    prvCalcAggr(PD_LEAK_ST, PD_LEAK_NUM, &s_xAggr[STC_GRP_PD]);
+    s_ucAggrTempNum = th_TempNum;
+}
+
+static void prvCalcAggr(uint8_t ucSt, uint8_t ucNum, StcAggr_t *pxAggr) {
+    /* An empty group keeps the "nothing is hot" defaults */
+    pxAggr->sMin      = 687;
+    pxAggr->sMax      = 0;
+    pxAggr->ucMinChan = 0xFF;
+    pxAggr->ucMaxChan = 0xFF;
+
+    for (uint8_t n = ucSt; n < ucSt + ucNum; n++) {
+        int16_t v = STC_VALUE(n);
+        if (pxAggr->sMin > v) {
+            pxAggr->sMin      = v;
+            pxAggr->ucMinChan = n;
+        }
+        if (pxAggr->sMax < v) {
+            pxAggr->sMax      = v;
+            pxAggr->ucMaxChan = n;
+        }
+    }
+}
+
+static void prvWinReset(void) {
+    s_ulWinReqCnt = 0;
+    s_ulWinErrCnt = 0;
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        s_ulWinRspCnt[n] = s_xBusStat[n].ulRspCnt;
+        s_ulWinReqCnt += s_xBusStat[n].ulReqCnt;
+        s_ulWinErrCnt += s_xBusStat[n].ulTimeoutCnt + s_xBusStat[n].ulCrcErrCnt;
+    }
+    s_ulWinBytes = s_xLinkStat.ulTxBytes + s_xLinkStat.ulRxBytes;
+}
+
+static void prvWinUpdate(uint32_t ulWinMs) {
+    uint32_t ulReq   = 0;
+    uint32_t ulErr   = 0;
+    uint32_t ulBytes = s_xLinkStat.ulTxBytes + s_xLinkStat.ulRxBytes;
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        s_xBusStat[n].usRate = (uint16_t)((s_xBusStat[n].ulRspCnt - s_ulWinRspCnt[n]) * 1000 / ulWinMs);
+        ulReq += s_xBusStat[n].ulReqCnt;
+        ulErr += s_xBusStat[n].ulTimeoutCnt + s_xBusStat[n].ulCrcErrCnt;
+    }
+    ulReq -= s_ulWinReqCnt;
+    ulErr -= s_ulWinErrCnt;
+    ulBytes -= s_ulWinBytes;
+
+    /* 10 bits per byte on the wire */
+    s_xLinkStat.usUtil    = (uint16_t)((uint64_t)ulBytes * 10 * 1000 * 1000 / ((uint64_t)s_xLinkStat.ulBaud * ulWinMs));
+    s_xLinkStat.usErrRate = ulReq ? (uint16_t)(ulErr * 1000 / ulReq) : 0;
+
+#if STC_BAUD_NEG
+    if ((ulReq >= STC_BAUD_MIN_REQ) && (ulErr * 100 > ulReq * STC_BAUD_ERR_PCT) && (s_ucBaudIdx > STC_BAUD_115200)) {
+        /* Step down one rate */
+        s_xLinkStat.ucBaudCap = s_ucBaudIdx - 1;
+        s_ulCleanWin          = 0;
+        s_bBaudNeg            = TRUE;
+    }
+    else if (ulErr == 0) {
+        /* Try one step up after a long clean period */
+        if ((++s_ulCleanWin >= STC_BAUD_RETRY_WIN) && (s_ucBaudIdx < STC_BAUD_MAX_IDX)) {
+            if (s_xLinkStat.ucBaudCap < STC_BAUD_MAX_IDX) {
+                s_xLinkStat.ucBaudCap++;
+            }
+            s_ulCleanWin = 0;
+            s_bBaudNeg   = TRUE;
+        }
+    }
+    else {
+        s_ulCleanWin = 0;
+    }
+#endif /* STC_BAUD_NEG */
+
+    prvWinReset();
 }
 
 static void prvCmdDiagInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
@@ -413,11 +1236,91 @@ static void prvCmdDiagInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t u
     memcpy(&s_xDiag[ucSrcAddr - 1], pucCont, ulLength);
 }
 
+static void prvCmdBaudInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
+    TRACE("rCmdBaudInfo\n");
+
+    if (ulLength != sizeof(BaudInfo_t)) {
+        TRACE("    Wrong length\n");
+        return;
+    }
+
+    memcpy(&s_xBaudInfo[ucSrcAddr - 1], pucCont, ulLength);
+}
+
+static void prvCmdSyncTemp(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
+    uint32_t ulBit = 1UL << (ucSrcAddr - 1);
+
+    TRACE("rCmdSyncTemp\n");
+
+    if ((ulLength != (1 + sizeof(TempInfo_t))) && (ulLength != (1 + sizeof(TempInfo_t) + sizeof(NoiseInfo_t)))) {
+        TRACE("    Wrong length\n");
+        return;
+    }
+
+    /* Late answer to an earlier broadcast */
+    if ((pucCont[0] != s_ucSyncSeq) || !(s_ulSyncPend & ulBit)) {
+        TRACE("    Stale\n");
+        return;
+    }
+
+    prvCmdTempInfo(ucSrcAddr, pucCont + 1, ulLength - 1);
+    prvRttRecord(&s_xBusStat[ucSrcAddr - 1], TimeCycToUs(TimeCycGet() - s_ulWaitCyc));
+
+    /* Wake up the poller once the last slot is in */
+    s_ulSyncPend &= ~ulBit;
+    if ((0 == s_ulSyncPend) && s_xTask) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        vTaskNotifyGiveFromISR(s_xTask, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+}
+
+static void prvCmdAlarmInfo(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
+    TRACE("rCmdAlarmInfo\n");
+
+    if (ulLength != sizeof(AlarmCfg_t)) {
+        TRACE("    Wrong length\n");
+        return;
+    }
+
+    memcpy(&s_xAlmCfg[ucSrcAddr - 1], pucCont, ulLength);
+}
+
+static void prvCmdAlarm(uint8_t ucSrcAddr, const uint8_t *pucCont, uint32_t ulLength) {
+    StcAlarmStat_t *pxStat = &s_xAlmStat[ucSrcAddr - 1];
+    AlarmInfo_t     xInfo;
+    uint32_t        ulLat;
+
+    TRACE("rCmdAlarm\n");
+
+    if (ulLength != sizeof(AlarmInfo_t)) {
+        TRACE("    Wrong length\n");
+        return;
+    }
+    memcpy(&xInfo, pucCont, ulLength);
+
+    /* Posted straight to the interlock, prvChkAPwr sees it on its next run */
+    ulLat             = xInfo.ucAge + (ALARM_RSP_LEN * 10 * 1000 + s_xLinkStat.ulBaud - 1) / s_xLinkStat.ulBaud;
+    taskENTER_CRITICAL();
+    pxStat->ulTick    = osKernelSysTick();
+    pxStat->ucFlags   = xInfo.ucFlags;
+    pxStat->ucChan    = xInfo.ucChan;
+    pxStat->sValue    = xInfo.sValue;
+    pxStat->usOtMask  = xInfo.usOtMask;
+    pxStat->usPdMask  = xInfo.usPdMask;
+    pxStat->ulLatLast = ulLat;
+    if (ulLat > pxStat->ulLatMax) {
+        pxStat->ulLatMax = ulLat;
+    }
+    pxStat->ulCnt++;
+    taskEXIT_CRITICAL();
+}
+
 static Status_t prvProtPktProc(const void *pvHead, const uint8_t *pucCont, uint32_t ulLength, void *pvInfo) {
     Head_t *p = (Head_t *)pvHead;
 
     /* Check source address */
-    if ((p->ucSrcAddr < 1) || (3 < p->ucSrcAddr)) {
+    if ((p->ucSrcAddr < 1) || (DEV_NUM < p->ucSrcAddr)) {
         TRACE("Com err: src addr\n");
         return STATUS_ERR;
     }
@@ -436,26 +1339,59 @@ static Status_t prvProtPktProc(const void *pvHead, const uint8_t *pucCont, uint3
     case rCmdDiagInfo:
         prvCmdDiagInfo(p->ucSrcAddr, pucCont, ulLength);
         break;
+    case rCmdBaudInfo:
+        prvCmdBaudInfo(p->ucSrcAddr, pucCont, ulLength);
+        break;
+    case rCmdSyncTemp:
+        prvCmdSyncTemp(p->ucSrcAddr, pucCont, ulLength);
+        break;
+    case rCmdAlarmInfo:
+        prvCmdAlarmInfo(p->ucSrcAddr, pucCont, ulLength);
+        break;
+    case rCmdAlarm:
+        prvCmdAlarm(p->ucSrcAddr, pucCont, ulLength);
+        break;
     default:
         break;
     }
 
+    /* Wake up the poller if this is the response it waits for */
+    if ((p->ucSrcAddr == s_ucWaitAddr) && (p->ucCmd == s_ucWaitCmd) && s_xTask) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        s_ucWaitAddr                        = 0;
+        vTaskNotifyGiveFromISR(s_xTask, &xHigherPriorityTaskWoken);
+        portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+    }
+
     return STATUS_OK;
 }
 
 static Bool_t prvProtPktChk(const void *pvStart, uint32_t ulLength) {
     uint8_t ucSum = 0;
+    uint8_t ucSrc = ((const Head_t *)pvStart)->ucSrcAddr;
 
     for (uint32_t n = 0; n < ulLength; n++) {
         ucSum += *((uint8_t *)pvStart + n);
     }
 
-    return (0xFF == ucSum) ? TRUE : FALSE;
+    if (0xFF != ucSum) {
+        /* Source address may be corrupted too, charge it to the device being polled */
+        if ((ucSrc < 1) || (DEV_NUM < ucSrc)) {
+            ucSrc = s_ucWaitAddr;
+        }
+        if (ucSrc) {
+            s_xBusStat[ucSrc - 1].ulCrcErrCnt++;
+        }
+        return FALSE;
+    }
+
+    return TRUE;
 }
 
 static Status_t prvUartRecv(uint8_t *pucBuf, uint16_t usLength, void *pvIsrPara) {
     static uint16_t s_usRecvIndex = 0;
     static uint8_t  s_ucProcBuf[MAX_MSG_SIZE];
+    s_xLinkStat.ulRxBytes += usLength;
     return ProtProc(s_xProt, pucBuf, usLength, &s_usRecvIndex, s_ucProcBuf, NULL);
 }
 
@@ -631,6 +1567,22 @@ CLI_CMD_EXPORT(stc_get_info, show stc sampled temperatures, prvCliCmdStcTemp)
 
 #endif
 
+/* The temperatures of the nodes on the bus, T1 ~ T12 as wired, then per node */
+static void prvCliTemp(cli_printf cliprintf) {
+    cliprintf("TEMP:\n");
+    for (uint8_t n = 0; n < CHAN_NUM; n++) {
+        if (!prvDevEn(n / 10) || !prvTempChan(n)) {
+            continue;
+        }
+        if (n < TEMP_NUM) {
+            cliprintf("    T%-3d: %4d\n", n + 1, prvGetTemp(STC_VALUE(n)));
+        }
+        else {
+            cliprintf("    STC-%d T%-3d: %4d\n", n / 10 + 1, n % 10 + 1, prvGetTemp(STC_VALUE(n)));
+        }
+    }
+}
+
 static void prvCliCmdStcTemp(cli_printf cliprintf, int argc, char **argv) {
     CHECK_CLI();
 
@@ -641,19 +1593,7 @@ static void prvCliCmdStcTemp(cli_printf cliprintf, int argc, char **argv) {
     }
 
     if (i == 1) {
-        cliprintf("TEMP:\n");
-        cliprintf("    T1  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[0]));
-        cliprintf("    T2  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[1]));
-        cliprintf("    T3  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[2]));
-        cliprintf("    T4  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[3]));
-        cliprintf("    T5  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[4]));
-        cliprintf("    T6  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[5]));
-        cliprintf("    T7  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[6]));
-        cliprintf("    T8  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[7]));
-        cliprintf("    T9  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[8]));
-        cliprintf("    T10 : %4d\n", prvGetTemp(s_xTemp[0].sTemp[9]));
-        cliprintf("    T11 : %4d\n", prvGetTemp(s_xTemp[1].sTemp[0]));
-        cliprintf("    T12 : %4d\n", prvGetTemp(s_xTemp[1].sTemp[1]));
+        prvCliTemp(cliprintf);
     }
     else if (i == 2) {
         cliprintf("PD:\n");
@@ -662,19 +1602,7 @@ static void prvCliCmdStcTemp(cli_printf cliprintf, int argc, char **argv) {
         cliprintf("    PD3 : %4d\n", prvGetTemp(s_xTemp[1].sTemp[4]));
     }
     else {
-        cliprintf("TEMP:\n");
-        cliprintf("    T1  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[0]));
-        cliprintf("    T2  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[1]));
-        cliprintf("    T3  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[2]));
-        cliprintf("    T4  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[3]));
-        cliprintf("    T5  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[4]));
-        cliprintf("    T6  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[5]));
-        cliprintf("    T7  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[6]));
-        cliprintf("    T8  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[7]));
-        cliprintf("    T9  : %4d\n", prvGetTemp(s_xTemp[0].sTemp[8]));
-        cliprintf("    T10 : %4d\n", prvGetTemp(s_xTemp[0].sTemp[9]));
-        cliprintf("    T11 : %4d\n", prvGetTemp(s_xTemp[1].sTemp[0]));
-        cliprintf("    T12 : %4d\n", prvGetTemp(s_xTemp[1].sTemp[1]));
+        prvCliTemp(cliprintf);
         cliprintf("\n");
 
         cliprintf("PD:\n");
@@ -707,14 +1635,27 @@ static void prvCliCmdStcDiag(cli_printf cliprintf, int argc, char **argv) {
                   (s_xDiag[i].ulSwVer >> 0) & 0xFF);
         cliprintf("    RunTime : %ld\n", s_xDiag[i].ulRunTime);
         cliprintf("    AdErrCnt: %ld\n", s_xDiag[i].ulAdcErrCnt);
+        cliprintf("    Noise   :");
+        for (uint8_t m = 0; m < 10; m++) {
+            cliprintf(" %d", s_xNoise[i].ucNoise[m]);
+        }
+        cliprintf("\n");
     }
     else {
         for (uint8_t n = 0; n < DEV_NUM; n++) {
+            if (!prvDevEn(n)) {
+                continue;
+            }
             cliprintf("STC-%d DIAG:\n", n + 1);
             cliprintf("    SwVer   : %d.%d.%d\n", (s_xDiag[n].ulSwVer >> 16) & 0xFF, (s_xDiag[n].ulSwVer >> 8) & 0xFF,
                       (s_xDiag[n].ulSwVer >> 0) & 0xFF);
             cliprintf("    RunTime : %ld\n", s_xDiag[n].ulRunTime);
             cliprintf("    AdErrCnt: %ld\n", s_xDiag[n].ulAdcErrCnt);
+            cliprintf("    Noise   :");
+            for (uint8_t m = 0; m < 10; m++) {
+                cliprintf(" %d", s_xNoise[n].ucNoise[m]);
+            }
+            cliprintf("\n");
             cliprintf("\n");
         }
     }
@@ -723,6 +1664,143 @@ static void prvCliCmdStcDiag(cli_printf cliprintf, int argc, char **argv) {
 }
 CLI_CMD_EXPORT(stc_diag, show stc diagnostic information, prvCliCmdStcDiag)
 
+static void prvCliCmdStcBusStat(cli_printf cliprintf, int argc, char **argv) {
+    CHECK_CLI();
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "clear"))) {
+        taskENTER_CRITICAL();
+        memset(s_xBusStat, 0, sizeof(s_xBusStat));
+        s_xLinkStat.ulTxBytes    = 0;
+        s_xLinkStat.ulRxBytes    = 0;
+        s_xLinkStat.ulUpCnt      = 0;
+        s_xLinkStat.ulDownCnt    = 0;
+        s_xLinkStat.ulNegFailCnt = 0;
+        s_xLinkStat.ulCycMax     = 0;
+        prvWinReset();
+        taskEXIT_CRITICAL();
+        cliprintf("stc bus statistics cleared\n");
+        return;
+    }
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        StcBusStat_t x;
+        if (!prvDevEn(n)) {
+            continue;
+        }
+        StcGetBusStat((StcDev_t)n, &x);
+        cliprintf("STC-%d BUS (weight %d):\n", n + 1, s_ucDevWeight[n]);
+        cliprintf("    Request : %lu\n", (unsigned long)x.ulReqCnt);
+        cliprintf("    Response: %lu\n", (unsigned long)x.ulRspCnt);
+        cliprintf("    Timeout : %lu\n", (unsigned long)x.ulTimeoutCnt);
+        cliprintf("    CrcErr  : %lu\n", (unsigned long)x.ulCrcErrCnt);
+        cliprintf("    Rtt     : %lu us (avg %lu us, max %lu us)\n", (unsigned long)x.ulRttLast,
+                  (unsigned long)(x.ulRspCnt ? (x.ulRttSum / x.ulRspCnt) : 0), (unsigned long)x.ulRttMax);
+        cliprintf("    Rate    : %d Hz\n", x.usRate);
+        cliprintf("\n");
+    }
+
+    StcLinkStat_t l;
+    StcGetLinkStat(&l);
+    cliprintf("LINK:\n");
+    cliprintf("    Baud    : %lu (mask 0x%02X, cap %lu)\n", (unsigned long)l.ulBaud, l.ucBaudMask,
+              (unsigned long)s_ulBaud[l.ucBaudCap]);
+    cliprintf("    Util    : %d.%d %%\n", l.usUtil / 10, l.usUtil % 10);
+    cliprintf("    ErrRate : %d.%d %%\n", l.usErrRate / 10, l.usErrRate % 10);
+    cliprintf("    Tx/Rx   : %lu/%lu bytes\n", (unsigned long)l.ulTxBytes, (unsigned long)l.ulRxBytes);
+    cliprintf("    Up/Down : %lu/%lu (fail %lu)\n", (unsigned long)l.ulUpCnt, (unsigned long)l.ulDownCnt,
+              (unsigned long)l.ulNegFailCnt);
+    cliprintf("    Cycle   : %lu us (max %lu us) with %d nodes\n", (unsigned long)l.ulCycLast, (unsigned long)l.ulCycMax,
+              l.ucDevNum);
+}
+CLI_CMD_EXPORT(stc_bus_stat, show or clear stc bus statistics, prvCliCmdStcBusStat)
+
+static void prvCliCmdStcBaud(cli_printf cliprintf, int argc, char **argv) {
+    CHECK_CLI();
+
+    if (argc >= 2) {
+        int i = atoi(argv[1]);
+        if ((i < STC_BAUD_115200) || (i > STC_BAUD_MAX_IDX)) {
+            cliprintf("baud index out of range, 0 ~ %d\n", STC_BAUD_MAX_IDX);
+            return;
+        }
+        /* Renegotiated by tStc before its next poll cycle */
+        s_xLinkStat.ucBaudCap = (uint8_t)i;
+        s_bBaudNeg            = TRUE;
+    }
+    cliprintf("stc baud %lu, cap %lu\n", (unsigned long)s_xLinkStat.ulBaud,
+              (unsigned long)s_ulBaud[s_xLinkStat.ucBaudCap]);
+}
+CLI_CMD_EXPORT(stc_baud, show or limit stc bus baud rate index, prvCliCmdStcBaud)
+
+static void prvCliCmdStcAlarm(cli_printf cliprintf, int argc, char **argv) {
+    CHECK_CLI();
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "clear"))) {
+        taskENTER_CRITICAL();
+        memset(s_xAlmStat, 0, sizeof(s_xAlmStat));
+        taskEXIT_CRITICAL();
+        cliprintf("stc alarm statistics cleared\n");
+        return;
+    }
+
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        StcAlarmStat_t x;
+        if (!prvDevEn(n)) {
+            continue;
+        }
+        StcGetAlarmStat((StcDev_t)n, &x);
+        cliprintf("STC-%d ALARM:\n", n + 1);
+        cliprintf("    Config  : ot %d mask 0x%03X, pd %d mask 0x%03X\n", s_xAlmCfg[n].usOtTh, s_xAlmCfg[n].usOtMask,
+                  s_xAlmCfg[n].usPdTh, s_xAlmCfg[n].usPdMask);
+        if (s_ulAlmCfgPend & (1UL << n)) {
+            cliprintf("    Pending : %d unanswered\n", s_ucAlmCfgFail[n]);
+        }
+        cliprintf("    Count   : %lu\n", (unsigned long)x.ulCnt);
+        if (x.ulCnt) {
+            cliprintf("    Last    : %s%sT%d %d, %lu ms ago\n", (x.ucFlags & STC_ALARM_OT) ? "OT " : "",
+                      (x.ucFlags & STC_ALARM_PD) ? "PD " : "", x.ucChan + 1, x.sValue,
+                      (unsigned long)(osKernelSysTick() - x.ulTick));
+            cliprintf("    Masks   : ot 0x%03X, pd 0x%03X\n", x.usOtMask, x.usPdMask);
+        }
+        cliprintf("    Latency : %lu ms (max %lu ms)\n", (unsigned long)x.ulLatLast, (unsigned long)x.ulLatMax);
+        cliprintf("\n");
+    }
+    cliprintf("Active: 0x%02X\n", StcGetAlarm());
+}
+CLI_CMD_EXPORT(stc_alarm, show or clear stc pushed alarms, prvCliCmdStcAlarm)
+
+static void prvCliCmdStcDev(cli_printf cliprintf, int argc, char **argv) {
+    CHECK_CLI();
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "scan"))) {
+        /* Done by tStc before its next poll cycle */
+        StcScan();
+        osDelay(DEV_NUM * STC_SCAN_TIMEOUT + 100);
+    }
+    else if (argc >= 3) {
+        int i = atoi(argv[1]);
+        int w = atoi(argv[2]);
+        if ((i < 1) || (i > DEV_NUM) || (w < 1) || (w > 255)) {
+            cliprintf("usage: stc_dev <addr 1 ~ %d> <weight 1 ~ 255>\n", DEV_NUM);
+            return;
+        }
+        StcSetWeight((StcDev_t)(i - 1), (uint8_t)w);
+    }
+
+    cliprintf("%d nodes, mask 0x%04lX\n", StcGetDevNum(), (unsigned long)StcGetDevMask());
+    for (uint8_t n = 0; n < DEV_NUM; n++) {
+        StcDevInfo_t x;
+        if (!prvDevEn(n)) {
+            continue;
+        }
+        StcGetDevInfo((StcDev_t)n, &x);
+        cliprintf("    STC-%-2d: weight %d, rate %d Hz, sw %lu.%lu.%lu\n", x.ucAddr, x.ucWeight, x.usRate,
+                  (unsigned long)((x.ulSwVer >> 16) & 0xFF), (unsigned long)((x.ulSwVer >> 8) & 0xFF),
+                  (unsigned long)((x.ulSwVer >> 0) & 0xFF));
+    }
+}
+CLI_CMD_EXPORT(stc_dev, scan stc nodes or set polling weight, prvCliCmdStcDev)
+
 #define TEMP_TBL_SIZE 241
 #define TEMP_TBL_CONT                                                                                                  \
     {                                                                                                                  \
@@ -791,11 +1869,11 @@ static int16_t prvGetTemp(uint16_t adc) {
         temp = (adc - T[st].adc) * (T[ed].temp - T[st].temp) / (T[ed].adc - T[st].adc) + T[st].temp;
     }
     else {
-        if (adc > T[0].adc) {
+        if (adc >= T[0].adc) {
             TRACE("Temp: under range\n");
             temp = T[0].temp;
         }
-        else if (adc < T[TEMP_TBL_SIZE - 1].adc) {
+        else {
             TRACE("Temp: over range\n");
             temp = T[TEMP_TBL_SIZE - 1].temp;
         }
@@ -16,6 +16,13 @@
     01e, 30Nov23, Karl Added AdcToTemp
     01f, 04Dec23, Karl Added StcGetTempH and StcGetTempL
     01g, 17Jan24, Karl Added StcGetTempHFrom
+    01h, 19Oct26, Karl Added cached group aggregates and StcGetSeq
+    01i, 19Oct26, Karl Pipelined bus polling with response notification
+    01j, 19Oct26, Karl Added bus baud rate negotiation and link statistics
+    01k, 19Oct26, Karl Added broadcast synchronized sampling
+    01l, 19Oct26, Karl Added node side filtered samples with noise metric
+    01m, 19Oct26, Karl Added node pushed alarms
+    01n, 19Oct26, Karl Added node discovery and per node polling weight
 */
 
 #ifndef __STC_H__
@@ -28,14 +35,32 @@ extern "C" {
 #include "Include/Include.h"
 
 /* Defines */
-#define STC_EN_DEV1             1
+#define STC_EN_DEV1             1    /* Nodes polled when the boot scan finds none */
 #define STC_EN_DEV2             1   /* XXX: STC_EN_DEV2 */
 #define STC_EN_DEV3             0   /* XXX: STC_EN_DEV3 */
-#define STC_QUERY_TASK_DELAY    20
-#define STC_QUERY_TEMP_PRD      20
-#define STC_QUERY_DIAG_PRD      1000
+#define STC_DEV_MAX             16   /* Highest node address, sync masks are 16 bits */
+#define STC_DISCOVERY           1    /* Scan node addresses at boot, absent ones again later */
+/* Nodes never talk unasked, a node powered up after the boot scan waits for its turn in the round robin,
+   at worst (STC_DEV_MAX - nodes found) * STC_SCAN_PRD, 15 s with one node found. StcScan finds it at once */
+#define STC_SCAN_PRD            1000 /* One absent address is probed per period (ms) */
+#define STC_SCAN_TIMEOUT        5    /* Scan probe response timeout (ms) */
+#define STC_DEV_WEIGHT          1    /* Default polling weight, node is polled every n-th cycle */
+#define STC_QUERY_TEMP_PRD      5    /* Minimum poll cycle period (ms) */
+#define STC_RSP_TIMEOUT         15   /* Per device response timeout (ms) */
+#define STC_RATE_WINDOW         1000 /* Refresh rate measurement window (ms) */
+#define STC_BAUD_NEG            1    /* Negotiate bus baud rate with the nodes */
+#define STC_BAUD_MAX_IDX        STC_BAUD_921600
+#define STC_BAUD_ERR_PCT        5    /* Step down if errors exceed it within a window (%) */
+#define STC_BAUD_MIN_REQ        20   /* Minimum requests in a window to judge error rate */
+#define STC_BAUD_RETRY_WIN      60   /* Clean windows before trying one step up */
+#define STC_SYNC_SAMPLE         1    /* One broadcast per cycle, nodes answer in slots */
+#define STC_SYNC_GUARD_MS       2    /* Slot margin on top of the frame time (ms) */
+#define STC_ALARM_PUSH          1    /* Nodes push alarms in a window after the sync slots */
+#define STC_ALARM_HOLD_MS       100  /* Pushed alarm stays active without a refresh (ms) */
+#define STC_ALARM_CFG_PRD       1000 /* Alarm thresholds are pushed again after it (ms) */
 
 /* Types */
+/* Node address minus one, up to STC_DEV_MAX - 1 */
 typedef enum {
     STC_DEV_1,
     STC_DEV_2,
@@ -55,12 +80,93 @@ typedef enum {
     STC_TEMP_NODE_10
 }StcTempNode_t;
 
+typedef enum {
+    STC_GRP_TEMP1, /* T1 ~ T(th_TempNum) */
+    STC_GRP_TEMP2, /* T(th_TempNum + 1) ~ T12 */
+    STC_GRP_PD,    /* PD leak detectors */
+    STC_GRP_NUM
+}StcGrp_t;
+
+typedef enum {
+    STC_BAUD_115200, /* Default, always supported */
+    STC_BAUD_230400,
+    STC_BAUD_460800,
+    STC_BAUD_921600,
+    STC_BAUD_NUM
+}StcBaud_t;
+
+typedef enum {
+    STC_ALARM_OT = 0x01, /* Over temperature, raw value <= th_OtCutTh */
+    STC_ALARM_PD = 0x02  /* PD leak, raw value >= th_PdWarnL1 */
+}StcAlarm_t;
+
+/* Raw AD aggregates, refreshed once per received temperature frame */
+typedef struct {
+    int16_t sMin;      /* Lowest raw value (highest temperature) */
+    int16_t sMax;      /* Highest raw value (strongest PD signal) */
+    uint8_t ucMinChan; /* Flat channel index of sMin, 0xFF if group is empty */
+    uint8_t ucMaxChan; /* Flat channel index of sMax, 0xFF if group is empty */
+}StcAggr_t;
+
+/* Per device bus statistics */
+typedef struct {
+    uint32_t ulReqCnt;     /* Requests sent */
+    uint32_t ulRspCnt;     /* Responses received in time */
+    uint32_t ulTimeoutCnt; /* Requests without response */
+    uint32_t ulCrcErrCnt;  /* Frames dropped by checksum */
+    uint32_t ulRttLast;    /* Last round trip time (us) */
+    uint32_t ulRttMax;     /* Maximum round trip time (us) */
+    uint32_t ulRttSum;     /* Sum of round trip time (us) */
+    uint16_t usRate;       /* Achieved refresh rate (Hz) */
+}StcBusStat_t;
+
+/* Bus link statistics */
+typedef struct {
+    uint32_t ulBaud;       /* Current baud rate */
+    uint8_t  ucBaudMask;   /* Rates supported by all enabled nodes, bit n is StcBaud_t n */
+    uint8_t  ucBaudCap;    /* Highest rate allowed by error history */
+    uint16_t usUtil;       /* Bus utilization of last window (0.1%) */
+    uint16_t usErrRate;    /* Timeout and checksum errors of last window (0.1%) */
+    uint32_t ulTxBytes;    /* Bytes sent */
+    uint32_t ulRxBytes;    /* Bytes received */
+    uint32_t ulUpCnt;      /* Rate steps up */
+    uint32_t ulDownCnt;    /* Rate steps down */
+    uint32_t ulNegFailCnt; /* Failed negotiations */
+    uint8_t  ucDevNum;     /* Nodes on the bus */
+    uint32_t ulCycLast;    /* Last poll cycle time, padding delay excluded (us) */
+    uint32_t ulCycMax;     /* Maximum poll cycle time (us) */
+}StcLinkStat_t;
+
+/* Per node information */
+typedef struct {
+    uint8_t  ucAddr;       /* Node address */
+    uint8_t  ucWeight;     /* Polled every ucWeight-th cycle */
+    uint16_t usRate;       /* Achieved refresh rate (Hz) */
+    uint32_t ulSwVer;      /* Node firmware version, 0 until reported */
+    int16_t  sTempH;       /* Lowest raw value (highest temperature) of the node */
+}StcDevInfo_t;
+
+/* Per device pushed alarm statistics */
+typedef struct {
+    uint32_t ulCnt;        /* Alarm frames received */
+    uint32_t ulTick;       /* Tick of the last alarm frame */
+    uint32_t ulLatLast;    /* Node detection to master receipt of the last alarm (ms) */
+    uint32_t ulLatMax;     /* Maximum detection to receipt latency (ms) */
+    uint16_t usOtMask;     /* Channels over temperature, bit n is node channel n */
+    uint16_t usPdMask;     /* Channels with PD leak */
+    uint8_t  ucFlags;      /* StcAlarm_t */
+    uint8_t  ucChan;       /* Node channel of sValue */
+    int16_t  sValue;       /* Unfiltered raw AD value that tripped */
+}StcAlarmStat_t;
+
 /* Functions */
 Status_t DrvStcInit(void);
 Status_t DrvStcTerm(void);
 
 int16_t  StcGetTemp(StcDev_t xDev, StcTempNode_t xTempNode);
 int16_t  StcGetPd(StcDev_t xDev, StcTempNode_t xTempNode);
+/* Peak to peak AD noise of a channel, 0 with older node firmware */
+uint8_t  StcGetNoise(StcDev_t xDev, StcTempNode_t xTempNode);
 /* Get highest temperature */
 int16_t  StcGetTempH(void);
 /* Get lowest temperature */
@@ -68,7 +174,26 @@ int16_t  StcGetTempL(void);
 /* Get highest temperature */
 int16_t  StcGetTempHFrom(uint8_t st, uint8_t ed);
 int16_t  StcGetPdHFrom(void);
-int16_t StcGetPdLight(void);
+int16_t  StcGetPdLight(void);
+/* O(1) group accessors, see StcGrp_t */
+int16_t  StcGetTempHGrp(StcGrp_t xGrp);
+Status_t StcGetAggr(StcGrp_t xGrp, StcAggr_t *pxAggr);
+/* Incremented on every parsed temperature frame */
+uint32_t StcGetSeq(void);
+/* Tick the latest synchronized samples were latched at, the end of their broadcast */
+uint32_t StcGetSampleTick(void);
+Status_t StcGetBusStat(StcDev_t xDev, StcBusStat_t *pxStat);
+Status_t StcGetLinkStat(StcLinkStat_t *pxStat);
+/* StcAlarm_t flags pushed by any node within STC_ALARM_HOLD_MS */
+uint8_t  StcGetAlarm(void);
+Status_t StcGetAlarmStat(StcDev_t xDev, StcAlarmStat_t *pxStat);
+/* Nodes on the bus, bit n is StcDev_t n */
+uint32_t StcGetDevMask(void);
+uint8_t  StcGetDevNum(void);
+Status_t StcGetDevInfo(StcDev_t xDev, StcDevInfo_t *pxInfo);
+Status_t StcSetWeight(StcDev_t xDev, uint8_t ucWeight);
+/* Scan all addresses again before the next poll cycle, e.g. after a node was powered up */
+void     StcScan(void);
 
 int16_t  AdcToTemp(uint16_t usAdc);
 
@@ -10,6 +10,7 @@
     modification history
     --------------------
     01a, 17Nov23, Karl Created
+    01b, 19Oct26, Karl Added TimeCycGet and TimeCycToUs
 */
 
 /* Includes */
@@ -57,6 +58,11 @@ Status_t DrvTimeInit(void) {
     RtcDs1338Init();
 #endif
 
+    /* Enable DWT cycle counter */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
     return STATUS_OK;
 }
 
@@ -65,6 +71,14 @@ Status_t DrvTimeTerm(void) {
     return STATUS_OK;
 }
 
+uint32_t TimeCycGet(void) {
+    return DWT->CYCCNT;
+}
+
+uint32_t TimeCycToUs(uint32_t ulCyc) {
+    return ulCyc / (SystemCoreClock / 1000000);
+}
+
 static void prvCliCmdRtcGet(cli_printf cliprintf, int argc, char **argv) {
     CHECK_CLI();
 
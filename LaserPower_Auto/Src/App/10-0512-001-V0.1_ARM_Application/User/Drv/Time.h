@@ -10,6 +10,7 @@
     modification history
     --------------------
     01a, 17Nov23, Karl Created
+    01b, 19Oct26, Karl Added TimeCycGet and TimeCycToUs
 */
 
 #ifndef ___TIME_H__
@@ -23,6 +24,10 @@ extern "C" {
 Status_t DrvTimeInit(void);
 Status_t DrvTimeTerm(void);
 
+/* Free running core cycle counter, for latency measurement only */
+uint32_t TimeCycGet(void);
+uint32_t TimeCycToUs(uint32_t ulCyc);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
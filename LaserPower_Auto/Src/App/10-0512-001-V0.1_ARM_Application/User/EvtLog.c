@@ -0,0 +1,380 @@
+/*
+    EvtLog.c
+
+    Implementation File for App Event Log Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent A read past the newest record is clamped to EvtLogEnd
+    01c, 19Oct26, agent CLI prints the counters and records with %lu
+    01d, 19Oct26, agent evt_log prints at most COUNT records, counted from after the flush
+    01e, 19Oct26, agent tEvtLog stack from its deepest path, its creation checked
+*/
+
+/* Includes */
+#include "Include.h"
+
+/* Debug config */
+#if EVT_LOG_DEBUG
+    #undef TRACE
+    #define TRACE(...)  DebugPrintf(__VA_ARGS__)
+#else
+    #undef TRACE
+    #define TRACE(...)
+#endif /* EVT_LOG_DEBUG */
+#if EVT_LOG_ASSERT
+    #undef ASSERT
+    #define ASSERT(a)   while(!(a)){DebugPrintf("ASSERT failed: %s %d\n", __FILE__, __LINE__);}
+#else
+    #undef ASSERT
+    #define ASSERT(...)
+#endif /* EVT_LOG_ASSERT */
+
+/*
+    Record n of the ring holds the sequence numbers equal to n modulo REC_NUM, so a
+    record is found without an index. EvtLog only fills a slot of the RAM stage, the
+    task programs whole or partial pages and erases a sector when it reaches its
+    first record, dropping the oldest 128 records.
+*/
+
+/* Local defines */
+#define REC_SIZE            sizeof(EvtRec_t)
+#define REC_PER_PAGE        (256 / REC_SIZE)
+#define REC_PER_SECTOR      (EVT_LOG_SECTOR / REC_SIZE)
+#define REC_NUM             (REC_PER_SECTOR * EVT_LOG_SECTOR_NUM)
+#define REC_ADDR(seq)       (EVT_LOG_ADDR + ((seq) % REC_NUM) * REC_SIZE)
+#define SEQ_FREE            0xFFFFFFFF
+#define FLUSH_PRD           100         /* ms */
+#define FLUSH_AGE           1000        /* ms a record may wait for a page to fill */
+#define RTC_PRD             3600000     /* ms between RTC reads */
+#define TASK_STACK          416         /* Words, deepest path 1224 bytes on the host plus the frame, 25% up */
+
+/* Forward declarations */
+static void     prvEvtLogTask(void *pvPara);
+static void     prvFlush(void);
+static uint16_t prvRecCrc(const EvtRec_t *pxRec);
+
+/* Local variables */
+static Bool_t        s_bInit = FALSE;
+static osMutexId     s_xMutex;
+static EvtRec_t      s_xStage[EVT_LOG_STAGE];
+static uint32_t      s_ulSeq      = 0;      /* Next to log */
+static uint32_t      s_ulFlushSeq = 0;      /* Next to program */
+static uint32_t      s_ulFirstSeq = 0;      /* Oldest that may still be in flash */
+static Bool_t        s_bErased    = FALSE;  /* Sector of s_ulFlushSeq found erased at boot */
+static uint32_t      s_ulRtcBase  = 0;      /* RTC seconds at s_ulRtcTick */
+static uint32_t      s_ulRtcTick  = 0;
+/* Statistics */
+static uint32_t      s_ulLogCnt   = 0;
+static uint32_t      s_ulDropCnt  = 0;
+static uint32_t      s_ulDropLast = 0;      /* Reported by an EVT_DROP */
+static uint32_t      s_ulStageMax = 0;
+static uint32_t      s_ulFlushMax = 0;      /* us */
+static uint32_t      s_ulEraseCnt = 0;
+static uint32_t      s_ulScanTime = 0;      /* us */
+
+/* Functions */
+Status_t AppEvtLogInit(void)
+{
+    uint32_t ulCyc  = TimeCycGet();
+    uint32_t ulLast = SEQ_FREE;
+    uint32_t ulPos  = 0;
+    Status_t xRet   = STATUS_OK;
+    EvtRec_t xRec;
+
+    if (s_bInit) {
+        return STATUS_OK;
+    }
+
+    /* The newest sector has the largest sequence in its first record */
+    for (uint32_t s = 0; s < EVT_LOG_SECTOR_NUM; s++) {
+        uint32_t ulSeq;
+        MemFlashRead(EVT_LOG_ADDR + s * EVT_LOG_SECTOR, sizeof(ulSeq), (uint8_t *)&ulSeq);
+        if ((ulSeq != SEQ_FREE) && ((ulLast == SEQ_FREE) || ((int32_t)(ulSeq - ulLast) > 0))) {
+            ulLast = ulSeq;
+            ulPos  = s * REC_PER_SECTOR;
+        }
+    }
+    if (ulLast != SEQ_FREE) {
+        /* Then its first free record, a torn one is left behind */
+        uint32_t ulEnd = ulPos + REC_PER_SECTOR;
+        for (ulPos++; ulPos < ulEnd; ulPos++) {
+            MemFlashRead(EVT_LOG_ADDR + ulPos * REC_SIZE, REC_SIZE, (uint8_t *)&xRec);
+            if (xRec.ulSeq == SEQ_FREE) {
+                break;
+            }
+            if ((xRec.usCrc == prvRecCrc(&xRec)) && ((int32_t)(xRec.ulSeq - ulLast) > 0)) {
+                ulLast = xRec.ulSeq;
+            }
+        }
+        ulPos %= REC_NUM;
+        /* Smallest sequence after the last that falls on the free record */
+        s_ulSeq = ulLast + 1 + ((ulPos + REC_NUM - (ulLast + 1) % REC_NUM) % REC_NUM);
+    }
+    else {
+        s_ulSeq = 0;
+    }
+    s_ulFlushSeq = s_ulSeq;
+    s_ulFirstSeq = s_ulSeq - (REC_NUM - REC_PER_SECTOR);
+    if ((s_ulSeq % REC_PER_SECTOR) == 0) {
+        MemFlashRead(REC_ADDR(s_ulSeq), sizeof(uint32_t), (uint8_t *)&xRec.ulSeq);
+        s_bErased = (xRec.ulSeq == SEQ_FREE) ? TRUE : FALSE;
+    }
+    s_ulScanTime = TimeCycToUs(TimeCycGet() - ulCyc);
+
+    osMutexDef(EvtLogMutex);
+    s_xMutex = osMutexCreate(osMutex(EvtLogMutex));
+    /* Without the task records stage till EvtLogFlush, then count as dropped */
+    if (pdPASS != xTaskCreate(prvEvtLogTask, "tEvtLog", TASK_STACK, NULL, tskIDLE_PRIORITY + 1, NULL)) {
+        TRACE("AppEvtLogInit: create tEvtLog task failed\n");
+        xRet = STATUS_ERR;
+    }
+    s_bInit = TRUE;
+
+    EvtLog(EVT_BOOT, RCC->CSR, 0, 0, 0);
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+
+    TRACE("AppEvtLogInit: seq %d, %d us\n", s_ulSeq, s_ulScanTime);
+    return xRet;
+}
+
+void EvtLog(uint16_t usId, uint32_t ulArg0, uint32_t ulArg1, uint32_t ulArg2, uint32_t ulArg3)
+{
+    uint32_t ulTick = osKernelSysTick();
+    uint32_t ulMask = 0;
+    Bool_t   bIsr   = (__get_IPSR() != 0) ? TRUE : FALSE;
+
+    if (!s_bInit) {
+        return;
+    }
+
+    if (bIsr) {
+        ulMask = taskENTER_CRITICAL_FROM_ISR();
+    }
+    else {
+        taskENTER_CRITICAL();
+    }
+
+    uint32_t ulStaged = s_ulSeq - s_ulFlushSeq;
+    if (ulStaged < EVT_LOG_STAGE) {
+        EvtRec_t *pxRec = &s_xStage[s_ulSeq % EVT_LOG_STAGE];
+        pxRec->ulSeq    = s_ulSeq++;
+        pxRec->ulTick   = ulTick;
+        pxRec->ulTime   = s_ulRtcBase ? (s_ulRtcBase + (ulTick - s_ulRtcTick) / 1000) : 0;
+        pxRec->usId     = usId;
+        pxRec->ulArg[0] = ulArg0;
+        pxRec->ulArg[1] = ulArg1;
+        pxRec->ulArg[2] = ulArg2;
+        pxRec->ulArg[3] = ulArg3;
+        s_ulLogCnt++;
+        if (ulStaged + 1 > s_ulStageMax) {
+            s_ulStageMax = ulStaged + 1;
+        }
+    }
+    else {
+        s_ulDropCnt++;
+    }
+
+    if (bIsr) {
+        taskEXIT_CRITICAL_FROM_ISR(ulMask);
+    }
+    else {
+        taskEXIT_CRITICAL();
+    }
+}
+
+Status_t EvtLogFlush(void)
+{
+    if (!s_bInit) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    prvFlush();
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+uint32_t EvtLogEnd(void)
+{
+    return s_ulFlushSeq;
+}
+
+Status_t EvtLogRead(uint32_t ulSeq, uint32_t ulStart, uint32_t ulEnd, OUT EvtRec_t *pxRec, uint32_t ulMax,
+                    OUT uint32_t *pulNum, OUT uint32_t *pulNext)
+{
+    EvtRec_t xPage[REC_PER_PAGE];
+    uint32_t ulNum = 0;
+
+    if (!s_bInit || (pxRec == NULL) || (pulNum == NULL) || (pulNext == NULL)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    /* Older ones were erased, newer ones do not exist yet */
+    if ((int32_t)(ulSeq - s_ulFirstSeq) < 0) {
+        ulSeq = s_ulFirstSeq;
+    }
+    else if ((int32_t)(ulSeq - s_ulFlushSeq) > 0) {
+        ulSeq = s_ulFlushSeq;
+    }
+    /* A page per read, at most a sector per call so the caller is not held long */
+    for (uint32_t ulScan = 0; (ulNum < ulMax) && (ulSeq != s_ulFlushSeq) && (ulScan < REC_PER_SECTOR);) {
+        uint32_t ulCnt = REC_PER_PAGE - (ulSeq % REC_PER_PAGE);
+        if (ulCnt > (s_ulFlushSeq - ulSeq)) {
+            ulCnt = s_ulFlushSeq - ulSeq;
+        }
+        MemFlashRead(REC_ADDR(ulSeq), ulCnt * REC_SIZE, (uint8_t *)xPage);
+        uint32_t n;
+        for (n = 0; (n < ulCnt) && (ulNum < ulMax); n++) {
+            EvtRec_t *px = &xPage[n];
+            if ((px->ulSeq != ulSeq + n) || (px->usCrc != prvRecCrc(px))) {
+                continue;
+            }
+            if ((px->ulTime < ulStart) || (px->ulTime > ulEnd)) {
+                continue;
+            }
+            pxRec[ulNum++] = *px;
+        }
+        ulSeq += n;
+        ulScan += n;
+    }
+
+    osMutexRelease(s_xMutex);
+
+    *pulNum  = ulNum;
+    *pulNext = ulSeq;
+    return STATUS_OK;
+}
+
+static void prvEvtLogTask(void *pvPara)
+{
+    uint32_t ulRtcTick = 0;
+    Bool_t   bRtc      = FALSE;
+
+    while (1) {
+        uint32_t ulNow = osKernelSysTick();
+
+        /* Records take their RTC time from this base, no I2C on the logging path */
+        if (!bRtc || ((ulNow - ulRtcTick) >= RTC_PRD)) {
+            Time_t   xTm    = RtcReadTime(RTC_TYPE_DS1338);
+            uint32_t ulTime = mktime(&xTm);
+            taskENTER_CRITICAL();
+            s_ulRtcBase = ulTime;
+            s_ulRtcTick = osKernelSysTick();
+            taskEXIT_CRITICAL();
+            ulRtcTick = ulNow;
+            bRtc      = TRUE;
+        }
+
+        /* A full page, or the oldest has waited long enough */
+        uint32_t ulStaged = s_ulSeq - s_ulFlushSeq;
+        if ((ulStaged >= REC_PER_PAGE) ||
+            ((ulStaged != 0) && ((ulNow - s_xStage[s_ulFlushSeq % EVT_LOG_STAGE].ulTick) >= FLUSH_AGE))) {
+            EvtLogFlush();
+        }
+        if (s_ulDropCnt != s_ulDropLast) {
+            uint32_t ulDrop = s_ulDropCnt;
+            EvtLog(EVT_DROP, ulDrop - s_ulDropLast, 0, 0, 0);
+            s_ulDropLast = ulDrop;
+        }
+
+        osDelay(FLUSH_PRD);
+    }
+}
+
+static void prvFlush(void)
+{
+    EvtRec_t xPage[REC_PER_PAGE];
+    uint32_t ulCyc = TimeCycGet();
+
+    while (s_ulSeq != s_ulFlushSeq) {
+        uint32_t ulSeq = s_ulFlushSeq;
+        uint32_t ulCnt = REC_PER_PAGE - (ulSeq % REC_PER_PAGE);
+
+        if (((ulSeq % REC_PER_SECTOR) == 0) && !s_bErased) {
+            MemFlashErase(REC_ADDR(ulSeq) & ~(EVT_LOG_SECTOR - 1), EVT_LOG_SECTOR);
+            s_ulEraseCnt++;
+            s_ulFirstSeq = ulSeq + REC_PER_SECTOR - REC_NUM;
+        }
+        s_bErased = FALSE;
+
+        /* Up to the page end, the slots stay taken till programmed */
+        taskENTER_CRITICAL();
+        if (ulCnt > (s_ulSeq - ulSeq)) {
+            ulCnt = s_ulSeq - ulSeq;
+        }
+        for (uint32_t n = 0; n < ulCnt; n++) {
+            xPage[n] = s_xStage[(ulSeq + n) % EVT_LOG_STAGE];
+        }
+        taskEXIT_CRITICAL();
+
+        for (uint32_t n = 0; n < ulCnt; n++) {
+            xPage[n].usCrc = prvRecCrc(&xPage[n]);
+        }
+        MemFlashProgram(REC_ADDR(ulSeq), ulCnt * REC_SIZE, (uint8_t *)xPage);
+
+        taskENTER_CRITICAL();
+        s_ulFlushSeq = ulSeq + ulCnt;
+        taskEXIT_CRITICAL();
+    }
+
+    ulCyc = TimeCycToUs(TimeCycGet() - ulCyc);
+    if (ulCyc > s_ulFlushMax) {
+        s_ulFlushMax = ulCyc;
+    }
+}
+
+static uint16_t prvRecCrc(const EvtRec_t *pxRec)
+{
+    uint16_t usCrc = Crc16Ccitt(CRC16_CCITT_INIT, (const uint8_t *)pxRec, offsetof(EvtRec_t, usCrc));
+    return Crc16Ccitt(usCrc, (const uint8_t *)pxRec->ulArg, sizeof(pxRec->ulArg));
+}
+
+static void prvCliCmdEvtLog(cli_printf cliprintf, int argc, char** argv)
+{
+    EvtRec_t xRec[REC_PER_PAGE];
+    uint32_t ulNum, ulNext;
+
+    CHECK_CLI();
+
+    if (!s_bInit) {
+        cliprintf("event log not initialized\n");
+        return;
+    }
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "stat"))) {
+        cliprintf("LOGGED      : %lu\n", (unsigned long)s_ulLogCnt);
+        cliprintf("DROPPED     : %lu\n", (unsigned long)s_ulDropCnt);
+        cliprintf("STAGE MAX   : %lu / %d\n", (unsigned long)s_ulStageMax, EVT_LOG_STAGE);
+        cliprintf("FLUSH MAX   : %lu us\n", (unsigned long)s_ulFlushMax);
+        cliprintf("ERASE CNT   : %lu\n", (unsigned long)s_ulEraseCnt);
+        cliprintf("BOOT SCAN   : %lu us\n", (unsigned long)s_ulScanTime);
+        cliprintf("SEQ         : %lu - %lu\n", (unsigned long)s_ulFirstSeq, (unsigned long)s_ulFlushSeq);
+        return;
+    }
+
+    /* evt_log [COUNT], the newest ones, those logged while printing are left out */
+    uint32_t ulShow = (argc >= 2) ? atoi(argv[1]) : 16;
+    EvtLogFlush();
+    uint32_t ulSeq  = s_ulFlushSeq - ulShow;
+    while (ulShow && (STATUS_OK == EvtLogRead(ulSeq, 0, 0xFFFFFFFF, xRec, REC_PER_PAGE, &ulNum, &ulNext)) &&
+           (ulNext != ulSeq)) {
+        for (uint32_t n = 0; (n < ulNum) && ulShow; n++, ulShow--) {
+            cliprintf("%6lu %10lu.%03lu %10lu id %2d: %08lX %08lX %08lX %08lX\n", (unsigned long)xRec[n].ulSeq,
+                      (unsigned long)(xRec[n].ulTick / 1000), (unsigned long)(xRec[n].ulTick % 1000),
+                      (unsigned long)xRec[n].ulTime, xRec[n].usId,
+                      (unsigned long)xRec[n].ulArg[0], (unsigned long)xRec[n].ulArg[1],
+                      (unsigned long)xRec[n].ulArg[2], (unsigned long)xRec[n].ulArg[3]);
+        }
+        ulSeq = ulNext;
+    }
+}
+CLI_CMD_EXPORT(evt_log, show the newest events or evt_log stat, prvCliCmdEvtLog)
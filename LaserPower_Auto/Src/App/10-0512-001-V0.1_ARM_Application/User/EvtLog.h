@@ -0,0 +1,79 @@
+/*
+    EvtLog.h
+
+    Head File for App Event Log Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent EvtLogRead clamps ulSeq past the newest record
+*/
+
+#ifndef __EVT_LOG_H__
+#define __EVT_LOG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include "Include/Include.h"
+
+/* Defines */
+#define EVT_LOG_ADDR        (1024*512)      /* SPI flash, after the data log */
+#define EVT_LOG_SECTOR      4096
+#define EVT_LOG_SECTOR_NUM  64
+#define EVT_LOG_STAGE       32              /* Records held in RAM till flushed, power of 2 */
+#define EVT_LOG_ARG_NUM     4
+
+/* Types */
+typedef enum {
+    EVT_BOOT = 1,           /* RCC_CSR reset flags */
+    EVT_FSM,                /* Old state, new state */
+    EVT_STATUS,             /* Old status, new status */
+    EVT_CAN_BUS_OFF,        /* TEC, REC */
+    EVT_CAN_ERR_PASSIVE,    /* TEC, REC */
+    EVT_PWR_LOST,           /* Device, request id */
+    EVT_PWR_BACK,           /* Device */
+    EVT_STC_LOST,           /* Node address */
+    EVT_STC_BACK,           /* Node address */
+    EVT_STC_TIMEOUT,        /* Node address, command */
+    EVT_CFG_COMMIT,         /* Status */
+    EVT_RESET,              /* Requested reset, 0 by Com, 1 by Cli */
+    EVT_DROP,               /* Records lost to a full stage */
+}EvtId_t;
+
+#pragma pack(push)
+#pragma pack(1)
+typedef struct {
+    uint32_t ulSeq;         /* Also the slot in the ring */
+    uint32_t ulTick;        /* ms since boot */
+    uint32_t ulTime;        /* RTC seconds, 0 till the RTC is read */
+    uint16_t usId;
+    uint16_t usCrc;
+    uint32_t ulArg[EVT_LOG_ARG_NUM];
+}EvtRec_t;
+#pragma pack(pop)
+
+/* Functions */
+Status_t AppEvtLogInit(void);
+/* Any context, never blocks, dropped if the stage is full */
+void     EvtLog(uint16_t usId, uint32_t ulArg0, uint32_t ulArg1, uint32_t ulArg2, uint32_t ulArg3);
+/* Writes the staged records now, call before a reset */
+Status_t EvtLogFlush(void);
+/* Sequence after the newest record in flash */
+uint32_t EvtLogEnd(void);
+/* Records in flash from ulSeq on with ulStart <= time <= ulEnd, *pulNext resumes the scan,
+   ulSeq is clamped to the records in flash */
+Status_t EvtLogRead(uint32_t ulSeq, uint32_t ulStart, uint32_t ulEnd, OUT EvtRec_t *pxRec, uint32_t ulMax,
+                    OUT uint32_t *pulNum, OUT uint32_t *pulNext);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __EVT_LOG_H__ */
@@ -0,0 +1,746 @@
+/*
+    Hist.c
+
+    Implementation File for App Telemetry Historian Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent HistFind takes a lost page as newer, a query no longer skips pages before it
+    01c, 19Oct26, agent CLI prints the counters and samples with %lu
+    01d, 19Oct26, agent Task stacks from their deepest paths, their creation checked
+*/
+
+/* Includes */
+#include "Include.h"
+
+/* Debug config */
+#if HIST_DEBUG
+    #undef TRACE
+    #define TRACE(...)  DebugPrintf(__VA_ARGS__)
+#else
+    #undef TRACE
+    #define TRACE(...)
+#endif /* HIST_DEBUG */
+#if HIST_ASSERT
+    #undef ASSERT
+    #define ASSERT(a)   while(!(a)){DebugPrintf("ASSERT failed: %s %d\n", __FILE__, __LINE__);}
+#else
+    #undef ASSERT
+    #define ASSERT(...)
+#endif /* HIST_ASSERT */
+
+/*
+    Page n of the ring holds the sequence numbers equal to n modulo PAGE_NUM, like the
+    event log. Frames are packed into a page in RAM and the page is programmed once,
+    when full, so the page heads are in time order and serve as the time index: a
+    range query reads about log2(PAGE_NUM) heads, then only the pages it returns.
+    Varints are made of nibbles, 3 bits each and a continue bit, as the deltas of
+    noisy channels mostly fit in one.
+*/
+
+/* Local defines */
+#define PAGE_PER_SECTOR     (HIST_SECTOR / HIST_PAGE)
+#define PAGE_NUM            (PAGE_PER_SECTOR * HIST_SECTOR_NUM)
+#define PAGE_ADDR(seq)      (HIST_ADDR + ((seq) % PAGE_NUM) * HIST_PAGE)
+#define DATA_MAX            (HIST_PAGE - sizeof(HistHead_t))
+#define DATA_NIB            (DATA_MAX * 2)
+#define NIB_BYTES(n)        (((n) + 1) / 2)
+#define FRAME_MAX           (11 + 6 + HIST_CH_NUM * 11) /* Nibbles: time, mask and each channel */
+#define SEQ_FREE            0xFFFFFFFF
+#define SAMPLE_PRD          1000        /* ms, the rates are multiples of it */
+#define RTC_PRD             3600000     /* ms between RTC reads */
+#define EXP_RECV_TIMEOUT    5000        /* ms for the export request */
+#define CH_BIT(ch)          ((uint16_t)(1UL << (ch)))
+#define CH_ALL              ((uint16_t)((1UL << HIST_CH_NUM) - 1))
+#define TASK_STACK          416         /* Words, deepest path 1192 bytes on the host plus mktime and the frame */
+#define NET_TASK_STACK      320         /* Words, deepest path 872 bytes on the host plus the frame, 25% up */
+
+/* Local types */
+typedef struct {
+    uint32_t         ulStart;
+    uint32_t         ulEnd;
+    uint16_t         usMask;
+    HistSampleFunc_t pfnSample;
+    void            *pvPara;
+}HistQry_t;
+
+/* Forward declarations */
+static void     prvHistTask(void *pvPara);
+static void     prvHistNetTask(void *pvPara);
+static void     prvExport(SOCKET xSock);
+static uint16_t prvSample(uint16_t usMask, OUT int32_t *plVal);
+static void     prvStart(uint32_t ulTime);
+static uint32_t prvEncode(OUT uint8_t *pucBuf, uint32_t ulTime, uint16_t usMask, const int32_t *plVal);
+static void     prvProgram(void);
+static Bool_t   prvHeadTime(uint32_t ulSeq, OUT uint32_t *pulTime);
+static uint16_t prvPageCrc(const HistPage_t *pxPage);
+static void     prvPutVar(uint8_t *puc, uint32_t *pulNib, uint32_t ulVal);
+static Bool_t   prvGetVar(const uint8_t *puc, uint32_t *pulNib, uint32_t ulEnd, OUT uint32_t *pulVal);
+static void     prvSetNib(uint8_t *puc, uint32_t ulNib, uint8_t ucNib);
+static uint8_t  prvGetNib(const uint8_t *puc, uint32_t ulNib);
+static void     prvQrySample(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara);
+
+/* Local variables */
+static Bool_t        s_bInit = FALSE;
+static osMutexId     s_xMutex;
+static HistPage_t    s_xPage;                   /* Open page, s_ulSeq */
+static HistPage_t    s_xExpPage;
+static int32_t       s_lPrev[HIST_CH_NUM];      /* Last sample in the open page */
+static uint32_t      s_ulPrevTime = 0;
+static uint16_t      s_usPrevMask = 0;
+static uint32_t      s_ulSeq      = 0;          /* Page being filled */
+static uint32_t      s_ulFirstSeq = 0;          /* Oldest that may still be in flash */
+static Bool_t        s_bErased    = FALSE;      /* Sector of s_ulSeq found erased at boot */
+static uint16_t      s_usRate[HIST_CH_NUM];     /* Seconds, 0 is off */
+static const uint16_t s_usRateDef[HIST_CH_NUM] = {
+    10, 10, 10, 10, 10, 10, 10, 10, 10, 10,     /* Temperatures */
+    1, 1, 1,                                    /* Currents */
+    5,                                          /* Supply */
+    60, 60,                                     /* Cabinet */
+};
+/* Statistics */
+static uint32_t      s_ulFrameCnt  = 0;
+static uint32_t      s_ulSampleCnt = 0;
+static uint32_t      s_ulNibCnt    = 0;         /* Frame nibbles */
+static uint32_t      s_ulPageCnt   = 0;         /* Programmed since boot */
+static uint32_t      s_ulEraseCnt  = 0;
+static uint32_t      s_ulProgMax   = 0;         /* us, erase included */
+static uint32_t      s_ulScanTime  = 0;         /* us */
+static uint32_t      s_ulExpCnt    = 0;
+static uint32_t      s_ulLastTime  = 0;         /* Newest frame */
+
+/* Functions */
+Status_t AppHistInit(void)
+{
+    uint32_t ulCyc  = TimeCycGet();
+    uint32_t ulLast = SEQ_FREE;
+    uint32_t ulPos  = 0;
+    Status_t xRet   = STATUS_OK;
+
+    if (s_bInit) {
+        return STATUS_OK;
+    }
+
+    /* The newest sector has the largest sequence in its first page */
+    for (uint32_t s = 0; s < HIST_SECTOR_NUM; s++) {
+        uint32_t ulSeq;
+        MemFlashRead(HIST_ADDR + s * HIST_SECTOR, sizeof(ulSeq), (uint8_t *)&ulSeq);
+        if ((ulSeq != SEQ_FREE) && ((ulLast == SEQ_FREE) || ((int32_t)(ulSeq - ulLast) > 0))) {
+            ulLast = ulSeq;
+            ulPos  = s * PAGE_PER_SECTOR;
+        }
+    }
+    if (ulLast != SEQ_FREE) {
+        /* Then its first free page, a torn one is left behind */
+        uint32_t ulEnd = ulPos + PAGE_PER_SECTOR;
+        for (ulPos++; ulPos < ulEnd; ulPos++) {
+            MemFlashRead(HIST_ADDR + ulPos * HIST_PAGE, HIST_PAGE, (uint8_t *)&s_xExpPage);
+            if (s_xExpPage.xHead.ulSeq == SEQ_FREE) {
+                break;
+            }
+            if ((s_xExpPage.xHead.usLen <= DATA_NIB) && (s_xExpPage.xHead.usCrc == prvPageCrc(&s_xExpPage)) &&
+                ((int32_t)(s_xExpPage.xHead.ulSeq - ulLast) > 0)) {
+                ulLast = s_xExpPage.xHead.ulSeq;
+            }
+        }
+        ulPos %= PAGE_NUM;
+        /* Smallest sequence after the last that falls on the free page */
+        s_ulSeq = ulLast + 1 + ((ulPos + PAGE_NUM - (ulLast + 1) % PAGE_NUM) % PAGE_NUM);
+    }
+    else {
+        s_ulSeq = 0;
+    }
+    /* The sector of the newest page was erased when it was started */
+    uint32_t ulSector = (s_ulSeq != 0) ? ((s_ulSeq - 1) / PAGE_PER_SECTOR * PAGE_PER_SECTOR) : 0;
+    s_ulFirstSeq = (ulSector + PAGE_PER_SECTOR > PAGE_NUM) ? (ulSector + PAGE_PER_SECTOR - PAGE_NUM) : 0;
+    if ((s_ulSeq % PAGE_PER_SECTOR) == 0) {
+        uint32_t ulSeq;
+        MemFlashRead(PAGE_ADDR(s_ulSeq), sizeof(ulSeq), (uint8_t *)&ulSeq);
+        s_bErased = (ulSeq == SEQ_FREE) ? TRUE : FALSE;
+    }
+    s_xPage.xHead.usLen = 0;
+    memcpy(s_usRate, s_usRateDef, sizeof(s_usRate));
+    s_ulScanTime = TimeCycToUs(TimeCycGet() - ulCyc);
+
+    osMutexDef(HistMutex);
+    s_xMutex = osMutexCreate(osMutex(HistMutex));
+    if (pdPASS != xTaskCreate(prvHistTask, "tHist", TASK_STACK, NULL, tskIDLE_PRIORITY + 1, NULL)) {
+        TRACE("AppHistInit: create tHist task failed\n");
+        return STATUS_ERR;
+    }
+    /* Without the export the history is still kept and read by the CLI */
+    if (pdPASS != xTaskCreate(prvHistNetTask, "tHistNet", NET_TASK_STACK, NULL, tskIDLE_PRIORITY, NULL)) {
+        TRACE("AppHistInit: create tHistNet task failed\n");
+        xRet = STATUS_ERR;
+    }
+    s_bInit = TRUE;
+
+    TRACE("AppHistInit: page %d, %d us\n", s_ulSeq, s_ulScanTime);
+    return xRet;
+}
+
+Status_t HistPut(uint32_t ulTime, uint16_t usMask, const int32_t *plVal)
+{
+    uint8_t  ucFrame[NIB_BYTES(FRAME_MAX)];
+    uint32_t ulLen;
+
+    usMask &= CH_ALL;
+    if (!s_bInit || (plVal == NULL) || (usMask == 0)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    /* A clock set back closes the page, the heads stay in time order */
+    if ((s_xPage.xHead.usLen != 0) && (ulTime < s_ulPrevTime)) {
+        prvProgram();
+    }
+    if (s_xPage.xHead.usLen == 0) {
+        prvStart(ulTime);
+    }
+    ulLen = prvEncode(ucFrame, ulTime, usMask, plVal);
+    if (s_xPage.xHead.usLen + ulLen > DATA_NIB) {
+        prvProgram();
+        prvStart(ulTime);
+        ulLen = prvEncode(ucFrame, ulTime, usMask, plVal);
+    }
+    for (uint32_t n = 0; n < ulLen; n++) {
+        prvSetNib(s_xPage.ucData, s_xPage.xHead.usLen + n, prvGetNib(ucFrame, n));
+    }
+    s_xPage.xHead.usLen += ulLen;
+
+    for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+        if (usMask & CH_BIT(ch)) {
+            s_lPrev[ch] = plVal[ch];
+            s_ulSampleCnt++;
+        }
+    }
+    s_ulPrevTime = ulTime;
+    s_usPrevMask = usMask;
+    s_ulLastTime = ulTime;
+    s_ulFrameCnt++;
+    s_ulNibCnt += ulLen;
+
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+Status_t HistFlush(void)
+{
+    if (!s_bInit) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    prvProgram();
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+Status_t HistSetRate(uint8_t ucCh, uint16_t usSec)
+{
+    if (ucCh >= HIST_CH_NUM) {
+        return STATUS_ERR;
+    }
+    s_usRate[ucCh] = usSec;
+    return STATUS_OK;
+}
+
+uint16_t HistGetRate(uint8_t ucCh)
+{
+    return (ucCh < HIST_CH_NUM) ? s_usRate[ucCh] : 0;
+}
+
+uint32_t HistFind(uint32_t ulTime)
+{
+    uint32_t ulLo, ulHi, ulFirst, ulPageTime;
+
+    if (!s_bInit) {
+        return 0;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    /* First page that starts later, the one before holds ulTime. A lost page counts as newer,
+       the search may then start before it but never skips a page that holds ulTime or later */
+    ulFirst = s_ulFirstSeq;
+    ulLo    = ulFirst;
+    ulHi    = HistEnd();
+    while (ulLo < ulHi) {
+        uint32_t ulMid = ulLo + (ulHi - ulLo) / 2;
+        if (!prvHeadTime(ulMid, &ulPageTime) || (ulPageTime > ulTime)) {
+            ulHi = ulMid;
+        }
+        else {
+            ulLo = ulMid + 1;
+        }
+    }
+
+    osMutexRelease(s_xMutex);
+
+    return (ulLo > ulFirst) ? (ulLo - 1) : ulFirst;
+}
+
+uint32_t HistEnd(void)
+{
+    return s_ulSeq + ((s_xPage.xHead.usLen != 0) ? 1 : 0);
+}
+
+Status_t HistReadPage(uint32_t ulSeq, OUT HistPage_t *pxPage)
+{
+    Status_t xRet = STATUS_ERR;
+
+    if (!s_bInit || (pxPage == NULL)) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+
+    if ((ulSeq == s_ulSeq) && (s_xPage.xHead.usLen != 0)) {
+        /* Not programmed yet, served as it will be */
+        *pxPage              = s_xPage;
+        pxPage->xHead.ulSeq  = ulSeq;
+        pxPage->xHead.usCrc  = prvPageCrc(pxPage);
+        xRet                 = STATUS_OK;
+    }
+    else {
+        MemFlashRead(PAGE_ADDR(ulSeq), HIST_PAGE, (uint8_t *)pxPage);
+        if ((ulSeq >= s_ulFirstSeq) && (ulSeq < s_ulSeq) && (pxPage->xHead.ulSeq == ulSeq) &&
+            (pxPage->xHead.usLen <= DATA_NIB) && (pxPage->xHead.usCrc == prvPageCrc(pxPage))) {
+            xRet = STATUS_OK;
+        }
+    }
+
+    osMutexRelease(s_xMutex);
+
+    return xRet;
+}
+
+Status_t HistDecode(const HistPage_t *pxPage, HistSampleFunc_t pfnSample, void *pvPara)
+{
+    int32_t        lVal[HIST_CH_NUM] = {0};
+    uint32_t       ulTime, ulDt, ulZz;
+    uint32_t       ulMask = 0;
+    uint32_t       ulNib  = 0;
+    uint32_t       ulEnd;
+    const uint8_t *puc;
+
+    if ((pxPage == NULL) || (pfnSample == NULL) || (pxPage->xHead.usLen > DATA_NIB)) {
+        return STATUS_ERR;
+    }
+
+    ulTime = pxPage->xHead.ulTime;
+    puc    = pxPage->ucData;
+    ulEnd  = pxPage->xHead.usLen;
+    while (ulNib < ulEnd) {
+        if (!prvGetVar(puc, &ulNib, ulEnd, &ulDt)) {
+            return STATUS_ERR;
+        }
+        if ((ulDt & 1) && (!prvGetVar(puc, &ulNib, ulEnd, &ulMask) || (ulMask & ~CH_ALL))) {
+            return STATUS_ERR;
+        }
+        ulTime += ulDt >> 1;
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            if (!(ulMask & CH_BIT(ch))) {
+                continue;
+            }
+            if (!prvGetVar(puc, &ulNib, ulEnd, &ulZz)) {
+                return STATUS_ERR;
+            }
+            lVal[ch] = (int32_t)((uint32_t)lVal[ch] + ((ulZz >> 1) ^ (0 - (ulZz & 1))));
+            pfnSample(ulTime, ch, lVal[ch], pvPara);
+        }
+    }
+
+    return STATUS_OK;
+}
+
+Status_t HistQuery(uint32_t ulStart, uint32_t ulEnd, uint16_t usMask, HistSampleFunc_t pfnSample, void *pvPara)
+{
+    static HistPage_t s_xQryPage;
+    HistQry_t         xQry;
+
+    if (!s_bInit || (pfnSample == NULL) || (ulStart > ulEnd)) {
+        return STATUS_ERR;
+    }
+
+    xQry.ulStart   = ulStart;
+    xQry.ulEnd     = ulEnd;
+    xQry.usMask    = usMask;
+    xQry.pfnSample = pfnSample;
+    xQry.pvPara    = pvPara;
+    for (uint32_t ulSeq = HistFind(ulStart); ulSeq < HistEnd(); ulSeq++) {
+        if (STATUS_OK != HistReadPage(ulSeq, &s_xQryPage)) {
+            continue;
+        }
+        if (s_xQryPage.xHead.ulTime > ulEnd) {
+            break;
+        }
+        HistDecode(&s_xQryPage, prvQrySample, &xQry);
+    }
+
+    return STATUS_OK;
+}
+
+static void prvQrySample(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara)
+{
+    HistQry_t *pxQry = (HistQry_t *)pvPara;
+
+    if ((pxQry->usMask & CH_BIT(ucCh)) && (ulTime >= pxQry->ulStart) && (ulTime <= pxQry->ulEnd)) {
+        pxQry->pfnSample(ulTime, ucCh, lVal, pxQry->pvPara);
+    }
+}
+
+static void prvHistTask(void *pvPara)
+{
+    int32_t  lVal[HIST_CH_NUM];
+    uint32_t ulSec     = 0;
+    uint32_t ulRtcTick = 0;
+    uint32_t ulBase    = 0;
+    Bool_t   bRtc      = FALSE;
+    uint32_t ulWake    = osKernelSysTick();
+
+    while (1) {
+        uint32_t ulNow = osKernelSysTick();
+
+        /* Samples take their time from this base, the RTC is read once an hour */
+        if (!bRtc || ((ulNow - ulRtcTick) >= RTC_PRD)) {
+            Time_t xTm = RtcReadTime(RTC_TYPE_DS1338);
+            ulBase     = mktime(&xTm);
+            ulRtcTick  = ulNow;
+            bRtc       = TRUE;
+        }
+        uint32_t ulTime = ulBase + (ulNow - ulRtcTick) / 1000;
+
+        uint16_t usMask = 0;
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            if (s_usRate[ch] && ((ulSec % s_usRate[ch]) == 0)) {
+                usMask |= CH_BIT(ch);
+            }
+        }
+        usMask = prvSample(usMask, lVal);
+        if (usMask != 0) {
+            HistPut(ulTime, usMask, lVal);
+        }
+        /* Slow channels only, the page is not held for hours */
+        if ((s_xPage.xHead.usLen != 0) && ((ulTime - s_xPage.xHead.ulTime) >= HIST_FLUSH_AGE)) {
+            HistFlush();
+        }
+        ulSec++;
+
+        /* Fixed period, a late round is not made up */
+        ulWake += SAMPLE_PRD;
+        int32_t lWait = (int32_t)(ulWake - osKernelSysTick());
+        if (lWait > 0) {
+            osDelay(lWait);
+        }
+        else {
+            ulWake = osKernelSysTick();
+        }
+    }
+}
+
+/* Channels that could not be read are dropped from the mask */
+static uint16_t prvSample(uint16_t usMask, OUT int32_t *plVal)
+{
+    for (uint8_t ch = HIST_CH_TEMP1; ch <= HIST_CH_TEMP10; ch++) {
+        if (!(usMask & CH_BIT(ch))) {
+            continue;
+        }
+        if ((ch - HIST_CH_TEMP1) < th_TempNum) {
+            plVal[ch] = StcGetTemp(STC_DEV_1, (StcTempNode_t)(STC_TEMP_NODE_1 + ch - HIST_CH_TEMP1));
+        }
+        else {
+            usMask &= ~CH_BIT(ch);
+        }
+    }
+    plVal[HIST_CH_CUR1]     = AdcGet(ADC_CHAN_1);
+    plVal[HIST_CH_CUR2]     = AdcGet(ADC_CHAN_3);
+    plVal[HIST_CH_CUR3]     = AdcGet(ADC_CHAN_5);
+    plVal[HIST_CH_MPWR_VOL] = PwrDataGet(PWR2_M1_ADDR, PWR_OUTPUT_VOL);
+    if (usMask & (CH_BIT(HIST_CH_HUMI) | CH_BIT(HIST_CH_AMB_TEMP))) {
+        int      lTemp;
+        uint16_t usHumi;
+        if (STATUS_OK == aht30_read_humiture(&lTemp, &usHumi)) {
+            plVal[HIST_CH_HUMI]     = usHumi;
+            plVal[HIST_CH_AMB_TEMP] = lTemp;
+        }
+        else {
+            usMask &= ~(CH_BIT(HIST_CH_HUMI) | CH_BIT(HIST_CH_AMB_TEMP));
+        }
+    }
+
+    return usMask;
+}
+
+static void prvStart(uint32_t ulTime)
+{
+    s_xPage.xHead.ulTime = ulTime;
+    s_xPage.xHead.usLen  = 0;
+    s_ulPrevTime         = ulTime;
+    s_usPrevMask         = 0;
+    memset(s_lPrev, 0, sizeof(s_lPrev));
+    memset(s_xPage.ucData, 0xFF, sizeof(s_xPage.ucData));
+}
+
+static uint32_t prvEncode(OUT uint8_t *pucBuf, uint32_t ulTime, uint16_t usMask, const int32_t *plVal)
+{
+    uint32_t ulNib = 0;
+
+    /* Low bit set if the mask follows, the 1 s current frames repeat theirs */
+    prvPutVar(pucBuf, &ulNib, ((ulTime - s_ulPrevTime) << 1) | ((usMask != s_usPrevMask) ? 1 : 0));
+    if (usMask != s_usPrevMask) {
+        prvPutVar(pucBuf, &ulNib, usMask);
+    }
+    for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+        if (usMask & CH_BIT(ch)) {
+            /* Zigzag, a change of -4 to 3 takes a nibble */
+            uint32_t ulDiff = (uint32_t)plVal[ch] - (uint32_t)s_lPrev[ch];
+            prvPutVar(pucBuf, &ulNib, (ulDiff << 1) ^ (uint32_t)((int32_t)ulDiff >> 31));
+        }
+    }
+
+    return ulNib;
+}
+
+static void prvProgram(void)
+{
+    uint32_t ulCyc = TimeCycGet();
+    uint32_t ulSeq = s_ulSeq;
+
+    if (s_xPage.xHead.usLen == 0) {
+        return;
+    }
+
+    if (((ulSeq % PAGE_PER_SECTOR) == 0) && !s_bErased) {
+        MemFlashErase(PAGE_ADDR(ulSeq), HIST_SECTOR);
+        s_ulEraseCnt++;
+        if (ulSeq + PAGE_PER_SECTOR > PAGE_NUM) {
+            s_ulFirstSeq = ulSeq + PAGE_PER_SECTOR - PAGE_NUM;
+        }
+    }
+    s_bErased = FALSE;
+
+    /* Head and frames only, the rest of the page stays erased */
+    s_xPage.xHead.ulSeq = ulSeq;
+    s_xPage.xHead.usCrc = prvPageCrc(&s_xPage);
+    MemFlashProgram(PAGE_ADDR(ulSeq), sizeof(HistHead_t) + NIB_BYTES(s_xPage.xHead.usLen), (uint8_t *)&s_xPage);
+    s_xPage.xHead.usLen = 0;
+    s_ulSeq             = ulSeq + 1;
+    s_ulPageCnt++;
+
+    ulCyc = TimeCycToUs(TimeCycGet() - ulCyc);
+    if (ulCyc > s_ulProgMax) {
+        s_ulProgMax = ulCyc;
+    }
+}
+
+static Bool_t prvHeadTime(uint32_t ulSeq, OUT uint32_t *pulTime)
+{
+    HistHead_t xHead;
+
+    if ((ulSeq == s_ulSeq) && (s_xPage.xHead.usLen != 0)) {
+        *pulTime = s_xPage.xHead.ulTime;
+        return TRUE;
+    }
+    MemFlashRead(PAGE_ADDR(ulSeq), sizeof(xHead), (uint8_t *)&xHead);
+    *pulTime = xHead.ulTime;
+    return (xHead.ulSeq == ulSeq) ? TRUE : FALSE;
+}
+
+static uint16_t prvPageCrc(const HistPage_t *pxPage)
+{
+    uint16_t usCrc = Crc16Ccitt(CRC16_CCITT_INIT, (const uint8_t *)&pxPage->xHead, offsetof(HistHead_t, usCrc));
+    return Crc16Ccitt(usCrc, pxPage->ucData, NIB_BYTES(pxPage->xHead.usLen));
+}
+
+static void prvPutVar(uint8_t *puc, uint32_t *pulNib, uint32_t ulVal)
+{
+    do {
+        uint8_t ucNib = ulVal & 0x07;
+        ulVal >>= 3;
+        if (ulVal) {
+            ucNib |= 0x08;
+        }
+        prvSetNib(puc, (*pulNib)++, ucNib);
+    } while (ulVal);
+}
+
+static Bool_t prvGetVar(const uint8_t *puc, uint32_t *pulNib, uint32_t ulEnd, OUT uint32_t *pulVal)
+{
+    uint32_t ulVal = 0;
+
+    for (uint8_t ucShift = 0; (*pulNib < ulEnd) && (ucShift < 33); ucShift += 3) {
+        uint8_t ucNib = prvGetNib(puc, (*pulNib)++);
+        ulVal |= (uint32_t)(ucNib & 0x07) << ucShift;
+        if (!(ucNib & 0x08)) {
+            *pulVal = ulVal;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* Low nibble first */
+static void prvSetNib(uint8_t *puc, uint32_t ulNib, uint8_t ucNib)
+{
+    uint8_t ucShift = (ulNib & 1) ? 4 : 0;
+    puc[ulNib >> 1] = (uint8_t)((puc[ulNib >> 1] & ~(0x0F << ucShift)) | (ucNib << ucShift));
+}
+
+static uint8_t prvGetNib(const uint8_t *puc, uint32_t ulNib)
+{
+    return (puc[ulNib >> 1] >> ((ulNib & 1) ? 4 : 0)) & 0x0F;
+}
+
+static void prvHistNetTask(void *pvPara)
+{
+    struct sockaddr_in xSvrAddr, xCliAddr;
+    SOCKET             xSvrSock, xCliSock;
+
+    xSvrSock = socket(AF_INET, SOCK_STREAM, 0);
+    if (xSvrSock == -1) {
+        TRACE("hist socket failed\n");
+    }
+    xSvrAddr.sin_family      = AF_INET;
+    xSvrAddr.sin_addr.s_addr = INADDR_ANY;
+    xSvrAddr.sin_port        = htons(HIST_PORT);
+    if (bind(xSvrSock, (struct sockaddr *)&xSvrAddr, sizeof(xSvrAddr)) == -1) {
+        TRACE("hist bind failed\n");
+    }
+    if (listen(xSvrSock, 1) == -1) {
+        TRACE("hist listen failed\n");
+    }
+
+    /* One export at a time, the client closes or is closed once the pages are sent */
+    while (1) {
+        socklen_t xCliAddrLength = sizeof(xCliAddr);
+        xCliSock = accept(xSvrSock, (struct sockaddr *)&xCliAddr, &xCliAddrLength);
+        if (xCliSock == -1) {
+            TRACE("hist accept failed\n");
+            osDelay(1000);
+            continue;
+        }
+        prvExport(xCliSock);
+        close(xCliSock);
+    }
+}
+
+static void prvExport(SOCKET xSock)
+{
+    HistExpReq_t  xReq;
+    HistExpHead_t xHead;
+    uint32_t      ulGot     = 0;
+    int           lTimeout  = EXP_RECV_TIMEOUT;
+    uint32_t      ulCyc     = TimeCycGet();
+
+    setsockopt(xSock, SOL_SOCKET, SO_RCVTIMEO, &lTimeout, sizeof(lTimeout));
+    while (ulGot < sizeof(xReq)) {
+        int lRead = recv(xSock, (uint8_t *)&xReq + ulGot, sizeof(xReq) - ulGot, 0);
+        if (lRead <= 0) {
+            return;
+        }
+        ulGot += lRead;
+    }
+
+    /* Pages from the one holding ulStart to the one holding ulEnd */
+    uint32_t ulSeq = HistFind(xReq.ulStart);
+    uint32_t ulEnd = (xReq.ulEnd >= xReq.ulStart) ? (HistFind(xReq.ulEnd) + 1) : ulSeq;
+    if (ulEnd > HistEnd()) {
+        ulEnd = HistEnd();
+    }
+    xHead.ulMagic = HIST_EXP_MAGIC;
+    xHead.ulSeq   = ulSeq;
+    xHead.ulNum   = (ulEnd > ulSeq) ? (ulEnd - ulSeq) : 0;
+    xHead.usPage  = HIST_PAGE;
+    xHead.ucChNum = HIST_CH_NUM;
+    xHead.ucRsvd  = 0;
+    if (send(xSock, &xHead, sizeof(xHead), 0) < 0) {
+        return;
+    }
+
+    /* Lost pages are sent as read, the client drops them by sequence and crc */
+    for (; ulSeq < ulEnd; ulSeq++) {
+        HistReadPage(ulSeq, &s_xExpPage);
+        if (send(xSock, &s_xExpPage, HIST_PAGE, 0) < 0) {
+            break;
+        }
+    }
+    s_ulExpCnt++;
+    TRACE("hist export: %d pages, %d us\n", xHead.ulNum, TimeCycToUs(TimeCycGet() - ulCyc));
+}
+
+static void prvCliPrintSample(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara)
+{
+    cli_printf *cliprintf = (cli_printf *)pvPara;
+    cliprintf("%10lu ch %2d: %ld\n", (unsigned long)ulTime, ucCh, (long)lVal);
+}
+
+static void prvCliCmdHist(cli_printf cliprintf, int argc, char** argv)
+{
+    CHECK_CLI();
+
+    if (!s_bInit) {
+        cliprintf("historian not initialized\n");
+        return;
+    }
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "stat"))) {
+        uint32_t ulRaw = s_ulFrameCnt * 4 + s_ulSampleCnt * 2; /* A time and 16 bit samples */
+        uint32_t ulCmp = NIB_BYTES(s_ulNibCnt) + s_ulPageCnt * sizeof(HistHead_t);
+        cliprintf("PAGES       : %lu - %lu (%d in ring)\n", (unsigned long)s_ulFirstSeq, (unsigned long)HistEnd(),
+                  PAGE_NUM);
+        cliprintf("FRAMES      : %lu\n", (unsigned long)s_ulFrameCnt);
+        cliprintf("SAMPLES     : %lu\n", (unsigned long)s_ulSampleCnt);
+        cliprintf("BYTES/SAMPLE: %lu.%02lu\n", (unsigned long)(s_ulSampleCnt ? (ulCmp / s_ulSampleCnt) : 0),
+                  (unsigned long)(s_ulSampleCnt ? ((ulCmp * 100 / s_ulSampleCnt) % 100) : 0));
+        cliprintf("RATIO       : %lu.%02lu\n", (unsigned long)(ulCmp ? (ulRaw / ulCmp) : 0),
+                  (unsigned long)(ulCmp ? ((ulRaw * 100 / ulCmp) % 100) : 0));
+        cliprintf("PROG MAX    : %lu us\n", (unsigned long)s_ulProgMax);
+        cliprintf("ERASE CNT   : %lu\n", (unsigned long)s_ulEraseCnt);
+        cliprintf("BOOT SCAN   : %lu us\n", (unsigned long)s_ulScanTime);
+        cliprintf("EXPORTS     : %lu\n", (unsigned long)s_ulExpCnt);
+        return;
+    }
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "flush"))) {
+        HistFlush();
+        return;
+    }
+
+    /* hist rate [CH SEC] */
+    if ((argc >= 2) && (0 == strcmp(argv[1], "rate"))) {
+        if ((argc >= 4) && (STATUS_OK != HistSetRate(atoi(argv[2]), atoi(argv[3])))) {
+            cliprintf("channel 0 - %d\n", HIST_CH_NUM - 1);
+            return;
+        }
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            cliprintf("CH %2d : %d s\n", ch, HistGetRate(ch));
+        }
+        return;
+    }
+
+    /* hist CH [SEC], the newest samples of a channel */
+    if (argc >= 2) {
+        uint32_t ulCh  = atoi(argv[1]);
+        uint32_t ulSec = (argc >= 3) ? atoi(argv[2]) : 60;
+        uint32_t ulCyc = TimeCycGet();
+        if (ulCh >= HIST_CH_NUM) {
+            cliprintf("channel 0 - %d\n", HIST_CH_NUM - 1);
+            return;
+        }
+        HistQuery(s_ulLastTime - ulSec, s_ulLastTime, CH_BIT(ulCh), prvCliPrintSample, (void *)cliprintf);
+        cliprintf("query %lu us\n", (unsigned long)TimeCycToUs(TimeCycGet() - ulCyc));
+        return;
+    }
+
+    cliprintf("hist stat | flush | rate [CH SEC] | CH [SEC]\n");
+}
+CLI_CMD_EXPORT(hist, telemetry historian, prvCliCmdHist)
@@ -0,0 +1,118 @@
+/*
+    Hist.h
+
+    Head File for App Telemetry Historian Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+*/
+
+#ifndef __HIST_H__
+#define __HIST_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include "Include/Include.h"
+
+/* Defines */
+#define HIST_ADDR           (1024*1024)     /* SPI flash, after the event log */
+#define HIST_SECTOR         4096
+#define HIST_SECTOR_NUM     1024            /* 4 MB */
+#define HIST_PAGE           256             /* Program unit, a page is one compressed block */
+#define HIST_FLUSH_AGE      600             /* Seconds a partial page is held in RAM */
+#define HIST_PORT           6001            /* Bulk export over TCP */
+#define HIST_EXP_MAGIC      0x54534948      /* "HIST" */
+
+/* Types */
+typedef enum {
+    HIST_CH_TEMP1,          /* STC_DEV_1 nodes, as StcGetTemp */
+    HIST_CH_TEMP2,
+    HIST_CH_TEMP3,
+    HIST_CH_TEMP4,
+    HIST_CH_TEMP5,
+    HIST_CH_TEMP6,
+    HIST_CH_TEMP7,
+    HIST_CH_TEMP8,
+    HIST_CH_TEMP9,
+    HIST_CH_TEMP10,
+    HIST_CH_CUR1,           /* Channel currents, ADC counts */
+    HIST_CH_CUR2,
+    HIST_CH_CUR3,
+    HIST_CH_MPWR_VOL,       /* Main supply, 0.1 V */
+    HIST_CH_HUMI,           /* Cabinet humidity, % */
+    HIST_CH_AMB_TEMP,       /* Cabinet temperature, degC */
+    HIST_CH_NUM
+}HistCh_t;
+
+#pragma pack(push)
+#pragma pack(1)
+typedef struct {
+    uint32_t ulSeq;         /* Also the page in the ring */
+    uint32_t ulTime;        /* RTC seconds of the first frame */
+    uint16_t usLen;         /* Frame nibbles after the head */
+    uint16_t usCrc;
+}HistHead_t;
+
+/*
+    Frames follow the head, each is varint(seconds since the previous frame << 1 |
+    mask changed), varint(channel mask) if it changed and a zigzag varint per channel
+    in the mask of the change since its previous sample in the page. A varint is a
+    run of nibbles, low first, of 3 value bits and a continue bit 0x8, packed low
+    nibble first. Every page starts from 0 with an empty mask, so it decodes on its
+    own.
+*/
+typedef struct {
+    HistHead_t xHead;
+    uint8_t    ucData[HIST_PAGE - sizeof(HistHead_t)];
+}HistPage_t;
+
+/* Export port: the client sends a HistExpReq_t, gets a HistExpHead_t and ulNum pages */
+typedef struct {
+    uint32_t ulStart;       /* RTC seconds, both ends included */
+    uint32_t ulEnd;
+}HistExpReq_t;
+
+typedef struct {
+    uint32_t ulMagic;
+    uint32_t ulSeq;         /* First page sent */
+    uint32_t ulNum;
+    uint16_t usPage;
+    uint8_t  ucChNum;
+    uint8_t  ucRsvd;
+}HistExpHead_t;
+#pragma pack(pop)
+
+typedef void (*HistSampleFunc_t)(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara);
+
+/* Functions */
+Status_t AppHistInit(void);
+/* Adds a frame of the channels in usMask, plVal is indexed by channel */
+Status_t HistPut(uint32_t ulTime, uint16_t usMask, const int32_t *plVal);
+/* Programs the partial page now, call before a reset */
+Status_t HistFlush(void);
+/* Sample period in seconds, 0 stops the channel */
+Status_t HistSetRate(uint8_t ucCh, uint16_t usSec);
+uint16_t HistGetRate(uint8_t ucCh);
+/* Page that holds ulTime, found by a binary search on the page heads */
+uint32_t HistFind(uint32_t ulTime);
+/* Page after the newest, the one in RAM included */
+uint32_t HistEnd(void);
+/* STATUS_ERR if the page was erased or torn, *pxPage is filled either way */
+Status_t HistReadPage(uint32_t ulSeq, OUT HistPage_t *pxPage);
+Status_t HistDecode(const HistPage_t *pxPage, HistSampleFunc_t pfnSample, void *pvPara);
+/* Samples of the channels in usMask with ulStart <= time <= ulEnd, oldest first */
+Status_t HistQuery(uint32_t ulStart, uint32_t ulEnd, uint16_t usMask, HistSampleFunc_t pfnSample, void *pvPara);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __HIST_H__ */
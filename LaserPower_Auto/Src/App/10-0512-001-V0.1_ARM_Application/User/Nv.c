@@ -0,0 +1,448 @@
+/*
+    Nv.c
+
+    Implementation File for App Persistent Counter Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent A formatted counter loads as 0, not as lost
+    01c, 19Oct26, agent CLI prints the counters with %lu
+    01d, 19Oct26, agent tNv stack from its deepest path, its creation checked
+*/
+
+/* Includes */
+#include "Include.h"
+
+/* Debug config */
+#if NV_DEBUG
+    #undef TRACE
+    #define TRACE(...)  DebugPrintf(__VA_ARGS__)
+#else
+    #undef TRACE
+    #define TRACE(...)
+#endif /* NV_DEBUG */
+#if NV_ASSERT
+    #undef ASSERT
+    #define ASSERT(a)   while(!(a)){DebugPrintf("ASSERT failed: %s %d\n", __FILE__, __LINE__);}
+#else
+    #undef ASSERT
+    #define ASSERT(...)
+#endif /* NV_ASSERT */
+
+/*
+    Counters that change every second are kept out of the SPI flash, where each
+    update would be a sector erase. The store is byte writable, a counter write is
+    its 6 byte slot and nothing else. Without FRAM on the board the DS1338 battery
+    backed RAM is used, 56 bytes on the software I2C: a slot takes about 200 ms of
+    bus time, all of it in osDelay, so writes are made by tNv only and the periods
+    keep the bus free for the AHT30.
+*/
+
+/* Local defines */
+#if NV_FRAM && !MEM_ENABLE_FRAM
+#error "NV_FRAM needs MEM_ENABLE_FRAM"
+#endif
+#undef PORT
+#define PORT(a)             (a##_Pin_Port)
+#define SLOT_NUM            2
+#define REC_SIZE            (sizeof(NvSlot_t) * SLOT_NUM)
+#define REC_OFF(id)         (sizeof(uint32_t) + (id) * REC_SIZE)
+#define STORE_SIZE          REC_OFF(NV_NUM)
+#define WH_J                3600.0f
+#define TASK_STACK          192         /* Words, deepest path 536 bytes on the host plus the frame, 25% up */
+
+/* Local types */
+typedef struct {
+    const char *pcName;
+    uint16_t    usPeriod;   /* s, 0 is on change */
+    uint16_t    usAge;      /* s since the last write */
+    uint32_t    ulVal;
+    uint8_t     ucSeq;      /* Of the newest slot */
+    uint8_t     ucSlot;     /* Newest slot, the next write goes to the other */
+    Bool_t      bReg;
+    Bool_t      bDirty;
+    Bool_t      bSet;       /* Set before the load, the stored value is dropped */
+}NvVar_t;
+
+/* Forward declarations */
+static void     prvNvTask(void *pvPara);
+static void     prvLoad(void);
+static void     prvTick(void);
+static void     prvWriteDue(Bool_t bAll);
+static Status_t prvWrite(NvId_t xId);
+static uint8_t  prvCrc(NvId_t xId, const NvSlot_t *pxSlot);
+static Status_t prvDevRead(uint32_t ulOff, uint32_t ulLength, OUT uint8_t *pucData);
+static Status_t prvDevWrite(uint32_t ulOff, uint32_t ulLength, IN uint8_t *pucData);
+
+/* Local variables */
+static Bool_t        s_bInit   = FALSE;
+static Bool_t        s_bLoaded = FALSE;
+static osMutexId     s_xMutex;
+static TaskHandle_t  s_xTask   = NULL;
+static NvVar_t       s_xVar[NV_NUM];
+static float         s_fEnergy = 0;             /* J not yet counted in NV_ENERGY */
+#if NV_FRAM
+static MemHandle_t   s_xFram;
+#endif /* NV_FRAM */
+/* Statistics */
+static uint32_t      s_ulWriteCnt = 0;
+static uint32_t      s_ulErrCnt   = 0;
+static uint32_t      s_ulWriteLast = 0;         /* us, a slot */
+static uint32_t      s_ulWriteMax  = 0;
+static uint32_t      s_ulLoadTime  = 0;
+static uint32_t      s_ulLostCnt   = 0;         /* Counters with no valid slot at the load */
+
+/* Functions */
+Status_t AppNvInit(void)
+{
+    if (s_bInit) {
+        return STATUS_OK;
+    }
+
+#if NV_FRAM
+    MemInit(MEM_DEVICE_FRAM);
+    s_xFram = MemCreate(MEM_DEVICE_FRAM);
+
+    MemConfig_t xConfig;
+    MemConfigInit(&xConfig);
+    MemConfigSpi(&xConfig, NV_FRAM_SPI);
+    MemConfigCsPin(&xConfig, PORT(FRAM_CS), PIN(FRAM_CS));
+    MemConfig(s_xFram, &xConfig);
+#endif /* NV_FRAM */
+
+    memset(s_xVar, 0, sizeof(s_xVar));
+    NvReg(NV_RUN_TIME,   "run time",   60);
+    NvReg(NV_LASER_TIME, "laser time", 60);
+    NvReg(NV_TRIP_CNT,   "trips",      0);
+    NvReg(NV_ENERGY,     "energy",     60);
+
+    osMutexDef(NvMutex);
+    s_xMutex = osMutexCreate(osMutex(NvMutex));
+    /* The store is read by the task, the I2C waits on the scheduler */
+    if (pdPASS != xTaskCreate(prvNvTask, "tNv", TASK_STACK, NULL, tskIDLE_PRIORITY + 1, &s_xTask)) {
+        TRACE("AppNvInit: create tNv task failed\n");
+        s_xTask = NULL;
+        return STATUS_ERR;
+    }
+    s_bInit = TRUE;
+
+    return STATUS_OK;
+}
+
+Status_t NvReg(NvId_t xId, const char *pcName, uint16_t usPeriod)
+{
+    if (xId >= NV_NUM) {
+        return STATUS_ERR;
+    }
+    s_xVar[xId].pcName   = pcName;
+    s_xVar[xId].usPeriod = usPeriod;
+    s_xVar[xId].bReg     = TRUE;
+    return STATUS_OK;
+}
+
+Status_t NvAdd(NvId_t xId, uint32_t ulDelta)
+{
+    if (!s_bInit || (xId >= NV_NUM)) {
+        return STATUS_ERR;
+    }
+    if (ulDelta == 0) {
+        return STATUS_OK;
+    }
+
+    taskENTER_CRITICAL();
+    s_xVar[xId].ulVal += ulDelta;
+    s_xVar[xId].bDirty = TRUE;
+    taskEXIT_CRITICAL();
+
+    if (s_xVar[xId].usPeriod == 0) {
+        xTaskNotifyGive(s_xTask);
+    }
+    return STATUS_OK;
+}
+
+Status_t NvSet(NvId_t xId, uint32_t ulVal)
+{
+    if (!s_bInit || (xId >= NV_NUM)) {
+        return STATUS_ERR;
+    }
+
+    taskENTER_CRITICAL();
+    s_xVar[xId].ulVal  = ulVal;
+    s_xVar[xId].bDirty = TRUE;
+    s_xVar[xId].bSet   = TRUE;
+    s_xVar[xId].usAge  = s_xVar[xId].usPeriod;
+    taskEXIT_CRITICAL();
+
+    xTaskNotifyGive(s_xTask);
+    return STATUS_OK;
+}
+
+uint32_t NvGet(NvId_t xId)
+{
+    return (xId < NV_NUM) ? s_xVar[xId].ulVal : 0;
+}
+
+Status_t NvFlush(void)
+{
+    if (!s_bInit || !s_bLoaded) {
+        return STATUS_ERR;
+    }
+
+    osMutexWait(s_xMutex, osWaitForever);
+    prvWriteDue(TRUE);
+    osMutexRelease(s_xMutex);
+
+    return STATUS_OK;
+}
+
+static void prvNvTask(void *pvPara)
+{
+    uint32_t ulWake;
+
+    osMutexWait(s_xMutex, osWaitForever);
+    prvLoad();
+    osMutexRelease(s_xMutex);
+
+    ulWake = osKernelSysTick() + NV_PRD;
+    while (1) {
+        /* Woken early by a change of an on change counter */
+        int32_t lWait = (int32_t)(ulWake - osKernelSysTick());
+        if (lWait > 0) {
+            ulTaskNotifyTake(pdTRUE, lWait);
+        }
+        lWait = (int32_t)(ulWake - osKernelSysTick());
+        if (lWait <= 0) {
+            prvTick();
+            /* A late round is not made up, the time would be counted twice */
+            ulWake = (lWait > -NV_PRD) ? (ulWake + NV_PRD) : (osKernelSysTick() + NV_PRD);
+        }
+
+        osMutexWait(s_xMutex, osWaitForever);
+        prvWriteDue(FALSE);
+        osMutexRelease(s_xMutex);
+    }
+}
+
+static void prvLoad(void)
+{
+    uint32_t ulCyc = TimeCycGet();
+    uint32_t ulMagic;
+    NvSlot_t xSlot[SLOT_NUM];
+
+    if ((STATUS_OK != prvDevRead(0, sizeof(ulMagic), (uint8_t *)&ulMagic)) || (ulMagic != NV_MAGIC)) {
+        /* First start or the battery was out, the counters begin from 0 */
+        TRACE("nv: no store, formatted\n");
+        for (uint8_t n = 0; n < NV_NUM; n++) {
+            /* Slot 0 holds 0, the others fail the CRC, what was in the RAM may pass it. A
+               counter not written before the next cut loads as 0, not as lost */
+            for (uint8_t s = 0; s < SLOT_NUM; s++) {
+                xSlot[s].ulVal = 0;
+                xSlot[s].ucSeq = s;
+                xSlot[s].ucCrc = prvCrc((NvId_t)n, &xSlot[s]);
+                if (s != 0) {
+                    xSlot[s].ucCrc = ~xSlot[s].ucCrc;
+                }
+            }
+            prvDevWrite(REC_OFF(n), REC_SIZE, (uint8_t *)xSlot);
+            s_xVar[n].ucSeq  = 0;
+            s_xVar[n].ucSlot = 0;
+        }
+        /* Last, a format cut short is done again */
+        ulMagic = NV_MAGIC;
+        prvDevWrite(0, sizeof(ulMagic), (uint8_t *)&ulMagic);
+        s_bLoaded = TRUE;
+        return;
+    }
+
+    for (uint8_t n = 0; n < NV_NUM; n++) {
+        NvVar_t *px   = &s_xVar[n];
+        int8_t   cNew = -1;
+
+        if (STATUS_OK == prvDevRead(REC_OFF(n), REC_SIZE, (uint8_t *)xSlot)) {
+            for (uint8_t s = 0; s < SLOT_NUM; s++) {
+                if (xSlot[s].ucCrc != prvCrc((NvId_t)n, &xSlot[s])) {
+                    continue;
+                }
+                if ((cNew < 0) || ((int8_t)(xSlot[s].ucSeq - xSlot[cNew].ucSeq) > 0)) {
+                    cNew = s;
+                }
+            }
+        }
+
+        taskENTER_CRITICAL();
+        if (cNew >= 0) {
+            /* Counts added before the load are kept */
+            if (!px->bSet) {
+                px->ulVal += xSlot[cNew].ulVal;
+            }
+            px->ucSeq  = xSlot[cNew].ucSeq;
+            px->ucSlot = cNew;
+        }
+        else {
+            px->ucSeq  = 0xFF;
+            px->ucSlot = SLOT_NUM - 1;
+            px->bDirty = TRUE;
+            s_ulLostCnt++;
+        }
+        taskEXIT_CRITICAL();
+    }
+    s_bLoaded    = TRUE;
+    s_ulLoadTime = TimeCycToUs(TimeCycGet() - ulCyc);
+
+    TRACE("nv: loaded, %d us\n", s_ulLoadTime);
+}
+
+/* Once a second */
+static void prvTick(void)
+{
+    NvAdd(NV_RUN_TIME, 1);
+    if (th_SysStatus.WORK_LASER) {
+        NvAdd(NV_LASER_TIME, 1);
+    }
+
+    /* W over a second is J */
+    float fCur = ADC_TO_CUR(AdcGet(APWR1_CUR)) + ADC_TO_CUR(AdcGet(APWR2_CUR)) + ADC_TO_CUR(AdcGet(APWR3_CUR));
+    float fVol = PwrDataGet(PWR2_M1_ADDR, PWR_OUTPUT_VOL) * 0.1f;
+    if ((fVol > 0) && (fCur > 0)) {
+        s_fEnergy += fVol * fCur;
+    }
+    if (s_fEnergy >= WH_J) {
+        uint32_t ulWh = (uint32_t)(s_fEnergy / WH_J);
+        s_fEnergy -= ulWh * WH_J;
+        NvAdd(NV_ENERGY, ulWh);
+    }
+
+    for (uint8_t n = 0; n < NV_NUM; n++) {
+        if (s_xVar[n].usAge < 0xFFFF) {
+            s_xVar[n].usAge++;
+        }
+    }
+}
+
+static void prvWriteDue(Bool_t bAll)
+{
+    for (uint8_t n = 0; n < NV_NUM; n++) {
+        NvVar_t *px = &s_xVar[n];
+        if (!px->bReg || !px->bDirty) {
+            continue;
+        }
+        if (bAll || (px->usPeriod == 0) || (px->usAge >= px->usPeriod)) {
+            prvWrite((NvId_t)n);
+        }
+    }
+}
+
+static Status_t prvWrite(NvId_t xId)
+{
+    NvVar_t *px    = &s_xVar[xId];
+    uint32_t ulCyc = TimeCycGet();
+    uint8_t  ucSlot;
+    NvSlot_t xSlot;
+    Status_t xRet;
+
+    taskENTER_CRITICAL();
+    xSlot.ulVal = px->ulVal;
+    px->bDirty  = FALSE;
+    taskEXIT_CRITICAL();
+
+    xSlot.ucSeq = px->ucSeq + 1;
+    xSlot.ucCrc = prvCrc(xId, &xSlot);
+    ucSlot      = (px->ucSlot + 1) % SLOT_NUM;
+    xRet        = prvDevWrite(REC_OFF(xId) + ucSlot * sizeof(NvSlot_t), sizeof(xSlot), (uint8_t *)&xSlot);
+    if (STATUS_OK == xRet) {
+        px->ucSeq  = xSlot.ucSeq;
+        px->ucSlot = ucSlot;
+        px->usAge  = 0;
+        s_ulWriteCnt++;
+    }
+    else {
+        /* Tried again on the next round */
+        px->bDirty = TRUE;
+        s_ulErrCnt++;
+    }
+
+    ulCyc         = TimeCycToUs(TimeCycGet() - ulCyc);
+    s_ulWriteLast = ulCyc;
+    if (ulCyc > s_ulWriteMax) {
+        s_ulWriteMax = ulCyc;
+    }
+    return xRet;
+}
+
+static uint8_t prvCrc(NvId_t xId, const NvSlot_t *pxSlot)
+{
+    uint8_t ucId = (uint8_t)xId;
+    uint8_t ucCrc;
+
+    /* The id is in, a slot read at the wrong offset fails */
+    ucCrc = Crc8Maxim(CRC8_MAXIM_INIT, &ucId, 1);
+    return Crc8Maxim(ucCrc, (const uint8_t *)pxSlot, offsetof(NvSlot_t, ucCrc));
+}
+
+static Status_t prvDevRead(uint32_t ulOff, uint32_t ulLength, OUT uint8_t *pucData)
+{
+#if NV_FRAM
+    return MemRead(s_xFram, NV_FRAM_ADDR + ulOff, ulLength, pucData);
+#else
+    return RtcDs1338ReadRam((uint8_t)ulOff, pucData, (uint8_t)ulLength);
+#endif /* NV_FRAM */
+}
+
+static Status_t prvDevWrite(uint32_t ulOff, uint32_t ulLength, IN uint8_t *pucData)
+{
+#if NV_FRAM
+    return MemWrite(s_xFram, NV_FRAM_ADDR + ulOff, ulLength, pucData);
+#else
+    return RtcDs1338WriteRam((uint8_t)ulOff, pucData, (uint8_t)ulLength);
+#endif /* NV_FRAM */
+}
+
+static void prvCliCmdNv(cli_printf cliprintf, int argc, char** argv)
+{
+    CHECK_CLI();
+
+    if (!s_bInit) {
+        cliprintf("nv not initialized\n");
+        return;
+    }
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "flush"))) {
+        if (STATUS_OK != NvFlush()) {
+            cliprintf("nv not loaded\n");
+        }
+        return;
+    }
+
+    /* nv set ID VAL */
+    if ((argc >= 2) && (0 == strcmp(argv[1], "set"))) {
+        if ((argc < 4) || (STATUS_OK != NvSet((NvId_t)atoi(argv[2]), strtoul(argv[3], NULL, 0)))) {
+            cliprintf("nv set ID(0 - %d) VAL\n", NV_NUM - 1);
+        }
+        return;
+    }
+
+    if (argc >= 2) {
+        cliprintf("nv [flush | set ID VAL]\n");
+        return;
+    }
+
+    for (uint8_t n = 0; n < NV_NUM; n++) {
+        if (s_xVar[n].bReg) {
+            cliprintf("%d %-10s : %lu%s (%d s)\n", n, s_xVar[n].pcName, (unsigned long)s_xVar[n].ulVal,
+                      s_xVar[n].bDirty ? " *" : "", s_xVar[n].usPeriod);
+        }
+    }
+    cliprintf("STORE       : %s, %lu bytes%s\n", NV_FRAM ? "fram" : "ds1338 ram", (unsigned long)STORE_SIZE,
+              s_bLoaded ? "" : ", not loaded");
+    cliprintf("WRITES      : %lu\n", (unsigned long)s_ulWriteCnt);
+    cliprintf("ERRORS      : %lu\n", (unsigned long)s_ulErrCnt);
+    cliprintf("WRITE LAST  : %lu us\n", (unsigned long)s_ulWriteLast);
+    cliprintf("WRITE MAX   : %lu us\n", (unsigned long)s_ulWriteMax);
+    cliprintf("LOAD        : %lu us, %lu lost\n", (unsigned long)s_ulLoadTime, (unsigned long)s_ulLostCnt);
+}
+CLI_CMD_EXPORT(nv, persistent counters, prvCliCmdNv)
@@ -0,0 +1,76 @@
+/*
+    Nv.h
+
+    Head File for App Persistent Counter Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+    01b, 19Oct26, agent NvFlush cost noted
+*/
+
+#ifndef __NV_H__
+#define __NV_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include "Include/Include.h"
+
+/* Defines */
+#ifndef NV_FRAM
+#define NV_FRAM             (0)             /* 1: FRAM on NV_FRAM_SPI, 0: DS1338 battery backed RAM */
+#endif /* NV_FRAM */
+#ifndef NV_FRAM_SPI
+#define NV_FRAM_SPI         SPI1
+#endif /* NV_FRAM_SPI */
+#define NV_FRAM_ADDR        0               /* Records in the FRAM */
+#define NV_PRD              1000            /* ms, the counter periods are multiples of it */
+#define NV_MAGIC            0x3156564E      /* "NVV1", the layout below */
+
+/* Types */
+typedef enum {
+    NV_RUN_TIME,            /* s powered */
+    NV_LASER_TIME,          /* s with WORK_LASER */
+    NV_TRIP_CNT,            /* Alarms raised */
+    NV_ENERGY,              /* Wh, main supply voltage by the channel currents */
+    NV_NUM
+}NvId_t;
+
+/*
+    The store holds NV_MAGIC, then two slots per counter. A write goes to the slot
+    not holding the newest value, so a write cut short leaves the other intact and
+    fails the CRC. The newest valid slot is the one with the larger sequence.
+*/
+#pragma pack(push)
+#pragma pack(1)
+typedef struct {
+    uint32_t ulVal;
+    uint8_t  ucSeq;
+    uint8_t  ucCrc;         /* CRC-8/MAXIM of the id, ulVal and ucSeq */
+}NvSlot_t;
+#pragma pack(pop)
+
+/* Functions */
+Status_t AppNvInit(void);
+/* usPeriod in seconds between writes of a changed value, 0 writes on every change */
+Status_t NvReg(NvId_t xId, const char *pcName, uint16_t usPeriod);
+/* From any task, the write is made by tNv */
+Status_t NvAdd(NvId_t xId, uint32_t ulDelta);
+Status_t NvSet(NvId_t xId, uint32_t ulVal);
+uint32_t NvGet(NvId_t xId);
+/* Writes the changed counters now, a slot each, about 200 ms on the ds1338. Call before a reset,
+   after the reply */
+Status_t NvFlush(void);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __NV_H__ */
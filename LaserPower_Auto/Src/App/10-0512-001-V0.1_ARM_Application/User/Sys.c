@@ -25,6 +25,14 @@
     01n, 26Jan24, Karl Added th_SwInfo
     01o, 29Jan24, Karl Added dynamic current adjustment
     01p, 30Jan24, Karl Optimized prvChkMPwr function
+    01q, 19Oct26, Karl Used cached Stc group aggregates
+    01r, 19Oct26, Karl Checked Stc node pushed alarms in prvChkAPwr
+    01s, 19Oct26, Karl Added sys_loop_stat
+    01t, 19Oct26, Karl Added CFG_PENDING status
+    01u, 19Oct26, Karl State and status changes sent to the event log
+    01v, 19Oct26, Karl Alarms raised counted in NV_TRIP_CNT
+    01w, 19Oct26, agent CLI prints the loop times with %lu
+    01x, 19Oct26, agent Added task_stat, stack high-water marks and free heap
 */
 
 /* Includes */
@@ -84,6 +92,7 @@
 #define WATER_CHILLER_ON      0
 #define WATER_CHILLER_OFF     1
 #define BEEP_DELAY            70
+#define TASK_STAT_MAX         24
 
 /* Forward declaration */
 static void prvSysTask        (void *pvPara);
@@ -115,6 +124,7 @@ static bool prvChkAPwr        (void);
 static void prvEnterFsm       (void);
 static void prvProcManualCtrl (void);
 static void prvProcPanelLed   (void);
+static void prvEvtChk         (const State_t *pxState);
 
 /* Global variables */
 State_t    *g_pxState         = NULL;
@@ -136,6 +146,10 @@ static uint8_t  s_ucAPwrCtrl3   = APWR_OFF;
 static uint8_t  aim_mutex_onoff = 1;
 static uint8_t  laser_on_pd_err = 1;
 static uint8_t  manual_ctrl_err = 1;
+static uint32_t s_ulProcLast    = 0; /* prvProc run time (us) */
+static uint32_t s_ulProcMax     = 0;
+static uint32_t s_ulLoopMax     = 0; /* tSys loop period (us) */
+static uint32_t s_ulLoopOverCnt = 0; /* Loops longer than SYS_TASK_DELAY + 1 tick */
 
 /* Functions */
 Status_t AppSysInit(void)
@@ -588,11 +602,29 @@ static void prvSysTask(void *pvPara)
         }
     }
 
+    uint32_t ulLoopCyc = TimeCycGet();
     while (1) {
+        uint32_t ulCyc = TimeCycGet();
         if (s_bProc) {
             prvProc();
         }
         WdogFeed();
+
+        /* Worst case loop time, see sys_loop_stat */
+        uint32_t ulProc = TimeCycToUs(TimeCycGet() - ulCyc);
+        uint32_t ulLoop = TimeCycToUs(ulCyc - ulLoopCyc);
+        ulLoopCyc       = ulCyc;
+        s_ulProcLast    = ulProc;
+        if (ulProc > s_ulProcMax) {
+            s_ulProcMax = ulProc;
+        }
+        if (ulLoop > s_ulLoopMax) {
+            s_ulLoopMax = ulLoop;
+        }
+        if (ulLoop > (SYS_TASK_DELAY + 1) * 1000) {
+            s_ulLoopOverCnt++;
+        }
+
         osDelay(SYS_TASK_DELAY);
     }
 }
@@ -681,6 +713,9 @@ static void prvProc(void)
 
     pxState->ulCounter++;
 
+    /* Black box, changes only */
+    prvEvtChk(pxState);
+
     return;
 }
 
@@ -1113,7 +1148,7 @@ static bool prvChkAPwr(void)
     }
 
     /* 温度组1检测 */
-    int16_t sTemp1 = StcGetTempHFrom(0, th_TempNum - 1);
+    int16_t sTemp1 = StcGetTempHGrp(STC_GRP_TEMP1);
     if (th_ModEn.TEMP1) {
         if (sTemp1 <= th_OtCutTh) {
             /* 切断温度 */
@@ -1127,7 +1162,7 @@ static bool prvChkAPwr(void)
     }
 
     /* 温度组2检测 */
-    int16_t sTemp2 = StcGetTempHFrom(th_TempNum, 12 - 1);
+    int16_t sTemp2 = StcGetTempHGrp(STC_GRP_TEMP2);
     if (th_ModEn.TEMP2) {
         if (sTemp2 <= th_OtCutTh) {
             /* 切断温度 */
@@ -1147,6 +1182,13 @@ static bool prvChkAPwr(void)
         return false;
     }
     
+    /* Alarms pushed by the Stc nodes ahead of the next poll */
+    uint8_t ucStcAlarm = StcGetAlarm();
+    if (ucStcAlarm) {
+        TRACE("[%6d]     STC node alarm 0x%02X\n", SYS_TICK_GET(), ucStcAlarm);
+        return false;
+    }
+
     /* PD开激光不出光检测 */
     int16_t pdLight = StcGetPdLight();
     State_t *pxState = &s_xState;
@@ -1230,6 +1272,31 @@ static void prvEnterFsm(void)
     }
 }
 
+static void prvEvtChk(const State_t *pxState)
+{
+    static Fsm_t    s_xLastState   = FSM_START;
+    static uint16_t s_usLastStatus = 0;
+    SysStatus_t     xStatus;
+
+    if (pxState->xState != s_xLastState) {
+        EvtLog(EVT_FSM, s_xLastState, pxState->xState, 0, 0);
+        s_xLastState = pxState->xState;
+    }
+
+    /* CFG_PENDING follows every setting, not worth a record */
+    xStatus.all = th_SysStatusAll;
+    xStatus.bit.CFG_PENDING = 0;
+    if (xStatus.all != s_usLastStatus) {
+        EvtLog(EVT_STATUS, s_usLastStatus, xStatus.all, 0, 0);
+        /* Each alarm raised is a trip */
+        SysStatus_t xRise;
+        xRise.all = xStatus.all & ~s_usLastStatus;
+        NvAdd(NV_TRIP_CNT, xRise.bit.ALARM_EMCY_STOP + xRise.bit.ALARM_WATER_CHILLER + xRise.bit.ALARM_WATER_PRESS +
+                           xRise.bit.ALARM_QBH + xRise.bit.ALARM_OT + xRise.bit.ALARM_PD + xRise.bit.ALARM_WET);
+        s_usLastStatus = xStatus.all;
+    }
+}
+
 static void prvProcManualCtrl(void)
 {
     static uint8_t on  = 0;
@@ -1278,8 +1345,8 @@ static void prvProcPanelLed(void)
     uint8_t  s_QBH_ON         = GpioGetInput(QBH_ON);
     uint8_t  s_WATER_PRESS    = GpioGetInput(WATER_PRESS);
     uint8_t  s_WATER_CHILLER  = GpioGetInput(WATER_CHILLER);
-    int16_t  s_MAX_TEMP1      = StcGetTempHFrom(0, th_TempNum - 1);
-    int16_t  s_MAX_TEMP2      = StcGetTempHFrom(th_TempNum, 10 - 1);
+    int16_t  s_MAX_TEMP1      = StcGetTempHGrp(STC_GRP_TEMP1);
+    int16_t  s_MAX_TEMP2      = StcGetTempHGrp(STC_GRP_TEMP2);
     int32_t  s_PWR_OUTPUT_VOL = PwrDataGet(PWR2_M1_ADDR, PWR_OUTPUT_VOL);
     int32_t  s_PWR_INPUT_VOL  = PwrDataGet(PWR2_M1_ADDR, PWR_INPUT_VOL);
     uint16_t s_PD             = StcGetPdHFrom();
@@ -1609,6 +1676,8 @@ static void prvProcPanelLed(void)
         th_SysStatus.ALARM_PD = 0;
         th_SysStatus.WARN_PD  = 0;
     }
+    /* Config changes not in flash yet */
+    th_SysStatus.CFG_PENDING = DataPending() ? 1 : 0;
 }
 
 static void prvCliCmdSysFsm(cli_printf cliprintf, int argc, char **argv)
@@ -1659,6 +1728,51 @@ static void prvCliCmdShowSysStatus(cli_printf cliprintf, int argc, char **argv)
 }
 CLI_CMD_EXPORT(show_sys_status, show system status, prvCliCmdShowSysStatus)
 
+static void prvCliCmdSysLoopStat(cli_printf cliprintf, int argc, char **argv)
+{
+    CHECK_CLI();
+
+    if ((argc >= 2) && (0 == strcmp(argv[1], "clear"))) {
+        taskENTER_CRITICAL();
+        s_ulProcMax     = 0;
+        s_ulLoopMax     = 0;
+        s_ulLoopOverCnt = 0;
+        taskEXIT_CRITICAL();
+        cliprintf("sys loop statistics cleared\n");
+        return;
+    }
+
+    cliprintf("PROC LAST     : %lu us\n", (unsigned long)s_ulProcLast);
+    cliprintf("PROC MAX      : %lu us\n", (unsigned long)s_ulProcMax);
+    cliprintf("LOOP MAX      : %lu us\n", (unsigned long)s_ulLoopMax);
+    cliprintf("LOOP OVER CNT : %lu\n", (unsigned long)s_ulLoopOverCnt);
+}
+CLI_CMD_EXPORT(sys_loop_stat, show tSys loop time, prvCliCmdSysLoopStat)
+
+static void prvCliCmdTaskStat(cli_printf cliprintf, int argc, char **argv)
+{
+    /* Too big for the CLI task stack */
+    static TaskStatus_t s_xStatus[TASK_STAT_MAX];
+    UBaseType_t         uxNum;
+
+    CHECK_CLI();
+
+    uxNum = uxTaskGetSystemState(s_xStatus, TASK_STAT_MAX, NULL);
+    if (uxNum == 0) {
+        cliprintf("more than %d tasks\n", TASK_STAT_MAX);
+        return;
+    }
+
+    cliprintf("TASK             PRIO  FREE STACK (words)\n");
+    for (UBaseType_t n = 0; n < uxNum; n++) {
+        cliprintf("%-16s %4lu  %lu\n", s_xStatus[n].pcTaskName, (unsigned long)s_xStatus[n].uxCurrentPriority,
+                  (unsigned long)s_xStatus[n].usStackHighWaterMark);
+    }
+    cliprintf("HEAP FREE     : %lu\n", (unsigned long)xPortGetFreeHeapSize());
+    cliprintf("HEAP MIN FREE : %lu\n", (unsigned long)xPortGetMinimumEverFreeHeapSize());
+}
+CLI_CMD_EXPORT(task_stat, show task stack high-water marks and free heap, prvCliCmdTaskStat)
+
 static void prvCliCmdFsmTest(cli_printf cliprintf, int argc, char **argv)
 {
     CHECK_CLI();
@@ -25,6 +25,7 @@
     01n, 26Jan24, Karl Added th_SwInfo
     01o, 29Jan24, Karl Added dynamic current adjustment
     01p, 30Jan24, Karl Optimized prvChkMPwr function
+    01q, 19Oct26, Karl Added CFG_PENDING in SysStatus_t
 */
 
 #ifndef __SYS_H__
@@ -98,6 +99,7 @@ typedef union {
         uint16_t WORK_INFRARED:1;       /* 指示光工作 */
         uint16_t WORK_LASER:1;          /* 激光工作 */
         uint16_t RUN:1;                 /* 程序执行 */
+        uint16_t CFG_PENDING:1;         /* 配置待保存 */
     }bit;
 }SysStatus_t;
 
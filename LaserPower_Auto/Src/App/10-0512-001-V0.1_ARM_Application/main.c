@@ -10,6 +10,9 @@
     modification history
     --------------------
     01a, 13Nov23, Karl Created
+    01b, 19Oct26, Karl Added AppEvtLogInit
+    01c, 19Oct26, Karl Added AppHistInit
+    01d, 19Oct26, Karl Added AppNvInit
 */
 
 /* PID : PD24D06-B */
@@ -59,6 +62,9 @@ int main(void) {
     Aht30Init();
     AppCliInit();
     AppDataInit();
+    AppEvtLogInit();
+    AppHistInit();
+    AppNvInit();
     
     AppComInit();
     AppSysInit();
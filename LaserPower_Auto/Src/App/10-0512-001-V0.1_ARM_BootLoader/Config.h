@@ -30,6 +30,15 @@ extern "C" {
 #define CLI_TEST                    (0)
 #define CLI_ASSERT                  (0)
 
+/* Crc module */
+#define CRC_ENABLE                  (1)
+#define CRC_ENABLE_HW               (1)
+#define CRC_NIBBLE_TABLE            (0)
+#define CRC_RTOS                    (0)
+#define CRC_DEBUG                   (0)
+#define CRC_TEST                    (0)
+#define CRC_ASSERT                  (0)
+
 /* Debug module */
 #define DEBUG_ENABLE                (1)
 #define DEBUG_ENABLE_UART           (0)
@@ -142,6 +151,7 @@ extern "C" {
 #define BOOT_UART_FLASH_PAGE_SIZE   (0x800)
 #define BOOT_UART_APP_ADDR          (0x08010000)
 #define BOOT_UART_APP_SIZE          (0x30000)
+#define BOOT_UART_STREAM            (1)
 
 /* XXX: Just for compatibility */
 #define TickInit()
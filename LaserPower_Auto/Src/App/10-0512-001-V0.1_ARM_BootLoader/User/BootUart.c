@@ -11,11 +11,16 @@
     --------------------
     01a, 06Apr22, Karl Created
     01b, 10Apr22, Karl Added image verification utility
+    01c, 19Oct26, Karl CRC16 from the Crc module
+    01d, 19Oct26, Karl Pages erased as the image reaches them
+    01e, 19Oct26, Karl Added streaming transfer mode
+    01f, 19Oct26, agent Packets received into unsigned char, as they are parsed
 */
 
 /* Includes */
 #include <string.h>
 #include "BootUart.h"
+#include "Crc/Crc.h"
 
 #if BOOT_UART_ENABLE
 
@@ -67,23 +72,68 @@
 /* Number of consecutive receive errors before giving up: */
 #define MAX_ERRORS              (5)
 
+/*
+    Streaming transfer, offered next to YMODEM. On the 'C' of the receiver the host
+    may send a request instead of the header packet:
+        SYN, baud, image size, image CRC (u32 little endian each), CRC16 (big endian)
+    The CRC is CRC-32/MPEG-2 of the image as little endian words, padded with 0xFF,
+    as the STM32 CRC unit computes it. The receiver answers NAK to stay on YMODEM or
+    ACK, then both switch to the baud. The host sends blocks of
+        STX, block number (u16 little endian), 1024 bytes, CRC16 (big endian)
+    the last one padded with 0xFF, and may run BOOT_UART_STREAM_WINDOW blocks ahead
+    of the replies, ACK or NAK followed by the block expected next (u16 little
+    endian). A NAK comes after a bad or missing block once the line is idle, the
+    host goes back to that block. After the last block the flash is read back and
+    a single ACK or CAN tells whether the image CRC matched.
+    Reception is DMA into a ring of a block more than the window, so the next
+    blocks arrive while the CPU is stalled on a flash erase or program.
+*/
+#if BOOT_UART_STREAM && !CRC_ENABLE_HW
+#error "BOOT_UART_STREAM needs CRC_ENABLE_HW"
+#endif
+#define SYN                     (0x16)  /* streaming request */
+#define STREAM_REQ              (-2)    /* receive_packet length of a request */
+#define STREAM_REQ_SIZE         (1 + 12 + PACKET_TRAILER)
+#define STREAM_BLOCK            (1024)
+#define STREAM_FRAME            (PACKET_HEADER + STREAM_BLOCK + PACKET_TRAILER)
+#define STREAM_RING             ((BOOT_UART_STREAM_WINDOW + 1) * STREAM_FRAME)
+#define STREAM_BAUD_MIN         (115200)
+#define STREAM_TIMEOUT          (1000)  /* ms for a block */
+#define STREAM_IDLE             (20)    /* ms of silence before a NAK */
+
 /* Forward declarations */
 static void prvBootUartDone(void);
 static uint8_t prvFlashAddrToSector(uint32_t ulAddr);
 static void prvFlashEraseSector(uint32_t page);
-static int receive_packet(char *data, int *length);
+static void prvFlashProgram(uint32_t ulOffset, const uint8_t *pucData, uint32_t ulLength);
+static int receive_packet(unsigned char *data, int *length);
 static unsigned long ymodem_receive(void);
 static void put_char(int c);
 static int get_char(int timeout);
 static void sleep(int delay/*s*/);
 static unsigned short crc16(const unsigned char *buf, unsigned long count);
 static unsigned long str_to_u32(char* str);
+#if BOOT_UART_STREAM
+static int stream_receive(const unsigned char *req);
+static void stream_start(void);
+static unsigned long stream_count(void);
+static int stream_get(unsigned char *data, unsigned long length, unsigned long timeout/*ms*/);
+static void stream_drain(void);
+static void stream_reply(int c, unsigned long block);
+static unsigned long get_u32(const unsigned char *buf);
+#endif /* BOOT_UART_STREAM */
 
 /* Local variables */
 static UART_HandleTypeDef s_hUart;
 static BootUartDone_t     s_pxDone = NULL;
 static uint8_t            s_ucSectorErased[SECTOR_COUNT];
 static uint32_t           s_ulErrorCnt = 0;
+#if BOOT_UART_STREAM
+static DMA_HandleTypeDef  s_hDmaRx;
+static uint8_t            s_ucRing[STREAM_RING];
+static uint32_t           s_ulRingRd = 0;
+static uint8_t            s_ucBlock[STREAM_FRAME];
+#endif /* BOOT_UART_STREAM */
 
 /* Functions */
 Status_t BootUartInit(void)
@@ -168,13 +218,8 @@ Status_t BootUartConfig(const BootUartConfig_t *pxConfig)
         s_pxDone = prvBootUartDone;
     }
     
-    /* Flash erase sectors */
+    /* Flash pages are erased by ymodem_receive, before the first packet into each */
     memset(s_ucSectorErased, 0, sizeof(s_ucSectorErased));
-    HAL_FLASH_Unlock();
-    for (uint32_t address = BOOT_UART_APP_ADDR; address < (BOOT_UART_APP_ADDR + BOOT_UART_APP_SIZE); address += BOOT_UART_FLASH_PAGE_SIZE) {
-        prvFlashEraseSector(address);
-    }
-    HAL_FLASH_Lock();
     
     return STATUS_OK;
 }
@@ -216,8 +261,25 @@ static void prvFlashEraseSector(uint32_t page)
     }
 }
 
+/* Erase the pages not erased yet, only the image size costs erase time */
+static void prvFlashProgram(uint32_t ulOffset, const uint8_t *pucData, uint32_t ulLength)
+{
+    for (uint32_t address = (BOOT_UART_APP_ADDR + ulOffset) & ~(BOOT_UART_FLASH_PAGE_SIZE - 1);
+         address < (BOOT_UART_APP_ADDR + ulOffset + ulLength); address += BOOT_UART_FLASH_PAGE_SIZE) {
+        prvFlashEraseSector(address);
+    }
+    HAL_FLASH_Unlock();
+    for (size_t i = 0; i < ulLength; i += 4) {
+        HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)(BOOT_UART_APP_ADDR + ulOffset + i), *(uint32_t*)(pucData + i));
+    }
+    HAL_FLASH_Lock();
+    if (0 != memcmp((void*)(BOOT_UART_APP_ADDR + ulOffset), pucData, ulLength)) {
+        s_ulErrorCnt++;
+    }
+}
+
 /* Returns 0 on success, 1 on corrupt packet, -1 on error (timeout): */
-static int receive_packet(char *data, int *length)
+static int receive_packet(unsigned char *data, int *length)
 {
     int i, c;
     unsigned int packet_size;
@@ -238,6 +300,21 @@ static int receive_packet(char *data, int *length)
         break;
     case EOT:
         return 0;
+#if BOOT_UART_STREAM
+    case SYN:
+        for (i = 1; i < STREAM_REQ_SIZE; ++i) {
+            c = get_char(PACKET_TIMEOUT);
+            if (c < 0) {
+                return -1;
+            }
+            data[i] = (unsigned char)c;
+        }
+        if (crc16(data + 1, STREAM_REQ_SIZE - 1) != 0) {
+            return 1;
+        }
+        *length = STREAM_REQ;
+        return 0;
+#endif /* BOOT_UART_STREAM */
     case CAN:
         c = get_char(PACKET_TIMEOUT);
         if (c == CAN) {
@@ -255,14 +332,14 @@ static int receive_packet(char *data, int *length)
         return 0;
     }
 
-    *data = (char)c;
+    *data = (unsigned char)c;
 
     for(i = 1; i < (packet_size + PACKET_OVERHEAD); ++i) {
         c = get_char(PACKET_TIMEOUT);
         if (c < 0) {
             return -1;
         }
-        data[i] = (char)c;
+        data[i] = (unsigned char)c;
     }
 
     /* Just a sanity check on the sequence number/complement value.
@@ -319,6 +396,16 @@ static unsigned long ymodem_receive(void)
                             s_pxDone();
                         }
                         break;
+                #if BOOT_UART_STREAM
+                    case STREAM_REQ:
+                        /* In place of the header packet only */
+                        if ((packets_received != 0) || (stream_receive(packet_data) >= 0)) {
+                            TRACE("\nstream done or failed.\n");
+                            return 0;
+                        }
+                        put_char(CRC);
+                        break;
+                #endif /* BOOT_UART_STREAM */
                     default:  /* normal packet */
                     if ((packet_data[PACKET_SEQNO_INDEX] & 0xff) != (packets_received & 0xff)) {
                         put_char(NAK);
@@ -336,7 +423,7 @@ static unsigned long ymodem_receive(void)
                                 }
                             }
                             if (i < PACKET_HEADER + 4) {  /* filename packet has data */
-                                for (file_ptr = packet_data + PACKET_HEADER, i = 0; *file_ptr && i < FILE_NAME_LENGTH; ) {
+                                for (file_ptr = (char *)packet_data + PACKET_HEADER, i = 0; *file_ptr && i < FILE_NAME_LENGTH; ) {
                                     file_name[i++] = *file_ptr++;
                                 }
                                 file_name[i++] = '\0';
@@ -356,23 +443,19 @@ static unsigned long ymodem_receive(void)
                                 break;
                             }
                         }
+                        else if ((offset + packet_length) > BOOT_UART_APP_SIZE) {
+                            /* Larger than the region, taken in but not written and never booted */
+                            s_ulErrorCnt++;
+                            offset += packet_length;
+                            put_char(ACK);
+                        }
                         else {
-                            /* get the data and write to the storage */
-                            HAL_FLASH_Unlock();
-                        #if 0
-                            for (size_t i = 0; i < packet_length; i++) {
-                                HAL_FLASH_Program(FLASH_TYPEPROGRAM_BYTE, (uint32_t)(BOOT_UART_APP_ADDR + offset + i), *(uint8_t*)(packet_data + PACKET_HEADER + i));
-                            }
-                        #else
+                            /* get the data and write to the storage. The CPU stalls on the
+                             * flash while a page erases, so this is done before the ACK,
+                             * when the sender is waiting and no byte can be lost.
+                             */
                             packet_length += (packet_length % 4) ? (4 - (packet_length % 4)) : 0;
-                            for (size_t i = 0; i < packet_length; i += 4) {
-                                HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, (uint32_t)(BOOT_UART_APP_ADDR + offset + i), *(uint32_t*)(packet_data + PACKET_HEADER + i));
-                            }
-                        #endif
-                            HAL_FLASH_Lock();
-                            if (0 != memcmp((void*)(BOOT_UART_APP_ADDR + offset), (packet_data + PACKET_HEADER), packet_length)) {
-                                s_ulErrorCnt++;
-                            }
+                            prvFlashProgram(offset, packet_data + PACKET_HEADER, packet_length);
                             offset += packet_length;
                             put_char(ACK);
                         }
@@ -450,23 +533,140 @@ static void sleep(int delay/*s*/)
 
 static unsigned short crc16(const unsigned char *buf, unsigned long count)
 {
-    unsigned short crc = 0;
-    int i;
-
-    while(count--) {
-        crc = crc ^ *buf++ << 8;
+    /* CRC-16/XMODEM */
+    return Crc16Ccitt(CRC16_XMODEM_INIT, buf, count);
+}
 
-        for (i=0; i<8; i++) {
-            if (crc & 0x8000) {
-                crc = crc << 1 ^ 0x1021;
-            }
-            else {
-                crc = crc << 1;
+#if BOOT_UART_STREAM
+/* Returns -1 if refused, YMODEM goes on, else 0 once done or failed */
+static int stream_receive(const unsigned char *req)
+{
+    unsigned long baud   = get_u32(req + 1);
+    unsigned long size   = get_u32(req + 5);
+    unsigned long crc    = get_u32(req + 9);
+    unsigned long blocks = (size + STREAM_BLOCK - 1) / STREAM_BLOCK;
+    unsigned long next   = 0;
+    unsigned int  errors = 0;
+
+    if ((baud < STREAM_BAUD_MIN) || (baud > BOOT_UART_STREAM_BAUD_MAX) || (size == 0) ||
+        (blocks * STREAM_BLOCK > BOOT_UART_APP_SIZE)) {
+        put_char(NAK);
+        return -1;
+    }
+    /* HAL_UART_Transmit returns after the stop bit, the host switches on the ACK */
+    put_char(ACK);
+    s_hUart.Init.BaudRate = baud;
+    HAL_UART_Init(&s_hUart);
+    stream_start();
+    TRACE("stream %d bytes at %d\n", size, baud);
+
+    while (next < blocks) {
+        if ((stream_get(s_ucBlock, STREAM_FRAME, STREAM_TIMEOUT) == 0) && (s_ucBlock[0] == STX) &&
+            ((s_ucBlock[1] | (s_ucBlock[2] << 8)) == (next & 0xFFFF)) &&
+            (crc16(s_ucBlock + 1, STREAM_FRAME - 1) == 0)) {
+            /* Replied first, the next blocks come in while this one is programmed */
+            stream_reply(ACK, next + 1);
+            prvFlashProgram(next * STREAM_BLOCK, s_ucBlock + PACKET_HEADER, STREAM_BLOCK);
+            next++;
+            errors = 0;
+        }
+        else {
+            if (++errors >= MAX_ERRORS) {
+                put_char(CAN);
+                put_char(CAN);
+                TRACE("\ntoo many errors - aborted.\n");
+                return 0;
             }
+            /* Blocks in flight are dropped, the host goes back to next */
+            stream_drain();
+            stream_reply(NAK, next);
         }
     }
-    return crc;
+
+    /* Whole image, read back from the flash */
+    if ((0 != s_ulErrorCnt) || (Crc32Hw((const uint32_t *)BOOT_UART_APP_ADDR, (size + 3) / 4) != crc)) {
+        s_ulErrorCnt++;
+        put_char(CAN);
+        TRACE("\nimage crc error - aborted.\n");
+        return 0;
+    }
+    put_char(ACK);
+    if (s_pxDone) {
+        s_pxDone();
+    }
+    return 0;
+}
+
+static void stream_start(void)
+{
+    __HAL_RCC_DMA1_CLK_ENABLE();
+    s_hDmaRx.Instance                 = BOOT_UART_STREAM_DMA_CHAN;
+    s_hDmaRx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    s_hDmaRx.Init.PeriphInc           = DMA_PINC_DISABLE;
+    s_hDmaRx.Init.MemInc              = DMA_MINC_ENABLE;
+    s_hDmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    s_hDmaRx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    s_hDmaRx.Init.Mode                = DMA_CIRCULAR;
+    s_hDmaRx.Init.Priority            = DMA_PRIORITY_HIGH;
+    HAL_DMA_Init(&s_hDmaRx);
+    __HAL_LINKDMA(&s_hUart, hdmarx, s_hDmaRx);
+
+    /* Polled, the DMA and UART interrupts are left off in the NVIC */
+    s_ulRingRd = 0;
+    HAL_UART_Receive_DMA(&s_hUart, s_ucRing, STREAM_RING);
+}
+
+static unsigned long stream_count(void)
+{
+    unsigned long wr = STREAM_RING - __HAL_DMA_GET_COUNTER(&s_hDmaRx);
+    return (wr + STREAM_RING - s_ulRingRd) % STREAM_RING;
+}
+
+/* Returns 0 on success, -1 on timeout with the bytes left in the ring */
+static int stream_get(unsigned char *data, unsigned long length, unsigned long timeout/*ms*/)
+{
+    uint32_t tick = HAL_GetTick();
+
+    while (stream_count() < length) {
+        if ((HAL_GetTick() - tick) >= timeout) {
+            return -1;
+        }
+    }
+    for (unsigned long i = 0; i < length; i++) {
+        data[i]    = s_ucRing[s_ulRingRd];
+        s_ulRingRd = (s_ulRingRd + 1) % STREAM_RING;
+    }
+    return 0;
+}
+
+/* Drops what is in the ring once the line has been idle for STREAM_IDLE */
+static void stream_drain(void)
+{
+    uint32_t tick = HAL_GetTick();
+    unsigned long last = STREAM_RING - __HAL_DMA_GET_COUNTER(&s_hDmaRx);
+
+    while ((HAL_GetTick() - tick) < STREAM_IDLE) {
+        unsigned long wr = STREAM_RING - __HAL_DMA_GET_COUNTER(&s_hDmaRx);
+        if (wr != last) {
+            last = wr;
+            tick = HAL_GetTick();
+        }
+    }
+    s_ulRingRd = last % STREAM_RING;
+}
+
+static void stream_reply(int c, unsigned long block)
+{
+    put_char(c);
+    put_char(block & 0xff);
+    put_char((block >> 8) & 0xff);
+}
+
+static unsigned long get_u32(const unsigned char *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((unsigned long)buf[3] << 24);
 }
+#endif /* BOOT_UART_STREAM */
 
 static unsigned long str_to_u32(char* str)
 {
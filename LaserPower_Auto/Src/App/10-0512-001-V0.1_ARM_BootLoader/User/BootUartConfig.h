@@ -10,6 +10,7 @@
     modification history
     --------------------
     01a, 06Apr22, Karl Created
+    01b, 19Oct26, Karl Added BOOT_UART_STREAM
 */
 
 #ifndef __BOOT_UART_CONFIG_H__
@@ -35,6 +36,18 @@ extern "C" {
 #ifndef BOOT_UART_APP_SIZE
 #define BOOT_UART_APP_SIZE           (0xFFFFFFFF)
 #endif
+#ifndef BOOT_UART_STREAM
+#define BOOT_UART_STREAM             (0)     /* Streaming transfer offered next to YMODEM, needs CRC_ENABLE_HW */
+#endif
+#ifndef BOOT_UART_STREAM_BAUD_MAX
+#define BOOT_UART_STREAM_BAUD_MAX    (921600)
+#endif
+#ifndef BOOT_UART_STREAM_WINDOW
+#define BOOT_UART_STREAM_WINDOW      (2)     /* Blocks the host may send ahead of the ACK */
+#endif
+#ifndef BOOT_UART_STREAM_DMA_CHAN
+#define BOOT_UART_STREAM_DMA_CHAN    DMA1_Channel5   /* USART1 RX */
+#endif
 #ifndef BOOT_UART_RTOS
 #define BOOT_UART_RTOS               (0)
 #endif
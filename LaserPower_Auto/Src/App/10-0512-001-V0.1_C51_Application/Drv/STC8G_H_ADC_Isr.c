@@ -0,0 +1,29 @@
+/*---------------------------------------------------------------------*/
+/* --- STC MCU Limited ------------------------------------------------*/
+/* --- STC 1T Series MCU Demo Programme -------------------------------*/
+/* --- Mobile: (86)13922805190 ----------------------------------------*/
+/* --- Fax: 86-0513-55012956,55012947,55012969 ------------------------*/
+/* --- Tel: 86-0513-55012928,55012929,55012966 ------------------------*/
+/* --- Web: www.STCAI.com ---------------------------------------------*/
+/* --- BBS: www.STCAIMCU.com  -----------------------------------------*/
+/* --- QQ:  800003751 -------------------------------------------------*/
+/* Ҫڳʹô˴,ڳעʹSTCϼ            */
+/*---------------------------------------------------------------------*/
+
+#include	"STC8G_H_ADC.h"
+
+//========================================================================
+// : ADC_ISR_Handler
+// : ADCжϺ.
+// : none.
+// : none.
+// 汾: V1.0, 2020-09-23
+//========================================================================
+void AdcIsrProc(void);
+void ADC_ISR_Handler (void) interrupt ADC_VECTOR
+{
+	ADC_CONTR &= ~ADC_FLAG;
+	// TODO: ڴ˴û
+    // XXX: Added by Karl
+    AdcIsrProc();
+}
@@ -57,16 +57,18 @@ void UART1_ISR_Handler (void) interrupt UART1_VECTOR
 // 汾: V1.0, 2020-09-23
 //========================================================================
 #ifdef UART2
+// XXX: Added by Karl
+void UartRxIsrProc(u8 dat);
+void UartTxIsrProc(void);
+
 void UART2_ISR_Handler (void) interrupt UART2_VECTOR
 {
 	if(RI2)
 	{
 		CLR_RI2();
 
-		
-        if(COM2.RX_Cnt >= COM_RX2_Lenth)	COM2.RX_Cnt = 0;
-        RX2_Buffer[COM2.RX_Cnt++] = S2BUF;
-        COM2.RX_TimeOut = TimeOutSet2;
+        // XXX: Modified by Karl, frame is assembled in user code
+        UartRxIsrProc(S2BUF);
 	}
 
 	if(TI2)
@@ -83,6 +85,8 @@ void UART2_ISR_Handler (void) interrupt UART2_VECTOR
         #else
         COM2.B_TX_busy = 0;     //ʹʽֱæ־
         #endif
+        // XXX: Added by Karl
+        UartTxIsrProc();
 	}
 }
 #endif
@@ -19,12 +19,17 @@
 #else
 #define TRACE
 #endif /* DEBUG */
+/* Cycle count of the hot paths, last/max kept in g_ulProfLast/g_ulProfMax for a debugger or
+ * Tool/C51Sim/ProfSim.py, also printed every second with DEBUG */
+#ifndef PROF
+#define PROF  0
+#endif /* PROF */
 
 /* Local defines */
 /* Work mode */
 #define WORK_MODE       1       /* 0: Standby; 1: Normal; */
 /* Device ID */
-#define DEV_ID          1       /* 1/2/3 */
+#define DEV_ID          1       /* 1 ~ 16 */
 /* Temp info type */
 #define TEMP_INFO_TYPE  0       /* 0: Raw adc data; 1: Temperature; */
 /* Software version  */
@@ -34,12 +39,46 @@
 /* Timer frequency */
 #define TIMER_FREQ      1000    /* XXX: Check it if accurate <MAIN_Fosc> */
 /* Com buffer size */
-#define COM_RX_SIZE     64
+#define COM_RX_SIZE     17      /* Longest request frame */
+#define COM_REQ_NUM     4       /* Request ring entries, power of 2 */
+#define COM_RX_GAP_MS   2       /* Partial frame dropped after this much silence */
+#define TEMP_FRM_LEN    39      /* rCmdTempInfo frame length */
+#define SYNC_FRM_LEN    40      /* rCmdSyncTemp frame length */
+#define ALM_FRM_LEN     19      /* rCmdAlarm frame length */
 /* Adc channel number */
 #define CHAN_NUM        10
+/* Adc oversampling and filter, one scan of all channels per ms */
+#define ADC_OVS         8       /* Scans averaged into one block */
+#define ADC_IIR_SHIFT   2       /* y += (x - y) / 4 per block */
+#define ADC_FRAC_BITS   4       /* Fraction bits of the filter state */
 /* RS485 rw config */
 #define RS485_RD()      P36 = 1
 #define RS485_WT()      P36 = 0
+/* Baud rate negotiation */
+#define BAUD_NUM        4       /* 115200/230400/460800/921600 */
+#define BAUD_DEF_IDX    0       /* 115200, always supported */
+#define BAUD_ERR_PPT    20      /* Max baud rate error (per thousand) */
+#define BAUD_REVERT_MS  2000    /* Back to default rate if no valid frame within it */
+#define BAUD_OP_PROBE   0
+#define BAUD_OP_SET     1
+/* Broadcast address, only accepted for iCmdSyncSample */
+#define ADDR_BCAST      0xFF
+/* Alarms, checked on the block average so the filter adds no lag */
+#define ALM_OT          0x01    /* Raw value <= over temperature threshold */
+#define ALM_PD          0x02    /* Raw value >= PD leak threshold */
+#define ALM_DEBOUNCE    2       /* Blocks in a row before an alarm is raised */
+/* Sum of the fixed frame bytes: head, length, command, addresses and tail */
+#define FRM_FIX_SUM(len, cmd)   ((uint8_t)(0x7E + 0x7E + (len) + (cmd) + DEV_ID + 0 + 0x0A + 0x0D))
+/* Timer0 counts MAIN_Fosc / TIMER_FREQ cycles per tick from its reload value */
+#define TICK_CYC        (MAIN_Fosc / TIMER_FREQ)
+
+#if PROF
+#define PROF_BEGIN(k)   s_ulProfSt[k] = ProfNow()
+#define PROF_END(k)     ProfEnd(k)
+#else
+#define PROF_BEGIN(k)
+#define PROF_END(k)
+#endif /* PROF */
 
 /* Local types */
 typedef signed char     int8_t;
@@ -65,8 +104,15 @@ enum {
 enum {
     iCmdQueryInfo = 0x01,
     iCmdSysReset  = 0x02,
+    iCmdBaudCfg   = 0x03,
+    iCmdSyncSample= 0x04,
+    iCmdAlarmCfg  = 0x05,
     rCmdTempInfo  = 0x81,
     rCmdDiagInfo  = 0x82,
+    rCmdBaudInfo  = 0x83,
+    rCmdSyncTemp  = 0x84,
+    rCmdAlarmInfo = 0x85,
+    rCmdAlarm     = 0x86,
 };
 
 typedef struct {
@@ -74,6 +120,15 @@ typedef struct {
     int16_t  temp;
 }TempTblItem_t;
 
+#if PROF
+enum {
+    PROF_ADC,       /* AdcProc filter pass */
+    PROF_BUILD,     /* BuildTempInfo, all SendTempInfo does besides the transfer */
+    PROF_UART,      /* UartProc per request, blocking transfers included */
+    PROF_NUM
+};
+#endif /* PROF */
+
 /* Forward declarations */
 /* Config */
 static void WdgConfig(void);
@@ -84,23 +139,131 @@ static void TimerConfig(void);
 /* Proc */
 static void AdcProc(void);
 static void UartProc(void);
+static void BaudProc(void);
+static void SlotProc(void);
+static void AlarmProc(void);
 static void ProcCmdQueryInfo(uint8_t cmd);
 static void ProcCmdSysReset(uint8_t mark[4]);
+static void ProcCmdBaudCfg(uint8_t op, uint8_t idx);
+static void ProcCmdSyncSample(uint8_t seq, uint8_t slot, uint8_t aofs, uint8_t aslot, uint16_t rsp, uint16_t alm);
+static uint8_t SlotRank(uint16_t mask);
+static void ProcCmdAlarmCfg(uint8_t cfg[8]);
 /* Help */
+static uint16_t Median3(uint16_t a, uint16_t b, uint16_t c);
+static uint8_t GetNoise(uint8_t n);
 static int16_t GetTemp(uint16_t adc);
+static void AlarmChk(uint8_t n, uint16_t x);
+static void BuildTempInfo(void);
+static void BuildSyncTemp(void);
 static void SendTempInfo(void);
 static void SendDiagInfo(void);
+static void SendBaudInfo(uint8_t idx);
+static void SendAlarmInfo(void);
+static void BuildAlarm(void);
+static void RxResync(uint8_t d);
+static uint8_t TxRequest(uint8_t xdata *p, uint8_t len);
+static void TxFrame(uint8_t xdata *p, uint8_t len);
+static void TxKick(uint8_t xdata *p, uint8_t len);
+static void UartSetBaud(uint8_t idx);
+static uint8_t GetBaudMask(void);
+#if PROF
+static uint32_t ProfNow(void);
+static void ProfEnd(uint8_t k);
+#endif /* PROF */
+#if (PROF && DEBUG)
+static void ProfProc(void);
+#endif /* (PROF && DEBUG) */
 /* Timer */
 void TimerProc(void);
+/* Adc */
+void AdcIsrProc(void);
+/* Uart */
+void UartRxIsrProc(uint8_t d);
+void UartTxIsrProc(void);
 
 /* Global variables */
-uint8_t g_bAdSmp = 1;
-uint8_t g_bComRx = 0;
+/* Memory placement: isr state and flags in data, isr arrays and samples in idata,
+ * constant tables in code, frames and everything else in xdata (large model) */
+uint8_t data g_bAdBlk = 0;
+uint8_t data g_bTxBusy = 0;
+uint8_t data g_bTxReq = 0;
 uint32_t g_ulRunTime = 0;
+uint8_t data g_bLinkAlive = 0;
+uint8_t data g_bBaudRevert = 0;
+uint8_t data g_bSlotTx = 0;
+uint8_t data g_bAlmTx = 0;
+#if PROF
+uint32_t g_ulProfLast[PROF_NUM];
+uint32_t g_ulProfMax[PROF_NUM];
+#endif /* PROF */
 
 /* Local variables */
-static int16_t s_sTemp[CHAN_NUM];
+static int16_t idata s_sTemp[CHAN_NUM];
 static uint32_t s_ulAdcErrCnt = 0;
+static uint8_t code s_ucAdcMap[CHAN_NUM] = {TS_1, TS_2, TS_3, TS_4, TS_5, TS_6, TS_7, TS_8, TS_9, TS_10};
+/* Adc isr accumulation */
+static uint8_t data s_ucAdcCh = CHAN_NUM;   /* Channel in conversion, CHAN_NUM when idle */
+static uint8_t data s_ucAdcOvs = 0;
+static uint16_t idata s_usAdcAcc[CHAN_NUM];
+static uint16_t idata s_usAdcMin[CHAN_NUM];
+static uint16_t idata s_usAdcMax[CHAN_NUM];
+/* Block handed over to AdcProc while g_bAdBlk is set */
+static uint16_t s_usBlkSum[CHAN_NUM];
+static uint16_t s_usBlkPp[CHAN_NUM];
+/* Filter state */
+static uint8_t s_bFltInit = 0;
+static uint16_t s_usMed[CHAN_NUM][2];
+static uint16_t s_usIir[CHAN_NUM];
+static uint16_t s_usNoise[CHAN_NUM];    /* Peak to peak within a block, 4x averaged */
+static uint32_t code s_ulBaud[BAUD_NUM] = {115200ul, 230400ul, 460800ul, 921600ul};
+static uint8_t s_ucBaudMask = 0;
+static uint8_t s_ucBaudIdx = BAUD_DEF_IDX;
+static uint8_t s_ucBaudNext = BAUD_DEF_IDX;
+static uint8_t s_ucSyncSeq = 0;
+static uint16_t data s_usSlotCnt = 0;
+/* Slot origin, taken by the uart isr at the end of the broadcast */
+static uint8_t data s_ucMsCnt = 0;      /* Free running, one increment is atomic */
+static uint8_t data s_ucSyncOrg = 0;    /* s_ucMsCnt at the end of the broadcast */
+static int16_t xdata s_sSyncTemp[CHAN_NUM];
+/* Uart isr frame assembly */
+static uint8_t idata s_ucRxBuf[COM_RX_SIZE];
+static uint8_t data s_ucRxIdx = 0;
+static uint8_t data s_ucRxSum = 0;      /* Running checksum of s_ucRxBuf */
+static uint8_t data s_ucRxGap = 0;      /* ms since the last byte */
+static uint8_t xdata s_ucReq[COM_REQ_NUM][COM_RX_SIZE];
+static uint8_t data s_ucReqWr = 0;      /* Written by isr only */
+static uint8_t data s_ucReqRd = 0;      /* Written by main loop only */
+static uint8_t s_ucReqOvr = 0;
+/* Uart isr transmit */
+static uint8_t xdata * data s_pucTx;
+static uint8_t data s_ucTxLen = 0;
+static uint8_t data s_ucTxPos = 0;
+static uint8_t xdata * data s_pucTxReq;
+static uint8_t data s_ucTxReqLen = 0;
+/* Staged responses, isr answers temp queries from s_ucTempFrm[s_ucTempAct] */
+static uint8_t xdata s_ucTempFrm[2][TEMP_FRM_LEN];
+static uint8_t data s_ucTempAct = 0xFF; /* 0xFF until the first frame is built */
+static uint8_t data s_ucTempTx = 0xFF;  /* Frame the isr is sending */
+static uint8_t xdata s_ucSyncFrm[SYNC_FRM_LEN];
+/* Alarm thresholds pushed by the master, nothing is checked until then */
+static uint16_t s_usAlmOtTh = 0;
+static uint16_t s_usAlmPdTh = 0xFFFF;
+static uint16_t s_usAlmOtEn = 0;
+static uint16_t s_usAlmPdEn = 0;
+static uint8_t s_ucAlmCnt[CHAN_NUM];
+/* Pending alarm, cleared once pushed */
+static uint16_t s_usAlmOt = 0;
+static uint16_t s_usAlmPd = 0;
+static uint8_t s_ucAlmChan = 0;
+static uint16_t s_usAlmVal = 0;
+static uint8_t data s_ucAlmAge = 0;
+static uint16_t data s_usAlmSlotCnt = 0;
+static uint8_t xdata s_ucAlmFrm[ALM_FRM_LEN];
+#if PROF
+static uint16_t data s_usTick = 0;
+static uint8_t data s_bProfRpt = 0;
+static uint32_t s_ulProfSt[PROF_NUM];
+#endif /* PROF */
 
 /* Functions */
 void main(void)
@@ -120,6 +283,12 @@ void main(void)
     #if (WORK_MODE == 1)
         AdcProc();
         UartProc();
+        SlotProc();
+        AlarmProc();
+        BaudProc();
+    #if (PROF && DEBUG)
+        ProfProc();
+    #endif /* (PROF && DEBUG) */
     #endif /* (WORK_MODE == 1) */
         WDT_Clear();
     }
@@ -186,18 +355,15 @@ static void AdcConfig(void)
     init.ADC_AdjResult = ADC_RIGHT_JUSTIFIED;
     ADC_Inilize(&init);
     ADC_PowerControl(ENABLE);
-    NVIC_ADC_Init(DISABLE, Priority_0);
+    NVIC_ADC_Init(ENABLE, Priority_0);
 }
 
 static void UartConfig(void)
 {
-    /* UART2: 115200, N, 8, 1 */
+    /* UART2: 115200, N, 8, 1, raised by iCmdBaudCfg */
     COMx_InitDefine init;
-    init.UART_Mode     = UART_8bit_BRTx;
-    init.UART_BRT_Use  = BRT_Timer2;
-    init.UART_BaudRate = 115200ul;
-    init.UART_RxEnable = ENABLE;
-    UART_Configuration(UART2, &init);
+    s_ucBaudMask = GetBaudMask();
+    UartSetBaud(BAUD_DEF_IDX);
     NVIC_UART2_Init(ENABLE, Priority_1);
     UART2_SW(UART2_SW_P10_P11);
     
@@ -228,122 +394,151 @@ static void TimerConfig(void)
 
 static void AdcProc(void)
 {
-    if (g_bAdSmp) {
+    if (g_bAdBlk) {
         uint8_t n;
-        static uint8_t c[CHAN_NUM] = {TS_1, TS_2, TS_3, TS_4, TS_5, TS_6, TS_7, TS_8, TS_9, TS_10};
+        PROF_BEGIN(PROF_ADC);
         for (n = 0; n < CHAN_NUM; n++) {
-            uint16_t adc = Get_ADCResult(c[n]);
-            if (4096 == adc) {
-                s_ulAdcErrCnt++;
+            uint16_t x = s_usBlkSum[n] / ADC_OVS;
+            uint16_t m;
+            AlarmChk(n, x);
+            if (!s_bFltInit) {
+                /* Start from the first block, not from 0 which reads as hottest */
+                s_usMed[n][0] = x;
+                s_usMed[n][1] = x;
+                s_usIir[n] = x << ADC_FRAC_BITS;
+                s_usNoise[n] = s_usBlkPp[n] << 2;
             }
-        #if (TEMP_INFO_TYPE == 0)
-            s_sTemp[n] = adc;
-        #endif /* (TEMP_INFO_TYPE == 0) */
+            /* Median of the last three blocks drops single spikes */
+            m = Median3(s_usMed[n][0], s_usMed[n][1], x);
+            s_usMed[n][0] = s_usMed[n][1];
+            s_usMed[n][1] = x;
+            /* First order IIR in fixed point */
+            s_usIir[n] = s_usIir[n] - (s_usIir[n] >> ADC_IIR_SHIFT) + (m << (ADC_FRAC_BITS - ADC_IIR_SHIFT));
+            s_usNoise[n] = s_usNoise[n] - (s_usNoise[n] >> 2) + s_usBlkPp[n];
+            x = (s_usIir[n] + (1 << (ADC_FRAC_BITS - 1))) >> ADC_FRAC_BITS;
         #if (TEMP_INFO_TYPE == 1)
-            s_sTemp[n] = GetTemp(adc);
+            x = GetTemp(x);
         #endif /* (TEMP_INFO_TYPE == 1) */
+            /* Uart isr latches it on a broadcast, it must never see half a value */
+            EA = 0;
+            s_sTemp[n] = x;
+            EA = 1;
         }
-        g_bAdSmp = 0;
+        s_bFltInit = 1;
+        g_bAdBlk = 0;
+        PROF_END(PROF_ADC);
+        PROF_BEGIN(PROF_BUILD);
+        BuildTempInfo();
+        PROF_END(PROF_BUILD);
     }
 }
 
 static void UartProc(void)
 {
-    static uint8_t b[COM_RX_SIZE];
-    static uint8_t i = 0;
-    
-    if(g_bComRx && (COM2.RX_Cnt > 0)) {
-        uint8_t n;
-        for (n = 0; n < COM2.RX_Cnt; n++) {
-            uint8_t d = RX2_Buffer[n];
-            if (i > COM_RX_SIZE) {
-                i = 0;
+    /* Requests assembled and validated by UartRxIsrProc */
+    while (s_ucReqRd != s_ucReqWr) {
+        uint8_t xdata *b = s_ucReq[s_ucReqRd & (COM_REQ_NUM - 1)];
+        PROF_BEGIN(PROF_UART);
+        switch (b[3]) {
+        case iCmdQueryInfo:
+            TRACE("Com ok: query info\n");
+            if ((9 + 1) == b[2]) {
+                ProcCmdQueryInfo(b[6]);
+            }
+            else {
+                TRACE("    wrong length\n");
+            }
+            break;
+        case iCmdSysReset:
+            TRACE("Com ok: sys reset\n");
+            if ((9 + 4) == b[2]) {
+                ProcCmdSysReset(b + 6);
+            }
+            else {
+                TRACE("    wrong length\n");
+            }
+            break;
+        case iCmdBaudCfg:
+            TRACE("Com ok: baud cfg\n");
+            if ((9 + 2) == b[2]) {
+                ProcCmdBaudCfg(b[6], b[7]);
+            }
+            else {
+                TRACE("    wrong length\n");
+            }
+            break;
+        case iCmdSyncSample:
+            TRACE("Com ok: sync sample\n");
+            if ((9 + 2) == b[2]) {
+                /* Master without alarm window, every node answers in the slot of its address */
+                ProcCmdSyncSample(b[6], b[7], 0, 0, 0xFFFF, 0xFFFF);
+            }
+            else if ((9 + 4) == b[2]) {
+                ProcCmdSyncSample(b[6], b[7], b[8], b[9], 0xFFFF, 0xFFFF);
+            }
+            else if ((9 + 8) == b[2]) {
+                ProcCmdSyncSample(b[6], b[7], b[8], b[9], b[10] | ((uint16_t)b[11] << 8),
+                                  b[12] | ((uint16_t)b[13] << 8));
             }
-            b[i++] = d;
-            switch (i) {
-            case 1: /* Head1 */
-                if (d != 0x7E) {
-                    TRACE("Com err: head 1\n");
-                    i = 0;
-                }
-                break;
-            case 2: /* Head2 */
-                if (d != 0x7E) {
-                    TRACE("Com err: head 2\n");
-                    i = 0;
-                }
-                break;
-            case 3: /* Length */
-                if (d > COM_RX_SIZE) {
-                    TRACE("Com err: len\n");
-                    i = 0;
-                }
-                break;
-            case 4: /* Command */
-                /* Do nothing */
-                break;
-            case 5: /* Source address */
-                if (d != 0) {
-                    TRACE("Com err: src addr\n");
-                    i = 0;
-                }
-                break;
-            case 6: /* Destination address */
-                if (d != DEV_ID) {
-                    TRACE("Com err: dst addr\n");
-                    i = 0;
-                }
-                break;
-            default:
-                /* Get whole packet */
-                if (i == b[2]) {
-                    uint8_t m = 0, sum = 0;
-                    /* Check tail */
-                    if (((b[i-2] != 0x0A) && (b[i-2] != 0x0D)) || ((b[i-1] != 0x0A) && (b[i-1] != 0x0D))) {
-                        TRACE("Com err: tail\n");
-                        i = 0;
-                        break;
-                    }
-                    /* Check sum */
-                    for (m = 0; m < i; m++) {
-                        sum += b[m];
-                    }
-                    if (sum != 0xFF) {
-                        TRACE("Com err: chk sum\n");
-                        i = 0;
-                        break;
-                    }
-                    /* Process data */
-                    switch (b[3]) {
-                    case iCmdQueryInfo:
-                        TRACE("Com ok: query info\n");
-                        if ((9 + 1) == b[2]) {
-                            ProcCmdQueryInfo(b[6]);
-                        }
-                        else {
-                            TRACE("    wrong length\n");
-                        }
-                        break;
-                    case iCmdSysReset:
-                        TRACE("Com ok: sys reset\n");
-                        if ((9 + 4) == b[2]) {
-                            ProcCmdSysReset(b + 6);
-                        }
-                        else {
-                            TRACE("    wrong length\n");
-                        }
-                        break;
-                    default:
-                        TRACE("Com ok: unknown cmd\n");
-                        break;
-                    }
-                    i = 0;
-                }
-                break;
+            else {
+                TRACE("    wrong length\n");
             }
+            break;
+        case iCmdAlarmCfg:
+            TRACE("Com ok: alarm cfg\n");
+            if ((9 + 8) == b[2]) {
+                ProcCmdAlarmCfg(b + 6);
+            }
+            else {
+                TRACE("    wrong length\n");
+            }
+            break;
+        default:
+            TRACE("Com ok: unknown cmd\n");
+            break;
         }
-        g_bComRx = 0;
-        COM2.RX_Cnt = 0;
+        PROF_END(PROF_UART);
+        s_ucReqRd++;
+    }
+}
+
+static void SlotProc(void)
+{
+    if (g_bSlotTx) {
+        g_bSlotTx = 0;
+        TxFrame(s_ucSyncFrm, SYNC_FRM_LEN);
+    }
+}
+
+static void AlarmProc(void)
+{
+    if (g_bAlmTx) {
+        g_bAlmTx = 0;
+        if (s_usAlmOt || s_usAlmPd) {
+            BuildAlarm();
+            s_usAlmOt = 0;
+            s_usAlmPd = 0;
+            TxFrame(s_ucAlmFrm, ALM_FRM_LEN);
+        }
+    }
+}
+
+static void BaudProc(void)
+{
+    if (g_bBaudRevert) {
+        /* Master went silent, it always falls back to the default rate */
+        g_bBaudRevert = 0;
+        s_ucBaudNext = BAUD_DEF_IDX;
+        if (s_ucBaudIdx != BAUD_DEF_IDX) {
+            TRACE("Baud: revert\n");
+            UartSetBaud(BAUD_DEF_IDX);
+        }
+    }
+    else if (s_ucBaudNext != s_ucBaudIdx) {
+        /* Let the stop bit of the acknowledge leave the shifter first */
+        delay_ms(1);
+        TRACE("Baud: switch\n");
+        UartSetBaud(s_ucBaudNext);
     }
 }
 
@@ -376,54 +571,205 @@ static void ProcCmdSysReset(uint8_t mark[4])
     }
 }
 
-static int16_t GetTemp(uint16_t adc)
+static void ProcCmdBaudCfg(uint8_t op, uint8_t idx)
+{
+    switch (op) {
+    case BAUD_OP_PROBE:
+        TRACE("    Probe\n");
+        SendBaudInfo(s_ucBaudIdx);
+        break;
+    case BAUD_OP_SET:
+        if ((idx < BAUD_NUM) && (s_ucBaudMask & (1 << idx))) {
+            /* Acknowledge at the current rate, switch in BaudProc */
+            TRACE("    Set\n");
+            SendBaudInfo(idx);
+            s_ucBaudNext = idx;
+        }
+        else {
+            TRACE("    Unsupported rate\n");
+            SendBaudInfo(s_ucBaudIdx);
+        }
+        break;
+    default:
+        TRACE("    Unknown op\n");
+        break;
+    }
+}
+
+static void ProcCmdSyncSample(uint8_t seq, uint8_t slot, uint8_t aofs, uint8_t aslot, uint16_t rsp, uint16_t alm)
 {
-    static TempTblItem_t T[TEMP_TBL_SIZE] = TEMP_TBL_CONT;
+    uint16_t cnt;
+    uint8_t r;
+    /* Time the request waited in the ring behind the main loop */
+    uint8_t age = s_ucMsCnt - s_ucSyncOrg;
+    
+    /* Values were latched by the uart isr at the end of the broadcast, the same instant on every node */
+    s_ucSyncSeq = seq;
+    BuildSyncTemp();
+    
+    /* Slots are packed over the nodes in the mask, bit n is node n + 1, and count from that instant too */
+    r = SlotRank(rsp);
+    if (r != 0xFF) {
+        cnt = (uint16_t)r * slot;
+        if (cnt <= age) {
+            g_bSlotTx = 1;
+        }
+        else {
+            cnt -= age;
+            EA = 0;
+            s_usSlotCnt = cnt;
+            EA = 1;
+        }
+    }
+    
+    /* Own alarm slot in the window the master keeps free after the last data slot */
+    r = SlotRank(alm);
+    if (aslot && (r != 0xFF)) {
+        cnt = aofs + (uint16_t)r * aslot;
+        if (cnt <= age) {
+            g_bAlmTx = 1;
+        }
+        else {
+            cnt -= age;
+            EA = 0;
+            s_usAlmSlotCnt = cnt;
+            EA = 1;
+        }
+    }
+}
 
-    uint8_t  ok = 0;
-    uint16_t st = 0;
-    uint16_t ed = 0;
-    uint16_t n = 0;
-    int16_t  temp;
+static uint8_t SlotRank(uint16_t mask)
+{
+    uint8_t n, r = 0;
     
-    if ((T[0].adc > adc) && (adc > T[TEMP_TBL_SIZE - 1].adc)) {
-        for (n = 0; n < (TEMP_TBL_SIZE - 1); n++) {
-            if (adc >= T[n + 1].adc) {
-                ok = 1;
-                st = n;
-                ed = n + 1;
-                break;
-            }
+    /* Not asked this time */
+    if (!(mask & ((uint16_t)1 << (DEV_ID - 1)))) {
+        return 0xFF;
+    }
+    for (n = 0; n < (DEV_ID - 1); n++) {
+        if (mask & ((uint16_t)1 << n)) {
+            r++;
         }
     }
+    
+    return r;
+}
 
-    if (ok) {
-        /* Linear interpolation */
-        /* y = (x - x1) * (y2 - y1) / (x2 - x1) + y1 */
-        temp = (adc - T[st].adc) * (T[ed].temp - T[st].temp) / (T[ed].adc - T[st].adc) + T[st].temp;
+static void ProcCmdAlarmCfg(uint8_t cfg[8])
+{
+    s_usAlmOtTh = cfg[0] | ((uint16_t)cfg[1] << 8);
+    s_usAlmPdTh = cfg[2] | ((uint16_t)cfg[3] << 8);
+    s_usAlmOtEn = cfg[4] | ((uint16_t)cfg[5] << 8);
+    s_usAlmPdEn = cfg[6] | ((uint16_t)cfg[7] << 8);
+    /* Drop what is no longer checked */
+    s_usAlmOt &= s_usAlmOtEn;
+    s_usAlmPd &= s_usAlmPdEn;
+    TRACE("    Ot %d/0x%x, Pd %d/0x%x\n", s_usAlmOtTh, s_usAlmOtEn, s_usAlmPdTh, s_usAlmPdEn);
+    SendAlarmInfo();
+}
+
+static uint16_t Median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b) {
+        uint16_t t = a;
+        a = b;
+        b = t;
     }
-    else {
-        if (adc > T[0].adc) {
+    /* a <= b */
+    if (c <= a) {
+        return a;
+    }
+    if (c >= b) {
+        return b;
+    }
+    return c;
+}
+
+static uint8_t GetNoise(uint8_t n)
+{
+    uint16_t v = (s_usNoise[n] + 2) >> 2;
+    return (v > 0xFF) ? 0xFF : v;
+}
+
+static void AlarmChk(uint8_t n, uint16_t x)
+{
+    uint16_t bit = 1 << n;
+    uint8_t ot = (s_usAlmOtEn & bit) && (x <= s_usAlmOtTh);
+    uint8_t pd = (s_usAlmPdEn & bit) && (x >= s_usAlmPdTh);
+    
+    if (!ot && !pd) {
+        s_ucAlmCnt[n] = 0;
+        return;
+    }
+    if (s_ucAlmCnt[n] < ALM_DEBOUNCE) {
+        if (++s_ucAlmCnt[n] < ALM_DEBOUNCE) {
+            return;
+        }
+    }
+    
+    /* First channel of a new alarm is reported with its value */
+    if (!s_usAlmOt && !s_usAlmPd) {
+        s_ucAlmAge  = 0;
+        s_ucAlmChan = n;
+        s_usAlmVal  = x;
+    }
+    if (ot) {
+        s_usAlmOt |= bit;
+    }
+    if (pd) {
+        s_usAlmPd |= bit;
+    }
+}
+
+static int16_t GetTemp(uint16_t adc)
+{
+    static TempTblItem_t code T[TEMP_TBL_SIZE] = TEMP_TBL_CONT;
+
+    uint8_t lo = 0;
+    uint8_t hi = TEMP_TBL_SIZE - 1;
+    uint8_t mid;
+    
+    /* Ends of the table, exact hits included */
+    if (adc >= T[lo].adc) {
+        if (adc > T[lo].adc) {
             TRACE("Temp: under range\n");
-            temp = T[0].temp;
         }
-        else if (adc < T[TEMP_TBL_SIZE - 1].adc) {
+        return T[lo].temp;
+    }
+    if (adc <= T[hi].adc) {
+        if (adc < T[hi].adc) {
             TRACE("Temp: over range\n");
-            temp = T[TEMP_TBL_SIZE - 1].temp;
+        }
+        return T[hi].temp;
+    }
+    
+    /* Table is sorted by falling adc, keep T[lo].adc > adc >= T[hi].adc */
+    while ((hi - lo) > 1) {
+        mid = (lo + hi) >> 1;
+        if (adc >= T[mid].adc) {
+            hi = mid;
+        }
+        else {
+            lo = mid;
         }
     }
 
-    return temp;
+    /* Linear interpolation */
+    /* y = (x - x1) * (y2 - y1) / (x2 - x1) + y1 */
+    return (adc - T[lo].adc) * (T[hi].temp - T[lo].temp) / (T[hi].adc - T[lo].adc) + T[lo].temp;
 }
 
-static void SendTempInfo(void)
+static void BuildTempInfo(void)
 {
-    #define LEN1 29
-    static uint8_t c[LEN1];
-    uint8_t i = 0, n = 0, sum = 0;
+    #define LEN1 TEMP_FRM_LEN
+    uint8_t k = (s_ucTempAct == 0) ? 1 : 0;
+    uint8_t xdata *c = s_ucTempFrm[k];
+    uint8_t i = 0, n = 0, v, sum = FRM_FIX_SUM(LEN1, rCmdTempInfo);
     
-    /* Enable RS485 write */
-    RS485_WT();
+    /* Isr is still sending it, take the next block */
+    if (s_ucTempTx == k) {
+        return;
+    }
     
     /* Head */
     c[i++] = 0x7E;
@@ -432,55 +778,43 @@ static void SendTempInfo(void)
     c[i++] = rCmdTempInfo;
     c[i++] = DEV_ID;
     c[i++] = 0;
-    /* Content */
-    c[i++] = s_sTemp[0] & 0xFF;
-    c[i++] = (s_sTemp[0] >> 8) & 0xFF;
-    c[i++] = s_sTemp[1] & 0xFF;
-    c[i++] = (s_sTemp[1] >> 8) & 0xFF;
-    c[i++] = s_sTemp[2] & 0xFF;
-    c[i++] = (s_sTemp[2] >> 8) & 0xFF;
-    c[i++] = s_sTemp[3] & 0xFF;
-    c[i++] = (s_sTemp[3] >> 8) & 0xFF;
-    c[i++] = s_sTemp[4] & 0xFF;
-    c[i++] = (s_sTemp[4] >> 8) & 0xFF;
-    c[i++] = s_sTemp[5] & 0xFF;
-    c[i++] = (s_sTemp[5] >> 8) & 0xFF;
-    c[i++] = s_sTemp[6] & 0xFF;
-    c[i++] = (s_sTemp[6] >> 8) & 0xFF;
-    c[i++] = s_sTemp[7] & 0xFF;
-    c[i++] = (s_sTemp[7] >> 8) & 0xFF;
-    c[i++] = s_sTemp[8] & 0xFF;
-    c[i++] = (s_sTemp[8] >> 8) & 0xFF;
-    c[i++] = s_sTemp[9] & 0xFF;
-    c[i++] = (s_sTemp[9] >> 8) & 0xFF;
+    /* Content, summed as it is written */
+    for (n = 0; n < CHAN_NUM; n++) {
+        v = s_sTemp[n] & 0xFF;
+        c[i++] = v;
+        sum += v;
+        v = (s_sTemp[n] >> 8) & 0xFF;
+        c[i++] = v;
+        sum += v;
+    }
+    for (n = 0; n < CHAN_NUM; n++) {
+        v = GetNoise(n);
+        c[i++] = v;
+        sum += v;
+    }
     /* Tail */
-    c[i++] = 0;
+    c[i++] = 0xFF - sum;
     c[i++] = 0x0A;
     c[i++] = 0x0D;
-    for (n = 0; n < LEN1; n++) {
-        sum += c[n];
-    }
-    sum = 0xFF - sum;
-    c[LEN1-3] = sum;
     
-    /* Send */
-    for (n = 0; n < LEN1; n++) {
-        TX2_write2buff(c[n]);
+    /* Publish */
+    s_ucTempAct = k;
+}
+
+static void SendTempInfo(void)
+{
+    /* Same staged frame the isr answers with */
+    if (s_ucTempAct < 2) {
+        TxFrame(s_ucTempFrm[s_ucTempAct], TEMP_FRM_LEN);
     }
-    
-    /* Enable RS485 read */
-    RS485_RD();
 }
 
 static void SendDiagInfo(void)
 {
     #define LEN2 21
-    static uint8_t c[LEN2];
+    static uint8_t xdata c[LEN2];
     uint8_t i = 0, n = 0, sum = 0;
     
-    /* Enable RS485 write */
-    RS485_WT();
-    
     /* Head */
     c[i++] = 0x7E;
     c[i++] = 0x7E;
@@ -512,34 +846,494 @@ static void SendDiagInfo(void)
     c[LEN2-3] = sum;
     
     /* Send */
-    for (n = 0; n < LEN2; n++) {
-        TX2_write2buff(c[n]);
+    TxFrame(c, LEN2);
+}
+
+static void SendBaudInfo(uint8_t idx)
+{
+    #define LEN3 11
+    static uint8_t xdata c[LEN3];
+    uint8_t i = 0, n = 0, sum = 0;
+    
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN3;
+    c[i++] = rCmdBaudInfo;
+    c[i++] = DEV_ID;
+    c[i++] = 0;
+    /* Content */
+    c[i++] = s_ucBaudMask;
+    c[i++] = idx;
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN3; n++) {
+        sum += c[n];
     }
+    sum = 0xFF - sum;
+    c[LEN3-3] = sum;
     
-    /* Enable RS485 read */
-    RS485_RD();
+    /* Send */
+    TxFrame(c, LEN3);
+}
+
+static void BuildSyncTemp(void)
+{
+    #define LEN4 SYNC_FRM_LEN
+    uint8_t xdata *c = s_ucSyncFrm;
+    uint8_t i = 0, n = 0, v, sum = FRM_FIX_SUM(LEN4, rCmdSyncTemp);
+    
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN4;
+    c[i++] = rCmdSyncTemp;
+    c[i++] = DEV_ID;
+    c[i++] = 0;
+    /* Content, summed as it is written, values as latched by the uart isr */
+    c[i++] = s_ucSyncSeq;
+    sum += s_ucSyncSeq;
+    for (n = 0; n < CHAN_NUM; n++) {
+        v = s_sSyncTemp[n] & 0xFF;
+        c[i++] = v;
+        sum += v;
+        v = (s_sSyncTemp[n] >> 8) & 0xFF;
+        c[i++] = v;
+        sum += v;
+    }
+    for (n = 0; n < CHAN_NUM; n++) {
+        v = GetNoise(n);
+        c[i++] = v;
+        sum += v;
+    }
+    /* Tail */
+    c[i++] = 0xFF - sum;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+}
+
+static void SendAlarmInfo(void)
+{
+    #define LEN5 17
+    static uint8_t xdata c[LEN5];
+    uint8_t i = 0, n = 0, sum = 0;
+    
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN5;
+    c[i++] = rCmdAlarmInfo;
+    c[i++] = DEV_ID;
+    c[i++] = 0;
+    /* Content */
+    c[i++] = s_usAlmOtTh & 0xFF;
+    c[i++] = (s_usAlmOtTh >> 8) & 0xFF;
+    c[i++] = s_usAlmPdTh & 0xFF;
+    c[i++] = (s_usAlmPdTh >> 8) & 0xFF;
+    c[i++] = s_usAlmOtEn & 0xFF;
+    c[i++] = (s_usAlmOtEn >> 8) & 0xFF;
+    c[i++] = s_usAlmPdEn & 0xFF;
+    c[i++] = (s_usAlmPdEn >> 8) & 0xFF;
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN5; n++) {
+        sum += c[n];
+    }
+    sum = 0xFF - sum;
+    c[LEN5-3] = sum;
+    
+    /* Send */
+    TxFrame(c, LEN5);
+}
+
+static void BuildAlarm(void)
+{
+    #define LEN6 ALM_FRM_LEN
+    uint8_t xdata *c = s_ucAlmFrm;
+    uint8_t i = 0, n = 0, sum = 0;
+    
+    /* Head */
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = LEN6;
+    c[i++] = rCmdAlarm;
+    c[i++] = DEV_ID;
+    c[i++] = 0;
+    /* Content */
+    c[i++] = s_ucSyncSeq;
+    c[i++] = (s_usAlmOt ? ALM_OT : 0) | (s_usAlmPd ? ALM_PD : 0);
+    c[i++] = s_ucAlmAge;
+    c[i++] = s_ucAlmChan;
+    c[i++] = s_usAlmOt & 0xFF;
+    c[i++] = (s_usAlmOt >> 8) & 0xFF;
+    c[i++] = s_usAlmPd & 0xFF;
+    c[i++] = (s_usAlmPd >> 8) & 0xFF;
+    c[i++] = s_usAlmVal & 0xFF;
+    c[i++] = (s_usAlmVal >> 8) & 0xFF;
+    /* Tail */
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (n = 0; n < LEN6; n++) {
+        sum += c[n];
+    }
+    sum = 0xFF - sum;
+    c[LEN6-3] = sum;
+}
+
+static void UartSetBaud(uint8_t idx)
+{
+    COMx_InitDefine init;
+    init.UART_Mode     = UART_8bit_BRTx;
+    init.UART_BRT_Use  = BRT_Timer2;
+    init.UART_BaudRate = s_ulBaud[idx];
+    init.UART_RxEnable = ENABLE;
+    UART_Configuration(UART2, &init);
+    s_ucRxIdx    = 0;
+    s_ucBaudIdx  = idx;
+    s_ucBaudNext = idx;
+}
+
+static uint8_t GetBaudMask(void)
+{
+    /* Timer2 in 1T mode divides (MAIN_Fosc / 4) by an integer reload */
+    uint8_t n, mask = 0;
+    for (n = 0; n < BAUD_NUM; n++) {
+        uint32_t j = (MAIN_Fosc / 4) / s_ulBaud[n];
+        uint32_t r, e;
+        if (0 == j) {
+            continue;
+        }
+        r = (MAIN_Fosc / 4) / j;
+        e = (r > s_ulBaud[n]) ? (r - s_ulBaud[n]) : (s_ulBaud[n] - r);
+        if ((e * 1000 / s_ulBaud[n]) <= BAUD_ERR_PPT) {
+            mask |= (1 << n);
+        }
+    }
+    return mask | (1 << BAUD_DEF_IDX);
+}
+
+static uint8_t TxRequest(uint8_t xdata *p, uint8_t len)
+{
+    uint8_t ok = 0;
+    
+    EA = 0;
+    if (!g_bTxBusy && !g_bTxReq) {
+        s_pucTxReq = p;
+        s_ucTxReqLen = len;
+        g_bTxReq = 1;
+        ok = 1;
+    }
+    EA = 1;
+    
+    /* Uart isr picks it up */
+    if (ok) {
+        SET_TI2();
+    }
+    return ok;
+}
+
+static void TxFrame(uint8_t xdata *p, uint8_t len)
+{
+    /* Wait behind a reply the isr may be sending, then till this one is out */
+    while (!TxRequest(p, len));
+    while (g_bTxReq || g_bTxBusy);
 }
 
 void TimerProc(void)
 {
     static uint16_t n = 0;
+    static uint16_t idle = 0;
     
     n++;
+    s_ucMsCnt++;
+    
+    /* Sync sample slot */
+    if (s_usSlotCnt > 0) {
+        if (--s_usSlotCnt == 0) {
+            g_bSlotTx = 1;
+        }
+    }
     
-    /* 1ms */
-    if(COM2.RX_TimeOut > 0) {
-        if(--COM2.RX_TimeOut == 0) {
-            g_bComRx = 1;
+    /* Alarm slot */
+    if (s_usAlmSlotCnt > 0) {
+        if (--s_usAlmSlotCnt == 0) {
+            g_bAlmTx = 1;
         }
     }
+    if (s_ucAlmAge < 0xFF) {
+        s_ucAlmAge++;
+    }
+    
+    /* Master sends a frame in one go, a gap means the rest is lost, e.g. to a corrupted length */
+    if (s_ucRxIdx && (++s_ucRxGap >= COM_RX_GAP_MS)) {
+        s_ucRxIdx = 0;
+    }
     
-    /* 10ms */
-    if (0 == (n % 10)) {
-        g_bAdSmp = 1;
+    /* Link supervision above the default rate */
+    if (g_bLinkAlive || (s_ucBaudIdx == BAUD_DEF_IDX)) {
+        g_bLinkAlive = 0;
+        idle = 0;
+    }
+    else if (++idle >= BAUD_REVERT_MS) {
+        idle = 0;
+        g_bBaudRevert = 1;
+    }
+    
+    /* Start an adc scan, the adc isr walks through all channels */
+    if (s_ucAdcCh >= CHAN_NUM) {
+        s_ucAdcCh = 0;
+        ADC_CONTR = (ADC_CONTR & 0xF0) | ADC_START | s_ucAdcMap[0];
+    }
+    else {
+        /* Previous scan is not finished */
+        s_ulAdcErrCnt++;
     }
     
     /* 1s */
     if (0 == (n % 1000)) {
         g_ulRunTime++;
+    #if PROF
+        s_bProfRpt = 1;
+    #endif /* PROF */
+    }
+#if PROF
+    s_usTick++;
+#endif /* PROF */
+}
+
+void AdcIsrProc(void)
+{
+    uint8_t n = s_ucAdcCh;
+    uint16_t adc;
+    
+    if (n >= CHAN_NUM) {
+        return;
+    }
+    
+    adc = ((uint16_t)ADC_RES << 8) | ADC_RESL;
+    if (s_ucAdcOvs == 0) {
+        s_usAdcAcc[n] = 0;
+        s_usAdcMin[n] = adc;
+        s_usAdcMax[n] = adc;
+    }
+    s_usAdcAcc[n] += adc;
+    if (adc < s_usAdcMin[n]) {
+        s_usAdcMin[n] = adc;
+    }
+    if (adc > s_usAdcMax[n]) {
+        s_usAdcMax[n] = adc;
+    }
+    
+    /* Next channel */
+    if (++n < CHAN_NUM) {
+        s_ucAdcCh = n;
+        ADC_CONTR = (ADC_CONTR & 0xF0) | ADC_START | s_ucAdcMap[n];
+        return;
+    }
+    
+    /* Scan done */
+    s_ucAdcCh = CHAN_NUM;
+    if (++s_ucAdcOvs >= ADC_OVS) {
+        s_ucAdcOvs = 0;
+        /* Block is dropped if AdcProc has not taken the previous one yet */
+        if (!g_bAdBlk) {
+            for (n = 0; n < CHAN_NUM; n++) {
+                s_usBlkSum[n] = s_usAdcAcc[n];
+                s_usBlkPp[n] = s_usAdcMax[n] - s_usAdcMin[n];
+            }
+            g_bAdBlk = 1;
+        }
+    }
+}
+
+void UartRxIsrProc(uint8_t d)
+{
+    uint8_t idata *b = s_ucRxBuf;
+    uint8_t i = s_ucRxIdx;
+    uint8_t m;
+    
+    if (i >= COM_RX_SIZE) {
+        i = 0;
+    }
+    b[i++] = d;
+    s_ucRxIdx = i;
+    s_ucRxGap = 0;
+    /* Checksum builds up byte by byte, nothing left to sum at the end */
+    s_ucRxSum = (1 == i) ? d : (s_ucRxSum + d);
+    switch (i) {
+    case 1: /* Head1 */
+    case 2: /* Head2 */
+        if (d != 0x7E) {
+            s_ucRxIdx = 0;
+        }
+        return;
+    case 3: /* Length */
+        if (0x7E == d) {
+            /* Run of head marks, the frame starts with the last two */
+            s_ucRxIdx = 2;
+            s_ucRxSum = 0x7E + 0x7E;
+        }
+        else if ((d > COM_RX_SIZE) || (d < 9)) {
+            s_ucRxIdx = 0;
+        }
+        return;
+    case 4: /* Command */
+        return;
+    case 5: /* Source address */
+        if (d != 0) {
+            RxResync(d);
+        }
+        return;
+    case 6: /* Destination address */
+        if ((d != DEV_ID) && (d != ADDR_BCAST)) {
+            RxResync(d);
+        }
+        return;
+    default:
+        break;
+    }
+    
+    /* Get whole packet */
+    if (i < b[2]) {
+        return;
+    }
+    s_ucRxIdx = 0;
+    /* Check tail */
+    if (((b[i-2] != 0x0A) && (b[i-2] != 0x0D)) || ((b[i-1] != 0x0A) && (b[i-1] != 0x0D))) {
+        return;
+    }
+    /* Check sum */
+    if (s_ucRxSum != 0xFF) {
+        return;
+    }
+    /* Broadcast is only for synchronized sampling */
+    if ((ADDR_BCAST == b[5]) && (iCmdSyncSample != b[3])) {
+        return;
+    }
+    g_bLinkAlive = 1;
+    
+    /* Broadcast ends at the same instant on every node, latch the values and the slot origin right here */
+    if (iCmdSyncSample == b[3]) {
+        s_ucSyncOrg = s_ucMsCnt;
+        for (m = 0; m < CHAN_NUM; m++) {
+            s_sSyncTemp[m] = s_sTemp[m];
+        }
+    }
+    
+    /* Temp query is answered right here from the staged frame */
+    if ((iCmdQueryInfo == b[3]) && ((9 + 1) == i) && (rCmdTempInfo == b[6]) && (DEV_ID == b[5]) &&
+        (s_ucTempAct < 2) && !g_bTxBusy && !g_bTxReq) {
+        s_ucTempTx = s_ucTempAct;
+        TxKick(s_ucTempFrm[s_ucTempAct], TEMP_FRM_LEN);
+        return;
+    }
+    
+    /* Everything else goes to the main loop */
+    if ((uint8_t)(s_ucReqWr - s_ucReqRd) >= COM_REQ_NUM) {
+        s_ucReqOvr++;
+        return;
+    }
+    for (m = 0; m < i; m++) {
+        s_ucReq[s_ucReqWr & (COM_REQ_NUM - 1)][m] = b[m];
+    }
+    s_ucReqWr++;
+}
+
+static void RxResync(uint8_t d)
+{
+    /* Header broken, a head mark in it may be the start of the next frame */
+    if (0x7E == d) {
+        s_ucRxBuf[0] = d;
+        s_ucRxIdx = 1;
+        s_ucRxSum = d;
+    }
+    else {
+        s_ucRxIdx = 0;
+    }
+}
+
+void UartTxIsrProc(void)
+{
+    if (s_ucTxPos < s_ucTxLen) {
+        S2BUF = s_pucTx[s_ucTxPos++];
+    }
+    else if (g_bTxReq) {
+        g_bTxReq = 0;
+        TxKick(s_pucTxReq, s_ucTxReqLen);
+    }
+    else if (g_bTxBusy) {
+        /* Last byte is out */
+        RS485_RD();
+        s_ucTxLen = 0;
+        s_ucTempTx = 0xFF;
+        g_bTxBusy = 0;
+    }
+}
+
+static void TxKick(uint8_t xdata *p, uint8_t len)
+{
+    /* Uart isr context only */
+    RS485_WT();
+    s_pucTx = p;
+    s_ucTxLen = len;
+    s_ucTxPos = 1;
+    g_bTxBusy = 1;
+    S2BUF = p[0];
+}
+
+#if PROF
+static uint32_t ProfNow(void)
+{
+    /* Main loop only (not reentrant), keep EA as it was */
+    uint8_t ea = EA;
+    uint8_t h, l;
+    uint16_t t;
+    
+    EA = 0;
+    do {
+        h = TH0;
+        l = TL0;
+    } while (h != TH0);
+    t = s_usTick;
+    if (TF0) {
+        /* Overflow not serviced yet */
+        h = TH0;
+        l = TL0;
+        t++;
+    }
+    EA = ea;
+    
+    return (uint32_t)t * TICK_CYC + ((((uint16_t)h << 8) | l) - (uint16_t)(65536UL - TICK_CYC));
+}
+
+static void ProfEnd(uint8_t k)
+{
+    uint32_t c = ProfNow() - s_ulProfSt[k];
+    
+    /* Wraps after 65536 ticks, a negative span is dropped */
+    if (c & 0x80000000ul) {
+        return;
+    }
+    g_ulProfLast[k] = c;
+    if (c > g_ulProfMax[k]) {
+        g_ulProfMax[k] = c;
+    }
+}
+#endif /* PROF */
+
+#if (PROF && DEBUG)
+static void ProfProc(void)
+{
+    if (s_bProfRpt) {
+        s_bProfRpt = 0;
+        TRACE("Prof cycles (last/max): adc %lu/%lu, build %lu/%lu, uart %lu/%lu\r\n",
+              g_ulProfLast[PROF_ADC], g_ulProfMax[PROF_ADC], g_ulProfLast[PROF_BUILD], g_ulProfMax[PROF_BUILD],
+              g_ulProfLast[PROF_UART], g_ulProfMax[PROF_UART]);
     }
 }
+#endif /* (PROF && DEBUG) */
@@ -99,7 +99,9 @@ extern uint32_t SystemCoreClock;
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 7 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)26500)
+/* Task stacks take most of it, about 30 KB with tDCommit, tDLog, tEvtLog, tHist,
+   tHistNet and tNv, task_stat shows the lowest free heap */
+#define configTOTAL_HEAP_SIZE                    ((size_t)34816)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
 #define configUSE_16_BIT_TICKS                   0
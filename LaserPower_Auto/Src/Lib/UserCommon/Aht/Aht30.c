@@ -38,6 +38,7 @@
 #include "stm32f1xx_hal.h"
 #include "I2c/I2c.h"
 #include "Aht/Aht30.h"
+#include "Crc/Crc.h"
 #include "Debug/Debug.h"
 #include "Cli/Cli.h"
 
@@ -183,26 +184,7 @@ Status_t aht30_read_humiture(int *temperature, uint16_t *humidity) {
  * @note      none
  */
 static uint8_t a_aht30_calc_crc(uint8_t *data, uint8_t len) {
-    uint8_t i;
-    uint8_t byte;
-    uint8_t crc = 0xFF;
-
-    for (byte = 0; byte < len; byte++) /* len times */
-    {
-        crc ^= data[byte];      /* xor byte */
-        for (i = 8; i > 0; --i) /* one byte */
-        {
-            if ((crc & 0x80) != 0) /* if high*/
-            {
-                crc = (crc << 1) ^ 0x31; /* xor 0x31 */
-            }
-            else {
-                crc = crc << 1; /* skip */
-            }
-        }
-    }
-
-    return crc; /* return crc */
+    return Crc8Nrsc5(CRC8_NRSC5_INIT, data, len); /* poly 0x31, init 0xFF */
 }
 
 static void cli_get_humiture(cli_printf cliprintf, int argc, char **argv) {
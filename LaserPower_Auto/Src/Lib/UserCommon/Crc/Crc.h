@@ -0,0 +1,49 @@
+/*
+    Crc.h
+
+    Head File for Crc Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+*/
+
+#ifndef __CRC_H__
+#define __CRC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdint.h>
+#include "Include/Include.h"
+#include "Crc/CrcConfig.h"
+
+/* Defines */
+#define CRC8_MAXIM_INIT     (0x00)
+#define CRC8_NRSC5_INIT     (0xFF)      /* Sensirion/Aosong sensors, poly 0x31 */
+#define CRC16_XMODEM_INIT   (0x0000)
+#define CRC16_CCITT_INIT    (0xFFFF)
+
+/* Functions */
+/* The running value is passed in, so a buffer may be fed in pieces */
+uint8_t  Crc8Maxim(uint8_t ucCrc, const uint8_t *pucData, uint32_t ulLength);
+uint8_t  Crc8Nrsc5(uint8_t ucCrc, const uint8_t *pucData, uint32_t ulLength);
+/* Poly 0x1021, not reflected, XMODEM or CCITT-FALSE by the init value */
+uint16_t Crc16Ccitt(uint16_t usCrc, const uint8_t *pucData, uint32_t ulLength);
+
+#if CRC_ENABLE_HW
+/* CRC-32/MPEG-2 of whole words, the unit cannot resume, one call per buffer */
+uint32_t Crc32Hw(const uint32_t *pulData, uint32_t ulWords);
+#endif /* CRC_ENABLE_HW */
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __CRC_H__ */
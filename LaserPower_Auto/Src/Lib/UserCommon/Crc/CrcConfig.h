@@ -0,0 +1,52 @@
+/*
+    CrcConfig.h
+
+    Configuration File for Crc Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, Karl Created
+*/
+
+#ifndef __CRC_CONFIG_H__
+#define __CRC_CONFIG_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include "Config.h"
+
+/* Defines */
+#ifndef CRC_ENABLE
+#define CRC_ENABLE          (0)
+#endif
+#ifndef CRC_ENABLE_HW
+#define CRC_ENABLE_HW       (0)         /* CRC32 on the STM32 CRC unit */
+#endif
+#ifndef CRC_NIBBLE_TABLE
+#define CRC_NIBBLE_TABLE    (0)         /* 16 entry tables, less flash, about half the speed */
+#endif
+#ifndef CRC_RTOS
+#define CRC_RTOS            (1)
+#endif
+#ifndef CRC_DEBUG
+#define CRC_DEBUG           (0)
+#endif
+#ifndef CRC_ASSERT
+#define CRC_ASSERT          (0)
+#endif
+#ifndef CRC_TEST
+#define CRC_TEST            (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __CRC_CONFIG_H__ */
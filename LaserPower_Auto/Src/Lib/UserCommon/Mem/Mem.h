@@ -10,6 +10,8 @@
     modification history
     --------------------
     01a, 24Jul19, Karl Created
+    01b, 19Oct26, Karl Added MEM_CTRL_OP_SPIFLASH_DMA and MEM_CTRL_OP_SPIFLASH_BLOCK_CYC
+    01c, 19Oct26, Karl Added MEM_CTRL_OP_SPIFLASH_STAT
 */
 
 #ifndef __MEM_H__
@@ -42,6 +44,13 @@ typedef struct {
     uint32_t ulLength;
 }MemSpiFlashErase_t;
 
+typedef struct {
+    uint32_t ulEraseCnt;        /* Sectors erased */
+    uint32_t ulEraseSkipCnt;    /* Sector erases avoided by MemEraseWrite */
+    uint32_t ulProgBytes;       /* Bytes programmed */
+    uint32_t ulSkipBytes;       /* MemEraseWrite bytes already in place */
+}MemSpiFlashStat_t;
+
 typedef struct {
     uint32_t ulStartSector;
 }MemStm32FlashErase_t;
@@ -60,6 +69,9 @@ typedef enum {
     /* SPI-FLASH Operation */
     MEM_CTRL_OP_SPIFLASH_ERASE,
     MEM_CTRL_OP_SPIFLASH_ERASE_CHIP,
+    MEM_CTRL_OP_SPIFLASH_DMA,           /* ulExtraPara: TRUE or FALSE */
+    MEM_CTRL_OP_SPIFLASH_BLOCK_CYC,     /* ulExtraPara: uint32_t* for the cycles blocked so far */
+    MEM_CTRL_OP_SPIFLASH_STAT,          /* ulExtraPara: MemSpiFlashStat_t* */
     /* STM32-FLASH Operation */
     MEM_CTRL_OP_STM32FLASH_ERASE,
     MEM_CTRL_OP_STM32FLASH_WP
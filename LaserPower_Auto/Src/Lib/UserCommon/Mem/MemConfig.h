@@ -11,6 +11,7 @@
     --------------------
     01a, 24Jul19, Karl Created
     01b, 11May20, Karl Added MEM_FRAM_ADDR_MASK & MEM_FRAM_ADDR_WIDTH
+    01c, 19Oct26, Karl Added MEM_SPIFLASH_DMA
 */
 
 #ifndef __MEM_CONFIG_H__
@@ -60,6 +61,30 @@ extern "C" {
 #ifndef MEM_FRAM_ENABLE_MSP
 #define MEM_FRAM_ENABLE_MSP         (0)
 #endif
+#ifndef MEM_SPIFLASH_DMA
+#define MEM_SPIFLASH_DMA            (0)
+#endif
+#ifndef MEM_SPIFLASH_DMA_MIN
+#define MEM_SPIFLASH_DMA_MIN        (32)
+#endif
+#ifndef MEM_SPIFLASH_DMA_RX_CHAN
+#define MEM_SPIFLASH_DMA_RX_CHAN    DMA2_Channel1
+#endif
+#ifndef MEM_SPIFLASH_DMA_RX_ISR
+#define MEM_SPIFLASH_DMA_RX_ISR     DMA2_Channel1_IRQn
+#endif
+#ifndef MEM_SPIFLASH_DMA_RX_ISR_HANDLER
+#define MEM_SPIFLASH_DMA_RX_ISR_HANDLER DMA2_Channel1_IRQHandler
+#endif
+#ifndef MEM_SPIFLASH_DMA_TX_CHAN
+#define MEM_SPIFLASH_DMA_TX_CHAN    DMA2_Channel2
+#endif
+#ifndef MEM_SPIFLASH_DMA_TX_ISR
+#define MEM_SPIFLASH_DMA_TX_ISR     DMA2_Channel2_IRQn
+#endif
+#ifndef MEM_SPIFLASH_DMA_TX_ISR_HANDLER
+#define MEM_SPIFLASH_DMA_TX_ISR_HANDLER DMA2_Channel2_IRQHandler
+#endif
 
 #ifdef __cplusplus
 }
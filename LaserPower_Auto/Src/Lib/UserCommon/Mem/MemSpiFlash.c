@@ -12,10 +12,17 @@
     01a, 20Sep18, David Created
     01b, 06Oct18, Karl Modified
     01c, 24Jul19, Karl Reconstructured Mem lib
+    01d, 19Oct26, Karl Added DMA transfers, FAST_READ and a yielding busy wait
+    01e, 19Oct26, Karl Erase write compares first and erases only when it must
+    01f, 19Oct26, agent Gave the DMA semaphore on a receive completion
+    01g, 19Oct26, agent Spi_Flash_Write fails for a write mode it does not support
 */
 
 /* Includes */
 #include "Mem/MemSpiFlash.h"
+#if MEM_SPIFLASH_DMA
+#include <cmsis_os.h>
+#endif /* MEM_SPIFLASH_DMA */
 
 #if (MEM_ENABLE && MEM_ENABLE_SPIFLASH)
 
@@ -38,6 +45,16 @@
 /* Forward declaration */
 /* Read and write SPI device */
 static Flash_Err Spi_Write_Read(uint8_t *write_buf, size_t write_size, uint8_t *read_buf, size_t read_size);
+/* Command and data to write in one chip select, the data is sent from where it is */
+static Flash_Err Spi_Cmd_Write(uint8_t *cmd, size_t cmd_size, const uint8_t *data, size_t data_size);
+static Flash_Err Spi_Send(const uint8_t *buf, size_t size);
+static Flash_Err Spi_Recv(uint8_t *buf, size_t size);
+#if MEM_SPIFLASH_DMA
+static void Dma_Init(void);
+static bool Dma_Usable(size_t size);
+static Flash_Err Dma_Xfer(uint8_t *buf, size_t size, bool recv);
+static void Dma_Done(SPI_HandleTypeDef *hspi, bool err);
+#endif
 #ifdef USING_SFDP
 /* SFDP */
 static Flash_Err read_sfdp_data(uint32_t addr, uint8_t *read_buf, size_t size);
@@ -64,9 +81,18 @@ static Flash_Err Aai_Write(uint32_t addr, size_t size, const uint8_t *data);
 Flash_Err Spi_Flash_Write_Status(bool is_volatile, uint8_t status);
 
 /* Local variables */
-static Flash_Spi spi = {.spix = NULL, .cs_gpiox = NULL, .cs_gpio_pin = NULL};
+static Flash_Spi spi = {.spix = NULL, .cs_gpiox = NULL, .cs_gpio_pin = 0};
 static Flash_t flash;
 static Bool_t s_bConfig = FALSE;
+static Flash_Stat stat;
+#if MEM_SPIFLASH_DMA
+static DMA_HandleTypeDef s_hDmaRx;
+static DMA_HandleTypeDef s_hDmaTx;
+static osSemaphoreId s_xDmaSem = NULL;
+static volatile bool s_bDmaErr = false;
+static bool s_bDma = true;              /* DMA, FAST_READ and yielding, off is the polled driver */
+static uint32_t s_ulBlockCyc = 0;       /* DWT cycles blocked in DMA waits and busy waits */
+#endif
 
 /* Functions */
 Flash_Err Spi_Flash_Init()
@@ -164,9 +190,26 @@ Flash_Err Spi_Flash_Config(SPI_HandleTypeDef *pSpi, GPIO_TypeDef *pCsPinPort, ui
     spi.cs_gpiox = pCsPinPort;
     spi.cs_gpio_pin = nCsPin;
     s_bConfig = TRUE;
+#if MEM_SPIFLASH_DMA
+    Dma_Init();
+#endif
     return FLASH_SUCCESS;
 }
 
+#if MEM_SPIFLASH_DMA
+/* Switch DMA, FAST_READ and the yielding busy wait, for a before and after comparison */
+void Spi_Flash_Set_Dma(bool enabled)
+{
+    s_bDma = enabled;
+}
+
+/* DWT cycles the callers spent blocked, the CPU was free for other tasks meanwhile */
+uint32_t Spi_Flash_Get_Block_Cyc(void)
+{
+    return s_ulBlockCyc;
+}
+#endif
+
 /* Read the status register */
 Flash_Err Spi_Flash_Read_Status(uint8_t *status)
 {
@@ -208,7 +251,7 @@ Flash_Err Spi_Flash_Write_Status(bool is_volatile, uint8_t status)
 Flash_Err Spi_Flash_Read(uint32_t addr, size_t size, uint8_t *data)
 {
     Flash_Err result;
-    uint8_t cmd_data[5], cmd_size;
+    uint8_t cmd_data[6], cmd_size;
 
     /* Check the validity of the parameter */
     assert_param(data);
@@ -230,6 +273,14 @@ Flash_Err Spi_Flash_Read(uint32_t addr, size_t size, uint8_t *data)
     cmd_data[0] = CMD_READ_DATA;
     Make_Adress_Byte_Array(addr, &cmd_data[1]);
     cmd_size = flash.addr_in_4_byte ? 5 : 4;
+#if MEM_SPIFLASH_DMA
+    /* Bulk reads go by FAST_READ, the dummy byte is sent as part of the command */
+    if(Dma_Usable(size))
+    {
+        cmd_data[0] = CMD_FAST_READ;
+        cmd_data[cmd_size++] = DUMMY_DATA;
+    }
+#endif
     result = Spi_Write_Read(cmd_data, cmd_size, data, size);
 
     return result;
@@ -238,7 +289,7 @@ Flash_Err Spi_Flash_Read(uint32_t addr, size_t size, uint8_t *data)
 /* Write flash data */
 Flash_Err Spi_Flash_Write(uint32_t addr, size_t size, const uint8_t *data)
 {
-    Flash_Err result;
+    Flash_Err result = FLASH_ERR_WRITE;
 
     /* Page programming mode */
     if(flash.chip.write_mode & WM_PAGE_256B) 
@@ -246,9 +297,12 @@ Flash_Err Spi_Flash_Write(uint32_t addr, size_t size, const uint8_t *data)
     /* self growth model */
     else if(flash.chip.write_mode & WM_AAI) 
         result = Aai_Write(addr, size, data);
-    /* Double buffer mode */
-    else if(flash.chip.write_mode & WM_DUAL_BUFFER);
+    /* Double buffer mode, not supported */
+    else if(flash.chip.write_mode & WM_DUAL_BUFFER)
+        result = FLASH_ERR_WRITE;
     
+    if(result == FLASH_SUCCESS)
+        stat.prog_bytes += size;
     TRACE("Spi_Flash_Write\r\n");
     return result;
 }
@@ -278,7 +332,10 @@ Flash_Err Spi_Flash_Chip_Erase(void)
     else
         result = Spi_Write_Read(cmd_data, 1, NULL, 0);
     if(result == FLASH_SUCCESS) 
+    {
         result = Wait_Busy();
+        stat.erase_cnt += flash.chip.capacity / flash.chip.erase_gran;
+    }
     else
         TRACE("Error: Flash chip erase SPI communicate error.");
 
@@ -347,6 +404,7 @@ Flash_Err Spi_Flash_Erase(uint32_t addr, size_t size)
         result = Wait_Busy();
         if(result != FLASH_SUCCESS) 
             break;
+        stat.erase_cnt++;
         
         /* Align the next erase address and calculate the erase size */
         if(addr % cur_erase_size != 0) 
@@ -376,18 +434,97 @@ Flash_Err Spi_Flash_Erase(uint32_t addr, size_t size)
     return result;
 }
 
-/* Erasure before writing data */
+/* 
+ * Erasure before writing data, sector by sector and only where needed: a sector
+ * already holding the data is left alone, one that only needs bits cleared is
+ * programmed over the changed bytes, the rest are erased and written. The bytes
+ * of an erased sector outside the range are lost as before, the others are kept.
+ */
 Flash_Err Spi_Flash_Erase_Write(uint32_t addr, size_t size, const uint8_t *data)
 {
-    Flash_Err result;
+    Flash_Err result = FLASH_SUCCESS;
+    uint8_t old[64];
+    size_t seg_size, chunk, i, first, last;
+    bool differ, need_erase;
 
-    result = Spi_Flash_Erase(addr, size);
-    if(result == FLASH_SUCCESS) 
-        result = Spi_Flash_Write(addr, size, data);
+    assert_param(flash->init_ok);
+
+    if(addr + size > flash.chip.capacity) 
+    {
+        TRACE("Error: Flash address is out of bound.");
+        return FLASH_ERR_ADDR_OUT_OF_BOUND;
+    }
+
+    while(size)
+    {
+        /* Up to the end of this sector */
+        seg_size = flash.chip.erase_gran - (addr % flash.chip.erase_gran);
+        if(seg_size > size)
+            seg_size = size;
+
+        /* Compare, a 0 to 1 anywhere needs the erase */
+        differ = false;
+        need_erase = false;
+        first = 0;
+        last = 0;
+        for(i = 0; i < seg_size && !need_erase; i += chunk)
+        {
+            chunk = (seg_size - i > sizeof(old)) ? sizeof(old) : (seg_size - i);
+            result = Spi_Flash_Read(addr + i, chunk, old);
+            if(result != FLASH_SUCCESS)
+                return result;
+            for(size_t n = 0; n < chunk; n++)
+            {
+                if(old[n] == data[i + n])
+                    continue;
+                if((old[n] & data[i + n]) != data[i + n])
+                {
+                    need_erase = true;
+                    break;
+                }
+                if(!differ)
+                    first = i + n;
+                last = i + n;
+                differ = true;
+            }
+        }
+
+        if(need_erase)
+        {
+            result = Spi_Flash_Erase(addr, seg_size);
+            if(result == FLASH_SUCCESS) 
+                result = Spi_Flash_Write(addr, seg_size, data);
+        }
+        else
+        {
+            stat.erase_skip_cnt++;
+            if(differ)
+            {
+                result = Spi_Flash_Write(addr + first, last - first + 1, data + first);
+                stat.skip_bytes += seg_size - (last - first + 1);
+            }
+            else
+                stat.skip_bytes += seg_size;
+        }
+        if(result != FLASH_SUCCESS)
+            break;
+
+        addr += seg_size;
+        data += seg_size;
+        size -= seg_size;
+    }
     TRACE("Spi_Flash_Erase_Write\r\n");
     return result;
 }
 
+Flash_Err Spi_Flash_Get_Stat(Flash_Stat *s)
+{
+    assert_param(s);
+
+    *s = stat;
+    return FLASH_SUCCESS;
+}
+
 static Flash_Err Read_Jedec_Id(void)
 {
     Flash_Err result;
@@ -424,7 +561,17 @@ static Flash_Err Wait_Busy(void)
         if(result == FLASH_SUCCESS && (status & STATUS_REGISTER_BUSY) == 0)
             break;
 
-        HAL_Delay(1);
+#if MEM_SPIFLASH_DMA
+        /* Sleep the tick out, a spin would hold lower priority tasks off for the whole program or erase */
+        if(s_bDma && (osKernelRunning() == 1))
+        {
+            uint32_t cyc = DWT->CYCCNT;
+            osDelay(1);
+            s_ulBlockCyc += DWT->CYCCNT - cyc;
+        }
+        else
+#endif
+            HAL_Delay(1);
     }while(--retry_times);
     
 
@@ -479,7 +626,7 @@ static Flash_Err Set_Write_Enabled(bool enabled)
         TRACE("Error: enable write status.\r\n");
         return FLASH_ERR_WRITE;
     } 
-    else if(!enabled && (register_status & STATUS_REGISTER_WEL) == 1) 
+    else if(!enabled && (register_status & STATUS_REGISTER_WEL) != 0) 
     {
         TRACE("Error: disable write status.\r\n");
         return FLASH_ERR_WRITE;
@@ -531,7 +678,7 @@ static Status_t Make_Adress_Byte_Array(uint32_t addr, uint8_t *array)
 static Flash_Err Page256_or_1_Byte_Write(uint32_t addr, size_t size, uint16_t write_gran, const uint8_t *data)
 {
     Flash_Err result;
-    uint8_t cmd_data[5 + WRITE_MAX_PAGE_SIZE], cmd_size;
+    uint8_t cmd_data[5], cmd_size;
     size_t data_size;
 
     assert_param(write_gran == 1 || write_gran == 256);
@@ -568,8 +715,7 @@ static Flash_Err Page256_or_1_Byte_Write(uint32_t addr, size_t size, uint16_t wr
         }
         size -= data_size;
         addr += data_size;
-        memcpy(&cmd_data[cmd_size], data, data_size);
-        result = Spi_Write_Read(cmd_data, cmd_size + data_size, NULL, 0);
+        result = Spi_Cmd_Write(cmd_data, cmd_size, data, data_size);
         if(result != FLASH_SUCCESS) 
         {
             TRACE("Error: Flash write SPI communicate error.");
@@ -967,7 +1113,7 @@ static size_t flash_sfdp_get_suitable_eraser(uint32_t addr, size_t erase_size)
 /* Read-write SPI equipment */
 static Flash_Err Spi_Write_Read(uint8_t *write_buf, size_t write_size, uint8_t *read_buf, size_t read_size)
 {
-    HAL_StatusTypeDef status;
+    Flash_Err result = FLASH_SUCCESS;
 
     /* Determine the validity of parameters */
     if((write_size != 0 && write_buf == NULL) ||
@@ -978,28 +1124,178 @@ static Flash_Err Spi_Write_Read(uint8_t *write_buf, size_t write_size, uint8_t *
     HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_RESET);
     
     if(write_size != 0)
+        result = Spi_Send(write_buf, write_size);
+
+    if(result == FLASH_SUCCESS && read_size != 0)
+        result = Spi_Recv(read_buf, read_size);
+    
+    HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_SET);
+    
+    return result;
+}
+
+static Flash_Err Spi_Cmd_Write(uint8_t *cmd, size_t cmd_size, const uint8_t *data, size_t data_size)
+{
+    Flash_Err result;
+
+    assert_param(cmd && data);
+
+    HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_RESET);
+    
+    result = Spi_Send(cmd, cmd_size);
+    if(result == FLASH_SUCCESS && data_size != 0)
+        result = Spi_Send(data, data_size);
+    
+    HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_SET);
+    
+    return result;
+}
+
+static Flash_Err Spi_Send(const uint8_t *buf, size_t size)
+{
+#if MEM_SPIFLASH_DMA
+    if(Dma_Usable(size))
+        return Dma_Xfer((uint8_t *)buf, size, false);
+#endif
+    if(HAL_SPI_Transmit(spi.spix, (uint8_t *)buf, size, 1000) != HAL_OK)
+        return FLASH_ERR_TIMEOUT;
+    return FLASH_SUCCESS;
+}
+
+static Flash_Err Spi_Recv(uint8_t *buf, size_t size)
+{
+#if MEM_SPIFLASH_DMA
+    if(Dma_Usable(size))
+        return Dma_Xfer(buf, size, true);
+#endif
+    if(HAL_SPI_Receive(spi.spix, buf, size, 1000) != HAL_OK)
+        return FLASH_ERR_TIMEOUT;
+    return FLASH_SUCCESS;
+}
+
+#if MEM_SPIFLASH_DMA
+static void Dma_Init(void)
+{
+    osSemaphoreDef(SpiFlashDmaSem);
+
+    __HAL_RCC_DMA2_CLK_ENABLE();
+    s_hDmaRx.Instance                 = MEM_SPIFLASH_DMA_RX_CHAN;
+    s_hDmaRx.Init.Direction           = DMA_PERIPH_TO_MEMORY;
+    s_hDmaRx.Init.PeriphInc           = DMA_PINC_DISABLE;
+    s_hDmaRx.Init.MemInc              = DMA_MINC_ENABLE;
+    s_hDmaRx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    s_hDmaRx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    s_hDmaRx.Init.Mode                = DMA_NORMAL;
+    s_hDmaRx.Init.Priority            = DMA_PRIORITY_HIGH;
+    if(HAL_DMA_Init(&s_hDmaRx) != HAL_OK)
+        ASSERT(0);  /* We should never get here! */
+    __HAL_LINKDMA(spi.spix, hdmarx, s_hDmaRx);
+
+    s_hDmaTx.Instance                 = MEM_SPIFLASH_DMA_TX_CHAN;
+    s_hDmaTx.Init.Direction           = DMA_MEMORY_TO_PERIPH;
+    s_hDmaTx.Init.PeriphInc           = DMA_PINC_DISABLE;
+    s_hDmaTx.Init.MemInc              = DMA_MINC_ENABLE;
+    s_hDmaTx.Init.PeriphDataAlignment = DMA_PDATAALIGN_BYTE;
+    s_hDmaTx.Init.MemDataAlignment    = DMA_MDATAALIGN_BYTE;
+    s_hDmaTx.Init.Mode                = DMA_NORMAL;
+    s_hDmaTx.Init.Priority            = DMA_PRIORITY_HIGH;
+    if(HAL_DMA_Init(&s_hDmaTx) != HAL_OK)
+        ASSERT(0);  /* We should never get here! */
+    __HAL_LINKDMA(spi.spix, hdmatx, s_hDmaTx);
+
+    /* Completion gives the semaphore, so the priority must be FreeRTOS managed */
+    HAL_NVIC_SetPriority(MEM_SPIFLASH_DMA_RX_ISR, 5, 0);
+    HAL_NVIC_EnableIRQ(MEM_SPIFLASH_DMA_RX_ISR);
+    HAL_NVIC_SetPriority(MEM_SPIFLASH_DMA_TX_ISR, 5, 0);
+    HAL_NVIC_EnableIRQ(MEM_SPIFLASH_DMA_TX_ISR);
+
+    if(s_xDmaSem == NULL)
     {
-        status = HAL_SPI_Transmit(spi.spix, write_buf, write_size, 1000);
-        if(status != HAL_OK)
-        {
-            HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_SET);
-            return FLASH_ERR_TIMEOUT;
-        }
+        s_xDmaSem = osSemaphoreCreate(osSemaphore(SpiFlashDmaSem), 1);
+        /* A binary semaphore is created given, the first wait must block */
+        osSemaphoreWait(s_xDmaSem, 0);
     }
+}
 
-    if(read_size != 0)
+/* Only worth it for a run longer than the setup and the task switch, and only once tasks run */
+static bool Dma_Usable(size_t size)
+{
+    return s_bDma && (size >= MEM_SPIFLASH_DMA_MIN) && (s_xDmaSem != NULL) && (osKernelRunning() == 1);
+}
+
+static Flash_Err Dma_Xfer(uint8_t *buf, size_t size, bool recv)
+{
+    HAL_StatusTypeDef status;
+    uint16_t len;
+    uint32_t cyc;
+
+    while(size)
     {
-        status = HAL_SPI_Receive(spi.spix, read_buf, read_size, 1000);
+        len = (size > 0xFFFF) ? 0xFFFF : size;
+        s_bDmaErr = false;
+        /* A 2 line master receive clocks the buffer itself out, the chip ignores it */
+        if(recv)
+            status = HAL_SPI_Receive_DMA(spi.spix, buf, len);
+        else
+            status = HAL_SPI_Transmit_DMA(spi.spix, buf, len);
         if(status != HAL_OK)
+            return FLASH_ERR_TIMEOUT;
+
+        cyc = DWT->CYCCNT;
+        if(osSemaphoreWait(s_xDmaSem, 1000) != osOK)
         {
-            HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_SET);
-            return FLASH_ERR_TIMEOUT;       
+            HAL_SPI_DMAStop(spi.spix);
+            TRACE("Error: Flash DMA timeout.\r\n");
+            return FLASH_ERR_TIMEOUT;
         }
+        s_ulBlockCyc += DWT->CYCCNT - cyc;
+        if(s_bDmaErr)
+            return recv ? FLASH_ERR_READ : FLASH_ERR_WRITE;
+
+        buf += len;
+        size -= len;
     }
-    
-    HAL_GPIO_WritePin(spi.cs_gpiox, spi.cs_gpio_pin, GPIO_PIN_SET);
-    
-    return FLASH_SUCCESS;   
+    return FLASH_SUCCESS;
+}
+
+static void Dma_Done(SPI_HandleTypeDef *hspi, bool err)
+{
+    if(hspi != spi.spix)
+        return;
+    s_bDmaErr = err;
+    osSemaphoreRelease(s_xDmaSem);
+}
+
+void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Dma_Done(hspi, false);
+}
+
+/* A 2 line master receive runs as TransmitReceive but still completes here */
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Dma_Done(hspi, false);
+}
+
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    Dma_Done(hspi, false);
+}
+
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    Dma_Done(hspi, true);
+}
+
+void MEM_SPIFLASH_DMA_RX_ISR_HANDLER(void)
+{
+    HAL_DMA_IRQHandler(&s_hDmaRx);
+}
+
+void MEM_SPIFLASH_DMA_TX_ISR_HANDLER(void)
+{
+    HAL_DMA_IRQHandler(&s_hDmaTx);
 }
+#endif /* MEM_SPIFLASH_DMA */
 
 #endif /* (MEM_ENABLE && MEM_ENABLE_SPIFLASH) */
@@ -12,6 +12,8 @@
     01a, 20Sep18, David Created
     01b, 06Oct18, Karl Modified
     01c, 24Jul19, Karl Reconstructured Mem lib
+    01d, 19Oct26, Karl Added FAST_READ and the DMA switch
+    01e, 19Oct26, Karl Added Spi_Flash_Get_Stat
 */
 
 #ifndef __MEM_SPI_FLASH_H__
@@ -52,6 +54,7 @@ extern "C" {
 #define CMD_AAI_WORD_PROGRAM            0xAD
 #define CMD_ERASE_CHIP                  0xC7
 #define CMD_READ_DATA                   0x03
+#define CMD_FAST_READ                   0x0B
 #define CMD_MANUFACTURER_DEVICE_ID      0x90
 #define CMD_JEDEC_ID                    0x9F
 #define CMD_READ_UNIQUE_ID              0x4B
@@ -185,6 +188,14 @@ static const Flash_Chip flash_chip_table[] = {
 };
 #endif
 
+/* Wear statistics since boot */
+typedef struct {
+    uint32_t erase_cnt;                 /* Sectors erased */
+    uint32_t erase_skip_cnt;            /* Sector erases the erase write avoided */
+    uint32_t prog_bytes;                /* Bytes programmed */
+    uint32_t skip_bytes;                /* Erase write bytes already in place, not programmed */
+}Flash_Stat;
+
 /* flashṹ */
 typedef struct  {
     Flash_Chip chip;            /* FLASHϢ */
@@ -213,6 +224,13 @@ Flash_Err Spi_Flash_Chip_Erase(void);
 Flash_Err Spi_Flash_Erase(uint32_t addr, size_t size);
 /* Ȳд */
 Flash_Err Spi_Flash_Erase_Write(uint32_t addr, size_t size, const uint8_t *data);
+Flash_Err Spi_Flash_Get_Stat(Flash_Stat *s);
+#if MEM_SPIFLASH_DMA
+/* DMA, FAST_READ and the yielding busy wait on or off */
+void Spi_Flash_Set_Dma(bool enabled);
+/* DWT cycles blocked in the driver, free for other tasks */
+uint32_t Spi_Flash_Get_Block_Cyc(void);
+#endif
 
 #ifdef __cplusplus
 }
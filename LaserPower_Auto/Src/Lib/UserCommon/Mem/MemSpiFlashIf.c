@@ -12,6 +12,8 @@
     01a, 20Sep18, David Created
     01b, 06Oct18, Karl Modified
     01c, 24Jul19, Karl Reconstructured Mem lib
+    01d, 19Oct26, Karl Added MEM_CTRL_OP_SPIFLASH_DMA and MEM_CTRL_OP_SPIFLASH_BLOCK_CYC
+    01e, 19Oct26, Karl Added MEM_CTRL_OP_SPIFLASH_STAT
 */
 
 /* Includes */
@@ -125,6 +127,28 @@ Status_t SpiFlashIfCtrl(MemHandle_t xHandle, MemCtrlOperation_t xCtrlOp, uint32_
     case MEM_CTRL_OP_SPIFLASH_ERASE_CHIP:
         xRet = prvChipErase(xHandle);
         break;
+    case MEM_CTRL_OP_SPIFLASH_STAT:
+    {
+        Flash_Stat xStat;
+        MemSpiFlashStat_t *pxStat = (MemSpiFlashStat_t*)ulExtraPara;
+        Spi_Flash_Get_Stat(&xStat);
+        pxStat->ulEraseCnt     = xStat.erase_cnt;
+        pxStat->ulEraseSkipCnt = xStat.erase_skip_cnt;
+        pxStat->ulProgBytes    = xStat.prog_bytes;
+        pxStat->ulSkipBytes    = xStat.skip_bytes;
+        xRet = STATUS_OK;
+        break;
+    }
+#if MEM_SPIFLASH_DMA
+    case MEM_CTRL_OP_SPIFLASH_DMA:
+        Spi_Flash_Set_Dma(ulExtraPara ? true : false);
+        xRet = STATUS_OK;
+        break;
+    case MEM_CTRL_OP_SPIFLASH_BLOCK_CYC:
+        *(uint32_t*)ulExtraPara = Spi_Flash_Get_Block_Cyc();
+        xRet = STATUS_OK;
+        break;
+#endif /* MEM_SPIFLASH_DMA */
     default:
         xRet = STATUS_ERR;
         break;
@@ -11,6 +11,7 @@
     --------------------
     01a, 22Nov18, Karl Created
     01b, 13Jul19, Karl Reconstructured Prot library
+    01c, 19Oct26, agent Pointer handle, prvGetLength returns 0 for an unknown length type
 */
 
 /* Includes */
@@ -187,7 +188,7 @@ Status_t ProtProc(ProtHandle_t xHandle, IN uint8_t* pucRecvBuf, IN uint16_t usRe
     ProtCtrl_t* pxCtrl = PROT_GET_CTRL(xHandle);
     
     ASSERT(NULL != pxCtrl);
-    TRACE("Enter ProtProc - %08X\n", xHandle);
+    TRACE("Enter ProtProc - %p\n", xHandle);
     if(!pxCtrl->bInit) {
         TRACE("    ProtCtrl_t hasn't been initialised\n");
         return STATUS_ERR;
@@ -283,14 +284,14 @@ Status_t ProtProc(ProtHandle_t xHandle, IN uint8_t* pucRecvBuf, IN uint16_t usRe
     }
     
     *pusRecvIndex = ucRecvIndex;
-    TRACE("Leave ProtProc - %08X\n", xHandle);
+    TRACE("Leave ProtProc - %p\n", xHandle);
     
     return STATUS_OK;
 }
 
 static uint32_t prvGetLength(IN uint8_t* pucBuf, ProtLength_t xLengthType, uint8_t ucLengthOffset)
 {
-    uint32_t ulLength;
+    uint32_t ulLength = 0;
     
     switch(xLengthType) {
         case PROT_LENGTH_UINT8:     ulLength = *(uint8_t*)(pucBuf+ucLengthOffset);     break;
@@ -310,7 +311,7 @@ Status_t ProtShowPara(ProtHandle_t xHandle)
     ProtCtrl_t *pxCtrl = PROT_GET_CTRL(xHandle);
     
     ASSERT(NULL != pxCtrl);
-    TRACE("ProtHandle %08X\n", xHandle);
+    TRACE("ProtHandle %p\n", xHandle);
     
     /********************************************************/
     TRACE("    bInit:             %d\n", pxCtrl->bInit);
@@ -11,6 +11,7 @@
     --------------------
     01a, 22Nov18, Karl Created
     01b, 13Jul19, Karl Reconstructured Prot library
+    01c, 19Oct26, agent ProtHandle_t is a pointer, it holds the control block address
 */
 
 #ifndef __PROT_H__
@@ -26,7 +27,7 @@ extern "C" {
 #include "Prot/ProtConfig.h"
 
 /* Types */
-typedef uint32_t ProtHandle_t;
+typedef void *ProtHandle_t;
 
 /* Packet head length type */
 typedef enum {
@@ -11,6 +11,7 @@
     --------------------
     01a, 20Sep18, David Created
     01b, 13Nov18, Karl Modified
+    01c, 19Oct26, Karl Added RtcDs1338ReadRam and RtcDs1338WriteRam
 */
 
 /* Includes */
@@ -97,7 +98,6 @@ static osMutexId        s_xMutex;
     #define DS1338_LOCK()
     #define DS1338_UNLOCK()
 #endif /* RTC_RTOS */
-#define DS1338_RAM_SIZE             (31)
 
                                     
 /* Functions */
@@ -140,6 +140,32 @@ Status_t RtcDs1338WriteTime(Time_t xTm)
     return STATUS_OK;
 }
 
+Status_t RtcDs1338ReadRam(uint8_t ucOffset, OUT uint8_t *pucData, uint8_t ucLength)
+{
+    Status_t xRet;
+    ASSERT(TRUE == s_bInit);
+    if ((ucOffset + ucLength) > DS1338_RAM_SIZE) {
+        return STATUS_ERR;
+    }
+    DS1338_LOCK();
+    xRet = i2c_read_register(DS1338_ADDR, DS1338_REG_RAM_BEGIN + ucOffset, pucData, ucLength);
+    DS1338_UNLOCK();
+    return xRet;
+}
+
+Status_t RtcDs1338WriteRam(uint8_t ucOffset, IN uint8_t *pucData, uint8_t ucLength)
+{
+    Status_t xRet;
+    ASSERT(TRUE == s_bInit);
+    if ((ucOffset + ucLength) > DS1338_RAM_SIZE) {
+        return STATUS_ERR;
+    }
+    DS1338_LOCK();
+    xRet = i2c_write_register(DS1338_ADDR, DS1338_REG_RAM_BEGIN + ucOffset, pucData, ucLength);
+    DS1338_UNLOCK();
+    return xRet;
+}
+
 #if (RTC_STDC_TIME == 3)
 time_t time(time_t * timer)
 {
@@ -11,6 +11,7 @@
     --------------------
     01a, 20Sep18, David Created
     01b, 13Nov18, Karl Modified
+    01c, 19Oct26, Karl Added RtcDs1338ReadRam and RtcDs1338WriteRam
 */
 
 #ifndef __RTC_DS1338_H__
@@ -66,6 +67,9 @@ These options control the behavior of the SQW/(!INTB) pin.
 // Occurs when the number of I2C bytes available is less than the number requested.
 #define READ_ERROR 5
 
+// Battery backed RAM, registers 0x08 to 0x3F
+#define DS1338_RAM_SIZE         (56)
+
 #define decode_bcd(x) ((x >> 4) * 10 + (x & 0x0F))
 #define encode_bcd(x) ((((x / 10) & 0x0F) << 4) + (x % 10))
 
@@ -74,6 +78,9 @@ These options control the behavior of the SQW/(!INTB) pin.
 Time_t RtcDs1338ReadTime(void);
 Status_t RtcDs1338WriteTime(Time_t xTm);
 Status_t RtcDs1338Init(void);
+/* Battery backed RAM, ucOffset 0 to DS1338_RAM_SIZE - 1 */
+Status_t RtcDs1338ReadRam(uint8_t ucOffset, OUT uint8_t *pucData, uint8_t ucLength);
+Status_t RtcDs1338WriteRam(uint8_t ucOffset, IN uint8_t *pucData, uint8_t ucLength);
 
 
 #if (RTC_STDC_TIME == 2)
@@ -14,6 +14,7 @@
     01c, 14Jul19, Karl Reconstructured Uart lib
     01d, 28Aug19, Karl Added UartIsrCb support for Uart isr without DMA
     01e, 03Dec19, Karl Added UartConfigComEx
+    01f, 19Oct26, agent Pointer handle
 */
 
 /* Includes */
@@ -495,7 +496,7 @@ Status_t UartShowStatus(UartHandle_t xHandle) {
     UartCtrl_t *pxCtrl = UART_GET_CTRL(xHandle);
 
     ASSERT(NULL != pxCtrl);
-    TRACE("Uart handle: %08X\n", xHandle);
+    TRACE("Uart handle: %p\n", xHandle);
     TRACE("    hUart               : %08X\n", pxCtrl->hUart);
     TRACE("    hDmaRx              : %08X\n", pxCtrl->hDmaRx);
     TRACE("    hDmaTx              : %08X\n", pxCtrl->hDmaTx);
@@ -14,6 +14,7 @@
     01c, 14Jul19, Karl Reconstructured Uart lib
     01d, 28Aug19, Karl Added UartIsrCb support for Uart isr without DMA
     01e, 03Dec19, Karl Added UartConfigComEx
+    01f, 19Oct26, agent UartHandle_t is a pointer, it holds the control block address
 */
 
 #ifndef __UART_H__
@@ -30,7 +31,7 @@ extern "C" {
 #include "Uart/UartConfig.h"
 
 /* Types */
-typedef uint32_t UartHandle_t;
+typedef void *UartHandle_t;
 
 typedef struct {
   uint32_t ulWordLength;
@@ -0,0 +1,167 @@
+# -*- coding: UTF8 -*-
+
+#
+#   BootStream.py
+#
+#   Sends an application image to the UART bootloader in its streaming mode,
+#   the protocol is described at BOOT_UART_STREAM in User/BootUart.c. The board
+#   must be in the bootloader, sending 'C', e.g. after the Upgrade command of
+#   UartBootTool/Config.ini, which --upgrade sends first.
+#
+#   python BootStream.py --port COM5 --upgrade 7E7E0E050001CDAB341201190A0D App.bin
+#
+
+import argparse
+import struct
+import sys
+import time
+import serial
+
+SYN = 0x16
+STX = 0x02
+ACK = 0x06
+NAK = 0x15
+CAN = 0x18
+CRC = 0x43
+
+BLOCK = 1024
+REPLY_TIMEOUT = 2.0     # s, a block is sent again after this without a reply
+RETRY_MAX = 10
+
+def Crc16(datas):
+    # CRC-16/XMODEM
+    crc = 0
+    for d in datas:
+        crc ^= d << 8
+        for n in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+        crc &= 0xFFFF
+    return crc
+
+def Crc32Mpeg2(datas):
+    # As the STM32 CRC unit over little endian words, padded with 0xFF
+    datas = datas + b"\xFF" * ((4 - len(datas) % 4) % 4)
+    crc = 0xFFFFFFFF
+    for (word,) in struct.iter_unpack("<I", datas):
+        crc ^= word
+        for n in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) if (crc & 0x80000000) else (crc << 1)
+        crc &= 0xFFFFFFFF
+    return crc
+
+def ComOpen(comName, baudRate):
+    comPort = serial.Serial(comName)
+    comPort.baudrate = baudRate
+    comPort.parity = serial.PARITY_NONE
+    comPort.stopbits = serial.STOPBITS_ONE
+    comPort.bytesize = serial.EIGHTBITS
+    comPort.timeout = 0.1
+    return comPort
+
+def WaitByte(comPort, wants, timeout):
+    end = time.time() + timeout
+    while time.time() < end:
+        data = comPort.read(1)
+        if data and data[0] in wants:
+            return data[0]
+    return None
+
+def ReadReply(comPort, timeout):
+    # ACK or NAK and the block expected next, or a lone CAN
+    end = time.time() + timeout
+    while time.time() < end:
+        data = comPort.read(1)
+        if not data:
+            continue
+        if data[0] == CAN:
+            return (CAN, 0)
+        if data[0] in (ACK, NAK):
+            rest = comPort.read(2)
+            if len(rest) == 2:
+                return (data[0], rest[0] | (rest[1] << 8))
+    return (None, 0)
+
+def Frame(image, block):
+    datas = image[block * BLOCK:(block + 1) * BLOCK]
+    datas = datas + b"\xFF" * (BLOCK - len(datas))
+    body = struct.pack("<H", block & 0xFFFF) + datas
+    return bytes([STX]) + body + struct.pack(">H", Crc16(body))
+
+def Send(comPort, image, streamBaud, window):
+    blocks = (len(image) + BLOCK - 1) // BLOCK
+
+    # The request in place of the YMODEM header, on a 'C'
+    if WaitByte(comPort, (CRC,), 30) is None:
+        print("Error: no 'C' from the bootloader")
+        return False
+    req = struct.pack("<III", streamBaud, len(image), Crc32Mpeg2(image))
+    comPort.reset_input_buffer()
+    comPort.write(bytes([SYN]) + req + struct.pack(">H", Crc16(req)))
+    reply = WaitByte(comPort, (ACK, NAK), 2)
+    if reply != ACK:
+        print("Error: streaming refused, use UartBootTool")
+        return False
+    comPort.baudrate = streamBaud
+    time.sleep(0.01)
+
+    start = time.time()
+    acked = 0
+    sent = 0
+    retry = 0
+    while acked < blocks:
+        while (sent < blocks) and (sent - acked < window):
+            comPort.write(Frame(image, sent))
+            sent += 1
+        (reply, expect) = ReadReply(comPort, REPLY_TIMEOUT)
+        if reply == CAN:
+            print("Error: aborted by the bootloader at block %d" % acked)
+            return False
+        if reply is None:
+            retry += 1
+            if retry > RETRY_MAX:
+                print("Error: no reply at block %d" % acked)
+                return False
+            sent = acked
+            continue
+        # Block numbers are 16 bits, the nearest to the last known
+        expect = acked + ((expect - acked) & 0xFFFF)
+        if reply == ACK:
+            acked = expect
+            retry = 0
+        else:
+            acked = expect
+            sent = expect
+        print("\r%d / %d blocks" % (acked, blocks), end="")
+    print("")
+
+    # The bootloader reads the image back from its flash
+    reply = WaitByte(comPort, (ACK, CAN), 10)
+    if reply != ACK:
+        print("Error: image CRC does not match")
+        return False
+    spend = time.time() - start
+    print("%d bytes in %.2f s, %.1f KB/s" % (len(image), spend, len(image) / 1024 / spend))
+    return True
+
+def Main():
+    parser = argparse.ArgumentParser(description="UART bootloader streaming sender")
+    parser.add_argument("--port", required=True)
+    parser.add_argument("--baud", type=int, default=115200, help="bootloader baud")
+    parser.add_argument("--stream-baud", type=int, default=921600)
+    parser.add_argument("--window", type=int, default=2, help="BOOT_UART_STREAM_WINDOW of the bootloader")
+    parser.add_argument("--upgrade", default="", help="command in hex sent first, see UartBootTool/Config.ini")
+    parser.add_argument("--upgrade-delay", type=int, default=500, help="ms after the command")
+    parser.add_argument("image")
+    args = parser.parse_args()
+
+    image = open(args.image, "rb").read()
+    comPort = ComOpen(args.port, args.baud)
+    if args.upgrade:
+        comPort.write(bytes.fromhex(args.upgrade))
+        time.sleep(args.upgrade_delay / 1000)
+    ok = Send(comPort, image, args.stream_baud, args.window)
+    comPort.close()
+    return 0 if ok else 1
+
+if __name__ == "__main__":
+    sys.exit(Main())
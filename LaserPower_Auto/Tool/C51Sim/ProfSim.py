@@ -0,0 +1,178 @@
+# -*- coding: UTF8 -*-
+
+#
+#   ProfSim.py
+#
+#   Builds the STC node (Src/App/10-0512-001-V0.1_C51_Application) with SDCC and
+#   runs it on the ucsim 8051 simulator (s51) to count the cycles of the main loop
+#   hot paths: the AdcProc filter pass, BuildTempInfo (all SendTempInfo does
+#   besides the transfer) and UartProc for one request.
+#
+#   The sources are Keil C51. They are copied to Out/<rev>/ and the Keil only
+#   syntax (sfr, sbit, interrupt, intrins.h) is rewritten on the way, the files
+#   built are those of the Keil project. ucsim has no ADC and no second UART, so
+#   at the top of every main loop pass the script does what their isrs would: it
+#   raises g_bAdBlk and puts a sync sample request in the request ring. The
+#   request asks no slot of this node, UartProc runs BuildSyncTemp and nothing
+#   waits for the line.
+#
+#   Spans are taken from the simulator clock between breakpoints on the main
+#   loop calls, not from PROF: ucsim runs Timer0 as a plain 8052 (13 bit mode 0,
+#   no 1T clock), which PROF's tick arithmetic does not hold for. The numbers
+#   are clocks of the 12T core ucsim models, compare revisions with each other,
+#   not with the part.
+#
+#   python ProfSim.py                   # working tree
+#   python ProfSim.py f413232^ f413232  # before/after, any revisions with the request ring
+#
+#   Results, f413232^ against f413232: none yet. The machine the script was
+#   written on has no SDCC or ucsim and no network to get them, the run stops at
+#   "sdcc not found". The clock counts go here and in the commit of that run.
+#
+
+import argparse
+import os
+import re
+import shutil
+import statistics
+import subprocess
+import sys
+
+TOOL = os.path.dirname(os.path.abspath(__file__))
+ROOT = os.path.normpath(os.path.join(TOOL, "..", ".."))
+NODE = "Src/App/10-0512-001-V0.1_C51_Application"
+PRJ = os.path.join(ROOT, "Prj", "C51_Application", "C51_Application.uvproj")
+OUT = os.path.join(TOOL, "Out")
+
+FOSC = 22118400
+PASSES = 200
+# Sync sample, seq 0x5A, slot 4 ms, alarm window 8 + 2 ms, no node asked
+REQ = [0x7E, 0x7E, 0x11, 0x04, 0x00, 0xFF, 0x5A, 0x04, 0x08, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x0D]
+REQ_NUM = 4         # COM_REQ_NUM
+REQ_SIZE = 17       # COM_RX_SIZE
+
+def FrameSum(frame):
+    frame[-3] = 0
+    frame[-3] = (0xFF - sum(frame)) & 0xFF
+    return frame
+
+def Export(rev, dst):
+    # Node sources of a revision, or of the working tree
+    if os.path.isdir(dst):
+        shutil.rmtree(dst)
+    if rev is None:
+        shutil.copytree(os.path.join(ROOT, NODE), dst)
+        return
+    os.makedirs(dst)
+    tar = subprocess.check_output(["git", "archive", rev, NODE], cwd=ROOT)
+    subprocess.run(["tar", "-x", "--strip-components", str(NODE.count("/") + 1), "-C", dst], input=tar, check=True)
+
+def KeilToSdcc(path):
+    with open(path, encoding="latin-1", newline="") as f:
+        text = f.read()
+    # sfr P0 = 0x80;  ->  __sfr __at(0x80) P0;
+    sfrs = {}
+    def Sfr(m):
+        sfrs[m.group(1)] = int(m.group(2), 16)
+        return "__sfr __at(%s) %s;" % (m.group(2), m.group(1))
+    text = re.sub(r"^\s*sfr\s+(\w+)\s*=\s*(0x[0-9A-Fa-f]+)\s*;", Sfr, text, flags=re.M)
+    # sbit TF0 = TCON^5;  ->  __sbit __at(0x8D) TF0;
+    def Sbit(m):
+        base = sfrs[m.group(2)] if m.group(2) in sfrs else int(m.group(2), 16)
+        return "__sbit __at(0x%02X) %s;" % (base + int(m.group(3)), m.group(1))
+    text = re.sub(r"^\s*sbit\s+(\w+)\s*=\s*(\w+)\s*\^\s*(\d)\s*;", Sbit, text, flags=re.M)
+    text = re.sub(r"\)\s*interrupt\s+(\w+)", r") __interrupt(\1)", text)
+    text = text.replace("#include <intrins.h>", "#define _nop_() __asm nop __endasm")
+    with open(path, "w", encoding="latin-1", newline="") as f:
+        f.write(text)
+
+def Build(src):
+    files = [p.replace("\\", "/").split(NODE.split("/")[-1] + "/")[-1]
+             for p in re.findall(r"<FilePath>([^<]*\.c)</FilePath>", open(PRJ).read())]
+    for root, dirs, names in os.walk(src):
+        for name in names:
+            if name.endswith((".c", ".h", ".H")):
+                KeilToSdcc(os.path.join(root, name))
+    # Keil includes STC8H.H on a case blind file system
+    shutil.copy(os.path.join(src, "Drv", "STC8H.h"), os.path.join(src, "Drv", "STC8H.H"))
+    flags = ["-mmcs51", "--model-large", "--std-c99", "--debug", "-DPROF=0",
+             "-Ddata=__data", "-Didata=__idata", "-Dxdata=__xdata", "-Dcode=__code",
+             "-I" + src, "-I" + os.path.join(src, "Drv")]
+    rels = []
+    for name in files:
+        rel = os.path.join(src, os.path.splitext(os.path.basename(name))[0] + ".rel")
+        subprocess.run(["sdcc"] + flags + ["-c", "-o", rel, os.path.join(src, name)], check=True)
+        rels.append(rel)
+    # main.rel first, it holds main and the interrupt vectors come with it
+    rels.sort(key=lambda r: os.path.basename(r) != "main.rel")
+    ihx = os.path.join(src, "node.ihx")
+    subprocess.run(["sdcc"] + flags + ["-o", ihx] + rels, check=True)
+    return ihx, os.path.join(src, "node.cdb")
+
+def Symbols(cdb):
+    # L:G$name$0_0$0:ADDR for globals, L:Fmain$name$... for file statics, functions alike. The
+    # S: record of a variable tells its address space, a revision may place it differently
+    syms = {}
+    mems = {}
+    for line in open(cdb, encoding="latin-1"):
+        m = re.match(r"L:[GF]\w*\$(\w+)\$[^:]*:([0-9A-Fa-f]+)$", line.strip())
+        if m:
+            syms.setdefault(m.group(1), int(m.group(2), 16))
+        m = re.match(r"S:[GF]\w*\$(\w+)\$.*\),([A-Z]),", line.strip())
+        if m:
+            mems.setdefault(m.group(1), "xram" if m.group(2) in "AF" else "iram")
+    return syms, mems
+
+def Run(ihx, syms, mems):
+    stops = [name for name in ("AdcProc", "BuildTempInfo", "UartProc", "SlotProc") if name in syms]
+    cmds = ["break 0x%04X" % syms[name] for name in stops]
+    wr = 0
+    req = FrameSum(list(REQ))
+    for n in range(PASSES):
+        for name in stops:
+            cmds.append("run")
+            cmds.append("state")
+            if name == "AdcProc":
+                # What the adc isr and the uart isr would have done meanwhile
+                cmds.append("set memory %s 0x%04X 1" % (mems["g_bAdBlk"], syms["g_bAdBlk"]))
+                cmds.append("set memory %s 0x%04X %s" % (mems["s_ucReq"], syms["s_ucReq"] + (wr % REQ_NUM) * REQ_SIZE,
+                                                         " ".join("0x%02X" % b for b in req)))
+                wr = (wr + 1) & 0xFF
+                cmds.append("set memory %s 0x%04X %d" % (mems["s_ucReqWr"], syms["s_ucReqWr"], wr))
+    cmds.append("kill")
+    out = subprocess.run(["s51", "-t", "8052", "-X", str(FOSC), ihx], input="\n".join(cmds) + "\n",
+                         capture_output=True, text=True).stdout
+    clks = [int(c) for c in re.findall(r"\((\d+) clks\)", out)]
+    if len(clks) != PASSES * len(stops):
+        sys.exit("ucsim stopped after %d of %d breakpoints, see its output:\n%s" %
+                 (len(clks), PASSES * len(stops), out[-2000:]))
+    spans = {}
+    for n in range(PASSES):
+        at = dict(zip(stops, clks[n * len(stops):(n + 1) * len(stops)]))
+        adc_end = at.get("BuildTempInfo", at["UartProc"])
+        spans.setdefault("AdcProc filter", []).append(adc_end - at["AdcProc"])
+        if "BuildTempInfo" in at:
+            spans.setdefault("BuildTempInfo", []).append(at["UartProc"] - at["BuildTempInfo"])
+        spans.setdefault("UartProc sync", []).append(at["SlotProc"] - at["UartProc"])
+    # The first pass starts from the first block, the filter takes another branch
+    return {k: v[1:] for k, v in spans.items()}
+
+def main():
+    parser = argparse.ArgumentParser(description="Cycle counts of the STC node hot paths on ucsim")
+    parser.add_argument("revs", nargs="*", help="git revisions, the working tree if none")
+    args = parser.parse_args()
+
+    for tool in ("sdcc", "s51"):
+        if shutil.which(tool) is None:
+            sys.exit("%s not found, install SDCC with ucsim" % tool)
+    for rev in args.revs or [None]:
+        src = os.path.join(OUT, rev.replace("/", "_").replace("~", "-") if rev else "work")
+        Export(rev, src)
+        ihx, cdb = Build(src)
+        spans = Run(ihx, *Symbols(cdb))
+        print("%s:" % (rev or "working tree"))
+        for name, v in spans.items():
+            print("    %-16s %7d min %7d mean %7d max clks" % (name, min(v), statistics.mean(v), max(v)))
+
+if __name__ == "__main__":
+    main()
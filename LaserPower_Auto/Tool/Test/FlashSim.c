@@ -0,0 +1,180 @@
+/*
+    FlashSim.c
+
+    Implementation File for the Host NOR Flash Simulator
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/* Includes */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "Include.h"
+#include "FlashSim.h"
+
+/* Local variables */
+static uint8_t        *s_pucImg   = NULL;
+static uint32_t        s_ulSize   = 0;
+static uint32_t        s_ulCut    = 0;      /* Bytes left before the cut, 0 disarmed */
+static FlashSimStat_t  s_xStat;
+static uint32_t       *s_pulErase = NULL;   /* Per sector */
+
+/* Functions */
+int FlashSimOpen(const char *pcPath, uint32_t ulSize)
+{
+    int   fd;
+    off_t llOld;
+
+    fd = open(pcPath, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    llOld = lseek(fd, 0, SEEK_END);
+    if ((llOld < (off_t)ulSize) && (ftruncate(fd, ulSize) != 0)) {
+        close(fd);
+        return -1;
+    }
+    s_pucImg = mmap(NULL, ulSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (s_pucImg == MAP_FAILED) {
+        s_pucImg = NULL;
+        return -1;
+    }
+    /* A new part comes erased */
+    if (llOld < (off_t)ulSize) {
+        memset(&s_pucImg[llOld], 0xFF, ulSize - llOld);
+    }
+    s_ulSize   = ulSize;
+    s_pulErase = calloc(ulSize / FLASH_SIM_SECTOR, sizeof(uint32_t));
+    FlashSimStatClear();
+    return 0;
+}
+
+void FlashSimClose(void)
+{
+    if (s_pucImg != NULL) {
+        msync(s_pucImg, s_ulSize, MS_SYNC);
+        munmap(s_pucImg, s_ulSize);
+    }
+    free(s_pulErase);
+    s_pucImg   = NULL;
+    s_pulErase = NULL;
+}
+
+uint8_t *FlashSimImage(void)
+{
+    return s_pucImg;
+}
+
+void FlashSimCut(uint32_t ulBytes)
+{
+    s_ulCut = ulBytes;
+}
+
+void FlashSimStat(FlashSimStat_t *pxStat)
+{
+    *pxStat = s_xStat;
+}
+
+void FlashSimStatClear(void)
+{
+    memset(&s_xStat, 0, sizeof(s_xStat));
+    if (s_pulErase != NULL) {
+        memset(s_pulErase, 0, s_ulSize / FLASH_SIM_SECTOR * sizeof(uint32_t));
+    }
+}
+
+/* Counts one unit off the cut, at zero leaves ucPart of the work done and exits */
+static void prvCutChk(uint8_t *pucCell, uint8_t ucWant)
+{
+    if (s_ulCut == 0) {
+        return;
+    }
+    if (--s_ulCut == 0) {
+        /* Some of the bits got there */
+        uint8_t ucMask = rand();
+        *pucCell = (*pucCell & ~ucMask) | (ucWant & ucMask);
+        _exit(0);
+    }
+}
+
+Status_t MemFlashRead(uint32_t ulAddr, uint32_t ulLength, OUT uint8_t *pucData)
+{
+    if ((ulAddr + ulLength) > s_ulSize) {
+        return STATUS_ERR;
+    }
+    memcpy(pucData, &s_pucImg[ulAddr], ulLength);
+    s_xStat.ullReadByte += ulLength;
+    return STATUS_OK;
+}
+
+Status_t MemFlashProgram(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData)
+{
+    if ((ulAddr + ulLength) > s_ulSize) {
+        return STATUS_ERR;
+    }
+    for (uint32_t n = 0; n < ulLength; n++) {
+        prvCutChk(&s_pucImg[ulAddr + n], s_pucImg[ulAddr + n] & pucData[n]);
+        s_pucImg[ulAddr + n] &= pucData[n];
+    }
+    s_xStat.ullProgByte += ulLength;
+    return STATUS_OK;
+}
+
+Status_t MemFlashErase(uint32_t ulAddr, uint32_t ulLength)
+{
+    uint32_t ulEnd = ulAddr + ulLength;
+
+    if (ulEnd > s_ulSize) {
+        return STATUS_ERR;
+    }
+    for (ulAddr &= ~(FLASH_SIM_SECTOR - 1); ulAddr < ulEnd; ulAddr += FLASH_SIM_SECTOR) {
+        /* An erase cut short leaves the sector part way, some cells still programmed */
+        if (s_ulCut == 1) {
+            for (uint32_t n = 0; n < FLASH_SIM_SECTOR; n++) {
+                s_pucImg[ulAddr + n] |= rand();
+            }
+            _exit(0);
+        }
+        prvCutChk(&s_pucImg[ulAddr], 0xFF);
+        memset(&s_pucImg[ulAddr], 0xFF, FLASH_SIM_SECTOR);
+        s_xStat.ullEraseCnt++;
+        if (++s_pulErase[ulAddr / FLASH_SIM_SECTOR] > s_xStat.ullEraseMax) {
+            s_xStat.ullEraseMax = s_pulErase[ulAddr / FLASH_SIM_SECTOR];
+        }
+    }
+    return STATUS_OK;
+}
+
+/* As MemEraseWrite, the sectors touched are read, erased and written back */
+Status_t MemFlashWrite(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData)
+{
+    static uint8_t ucSector[FLASH_SIM_SECTOR];
+    uint32_t ulEnd = ulAddr + ulLength;
+
+    if (ulEnd > s_ulSize) {
+        return STATUS_ERR;
+    }
+    while (ulAddr < ulEnd) {
+        uint32_t ulBase = ulAddr & ~(FLASH_SIM_SECTOR - 1);
+        uint32_t ulOfs  = ulAddr - ulBase;
+        uint32_t ulLen  = ((ulEnd - ulAddr) < (FLASH_SIM_SECTOR - ulOfs)) ? (ulEnd - ulAddr) : (FLASH_SIM_SECTOR - ulOfs);
+        memcpy(ucSector, &s_pucImg[ulBase], FLASH_SIM_SECTOR);
+        memcpy(&ucSector[ulOfs], pucData, ulLen);
+        MemFlashErase(ulBase, FLASH_SIM_SECTOR);
+        MemFlashProgram(ulBase, FLASH_SIM_SECTOR, ucSector);
+        ulAddr  += ulLen;
+        pucData += ulLen;
+    }
+    return STATUS_OK;
+}
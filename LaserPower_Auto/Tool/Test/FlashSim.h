@@ -0,0 +1,54 @@
+/*
+    FlashSim.h
+
+    Head File for the Host NOR Flash Simulator
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __FLASH_SIM_H__
+#define __FLASH_SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define FLASH_SIM_SECTOR    4096
+
+/* Types */
+typedef struct {
+    uint64_t ullReadByte;
+    uint64_t ullProgByte;
+    uint64_t ullEraseCnt;
+    uint64_t ullEraseMax;       /* Of any one sector */
+}FlashSimStat_t;
+
+/*
+    The image is a file mapped shared, so it outlives a forked child cut by
+    FlashSimCut, as the flash outlives a power loss. Programming clears bits
+    only, erasing sets a whole sector to 0xFF, as on the part.
+*/
+int  FlashSimOpen(const char *pcPath, uint32_t ulSize);
+void FlashSimClose(void);
+uint8_t *FlashSimImage(void);
+/* After ulBytes more programmed bytes the next one is left half programmed and
+   the process exits, as a power loss would stop it. 0 disarms. */
+void FlashSimCut(uint32_t ulBytes);
+void FlashSimStat(FlashSimStat_t *pxStat);
+void FlashSimStatClear(void);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __FLASH_SIM_H__ */
@@ -0,0 +1,300 @@
+/*
+    RtosSim.c
+
+    Implementation File for the RTOS Simulator
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Mutexes block, the owner keeps them across its waits
+*/
+
+/* Includes */
+#include <ucontext.h>
+#include "Include.h"
+#include "RtosSim.h"
+
+/* Local defines */
+#define TASK_MAX        4
+#define TASK_STACK      (256 * 1024)
+#define EVT_MAX         65536
+#define WAKE_NEVER      UINT64_MAX
+
+/* Local types */
+typedef struct {
+    uint64_t      ullAt;
+    uint64_t      ullOrder;     /* Same time, first come first served */
+    RtosSimFunc_t pxFunc;
+    void         *pvPara;
+}Evt_t;
+
+typedef struct {
+    ucontext_t    xCtx;
+    void        (*pxFunc)(void *);
+    void         *pvPara;
+    uint64_t      ullWake;
+    Bool_t        bWaitNotify;
+    uint32_t      ulNotify;
+    int          *piMutex;      /* Waited for, the int is the owner task plus one */
+}Task_t;
+
+/* Local variables */
+static uint64_t   s_ullNow = 0;
+static uint64_t   s_ullOrder = 0;
+static Evt_t      s_xEvt[EVT_MAX];     /* Heap on ullAt, ullOrder */
+static uint32_t   s_ulEvtNum = 0;
+static Task_t     s_xTask[TASK_MAX];
+static uint32_t   s_ulTaskNum = 0;
+static Task_t    *s_pxCur = NULL;
+static ucontext_t s_xMain;
+
+/* Functions */
+static Bool_t prvEvtLess(const Evt_t *a, const Evt_t *b)
+{
+    return (a->ullAt < b->ullAt) || ((a->ullAt == b->ullAt) && (a->ullOrder < b->ullOrder));
+}
+
+void RtosSimInit(void)
+{
+    s_ullNow    = 0;
+    s_ullOrder  = 0;
+    s_ulEvtNum  = 0;
+    s_ulTaskNum = 0;
+    s_pxCur     = NULL;
+}
+
+uint64_t RtosSimNow(void)
+{
+    return s_ullNow;
+}
+
+void RtosSimAt(uint64_t ullUs, RtosSimFunc_t pxFunc, void *pvPara)
+{
+    uint32_t n = s_ulEvtNum++;
+
+    if (n >= EVT_MAX) {
+        printf("rtos sim: event queue full\n");
+        exit(1);
+    }
+    s_xEvt[n].ullAt    = (ullUs < s_ullNow) ? s_ullNow : ullUs;
+    s_xEvt[n].ullOrder = s_ullOrder++;
+    s_xEvt[n].pxFunc   = pxFunc;
+    s_xEvt[n].pvPara   = pvPara;
+    while (n && prvEvtLess(&s_xEvt[n], &s_xEvt[(n - 1) / 2])) {
+        Evt_t xTmp = s_xEvt[n];
+        s_xEvt[n] = s_xEvt[(n - 1) / 2];
+        s_xEvt[(n - 1) / 2] = xTmp;
+        n = (n - 1) / 2;
+    }
+}
+
+static Evt_t prvEvtPop(void)
+{
+    Evt_t    xTop = s_xEvt[0];
+    uint32_t n    = 0;
+
+    s_xEvt[0] = s_xEvt[--s_ulEvtNum];
+    while (1) {
+        uint32_t m = n;
+        if (((2 * n + 1) < s_ulEvtNum) && prvEvtLess(&s_xEvt[2 * n + 1], &s_xEvt[m])) {
+            m = 2 * n + 1;
+        }
+        if (((2 * n + 2) < s_ulEvtNum) && prvEvtLess(&s_xEvt[2 * n + 2], &s_xEvt[m])) {
+            m = 2 * n + 2;
+        }
+        if (m == n) {
+            break;
+        }
+        Evt_t xTmp = s_xEvt[n];
+        s_xEvt[n] = s_xEvt[m];
+        s_xEvt[m] = xTmp;
+        n = m;
+    }
+    return xTop;
+}
+
+static Bool_t prvReady(const Task_t *pxTask)
+{
+    return (s_ullNow >= pxTask->ullWake) || (pxTask->bWaitNotify && pxTask->ulNotify) ||
+           ((pxTask->piMutex != NULL) && (*pxTask->piMutex == 0));
+}
+
+static void prvBlock(uint64_t ullWake, Bool_t bWaitNotify)
+{
+    Task_t *pxTask = s_pxCur;
+
+    pxTask->ullWake     = ullWake;
+    pxTask->bWaitNotify = bWaitNotify;
+    swapcontext(&pxTask->xCtx, &s_xMain);
+}
+
+/* The tick interrupt comes every ms, a wait of n ticks ends at the n-th one */
+static uint64_t prvTicksLater(uint32_t ulTicks)
+{
+    return (ulTicks == portMAX_DELAY) ? WAKE_NEVER : ((s_ullNow / 1000 + ulTicks) * 1000);
+}
+
+void RtosSimRun(uint64_t ullUs)
+{
+    while (1) {
+        Bool_t   bRan  = FALSE;
+        uint64_t ullNext = WAKE_NEVER;
+
+        for (uint32_t n = 0; n < s_ulTaskNum; n++) {
+            if (prvReady(&s_xTask[n])) {
+                s_pxCur = &s_xTask[n];
+                swapcontext(&s_xMain, &s_xTask[n].xCtx);
+                s_pxCur = NULL;
+                bRan = TRUE;
+            }
+        }
+        if (bRan) {
+            continue;
+        }
+
+        for (uint32_t n = 0; n < s_ulTaskNum; n++) {
+            if (s_xTask[n].ullWake < ullNext) {
+                ullNext = s_xTask[n].ullWake;
+            }
+        }
+        if (s_ulEvtNum && (s_xEvt[0].ullAt < ullNext)) {
+            ullNext = s_xEvt[0].ullAt;
+        }
+        if (ullNext > ullUs) {
+            s_ullNow = ullUs;
+            return;
+        }
+        s_ullNow = ullNext;
+        while (s_ulEvtNum && (s_xEvt[0].ullAt <= s_ullNow)) {
+            Evt_t xEvt = prvEvtPop();
+            xEvt.pxFunc(xEvt.pvPara);
+        }
+    }
+}
+
+void RtosSimBusy(uint32_t ulUs)
+{
+    prvBlock(s_ullNow + ulUs, FALSE);
+}
+
+static void prvTaskEntry(uint32_t ulIdx)
+{
+    s_xTask[ulIdx].pxFunc(s_xTask[ulIdx].pvPara);
+    printf("rtos sim: task %u returned\n", ulIdx);
+    exit(1);
+}
+
+/* cmsis_os.h */
+uint32_t osKernelSysTick(void)
+{
+    return (uint32_t)(s_ullNow / 1000);
+}
+
+osStatus osDelay(uint32_t ms)
+{
+    prvBlock(prvTicksLater(ms), FALSE);
+    return osOK;
+}
+
+osStatus osMutexWait(osMutexId id, uint32_t ms)
+{
+    int     *piOwner = (int *)id;
+    uint64_t ullWake;
+    int      iSelf;
+
+    /* Before the tasks run nobody else can hold it */
+    if (s_pxCur == NULL) {
+        return osOK;
+    }
+    iSelf   = (int)(s_pxCur - s_xTask) + 1;
+    ullWake = prvTicksLater(ms);
+    /* Another task may take it again before the waiter runs */
+    while ((*piOwner != 0) && (*piOwner != iSelf)) {
+        if (s_ullNow >= ullWake) {
+            return osErrorOS;
+        }
+        s_pxCur->piMutex = piOwner;
+        prvBlock(ullWake, FALSE);
+        s_pxCur->piMutex = NULL;
+    }
+    *piOwner = iSelf;
+    return osOK;
+}
+
+osStatus osMutexRelease(osMutexId id)
+{
+    int *piOwner = (int *)id;
+
+    if (s_pxCur != NULL) {
+        *piOwner = 0;
+    }
+    return osOK;
+}
+
+int xTaskCreate(void (*fn)(void *), const char *name, uint16_t stack, void *para, uint32_t prio, TaskHandle_t *handle)
+{
+    Task_t *pxTask = &s_xTask[s_ulTaskNum];
+
+    (void)name;
+    (void)stack;
+    (void)prio;
+    if (s_ulTaskNum >= TASK_MAX) {
+        return pdFALSE;
+    }
+    memset(pxTask, 0, sizeof(Task_t));
+    pxTask->pxFunc  = fn;
+    pxTask->pvPara  = para;
+    pxTask->ullWake = s_ullNow;
+    getcontext(&pxTask->xCtx);
+    pxTask->xCtx.uc_stack.ss_sp   = malloc(TASK_STACK);
+    pxTask->xCtx.uc_stack.ss_size = TASK_STACK;
+    pxTask->xCtx.uc_link          = NULL;
+    makecontext(&pxTask->xCtx, (void (*)(void))prvTaskEntry, 1, s_ulTaskNum);
+    *handle = (TaskHandle_t)pxTask;
+    s_ulTaskNum++;
+    return pdPASS;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    ((Task_t *)task)->ulNotify++;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    ((Task_t *)task)->ulNotify++;
+    *woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(int clr, uint32_t ms)
+{
+    Task_t  *pxTask = s_pxCur;
+    uint32_t ulVal;
+
+    if ((pxTask->ulNotify == 0) && ms) {
+        prvBlock(prvTicksLater(ms), TRUE);
+    }
+    ulVal = pxTask->ulNotify;
+    if (clr) {
+        pxTask->ulNotify = 0;
+    }
+    else if (ulVal) {
+        pxTask->ulNotify--;
+    }
+    return ulVal;
+}
+
+/* The DWT counter of the part */
+uint32_t TimeCycGet(void)
+{
+    return (uint32_t)(s_ullNow * RTOS_SIM_CPU_MHZ);
+}
+
+uint32_t TimeCycToUs(uint32_t ulCyc)
+{
+    return ulCyc / RTOS_SIM_CPU_MHZ;
+}
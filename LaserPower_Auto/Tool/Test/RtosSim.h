@@ -0,0 +1,53 @@
+/*
+    RtosSim.h
+
+    Head File for the RTOS Simulator, Tasks on a Virtual Clock
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Mutexes block
+*/
+
+#ifndef __RTOS_SIM_H__
+#define __RTOS_SIM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdint.h>
+
+/* Defines */
+#define RTOS_SIM_CPU_MHZ    72      /* TimeCycGet counts at the core clock */
+
+/* Types */
+typedef void (*RtosSimFunc_t)(void *pvPara);
+
+/*
+    Tasks made by xTaskCreate run as coroutines and take no time, the clock only
+    moves while all of them are blocked. Events are what the hardware does, they
+    run at their time in isr context and may notify a task, which then runs at
+    that time. Everything is deterministic, a second of bus traffic takes a few
+    ms on the host.
+    A mutex blocks the tasks other than its owner, who may wait for anything
+    while holding it.
+*/
+void     RtosSimInit(void);
+uint64_t RtosSimNow(void);      /* us */
+void     RtosSimAt(uint64_t ullUs, RtosSimFunc_t pxFunc, void *pvPara);
+/* Runs events and tasks till the clock reaches ullUs */
+void     RtosSimRun(uint64_t ullUs);
+/* Task context, the caller is busy for ulUs, e.g. a blocking send */
+void     RtosSimBusy(uint32_t ulUs);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __RTOS_SIM_H__ */
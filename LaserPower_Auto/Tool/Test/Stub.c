@@ -0,0 +1,89 @@
+/*
+    Stub.c
+
+    Implementation File for the Host Stand-ins
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent RTOS stand-ins moved here from cmsis_os.h
+    01c, 19Oct26, agent xTaskCreate takes no handle
+*/
+
+/* Includes */
+#include <time.h>
+#include "Include.h"
+
+/* Functions */
+/* The cycle counter runs at 1 GHz on the host, ns */
+uint32_t TimeCycGet(void)
+{
+    struct timespec xTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint32_t)((uint64_t)xTs.tv_sec * 1000000000ULL + xTs.tv_nsec);
+}
+
+uint32_t TimeCycToUs(uint32_t ulCyc)
+{
+    return ulCyc / 1000;
+}
+
+/* One thread, tasks are created but never run */
+uint32_t osKernelSysTick(void)
+{
+    return TimeCycGet() / 1000000;
+}
+
+osStatus osDelay(uint32_t ms)
+{
+    (void)ms;
+    return osOK;
+}
+
+osStatus osMutexWait(osMutexId id, uint32_t ms)
+{
+    (void)id;
+    (void)ms;
+    return osOK;
+}
+
+osStatus osMutexRelease(osMutexId id)
+{
+    (void)id;
+    return osOK;
+}
+
+int xTaskCreate(void (*fn)(void *), const char *name, uint16_t stack, void *para, uint32_t prio, TaskHandle_t *handle)
+{
+    (void)name;
+    (void)stack;
+    (void)para;
+    (void)prio;
+    if (handle != NULL) {
+        *handle = (TaskHandle_t)fn;
+    }
+    return pdPASS;
+}
+
+void xTaskNotifyGive(TaskHandle_t task)
+{
+    (void)task;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    (void)task;
+    (void)woken;
+}
+
+uint32_t ulTaskNotifyTake(int clr, uint32_t ms)
+{
+    (void)clr;
+    (void)ms;
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+    Cli.h
+
+    Host Stand-in For The Cli Head File, Include.h Has What The Commands Use
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __CLI_H__
+#define __CLI_H__
+
+#include "Include.h"
+
+#endif /* __CLI_H__ */
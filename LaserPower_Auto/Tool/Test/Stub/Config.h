@@ -0,0 +1,42 @@
+/*
+    Config.h
+
+    Host Stand-in For The App Config Head File
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Added Prot and Stc
+    01c, 19Oct26, agent Added Hist
+    01d, 19Oct26, agent Added Nv
+*/
+
+#ifndef __APP_CONFIG_H__
+#define __APP_CONFIG_H__
+
+/* Crc, software tables, no unit and no locking on the host */
+#define CRC_ENABLE               (1)
+#define CRC_ENABLE_HW            (0)
+#define CRC_RTOS                 (0)
+#define CRC_DEBUG                (0)
+#define CRC_ASSERT               (0)
+
+/* Prot, the Stc frames */
+#define PROT_ENABLE              (1)
+#define PROT_RTOS                (0)
+
+/* App */
+#define DATA_DEBUG               (0)
+#define DATA_ASSERT              (0)
+#define STC_DEBUG                (0)
+#define STC_ASSERT               (0)
+#define HIST_DEBUG               (0)
+#define HIST_ASSERT              (0)
+#define NV_DEBUG                 (0)
+#define NV_ASSERT                (0)
+
+#endif /* __APP_CONFIG_H__ */
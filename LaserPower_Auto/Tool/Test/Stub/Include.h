@@ -0,0 +1,73 @@
+/*
+    Include.h
+
+    Host Stand-in For The App Include Head File
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Added Stc and what it needs
+*/
+
+#ifndef __APP_INCLUDE_H__
+#define __APP_INCLUDE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <cmsis_os.h>
+#include <stm32f1xx_hal.h>
+#include "Config.h"
+#include "Include/Include.h"
+#include "Crc/Crc.h"
+#include "Prot/Prot.h"
+#include "Uart/Uart.h"
+
+/* User application, the modules under test */
+#include "User/Drv/Stc.h"
+#include "User/Data.h"
+#include "User/DataLog.h"
+#include "User/EvtLog.h"
+
+/* Defines */
+#define DebugPrintf(...)    printf(__VA_ARGS__)
+
+/* Cli, the commands are compiled and kept but never run */
+typedef void cli_printf(const char* format, ...);
+#define CHECK_CLI()
+#define CLI_CMD_EXPORT(name, help, func) \
+    void (*const g_pfnCli_##name)(cli_printf cliprintf, int argc, char** argv) = func;
+
+/* Bsp */
+#define RS485a_EN           0
+Status_t GpioSetOutput(uint16_t usSeq, uint16_t usSw);
+
+/* Functions, FlashSim.c */
+Status_t MemFlashRead(uint32_t ulAddr, uint32_t ulLength, OUT uint8_t *pucData);
+Status_t MemFlashWrite(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData);
+Status_t MemFlashProgram(uint32_t ulAddr, uint32_t ulLength, IN uint8_t *pucData);
+Status_t MemFlashErase(uint32_t ulAddr, uint32_t ulLength);
+
+/* Functions, Stub.c or RtosSim.c */
+uint32_t TimeCycGet(void);
+uint32_t TimeCycToUs(uint32_t ulCyc);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __APP_INCLUDE_H__ */
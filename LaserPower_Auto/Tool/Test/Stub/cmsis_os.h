@@ -0,0 +1,75 @@
+/*
+    cmsis_os.h
+
+    Host Stand-in For The RTOS, Stub.c Never Runs Tasks, RtosSim.c Does
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Functions moved out to Stub.c and RtosSim.c, added the notify from isr
+    01c, 19Oct26, agent A mutex is an int holding its owner
+*/
+
+#ifndef __CMSIS_OS_H__
+#define __CMSIS_OS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Defines */
+#define osWaitForever               0xFFFFFFFF
+#define portMAX_DELAY               0xFFFFFFFF
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define pdPASS                      1
+#define tskIDLE_PRIORITY            0
+#define taskSCHEDULER_NOT_STARTED   1
+#define taskSCHEDULER_RUNNING       2
+
+#define osMutexDef(name)            static int os_mutex_def_##name
+#define osMutex(name)               (&os_mutex_def_##name)
+#define osSemaphoreDef(name)        static int os_semaphore_def_##name
+#define osSemaphore(name)           (&os_semaphore_def_##name)
+
+#define osMutexCreate(def)          ((osMutexId)(def))
+#define osKernelRunning()           0
+#define pdMS_TO_TICKS(ms)           (ms)
+/* Isrs never preempt a task on the host, they run while it is blocked */
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define portYIELD_FROM_ISR(woken)   ((void)(woken))
+#define xTaskGetSchedulerState()    taskSCHEDULER_NOT_STARTED
+
+/* Types */
+typedef long  BaseType_t;
+typedef void *osMutexId;
+typedef void *osSemaphoreId;
+typedef void *TaskHandle_t;
+typedef enum {
+    osOK = 0,
+    osErrorOS = 0xFF
+}osStatus;
+
+/* Functions */
+uint32_t osKernelSysTick(void);
+osStatus osDelay(uint32_t ms);
+osStatus osMutexWait(osMutexId id, uint32_t ms);
+osStatus osMutexRelease(osMutexId id);
+int      xTaskCreate(void (*fn)(void *), const char *name, uint16_t stack, void *para, uint32_t prio,
+                     TaskHandle_t *handle);
+void     xTaskNotifyGive(TaskHandle_t task);
+void     vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+uint32_t ulTaskNotifyTake(int clr, uint32_t ms);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __CMSIS_OS_H__ */
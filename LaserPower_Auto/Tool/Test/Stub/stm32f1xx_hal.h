@@ -0,0 +1,36 @@
+/*
+    stm32f1xx_hal.h
+
+    Host Stand-in For The HAL, Only What The Tested Modules Touch
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Added the Stc bus peripherals
+*/
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stdint.h>
+
+#define __IO    volatile
+
+/* Peripherals the drivers are handed, never dereferenced on the host */
+typedef struct { uint32_t ulDummy; } USART_TypeDef;
+typedef struct { uint32_t ulDummy; } DMA_Channel_TypeDef;
+typedef enum {
+    USART2_IRQn         = 38,
+    DMA1_Channel6_IRQn  = 16,
+    DMA1_Channel7_IRQn  = 17
+}IRQn_Type;
+
+#define USART2          ((USART_TypeDef *)0x40004400)
+#define DMA1_Channel6   ((DMA_Channel_TypeDef *)0x4002006C)
+#define DMA1_Channel7   ((DMA_Channel_TypeDef *)0x40020080)
+
+#endif /* __STM32F1xx_HAL_H */
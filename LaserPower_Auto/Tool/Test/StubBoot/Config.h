@@ -0,0 +1,34 @@
+/*
+    Config.h
+
+    Host Stand-in For The BootLoader Config Head File
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __BOOT_CONFIG_H__
+#define __BOOT_CONFIG_H__
+
+/* Crc, Crc.c is built without the unit, TestBootStream.c stands in for it */
+#define CRC_ENABLE                  (1)
+#ifndef CRC_ENABLE_HW
+#define CRC_ENABLE_HW               (1)
+#endif
+#define CRC_RTOS                    (0)
+
+/* BootUart, as the bootloader sets it, the region is mapped by the test */
+#define BOOT_UART_ENABLE            (1)
+#define BOOT_UART_FLASH_PAGE_SIZE   (0x800)
+#define BOOT_UART_APP_ADDR          (0x08010000)
+#define BOOT_UART_APP_SIZE          (0x30000)
+#define BOOT_UART_STREAM            (1)
+
+#define TickDelay(d)                HAL_Delay(d)
+
+#endif /* __BOOT_CONFIG_H__ */
@@ -0,0 +1,20 @@
+/*
+    Uart.h
+
+    Host Stand-in For The Uart Library Head File, BootUart Drives The HAL Itself
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __UART_H__
+#define __UART_H__
+
+#include <stm32f1xx_hal.h>
+
+#endif /* __UART_H__ */
@@ -0,0 +1,146 @@
+/*
+    stm32f1xx_hal.h
+
+    Host Stand-in For The HAL Used By BootUart, Implemented In The Tests Of It
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Implemented by TestBootYmodem.c too
+*/
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stdint.h>
+
+/* Defines */
+#define __IO                    volatile
+#define FLASH_PAGE_SIZE         0x800
+#define FLASH_TYPEERASE_PAGES   0x00
+#define FLASH_TYPEPROGRAM_WORD  0x02
+#define FLASH_BANK_1            0x01
+
+#define GPIO_MODE_INPUT         0x00
+#define GPIO_MODE_AF_PP         0x02
+#define GPIO_PULLUP             0x01
+#define GPIO_SPEED_FREQ_HIGH    0x03
+#define UART_MODE_TX_RX         0x0C
+#define UART_HWCONTROL_NONE     0x00
+#define UART_OVERSAMPLING_16    0x00
+#define DMA_PERIPH_TO_MEMORY    0x00
+#define DMA_PINC_DISABLE        0x00
+#define DMA_MINC_ENABLE         0x80
+#define DMA_PDATAALIGN_BYTE     0x00
+#define DMA_MDATAALIGN_BYTE     0x00
+#define DMA_CIRCULAR            0x20
+#define DMA_PRIORITY_HIGH       0x2000
+
+/* The part's addresses, BootUart switches on them, never dereferenced */
+#define GPIOA                   ((GPIO_TypeDef *)0x40010800)
+#define GPIOB                   ((GPIO_TypeDef *)0x40010C00)
+#define GPIOC                   ((GPIO_TypeDef *)0x40011000)
+#define GPIOD                   ((GPIO_TypeDef *)0x40011400)
+#define GPIOE                   ((GPIO_TypeDef *)0x40011800)
+#define USART1                  ((USART_TypeDef *)0x40013800)
+#define USART2                  ((USART_TypeDef *)0x40004400)
+#define USART3                  ((USART_TypeDef *)0x40004800)
+#define UART4                   ((USART_TypeDef *)0x40004C00)
+#define UART5                   ((USART_TypeDef *)0x40005000)
+#define DMA1_Channel5           ((DMA_Channel_TypeDef *)0x40020058)
+
+#define __HAL_RCC_GPIOA_CLK_ENABLE()
+#define __HAL_RCC_GPIOB_CLK_ENABLE()
+#define __HAL_RCC_GPIOC_CLK_ENABLE()
+#define __HAL_RCC_GPIOD_CLK_ENABLE()
+#define __HAL_RCC_GPIOE_CLK_ENABLE()
+#define __HAL_RCC_USART1_CLK_ENABLE()
+#define __HAL_RCC_USART2_CLK_ENABLE()
+#define __HAL_RCC_USART3_CLK_ENABLE()
+#define __HAL_RCC_UART4_CLK_ENABLE()
+#define __HAL_RCC_UART5_CLK_ENABLE()
+#define __HAL_RCC_DMA1_CLK_ENABLE()
+#define __HAL_LINKDMA(h, field, dma)    ((h)->field = &(dma))
+#define __HAL_DMA_GET_COUNTER(h)        HAL_DMA_SimCounter(h)
+
+/* Types */
+typedef struct { uint8_t ucDummy; } GPIO_TypeDef;
+typedef struct { uint8_t ucDummy; } USART_TypeDef;
+typedef struct { uint8_t ucDummy; } DMA_Channel_TypeDef;
+
+typedef enum {
+    HAL_OK      = 0x00,
+    HAL_ERROR   = 0x01,
+    HAL_BUSY    = 0x02,
+    HAL_TIMEOUT = 0x03
+}HAL_StatusTypeDef;
+
+typedef enum {
+    HAL_UART_STATE_READY   = 0x20,
+    HAL_UART_STATE_BUSY_TX = 0x21,
+    HAL_UART_STATE_BUSY_RX = 0x22
+}HAL_UART_StateTypeDef;
+
+typedef struct {
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+}GPIO_InitTypeDef;
+
+typedef struct {
+    DMA_Channel_TypeDef *Instance;
+    struct {
+        uint32_t Direction;
+        uint32_t PeriphInc;
+        uint32_t MemInc;
+        uint32_t PeriphDataAlignment;
+        uint32_t MemDataAlignment;
+        uint32_t Mode;
+        uint32_t Priority;
+    }Init;
+}DMA_HandleTypeDef;
+
+typedef struct {
+    USART_TypeDef *Instance;
+    struct {
+        uint32_t BaudRate;
+        uint32_t WordLength;
+        uint32_t StopBits;
+        uint32_t Parity;
+        uint32_t Mode;
+        uint32_t HwFlowCtl;
+        uint32_t OverSampling;
+    }Init;
+    DMA_HandleTypeDef *hdmarx;
+}UART_HandleTypeDef;
+
+typedef struct {
+    uint32_t TypeErase;
+    uint32_t Banks;
+    uint32_t PageAddress;
+    uint32_t NbPages;
+}FLASH_EraseInitTypeDef;
+
+/* Functions */
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size);
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart);
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+uint32_t HAL_DMA_SimCounter(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t Delay);
+void NVIC_SystemReset(void);
+
+#endif /* __STM32F1xx_HAL_H */
@@ -0,0 +1,9 @@
+/*
+    STC8G_H_UART.h
+
+    Host Stand-in, All in config.h
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+#include "config.h"
@@ -0,0 +1,144 @@
+/*
+    config.h
+
+    Host Stand-in For The STC8G Config and Driver Head Files
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __C51_CONFIG_H__
+#define __C51_CONFIG_H__
+
+#include <stdint.h>
+
+/* Clock, as the node is built */
+#define MAIN_Fosc           22118400L
+
+/* Memory classes mean nothing on the host, the isr state may change under the main loop */
+#define data                volatile
+#define idata
+#define xdata
+#define code                const
+
+/* Special function registers, TestNodeRx.c owns them */
+/* Main loop code takes time, each EA access lets the line and the isrs move on */
+volatile uint8_t *SimEa(void);
+#define EA                  (*SimEa())
+extern volatile uint8_t  P36;
+extern volatile uint8_t  TH0;
+extern volatile uint8_t  TL0;
+extern volatile uint8_t  TF0;
+extern volatile uint8_t  ADC_CONTR;
+extern volatile uint8_t  ADC_RES;
+extern volatile uint8_t  ADC_RESL;
+#define ADC_START           0x40
+/* Every write to the transmit buffer starts a byte on the line */
+extern uint8_t  g_ucSimTx[];
+extern uint32_t g_ulSimTxNum;
+#define S2BUF               g_ucSimTx[g_ulSimTxNum++]
+/* Software set TI2 raises the transmit interrupt */
+void SimSetTi2(void);
+#define SET_TI2()           SimSetTi2()
+
+/* Drivers, the init calls are empty */
+#define ENABLE              1
+#define DISABLE             0
+#define Priority_0          0
+#define Priority_1          1
+
+typedef struct {
+    uint8_t WDT_Enable;
+    uint8_t WDT_IDLE_Mode;
+    uint8_t WDT_PS;
+}WDT_InitTypeDef;
+#define WDT_IDLE_STOP       0
+#define WDT_SCALE_16        3
+#define WDT_Inilize(p)      ((void)(p))
+#define WDT_Clear()
+
+typedef struct {
+    uint8_t Mode;
+    uint8_t Pin;
+}GPIO_InitTypeDef;
+#define GPIO_Pin_0          0x01
+#define GPIO_Pin_1          0x02
+#define GPIO_Pin_2          0x04
+#define GPIO_Pin_3          0x08
+#define GPIO_Pin_4          0x10
+#define GPIO_Pin_5          0x20
+#define GPIO_Pin_6          0x40
+#define GPIO_Pin_7          0x80
+#define GPIO_PullUp         0
+#define GPIO_HighZ          1
+#define GPIO_OUT_OD         2
+#define GPIO_OUT_PP         3
+#define GPIO_P1             1
+#define GPIO_P3             3
+#define GPIO_Inilize(g, p)  ((void)(p))
+
+typedef struct {
+    uint8_t ADC_SMPduty;
+    uint8_t ADC_Speed;
+    uint8_t ADC_AdjResult;
+    uint8_t ADC_CsSetup;
+    uint8_t ADC_CsHold;
+}ADC_InitTypeDef;
+#define ADC_SPEED_2X16T     7
+#define ADC_RIGHT_JUSTIFIED 1
+#define ADC_Inilize(p)      ((void)(p))
+#define ADC_PowerControl(e)
+#define NVIC_ADC_Init(e, p)
+
+typedef struct {
+    uint8_t  UART_Mode;
+    uint8_t  UART_BRT_Use;
+    uint32_t UART_BaudRate;
+    uint8_t  Morecommunicate;
+    uint8_t  UART_RxEnable;
+    uint8_t  BaudRateDouble;
+}COMx_InitDefine;
+#define UART_8bit_BRTx      1
+#define BRT_Timer1          1
+#define BRT_Timer2          2
+#define UART1               1
+#define UART2               2
+#define UART2_SW_P10_P11    0
+#define UART2_SW(s)
+#define NVIC_UART2_Init(e, p)
+/* The rate the node switches to, TestNodeRx.c follows it */
+void SimUartConfig(uint8_t ucUart, COMx_InitDefine *pxInit);
+#define UART_Configuration(u, p)    SimUartConfig(u, p)
+
+typedef struct {
+    uint8_t  TIM_Mode;
+    uint8_t  TIM_ClkSource;
+    uint8_t  TIM_ClkOut;
+    uint16_t TIM_Value;
+    uint8_t  TIM_Run;
+}TIM_InitTypeDef;
+#define TIM_16BitAutoReload 0
+#define TIM_CLOCK_1T        1
+#define Timer0              0
+#define Timer_Inilize(t, p) ((void)(p))
+#define NVIC_Timer0_Init(e, p)
+
+#define EAXSFR()
+/* Busy wait of the main loop, the line and the isrs go on meanwhile */
+void delay_ms(uint8_t ms);
+
+/* main.c typedefs its own fixed width types, they must not clash with stdint.h. int is wider here, the
+   frame assembler and the ring only work on bytes */
+#define int8_t              c51_int8_t
+#define int16_t             c51_int16_t
+#define int32_t             c51_int32_t
+#define uint8_t             c51_uint8_t
+#define uint16_t            c51_uint16_t
+#define uint32_t            c51_uint32_t
+
+#endif /* __C51_CONFIG_H__ */
@@ -0,0 +1,70 @@
+/*
+    Include.h
+
+    Host Stand-in For The App Include Head File, the Can Module on the Real HAL
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __APP_INCLUDE_H__
+#define __APP_INCLUDE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <cmsis_os.h>
+#include <stm32f1xx_hal.h>
+#include "Include/Include.h"
+
+/* The bxCAN is modelled by TestCan.c, on a page of its own */
+typedef union {
+    CAN_TypeDef xCan;
+    uint8_t     ucPage[4096];
+}CanSimPage_t;
+
+extern CanSimPage_t g_xCanSim;
+void SimCanRelease(CAN_TypeDef *pxCan, uint8_t ucFifo);
+
+#undef CAN1
+#define CAN1                    (&g_xCanSim.xCan)
+
+/* The release is written to the register, then the model moves the next frame up */
+#undef __HAL_CAN_FIFO_RELEASE
+#define __HAL_CAN_FIFO_RELEASE(__HANDLE__, __FIFONUMBER__)  SimCanRelease((__HANDLE__)->Instance, (__FIFONUMBER__))
+
+/* One core, nothing to order */
+#define __DMB()                 __asm__ volatile("" ::: "memory")
+
+/* User application, the module under test */
+#include "User/Drv/Can.h"
+#include "User/EvtLog.h"
+
+/* Cli, the commands are compiled and kept but never run */
+typedef void cli_printf(const char* format, ...);
+#define CHECK_CLI()
+#define CLI_CMD_EXPORT(name, help, func) \
+    void (*const g_pfnCli_##name)(cli_printf cliprintf, int argc, char** argv) = func;
+
+/* Functions, TestCan.c */
+uint32_t TimeCycGet(void);
+uint32_t TimeCycToUs(uint32_t ulCyc);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __APP_INCLUDE_H__ */
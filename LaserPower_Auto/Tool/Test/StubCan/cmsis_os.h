@@ -0,0 +1,49 @@
+/*
+    cmsis_os.h
+
+    Host Stand-in For The RTOS Used By Can, Implemented In TestCan.c
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __CMSIS_OS_H__
+#define __CMSIS_OS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Defines */
+#define pdTRUE                      1
+#define pdFALSE                     0
+#define pdMS_TO_TICKS(ms)           (ms)
+/* The isrs are called by the test, never preempting it */
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+#define portYIELD_FROM_ISR(woken)   ((void)(woken))
+
+/* Types */
+typedef long  BaseType_t;
+typedef void *TaskHandle_t;
+typedef void *SemaphoreHandle_t;
+
+/* Functions, a take nobody gave times out at once */
+uint32_t          osKernelSysTick(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t        xSemaphoreTake(SemaphoreHandle_t xSem, uint32_t ulTicks);
+BaseType_t        xSemaphoreGiveFromISR(SemaphoreHandle_t xSem, BaseType_t *pxWoken);
+void              vTaskNotifyGiveFromISR(TaskHandle_t xTask, BaseType_t *pxWoken);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __CMSIS_OS_H__ */
@@ -0,0 +1,58 @@
+/*
+    Include.h
+
+    Host Stand-in For The App Include Head File, the Pwr2 Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __APP_INCLUDE_H__
+#define __APP_INCLUDE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Includes */
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <cmsis_os.h>
+#include <stm32f1xx_hal.h>
+#include "Include/Include.h"
+
+/* User application, the modules under test, the CAN driver is modelled by TestPwr2.c */
+#include "User/Drv/Pwr.h"
+#include "User/Drv/Can.h"
+#include "User/Drv/Pwr/PwrTrans.h"
+#include "User/Drv/Pwr/Pwr2Prot.h"
+#include "User/EvtLog.h"
+
+/* Defines */
+#define DebugPrintf(...)    printf(__VA_ARGS__)
+
+/* Cli, the commands are compiled and kept but never run */
+typedef void cli_printf(const char* format, ...);
+#define CHECK_CLI()
+#define CLI_CMD_EXPORT(name, help, func) \
+    void (*const g_pfnCli_##name)(cli_printf cliprintf, int argc, char** argv) = func;
+
+/* Functions, RtosSim.c */
+uint32_t TimeCycGet(void);
+uint32_t TimeCycToUs(uint32_t ulCyc);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __APP_INCLUDE_H__ */
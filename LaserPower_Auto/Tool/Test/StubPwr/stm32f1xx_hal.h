@@ -0,0 +1,52 @@
+/*
+    stm32f1xx_hal.h
+
+    Host Stand-in For The HAL, the CAN Frames Only
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stdint.h>
+
+#define __IO            volatile
+
+#define CAN_ID_STD      0x00000000U
+#define CAN_ID_EXT      0x00000004U
+#define CAN_RTR_DATA    0x00000000U
+#define CAN_RTR_REMOTE  0x00000002U
+#define CAN_FIFO0       0x00U
+#define CAN_FIFO1       0x01U
+
+/* One core, nothing to order */
+#define __DMB()         __asm__ volatile("" ::: "memory")
+
+typedef struct {
+    uint32_t StdId;
+    uint32_t ExtId;
+    uint32_t IDE;
+    uint32_t RTR;
+    uint32_t DLC;
+    uint8_t  Data[8];
+}CanTxMsgTypeDef;
+
+typedef struct {
+    uint32_t StdId;
+    uint32_t ExtId;
+    uint32_t IDE;
+    uint32_t RTR;
+    uint32_t DLC;
+    uint8_t  Data[8];
+    uint32_t FMI;
+    uint32_t FIFONumber;
+}CanRxMsgTypeDef;
+
+#endif /* __STM32F1xx_HAL_H */
@@ -0,0 +1,29 @@
+/*
+    Config.h
+
+    Host Stand-in For The App Config Head File, the Mem Module Only
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __SPI_CONFIG_H__
+#define __SPI_CONFIG_H__
+
+/* Mem, as the app sets it, the chip behind the HAL is TestSpiFlash.c */
+#define MEM_ENABLE               (1)
+#define MEM_ENABLE_FRAM          (0)
+#define MEM_ENABLE_SPIFLASH      (1)
+#define MEM_ENABLE_STM32FLASH    (0)
+#define MEM_RTOS                 (1)
+#define MEM_DEBUGx               (0)
+#define MEM_TEST                 (0)
+#define MEM_ASSERT               (0)
+#define MEM_SPIFLASH_DMA         (1)
+
+#endif /* __SPI_CONFIG_H__ */
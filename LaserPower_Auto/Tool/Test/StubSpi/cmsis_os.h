@@ -0,0 +1,50 @@
+/*
+    cmsis_os.h
+
+    Host Stand-in For The RTOS Used By MemSpiFlash, Implemented In TestSpiFlash.c
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __CMSIS_OS_H__
+#define __CMSIS_OS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /*__cplusplus */
+
+/* Defines */
+#define osSemaphoreDef(name)        static int os_semaphore_def_##name
+#define osSemaphore(name)           (&os_semaphore_def_##name)
+
+/* Types */
+typedef struct {
+    int32_t lCount;
+}osSemaphore_t;
+
+typedef osSemaphore_t *osSemaphoreId;
+typedef enum {
+    osOK = 0,
+    osErrorOS = 0xFF
+}osStatus;
+
+/* Functions, one thread: a wait on a semaphore nobody gave times out at once */
+int32_t       osKernelRunning(void);
+osStatus      osDelay(uint32_t ms);
+osSemaphoreId osSemaphoreCreate(const int *def, int32_t count);
+int32_t       osSemaphoreWait(osSemaphoreId id, uint32_t ms);
+osStatus      osSemaphoreRelease(osSemaphoreId id);
+
+#ifdef __cplusplus
+}
+#endif /*__cplusplus */
+
+#endif /* __CMSIS_OS_H__ */
@@ -0,0 +1,105 @@
+/*
+    stm32f1xx_hal.h
+
+    Host Stand-in For The HAL Used By MemSpiFlash, Implemented In TestSpiFlash.c
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+#ifndef __STM32F1xx_HAL_H
+#define __STM32F1xx_HAL_H
+
+#include <stdint.h>
+
+/* Defines */
+#define __IO                    volatile
+#define assert_param(expr)      ((void)0)
+
+#define GPIO_PIN_RESET          0
+#define GPIO_PIN_SET            1
+#define DMA_PERIPH_TO_MEMORY    0x00
+#define DMA_MEMORY_TO_PERIPH    0x10
+#define DMA_PINC_DISABLE        0x00
+#define DMA_MINC_ENABLE         0x80
+#define DMA_PDATAALIGN_BYTE     0x00
+#define DMA_MDATAALIGN_BYTE     0x00
+#define DMA_NORMAL              0x00
+#define DMA_PRIORITY_HIGH       0x2000
+
+/* The part's addresses, never dereferenced */
+#define GPIOA                   ((GPIO_TypeDef *)0x40010800)
+#define SPI1                    ((SPI_TypeDef *)0x40013000)
+#define DMA2_Channel1           ((DMA_Channel_TypeDef *)0x40020408)
+#define DMA2_Channel2           ((DMA_Channel_TypeDef *)0x4002041C)
+#define DWT                     (&g_xSimDwt)
+
+#define __HAL_RCC_DMA2_CLK_ENABLE()
+#define __HAL_LINKDMA(h, field, dma)    ((h)->field = &(dma))
+
+/* Types */
+typedef struct { uint8_t ucDummy; } GPIO_TypeDef;
+typedef struct { uint8_t ucDummy; } SPI_TypeDef;
+typedef struct { uint8_t ucDummy; } DMA_Channel_TypeDef;
+typedef struct { volatile uint32_t CYCCNT; } DWT_Type;
+
+typedef enum {
+    DMA2_Channel1_IRQn  = 56,
+    DMA2_Channel2_IRQn  = 57
+}IRQn_Type;
+
+typedef enum {
+    HAL_OK      = 0x00,
+    HAL_ERROR   = 0x01,
+    HAL_BUSY    = 0x02,
+    HAL_TIMEOUT = 0x03
+}HAL_StatusTypeDef;
+
+typedef struct {
+    uint32_t Direction;
+    uint32_t PeriphInc;
+    uint32_t MemInc;
+    uint32_t PeriphDataAlignment;
+    uint32_t MemDataAlignment;
+    uint32_t Mode;
+    uint32_t Priority;
+}DMA_InitTypeDef;
+
+typedef struct {
+    DMA_Channel_TypeDef *Instance;
+    DMA_InitTypeDef      Init;
+}DMA_HandleTypeDef;
+
+typedef struct {
+    SPI_TypeDef         *Instance;
+    DMA_HandleTypeDef   *hdmatx;
+    DMA_HandleTypeDef   *hdmarx;
+}SPI_HandleTypeDef;
+
+/* Variables */
+extern DWT_Type g_xSimDwt;
+
+/* Functions */
+void              HAL_Delay(uint32_t ms);
+void              HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, int state);
+void              HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub);
+void              HAL_NVIC_EnableIRQ(IRQn_Type irq);
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma);
+void              HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma);
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size, uint32_t ms);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size, uint32_t ms);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size);
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *hspi);
+/* Weak in the HAL, the driver overrides those it wants */
+void              HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi);
+void              HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi);
+void              HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+void              HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+
+#endif /* __STM32F1xx_HAL_H */
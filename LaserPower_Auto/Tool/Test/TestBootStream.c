@@ -0,0 +1,382 @@
+/*
+    TestBootStream.c
+
+    Host Loopback Test for the BootUart Streaming Mode
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    The real BootUart.c runs against the HAL stand-ins below, Tool/Boot/BootStream.py
+    sends a random image to it over a pseudo terminal. The UART bytes are paced at the
+    baud in use. The DMA1 Ch5 circular receive is a thread filling the ring and counting
+    CNDTR down as the channel does. The application region is mapped at its address,
+    a page erase stalls the CPU 20 ms and a word program 105 us, the typical F107
+    figures, while the DMA thread keeps receiving. Bytes may be corrupted on the way
+    to exercise the NAK path.
+
+        TestBootStream [sender.py]
+*/
+
+/* Includes */
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "BootUart.h"
+
+/* Local defines */
+#define ERASE_NS        20000000ULL     /* Page erase, typical */
+#define PROGRAM_NS      105000ULL       /* Word, two half words at 52.5 us */
+#define BYTE_BITS       10
+#define IMG_SIZE        65536
+
+/* Local variables */
+static int               s_lWire  = -1;     /* Pty master, the host on the other end */
+static volatile uint32_t s_ulBaud = 115200;
+static uint64_t          s_ullT0  = 0;
+static uint8_t          *s_pucImg = NULL;
+static uint32_t          s_ulImgSize = 0;
+static double            s_dErrRate = 0;
+static pid_t             s_xSender = -1;
+static int               s_bDone  = 0;
+static uint64_t          s_ullStreamT0 = 0;
+static uint64_t          s_ullStreamT1 = 0;
+static uint32_t          s_ulEraseCnt = 0;
+static uint32_t          s_ulProgErr  = 0;
+static uint32_t          s_ulNakCnt   = 0;
+static uint32_t          s_ulReplyPos = 0;
+static uint32_t          s_ulCorrupt  = 0;
+static uint64_t          s_ullStallNs = 0;  /* Flash time owed, slept in ms steps */
+/* DMA */
+static pthread_t         s_xDma;
+static uint8_t          *s_pucRing = NULL;
+static uint32_t          s_ulRingSize = 0;
+static volatile uint32_t s_ulCndtr = 0;
+
+/* Functions */
+static uint64_t prvNs(void)
+{
+    struct timespec xTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t)xTs.tv_sec * 1000000000ULL + xTs.tv_nsec;
+}
+
+static void prvSleepNs(uint64_t ullNs)
+{
+    struct timespec xTs;
+
+    xTs.tv_sec  = ullNs / 1000000000ULL;
+    xTs.tv_nsec = ullNs % 1000000000ULL;
+    nanosleep(&xTs, NULL);
+}
+
+static void prvStall(uint64_t ullNs)
+{
+    s_ullStallNs += ullNs;
+    if (s_ullStallNs >= 1000000ULL) {
+        prvSleepNs(s_ullStallNs);
+        s_ullStallNs = 0;
+    }
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    s_ulBaud = huart->Init.BaudRate;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)huart;
+    (void)Timeout;
+    /* Streaming replies are ACK or NAK and two block bytes */
+    for (uint16_t n = 0; (s_pucRing != NULL) && (n < Size); n++) {
+        if (s_ulReplyPos == 0) {
+            s_ulNakCnt  += (pData[n] == 0x15);
+            s_ulReplyPos = ((pData[n] == 0x06) || (pData[n] == 0x15)) ? 1 : 0;
+        }
+        else {
+            s_ulReplyPos = (s_ulReplyPos + 1) % 3;
+        }
+    }
+    if (write(s_lWire, pData, Size) != Size) {
+        return HAL_ERROR;
+    }
+    prvSleepNs(1000000000ULL * BYTE_BITS * Size / s_ulBaud);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    struct pollfd xPoll = {s_lWire, POLLIN, 0};
+
+    (void)huart;
+    for (uint16_t n = 0; n < Size; n++) {
+        if ((poll(&xPoll, 1, Timeout) <= 0) || (read(s_lWire, &pData[n], 1) != 1)) {
+            return HAL_TIMEOUT;
+        }
+    }
+    return HAL_OK;
+}
+
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return HAL_UART_STATE_READY;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    return (hdma->Instance == DMA1_Channel5) && (hdma->Init.Mode == DMA_CIRCULAR) ? HAL_OK : HAL_ERROR;
+}
+
+/* DMA1 Ch5, each byte lands in the ring at the baud and counts CNDTR down, reloaded at 0 */
+static void *prvDmaThread(void *pvPara)
+{
+    struct pollfd xPoll = {s_lWire, POLLIN, 0};
+    uint8_t       ucBuf[64];
+    uint32_t      ulWr   = 0;
+    uint64_t      ullDue = prvNs();
+
+    (void)pvPara;
+    while (1) {
+        if (poll(&xPoll, 1, 10) <= 0) {
+            continue;
+        }
+        ssize_t lNum = read(s_lWire, ucBuf, sizeof(ucBuf));
+        if (lNum <= 0) {
+            break;
+        }
+        for (ssize_t n = 0; n < lNum; n++) {
+            uint64_t ullNow = prvNs();
+            ullDue = ((ullDue > ullNow) ? ullDue : ullNow) + 1000000000ULL * BYTE_BITS / s_ulBaud;
+            if (ullDue > (ullNow + 200000ULL)) {
+                prvSleepNs(ullDue - ullNow);
+            }
+            uint8_t ucByte = ucBuf[n];
+            if ((s_dErrRate > 0) && ((double)rand() / RAND_MAX < s_dErrRate)) {
+                ucByte ^= 1 << (rand() % 8);
+                s_ulCorrupt++;
+            }
+            s_pucRing[ulWr] = ucByte;
+            ulWr = (ulWr + 1) % s_ulRingSize;
+            __atomic_store_n(&s_ulCndtr, s_ulRingSize - ulWr, __ATOMIC_RELEASE);
+        }
+    }
+    return NULL;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    if ((huart->hdmarx == NULL) || (s_pucRing != NULL)) {
+        return HAL_ERROR;
+    }
+    s_ullStreamT0 = prvNs();
+    s_pucRing     = pData;
+    s_ulRingSize  = Size;
+    s_ulCndtr     = Size;
+    pthread_create(&s_xDma, NULL, prvDmaThread, NULL);
+    return HAL_OK;
+}
+
+uint32_t HAL_DMA_SimCounter(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return __atomic_load_n(&s_ulCndtr, __ATOMIC_ACQUIRE);
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    volatile uint32_t *pulCell = (volatile uint32_t *)(uintptr_t)Address;
+
+    /* PGERR on a word not erased, the part leaves it as it was */
+    if ((TypeProgram != FLASH_TYPEPROGRAM_WORD) || (*pulCell != 0xFFFFFFFF)) {
+        s_ulProgErr++;
+        return HAL_ERROR;
+    }
+    *pulCell = (uint32_t)Data;
+    prvStall(PROGRAM_NS);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    for (uint32_t n = 0; n < pEraseInit->NbPages; n++) {
+        memset((void *)(uintptr_t)(pEraseInit->PageAddress + n * FLASH_PAGE_SIZE), 0xFF, FLASH_PAGE_SIZE);
+        s_ulEraseCnt++;
+        prvStall(ERASE_NS);
+    }
+    *PageError = 0xFFFFFFFF;
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return (prvNs() - s_ullT0) / 1000000ULL;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    prvSleepNs(Delay * 1000000ULL);
+}
+
+/* CRC-32/MPEG-2 over words, as the unit computes it */
+uint32_t Crc32Hw(const uint32_t *pulData, uint32_t ulWords)
+{
+    uint32_t ulCrc = 0xFFFFFFFF;
+
+    while (ulWords--) {
+        ulCrc ^= *pulData++;
+        for (uint8_t m = 0; m < 32; m++) {
+            ulCrc = (ulCrc & 0x80000000) ? ((ulCrc << 1) ^ 0x04C11DB7) : (ulCrc << 1);
+        }
+    }
+    return ulCrc;
+}
+
+static void prvDone(void)
+{
+    s_ullStreamT1 = prvNs();
+    s_bDone = (0 == memcmp((void *)BOOT_UART_APP_ADDR, s_pucImg, s_ulImgSize));
+}
+
+/* BootUartRun ends here, done or not */
+void NVIC_SystemReset(void)
+{
+    int lStatus = -1;
+
+    waitpid(s_xSender, &lStatus, 0);
+    if (s_bDone && WIFEXITED(lStatus) && (WEXITSTATUS(lStatus) == 0) && (s_ulProgErr == 0)) {
+        double dSec = (s_ullStreamT1 - s_ullStreamT0) / 1e9;
+        printf("boot stream: %u bytes at %u baud, error rate %g: %.2f s, %.1f KB/s, "
+               "%u pages erased, %u bytes corrupted, %u NAK: PASS\n", s_ulImgSize, s_ulBaud, s_dErrRate, dSec,
+               s_ulImgSize / 1024.0 / dSec, s_ulEraseCnt, s_ulCorrupt, s_ulNakCnt);
+        _exit(0);
+    }
+    printf("boot stream: done %d, sender status %x, %u program errors: FAIL\n", s_bDone, lStatus, s_ulProgErr);
+    _exit(1);
+}
+
+/* One download in a forked child, BootUartRun leaves through NVIC_SystemReset */
+static void prvRun(const char *pcSender, uint32_t ulBaud, double dErrRate)
+{
+    BootUartConfig_t xConfig = {0};
+    struct termios   xTerm;
+    char             cBaud[16];
+    const char      *pcImg = "BootStream.bin";
+    FILE            *pxFile;
+    int              lSlave;
+    int              lLog;
+
+    s_dErrRate = dErrRate;
+    s_ullT0    = prvNs();
+    srand(ulBaud);
+    alarm(120);
+
+    /* The application region at its address, an old image in it */
+    if (MAP_FAILED == mmap((void *)BOOT_UART_APP_ADDR, BOOT_UART_APP_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)) {
+        printf("cannot map 0x%08X\n", BOOT_UART_APP_ADDR);
+        _exit(1);
+    }
+    memset((void *)BOOT_UART_APP_ADDR, 0x5A, BOOT_UART_APP_SIZE);
+    s_pucImg = malloc(s_ulImgSize);
+    for (uint32_t n = 0; n < s_ulImgSize; n++) {
+        s_pucImg[n] = rand();
+    }
+    pxFile = fopen(pcImg, "wb");
+    fwrite(s_pucImg, 1, s_ulImgSize, pxFile);
+    fclose(pxFile);
+
+    /* Raw both ends before a byte moves, no echo and no translation */
+    s_lWire = posix_openpt(O_RDWR | O_NOCTTY);
+    grantpt(s_lWire);
+    unlockpt(s_lWire);
+    lSlave = open(ptsname(s_lWire), O_RDWR | O_NOCTTY);
+    tcgetattr(lSlave, &xTerm);
+    cfmakeraw(&xTerm);
+    tcsetattr(lSlave, TCSANOW, &xTerm);
+
+    snprintf(cBaud, sizeof(cBaud), "%u", ulBaud);
+    s_xSender = fork();
+    if (s_xSender == 0) {
+        lLog = open("BootStream.log", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        dup2(lLog, STDOUT_FILENO);
+        execlp("python3", "python3", pcSender, "--port", ptsname(s_lWire), "--stream-baud", cBaud, pcImg, NULL);
+        _exit(127);
+    }
+
+    xConfig.pxRxPinPort = GPIOA;
+    xConfig.pxTxPinPort = GPIOA;
+    xConfig.pxInstance  = USART1;
+    xConfig.ulBaudRate  = 115200;
+    xConfig.pxDoneFunc  = prvDone;
+    BootUartConfig(&xConfig);
+    BootUartRun();
+    _exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        uint32_t ulBaud;
+        double   dErrRate;
+    } xCase[] = {
+        {115200, 0},
+        {921600, 0},
+        {921600, 5e-5},
+    };
+    const char *pcSender = (argc > 1) ? argv[1] : "../../Boot/BootStream.py";
+    int         lStatus;
+
+    /* A child leaves by _exit, nothing may wait in a buffer */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    s_ulImgSize = IMG_SIZE;
+    for (uint32_t n = 0; n < (sizeof(xCase) / sizeof(xCase[0])); n++) {
+        pid_t xPid = fork();
+        if (xPid == 0) {
+            prvRun(pcSender, xCase[n].ulBaud, xCase[n].dErrRate);
+        }
+        waitpid(xPid, &lStatus, 0);
+        if (!WIFEXITED(lStatus) || (WEXITSTATUS(lStatus) != 0)) {
+            printf("FAIL at %u baud, status %x, see BootStream.log\n", xCase[n].ulBaud, lStatus);
+            return 1;
+        }
+    }
+    unlink("BootStream.bin");
+    unlink("BootStream.log");
+    return 0;
+}
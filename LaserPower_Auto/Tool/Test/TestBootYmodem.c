@@ -0,0 +1,421 @@
+/*
+    TestBootYmodem.c
+
+    Host Model of a BootUart YMODEM Download, Page Erases and Total Time
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    The real BootUart.c receives an image from a YMODEM sender modelled here, on a
+    virtual clock: a byte takes 10 bit times at 115200 baud either way, a page erase
+    stalls the CPU 20 ms and a word program 105 us (two half words at 52.5 us), the
+    typical F107 figures. The sender answers each byte of the receiver when it has
+    crossed the line. The time is from the first 'C' to the done callback.
+
+    Every programmed word must land on an erased word, the region holds an old image
+    at the start, and the image must read back. The pages erased must be the pages
+    the image covers. Erasing the whole region up front, as BootUartConfig did before
+    01d, costs the pages not touched on top while the sender waits for the first 'C',
+    so that time is the measured one plus their erases. An image past the region must
+    not reach the done callback.
+*/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "BootUart.h"
+
+/* Local defines */
+#define BAUD            115200
+#define BYTE_NS         (1000000000ULL * 10 / BAUD)
+#define ERASE_NS        20000000ULL     /* Page erase, typical */
+#define PROGRAM_NS      105000ULL       /* Word, two half words at 52.5 us */
+#define PAGE_NUM        (BOOT_UART_APP_SIZE / FLASH_PAGE_SIZE)
+#define LINE_SIZE       (3 * (1024 + 5))
+
+#define SOH             0x01
+#define STX             0x02
+#define EOT             0x04
+#define ACK             0x06
+#define NAK             0x15
+#define CAN             0x18
+#define CRC             0x43
+
+/* Local types */
+typedef enum {
+    SEND_WAIT_C,        /* For the header */
+    SEND_HEADER,        /* Header sent, ACK then 'C' */
+    SEND_DATA,
+    SEND_EOT,
+    SEND_END,           /* For the 'C' before the empty header */
+    SEND_DONE
+}SendState_t;
+
+/* Local variables */
+static uint64_t     s_ullNow     = 0;       /* ns, virtual */
+static uint8_t      s_ucLine[LINE_SIZE];    /* Sender to receiver, in flight */
+static uint64_t     s_ullAt[LINE_SIZE];     /* Arrival of each byte */
+static uint32_t     s_ulLineRd   = 0;
+static uint32_t     s_ulLineWr   = 0;
+static uint64_t     s_ullLineFree = 0;      /* The sender's line is busy until */
+static SendState_t  s_xSend      = SEND_WAIT_C;
+static Bool_t       s_bHeaderAck = FALSE;
+static uint32_t     s_ulBlock    = 0;       /* Data block being sent, from 1 */
+static uint32_t     s_ulBlockNum = 0;
+static uint8_t     *s_pucImg     = NULL;
+static uint32_t     s_ulImgSize  = 0;
+static uint64_t     s_ullT0      = 0;
+static uint64_t     s_ullT1      = 0;
+static Bool_t       s_bDone      = FALSE;
+static Bool_t       s_bImgOk     = FALSE;
+static uint32_t     s_ulEraseCnt = 0;
+static uint32_t     s_ulProgErr  = 0;
+static uint8_t      s_ucErased[PAGE_NUM];
+
+/* Functions */
+static uint16_t prvCrc16(const uint8_t *pucData, uint32_t ulLength)
+{
+    /* CRC-16/XMODEM */
+    uint16_t usCrc = 0;
+
+    while (ulLength--) {
+        usCrc ^= (uint16_t)*pucData++ << 8;
+        for (uint8_t n = 0; n < 8; n++) {
+            usCrc = (usCrc & 0x8000) ? ((usCrc << 1) ^ 0x1021) : (usCrc << 1);
+        }
+    }
+    return usCrc;
+}
+
+/* Onto the line from now, or after what is still going out */
+static void prvLinePut(const uint8_t *pucData, uint32_t ulLength)
+{
+    uint64_t ullAt = (s_ullLineFree > s_ullNow) ? s_ullLineFree : s_ullNow;
+
+    for (uint32_t n = 0; n < ulLength; n++) {
+        ullAt += BYTE_NS;
+        s_ucLine[s_ulLineWr % LINE_SIZE] = pucData[n];
+        s_ullAt[s_ulLineWr % LINE_SIZE]  = ullAt;
+        s_ulLineWr++;
+    }
+    s_ullLineFree = ullAt;
+}
+
+/* Block 0 is the header, a NULL name the empty one ending the session */
+static void prvSendBlock(uint32_t ulBlock, const char *pcName)
+{
+    static uint8_t ucPkt[1024 + 5];
+    uint32_t       ulSize = (ulBlock == 0) ? 128 : 1024;
+    uint16_t       usCrc;
+
+    ucPkt[0] = (ulSize == 128) ? SOH : STX;
+    ucPkt[1] = (uint8_t)ulBlock;
+    ucPkt[2] = (uint8_t)~ulBlock;
+    if (ulBlock == 0) {
+        memset(&ucPkt[3], 0, ulSize);
+        if (pcName != NULL) {
+            uint32_t ulLen = strlen(pcName);
+            memcpy(&ucPkt[3], pcName, ulLen);
+            sprintf((char *)&ucPkt[3 + ulLen + 1], "%u ", s_ulImgSize);
+        }
+    }
+    else {
+        /* The last block is padded with SUB */
+        uint32_t ulOff = (ulBlock - 1) * 1024;
+        uint32_t ulLen = ((s_ulImgSize - ulOff) < 1024) ? (s_ulImgSize - ulOff) : 1024;
+        memcpy(&ucPkt[3], &s_pucImg[ulOff], ulLen);
+        memset(&ucPkt[3 + ulLen], 0x1A, 1024 - ulLen);
+    }
+    usCrc = prvCrc16(&ucPkt[3], ulSize);
+    ucPkt[3 + ulSize] = usCrc >> 8;
+    ucPkt[4 + ulSize] = usCrc & 0xFF;
+    prvLinePut(ucPkt, ulSize + 5);
+}
+
+/* The sender, on a byte of the receiver */
+static void prvSender(uint8_t ucByte)
+{
+    uint8_t ucEot = EOT;
+
+    if (ucByte == CAN) {
+        s_xSend = SEND_DONE;
+        return;
+    }
+    switch (s_xSend) {
+    case SEND_WAIT_C:
+        if (ucByte == CRC) {
+            s_ullT0 = s_ullNow;
+            prvSendBlock(0, "App.bin");
+            s_xSend = SEND_HEADER;
+        }
+        break;
+    case SEND_HEADER:
+        if (ucByte == ACK) {
+            s_bHeaderAck = TRUE;
+        }
+        else if ((ucByte == CRC) && s_bHeaderAck) {
+            s_ulBlock = 1;
+            prvSendBlock(s_ulBlock, NULL);
+            s_xSend = SEND_DATA;
+        }
+        break;
+    case SEND_DATA:
+        if (ucByte == ACK) {
+            s_ulBlock++;
+        }
+        if ((ucByte == ACK) || (ucByte == NAK)) {
+            if (s_ulBlock <= s_ulBlockNum) {
+                prvSendBlock(s_ulBlock, NULL);
+            }
+            else {
+                prvLinePut(&ucEot, 1);
+                s_xSend = SEND_EOT;
+            }
+        }
+        break;
+    case SEND_EOT:
+        if (ucByte == ACK) {
+            s_xSend = SEND_END;
+        }
+        break;
+    case SEND_END:
+        if (ucByte == CRC) {
+            prvSendBlock(0, NULL);
+            s_xSend = SEND_DONE;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+    (void)GPIOx;
+    (void)GPIO_Init;
+}
+
+HAL_StatusTypeDef HAL_UART_Init(UART_HandleTypeDef *huart)
+{
+    return (huart->Init.BaudRate == BAUD) ? HAL_OK : HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)huart;
+    (void)Timeout;
+    for (uint16_t n = 0; n < Size; n++) {
+        s_ullNow += BYTE_NS;
+        prvSender(pData[n]);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size, uint32_t Timeout)
+{
+    (void)huart;
+    for (uint16_t n = 0; n < Size; n++) {
+        if ((s_ulLineRd == s_ulLineWr) || (s_ullAt[s_ulLineRd % LINE_SIZE] > (s_ullNow + Timeout * 1000000ULL))) {
+            s_ullNow += Timeout * 1000000ULL;
+            return HAL_TIMEOUT;
+        }
+        if (s_ullAt[s_ulLineRd % LINE_SIZE] > s_ullNow) {
+            s_ullNow = s_ullAt[s_ulLineRd % LINE_SIZE];
+        }
+        pData[n] = s_ucLine[s_ulLineRd % LINE_SIZE];
+        s_ulLineRd++;
+    }
+    return HAL_OK;
+}
+
+HAL_UART_StateTypeDef HAL_UART_GetState(UART_HandleTypeDef *huart)
+{
+    (void)huart;
+    return HAL_UART_STATE_READY;
+}
+
+/* The sender never asks for streaming */
+HAL_StatusTypeDef HAL_UART_Receive_DMA(UART_HandleTypeDef *huart, uint8_t *pData, uint16_t Size)
+{
+    (void)huart;
+    (void)pData;
+    (void)Size;
+    return HAL_ERROR;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return HAL_ERROR;
+}
+
+uint32_t HAL_DMA_SimCounter(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return 0;
+}
+
+uint32_t Crc32Hw(const uint32_t *pulData, uint32_t ulWords)
+{
+    (void)pulData;
+    (void)ulWords;
+    return 0;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+    volatile uint32_t *pulCell = (volatile uint32_t *)(uintptr_t)Address;
+
+    /* PGERR on a word not erased, the part leaves it as it was */
+    if ((TypeProgram != FLASH_TYPEPROGRAM_WORD) || (*pulCell != 0xFFFFFFFF)) {
+        s_ulProgErr++;
+        return HAL_ERROR;
+    }
+    *pulCell = (uint32_t)Data;
+    s_ullNow += PROGRAM_NS;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *PageError)
+{
+    for (uint32_t n = 0; n < pEraseInit->NbPages; n++) {
+        uint32_t ulAddr = pEraseInit->PageAddress + n * FLASH_PAGE_SIZE;
+        memset((void *)(uintptr_t)ulAddr, 0xFF, FLASH_PAGE_SIZE);
+        s_ucErased[(ulAddr - BOOT_UART_APP_ADDR) / FLASH_PAGE_SIZE]++;
+        s_ulEraseCnt++;
+        s_ullNow += ERASE_NS;
+    }
+    *PageError = 0xFFFFFFFF;
+    return HAL_OK;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return s_ullNow / 1000000ULL;
+}
+
+void HAL_Delay(uint32_t Delay)
+{
+    s_ullNow += Delay * 1000000ULL;
+}
+
+static void prvDone(void)
+{
+    s_ullT1  = s_ullNow;
+    s_bDone  = TRUE;
+    s_bImgOk = (0 == memcmp((void *)BOOT_UART_APP_ADDR, s_pucImg, s_ulImgSize));
+}
+
+/* BootUartRun ends here, done or not */
+void NVIC_SystemReset(void)
+{
+    uint32_t ulPages = (s_ulImgSize + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE;
+    Bool_t   bOver   = (s_ulImgSize > BOOT_UART_APP_SIZE);
+
+    if (ulPages > PAGE_NUM) {
+        ulPages = PAGE_NUM;
+    }
+    for (uint32_t n = 0; n < PAGE_NUM; n++) {
+        if (s_ucErased[n] != ((n < ulPages) ? 1 : 0)) {
+            printf("boot ymodem: %u bytes, page %u erased %u times: FAIL\n", s_ulImgSize, n, s_ucErased[n]);
+            _exit(1);
+        }
+    }
+    if ((s_xSend != SEND_DONE) || (s_ulProgErr != 0)) {
+        printf("boot ymodem: %u bytes, sender state %d, %u program errors: FAIL\n", s_ulImgSize, s_xSend, s_ulProgErr);
+        _exit(1);
+    }
+    if (bOver) {
+        if (s_bDone) {
+            printf("boot ymodem: %u bytes, past the region, done called: FAIL\n", s_ulImgSize);
+            _exit(1);
+        }
+        printf("    %6u B  past the region, %u pages erased, not booted: PASS\n", s_ulImgSize, s_ulEraseCnt);
+        _exit(0);
+    }
+    if (!s_bDone || !s_bImgOk) {
+        printf("boot ymodem: %u bytes, done %d, image %s: FAIL\n", s_ulImgSize, s_bDone, s_bImgOk ? "ok" : "bad");
+        _exit(1);
+    }
+    printf("    %6u B  %6.2f s (%2u)  %6.2f s (%u): PASS\n", s_ulImgSize,
+           (s_ullT1 - s_ullT0 + (PAGE_NUM - s_ulEraseCnt) * ERASE_NS) / 1e9, PAGE_NUM,
+           (s_ullT1 - s_ullT0) / 1e9, s_ulEraseCnt);
+    _exit(0);
+}
+
+/* One download in a forked child, BootUartRun leaves through NVIC_SystemReset */
+static void prvRun(uint32_t ulSize)
+{
+    BootUartConfig_t xConfig = {0};
+
+    /* The application region at its address, an old image in it */
+    if (MAP_FAILED == mmap((void *)BOOT_UART_APP_ADDR, BOOT_UART_APP_SIZE, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0)) {
+        printf("cannot map 0x%08X\n", BOOT_UART_APP_ADDR);
+        _exit(1);
+    }
+    memset((void *)BOOT_UART_APP_ADDR, 0x5A, BOOT_UART_APP_SIZE);
+    srand(ulSize);
+    s_ulImgSize  = ulSize;
+    s_ulBlockNum = (ulSize + 1023) / 1024;
+    s_pucImg     = malloc(ulSize);
+    for (uint32_t n = 0; n < ulSize; n++) {
+        s_pucImg[n] = rand();
+    }
+
+    xConfig.pxRxPinPort = GPIOA;
+    xConfig.pxTxPinPort = GPIOA;
+    xConfig.pxInstance  = USART1;
+    xConfig.ulBaudRate  = BAUD;
+    xConfig.pxDoneFunc  = prvDone;
+    BootUartConfig(&xConfig);
+    BootUartRun();
+    _exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t ulSize[] = {
+        16 * 1024, 64 * 1024, 100000, 128 * 1024, BOOT_UART_APP_SIZE, BOOT_UART_APP_SIZE + 2048
+    };
+    int lStatus;
+
+    (void)argc;
+    (void)argv;
+    /* A child leaves by _exit, nothing may wait in a buffer */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    printf("boot ymodem at %u baud, image, erase all (pages), lazy erase (pages):\n", BAUD);
+    for (uint32_t n = 0; n < (sizeof(ulSize) / sizeof(ulSize[0])); n++) {
+        pid_t xPid = fork();
+        if (xPid == 0) {
+            prvRun(ulSize[n]);
+        }
+        waitpid(xPid, &lStatus, 0);
+        if (!WIFEXITED(lStatus) || (WEXITSTATUS(lStatus) != 0)) {
+            printf("FAIL at %u bytes, status %x\n", ulSize[n], lStatus);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,276 @@
+/*
+    TestCrc.c
+
+    Host Known Answer Test and Benchmark of the Crc Module
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    Crc.c is compiled in here with CRC_TEST, so the bit, nibble and byte variants
+    of each CRC are all in reach. Each must give the published check values and the
+    known answers of the parts the tree talks to, agree with the bit by bit reference
+    on random buffers, give the same fed in pieces, and leave a zero residue with its
+    CRC appended, as BootUart checks a YMODEM packet. The crc_bench command runs once
+    on the host clock and must report no mismatch. Then each variant is timed over a
+    1 KB buffer, in ns per byte.
+*/
+
+/* Includes */
+#define CRC_TEST        1
+#include "Include.h"
+
+/* The cycle counter of crc_bench, TimeCycGet counts ns */
+typedef struct {
+    uint32_t CTRL;
+    uint32_t CYCCNT;
+}DwtSim_t;
+
+typedef struct {
+    uint32_t DEMCR;
+}CoreDebugSim_t;
+
+static DwtSim_t       s_xDwt;
+static CoreDebugSim_t s_xCoreDebug;
+
+static DwtSim_t *prvDwt(void)
+{
+    s_xDwt.CYCCNT = TimeCycGet();
+    return &s_xDwt;
+}
+
+#define DWT                         (prvDwt())
+#define CoreDebug                   (&s_xCoreDebug)
+#define CoreDebug_DEMCR_TRCENA_Msk  (1UL << 24)
+#define DWT_CTRL_CYCCNTENA_Msk      (1UL << 0)
+
+/* The module, with its statics */
+#include "Crc/Crc.c"
+
+/* Local defines */
+#define RAND_NUM        2000
+#define RAND_MAX_LEN    300
+#define BENCH_SIZE_B    1024
+#define BENCH_PASS      10000
+
+/* Local types */
+typedef enum {
+    CRC_MAXIM,
+    CRC_NRSC5,
+    CRC_XMODEM,
+    CRC_CCITT,
+    CRC_NUM
+}CrcKind_t;
+
+typedef struct {
+    CrcKind_t   xKind;
+    const char *pcData;
+    uint32_t    ulLength;
+    uint16_t    usCrc;
+    const char *pcWhat;
+}Kat_t;
+
+typedef uint32_t (*CrcFunc_t)(CrcKind_t xKind, uint32_t ulCrc, const uint8_t *pucData, uint32_t ulLength);
+
+/* Local variables */
+static const char *s_pcKind[CRC_NUM] = {"CRC8 MAXIM", "CRC8 NRSC5", "CRC16 XMODEM", "CRC16 CCITT"};
+static const uint16_t s_usInit[CRC_NUM] = {
+    CRC8_MAXIM_INIT, CRC8_NRSC5_INIT, CRC16_XMODEM_INIT, CRC16_CCITT_INIT
+};
+
+static const Kat_t s_xKat[] = {
+    {CRC_MAXIM,  "123456789", 9, 0xA1, "check value"},
+    {CRC_NRSC5,  "123456789", 9, 0xF7, "check value"},
+    {CRC_XMODEM, "123456789", 9, 0x31C3, "check value"},
+    {CRC_CCITT,  "123456789", 9, 0x29B1, "check value"},
+    {CRC_MAXIM,  "", 0, CRC8_MAXIM_INIT, "empty"},
+    {CRC_NRSC5,  "", 0, CRC8_NRSC5_INIT, "empty"},
+    {CRC_XMODEM, "", 0, CRC16_XMODEM_INIT, "empty"},
+    {CRC_CCITT,  "", 0, CRC16_CCITT_INIT, "empty"},
+    /* 1-Wire ROM 02 1C B8 01 00 00 00 A2, Maxim application note 27 */
+    {CRC_MAXIM,  "\x02\x1C\xB8\x01\x00\x00\x00", 7, 0xA2, "1-wire rom"},
+    /* Sensor word 0xBEEF, Sensirion humidity sensor datasheets */
+    {CRC_NRSC5,  "\xBE\xEF", 2, 0x92, "sensor word"},
+    {CRC_XMODEM, "A", 1, 0x58E5, "one byte"},
+    {CRC_CCITT,  "A", 1, 0xB915, "one byte"},
+};
+
+static volatile uint32_t s_ulSink;
+
+/* Functions */
+static uint32_t prvBit(CrcKind_t xKind, uint32_t ulCrc, const uint8_t *pucData, uint32_t ulLength)
+{
+    switch (xKind) {
+    case CRC_MAXIM: return prvCrc8MaximBit(ulCrc, pucData, ulLength);
+    case CRC_NRSC5: return prvCrc8Nrsc5Bit(ulCrc, pucData, ulLength);
+    default:        return prvCrc16CcittBit(ulCrc, pucData, ulLength);
+    }
+}
+
+static uint32_t prvNibble(CrcKind_t xKind, uint32_t ulCrc, const uint8_t *pucData, uint32_t ulLength)
+{
+    switch (xKind) {
+    case CRC_MAXIM: return prvCrc8MaximNibble(ulCrc, pucData, ulLength);
+    case CRC_NRSC5: return prvCrc8Nrsc5Nibble(ulCrc, pucData, ulLength);
+    default:        return prvCrc16CcittNibble(ulCrc, pucData, ulLength);
+    }
+}
+
+static uint32_t prvByte(CrcKind_t xKind, uint32_t ulCrc, const uint8_t *pucData, uint32_t ulLength)
+{
+    switch (xKind) {
+    case CRC_MAXIM: return prvCrc8MaximByte(ulCrc, pucData, ulLength);
+    case CRC_NRSC5: return prvCrc8Nrsc5Byte(ulCrc, pucData, ulLength);
+    default:        return prvCrc16CcittByte(ulCrc, pucData, ulLength);
+    }
+}
+
+/* The exported functions, as the callers see them */
+static uint32_t prvApi(CrcKind_t xKind, uint32_t ulCrc, const uint8_t *pucData, uint32_t ulLength)
+{
+    switch (xKind) {
+    case CRC_MAXIM: return Crc8Maxim(ulCrc, pucData, ulLength);
+    case CRC_NRSC5: return Crc8Nrsc5(ulCrc, pucData, ulLength);
+    default:        return Crc16Ccitt(ulCrc, pucData, ulLength);
+    }
+}
+
+static const CrcFunc_t   s_pfnVar[]  = {prvBit, prvNibble, prvByte, prvApi};
+static const char *const s_pcVar[]   = {"bit", "nibble", "byte", "api"};
+#define VAR_NUM         (sizeof(s_pfnVar) / sizeof(s_pfnVar[0]))
+
+static int prvChkKat(void)
+{
+    for (uint32_t n = 0; n < (sizeof(s_xKat) / sizeof(s_xKat[0])); n++) {
+        const Kat_t *px = &s_xKat[n];
+        for (uint32_t v = 0; v < VAR_NUM; v++) {
+            uint32_t ulCrc = s_pfnVar[v](px->xKind, s_usInit[px->xKind], (const uint8_t *)px->pcData, px->ulLength);
+            if (ulCrc != px->usCrc) {
+                printf("%s %s, %s: %04X, expected %04X\n", s_pcKind[px->xKind], px->pcWhat, s_pcVar[v],
+                       ulCrc, px->usCrc);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* Random buffers, all variants, whole and in pieces, and the residue */
+static int prvChkRand(void)
+{
+    uint8_t ucBuf[RAND_MAX_LEN + 2];
+
+    srand(1);
+    for (uint32_t n = 0; n < RAND_NUM; n++) {
+        uint32_t ulLen = rand() % RAND_MAX_LEN;
+        uint32_t ulCut = (ulLen > 0) ? (rand() % ulLen) : 0;
+        for (uint32_t m = 0; m < ulLen; m++) {
+            ucBuf[m] = rand();
+        }
+        for (uint32_t k = 0; k < CRC_NUM; k++) {
+            uint32_t ulRef = prvBit((CrcKind_t)k, s_usInit[k], ucBuf, ulLen);
+            for (uint32_t v = 0; v < VAR_NUM; v++) {
+                uint32_t ulCrc = s_pfnVar[v]((CrcKind_t)k, s_usInit[k], ucBuf, ulLen);
+                uint32_t ulTwo = s_pfnVar[v]((CrcKind_t)k, s_usInit[k], ucBuf, ulCut);
+                ulTwo = s_pfnVar[v]((CrcKind_t)k, ulTwo, &ucBuf[ulCut], ulLen - ulCut);
+                if ((ulCrc != ulRef) || (ulTwo != ulRef)) {
+                    printf("%s %s, %u bytes: %04X, in two at %u %04X, bit %04X\n", s_pcKind[k], s_pcVar[v],
+                           ulLen, ulCrc, ulCut, ulTwo, ulRef);
+                    return 1;
+                }
+            }
+            /* The CRC appended as it goes on the wire, the 16 bit ones high byte first */
+            uint32_t ulAll;
+            if (k == CRC_MAXIM || k == CRC_NRSC5) {
+                ucBuf[ulLen] = (uint8_t)ulRef;
+                ulAll = prvApi((CrcKind_t)k, s_usInit[k], ucBuf, ulLen + 1);
+            }
+            else {
+                ucBuf[ulLen]     = (uint8_t)(ulRef >> 8);
+                ucBuf[ulLen + 1] = (uint8_t)ulRef;
+                ulAll = prvApi((CrcKind_t)k, s_usInit[k], ucBuf, ulLen + 2);
+            }
+            if (ulAll != 0) {
+                printf("%s, %u bytes: residue %04X\n", s_pcKind[k], ulLen, ulAll);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static uint32_t s_ulMismatch = 0;
+static Bool_t   s_bLineStart = TRUE;
+
+/* Indented, a line may come in several calls */
+static void prvCliPrintf(const char *pcFormat, ...)
+{
+    char    cBuf[256];
+    va_list va;
+
+    va_start(va, pcFormat);
+    vsnprintf(cBuf, sizeof(cBuf), pcFormat, va);
+    va_end(va);
+    s_ulMismatch += (NULL != strstr(cBuf, "MISMATCH"));
+    printf("%s%s", s_bLineStart ? "    " : "", cBuf);
+    s_bLineStart = (cBuf[0] != 0) && (cBuf[strlen(cBuf) - 1] == '\n');
+}
+
+static void prvBench(void)
+{
+    static uint8_t ucBuf[BENCH_SIZE_B];
+
+    for (uint32_t n = 0; n < BENCH_SIZE_B; n++) {
+        ucBuf[n] = n * 0x9E3779B9 >> 24;
+    }
+    printf("crc: %d bytes, ns per byte\n", BENCH_SIZE_B);
+    /* CCITT stands for both 16 bit inits, the loop is the same */
+    for (uint32_t k = CRC_MAXIM; k <= CRC_CCITT; k++) {
+        if (k == CRC_XMODEM) {
+            continue;
+        }
+        printf("    %-12s:", s_pcKind[k]);
+        for (uint32_t v = 0; v < 3; v++) {
+            uint32_t ulCrc = s_usInit[k];
+            uint32_t ulCyc = TimeCycGet();
+            for (uint32_t p = 0; p < BENCH_PASS; p++) {
+                ulCrc = s_pfnVar[v]((CrcKind_t)k, ulCrc, ucBuf, BENCH_SIZE_B);
+            }
+            ulCyc = TimeCycGet() - ulCyc;
+            s_ulSink += ulCrc;
+            printf(" %s %5.2f", s_pcVar[v], (double)ulCyc / BENCH_PASS / BENCH_SIZE_B);
+        }
+        printf("\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    if (0 != prvChkKat()) {
+        printf("crc known answers: FAIL\n");
+        return 1;
+    }
+    printf("crc: %u known answers, bit, nibble, byte and api: PASS\n", (unsigned)(sizeof(s_xKat) / sizeof(s_xKat[0])));
+    if (0 != prvChkRand()) {
+        printf("crc random buffers: FAIL\n");
+        return 1;
+    }
+    printf("crc: %u random buffers agree with the bit reference, whole and in two, zero residue: PASS\n", RAND_NUM);
+
+    printf("crc_bench on the host clock:\n");
+    prvCliCmdCrcBench(prvCliPrintf, 1, NULL);
+    if (s_ulMismatch != 0) {
+        printf("crc_bench: %u mismatches: FAIL\n", s_ulMismatch);
+        return 1;
+    }
+    prvBench();
+    return 0;
+}
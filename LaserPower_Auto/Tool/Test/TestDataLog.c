@@ -0,0 +1,171 @@
+/*
+    TestDataLog.c
+
+    Host Test for the App Data Log, Saves Cut by Power Losses
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    Each boot is a forked child on the same flash image. It loads the log, checks
+    the image is the last save that returned or the one cut, then saves random
+    changes until the flash simulator cuts it at a random byte. A load must never
+    return a mix of two saves, nor anything older than the last save that returned.
+*/
+
+/* Includes */
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Include.h"
+#include "FlashSim.h"
+#include "User/DataLog.h"
+
+/* Local defines */
+#define IMG_SIZE        120
+#define HIST_MAX        4096        /* Saves kept to check DataLogLoadPrev against */
+#define BOOT_NUM        3000
+#define CUT_MAX         6000        /* Bytes programmed at most before a cut */
+
+/* Local types */
+typedef struct {
+    uint8_t  ucAcked[IMG_SIZE];     /* Last save that returned */
+    uint8_t  ucPending[IMG_SIZE];   /* Save in progress */
+    uint32_t ulAcked;               /* Saves that returned */
+    Bool_t   bPending;
+    uint32_t ulPendingHit;          /* Boots that found the cut save complete */
+    uint32_t ulPrevChk;
+    uint8_t  ucHist[HIST_MAX][IMG_SIZE];
+}Shared_t;
+
+/* Local variables */
+static Shared_t *s_pxSh;
+
+/* Functions */
+static void prvAck(const uint8_t *pucImg)
+{
+    memcpy(s_pxSh->ucAcked, pucImg, IMG_SIZE);
+    memcpy(s_pxSh->ucHist[s_pxSh->ulAcked % HIST_MAX], pucImg, IMG_SIZE);
+    s_pxSh->ulAcked++;
+    s_pxSh->bPending = FALSE;
+}
+
+/* Every older image must be an earlier save, newest first */
+static int prvChkPrev(void)
+{
+    uint8_t  ucImg[IMG_SIZE];
+    uint32_t ulAt = s_pxSh->ulAcked;
+
+    while (STATUS_OK == DataLogLoadPrev(ucImg, IMG_SIZE)) {
+        while (1) {
+            if ((s_pxSh->ulAcked - ulAt) >= HIST_MAX) {
+                /* Older than the history, cannot tell */
+                return 0;
+            }
+            if (ulAt == 0) {
+                printf("older image is no earlier save\n");
+                return 1;
+            }
+            ulAt--;
+            if (0 == memcmp(ucImg, s_pxSh->ucHist[ulAt % HIST_MAX], IMG_SIZE)) {
+                break;
+            }
+        }
+        s_pxSh->ulPrevChk++;
+    }
+    return 0;
+}
+
+static int prvBoot(uint32_t ulBoot)
+{
+    uint8_t ucImg[IMG_SIZE];
+
+    srand(ulBoot * 7919 + 1);
+    if (STATUS_OK == DataLogInit(IMG_SIZE)) {
+        if (STATUS_OK != DataLogLoad(ucImg, IMG_SIZE)) {
+            printf("boot %u: load failed\n", ulBoot);
+            return 1;
+        }
+        if (s_pxSh->bPending && (0 == memcmp(ucImg, s_pxSh->ucPending, IMG_SIZE))) {
+            prvAck(ucImg);
+            s_pxSh->ulPendingHit++;
+        }
+        if ((s_pxSh->ulAcked == 0) || (0 != memcmp(ucImg, s_pxSh->ucAcked, IMG_SIZE))) {
+            printf("boot %u: image is not the last save\n", ulBoot);
+            return 1;
+        }
+        if (((ulBoot % 16) == 0) && (0 != prvChkPrev())) {
+            return 1;
+        }
+    }
+    else if (s_pxSh->ulAcked != 0) {
+        printf("boot %u: log lost after %u saves\n", ulBoot, s_pxSh->ulAcked);
+        return 1;
+    }
+    else {
+        for (uint32_t n = 0; n < IMG_SIZE; n++) {
+            ucImg[n] = rand();
+        }
+    }
+
+    FlashSimCut(1 + rand() % CUT_MAX);
+    while (1) {
+        /* A few settings at a time, now and then a block */
+        uint32_t ulNum = 1 + rand() % 4;
+        for (uint32_t n = 0; n < ulNum; n++) {
+            uint32_t ulOfs = rand() % IMG_SIZE;
+            uint32_t ulLen = ((rand() % 8) == 0) ? (1 + rand() % 24) : 1;
+            for (uint32_t m = ulOfs; (m < IMG_SIZE) && (m < (ulOfs + ulLen)); m++) {
+                ucImg[m] = rand();
+            }
+        }
+        memcpy(s_pxSh->ucPending, ucImg, IMG_SIZE);
+        s_pxSh->bPending = TRUE;
+        if (STATUS_OK != DataLogSave(ucImg, IMG_SIZE)) {
+            printf("boot %u: save failed\n", ulBoot);
+            return 1;
+        }
+        prvAck(ucImg);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *pcImg = (argc > 1) ? argv[1] : "DataLog.img";
+    int         lStatus;
+
+    /* A child leaves by _exit, nothing may wait in a buffer */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    unlink(pcImg);
+    /* One sector spare, the replay cache reads past the last one */
+    if (0 != FlashSimOpen(pcImg, DATA_LOG_ADDR + DATA_LOG_SECTOR * (DATA_LOG_SECTOR_NUM + 1))) {
+        printf("cannot open %s\n", pcImg);
+        return 1;
+    }
+    s_pxSh = mmap(NULL, sizeof(Shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memset(s_pxSh, 0, sizeof(Shared_t));
+
+    for (uint32_t ulBoot = 0; ulBoot < BOOT_NUM; ulBoot++) {
+        pid_t xPid = fork();
+        if (xPid == 0) {
+            _exit(prvBoot(ulBoot));
+        }
+        waitpid(xPid, &lStatus, 0);
+        if (!WIFEXITED(lStatus) || (WEXITSTATUS(lStatus) != 0)) {
+            printf("FAIL at boot %u, status %x\n", ulBoot, lStatus);
+            return 1;
+        }
+    }
+
+    printf("data log: %u boots cut at random, %u saves returned, %u cut saves found whole, "
+           "%u older saves checked: PASS\n", BOOT_NUM, s_pxSh->ulAcked, s_pxSh->ulPendingHit, s_pxSh->ulPrevChk);
+    FlashSimClose();
+    unlink(pcImg);
+    return 0;
+}
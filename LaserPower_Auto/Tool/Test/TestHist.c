@@ -0,0 +1,538 @@
+/*
+    TestHist.c
+
+    Host Benchmark and Test of the Telemetry Historian on a File Backed Flash Image
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    Hist.c is compiled in here, so the export and a reboot are in reach. The plant
+    is a function of the second and the channel: temperatures drift over the day
+    with a little AD noise, the currents follow laser shifts, the supply sags under
+    load and the cabinet moves slowly. Frames are put as prvHistTask puts them, at
+    the default rates, for DAYS days from T0, more than the ring holds, so it wraps.
+
+    Every sample a query returns must be the plant's and a query must return all
+    of them. HistFind must match a linear walk over the page heads and read no more
+    heads than log2(pages + 1), rounded up. A lost page may take its own samples only, a
+    reboot must find the ring where it was left and the export must send the pages
+    a query reads.
+*/
+
+/* Includes */
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "Include.h"
+#include "FlashSim.h"
+#include "User/Hist.h"
+
+/* What prvSample and the hourly RTC read need, the task never runs on the host */
+typedef enum {
+    RTC_TYPE_DS1338 = 2
+}RtcType_t;
+
+typedef enum {
+    ADC_CHAN_1,
+    ADC_CHAN_3,
+    ADC_CHAN_5
+}AdcChan_t;
+
+#define PWR2_M1_ADDR    1
+#define PWR_OUTPUT_VOL  0
+
+Time_t   RtcReadTime(RtcType_t xRtcType);
+uint16_t AdcGet(AdcChan_t xChan);
+int32_t  PwrDataGet(uint32_t ulPwr2Addr, int xType);
+Status_t aht30_read_humiture(int *temperature, uint16_t *humidity);
+
+/* The historian, with its statics */
+#include "User/Hist.c"
+
+/* Local defines */
+#define T0              1790000000  /* 2026-09-21 */
+#define DAYS            14
+#define DAY             86400
+#define QRY_NUM         300
+#define FIND_NUM        5000
+
+/* Local types */
+typedef struct {
+    uint32_t ulStart;
+    uint32_t ulEnd;
+    uint32_t ulCnt[HIST_CH_NUM];
+    uint32_t ulLastTime;
+    uint32_t ulBad;
+    Bool_t   bPages;                    /* Whole pages, samples out of the window are skipped */
+}Chk_t;
+
+/* Local variables */
+static uint32_t s_ulHead[PAGE_NUM];     /* Head time by page, s_ulFirstSeq on */
+static uint32_t s_ulSec = 0;            /* Seconds put since T0 */
+
+Data_t   g_xData;
+
+/* Functions */
+Time_t RtcReadTime(RtcType_t xRtcType)
+{
+    time_t xT = T0;
+    (void)xRtcType;
+    return *gmtime(&xT);
+}
+
+uint16_t AdcGet(AdcChan_t xChan)
+{
+    (void)xChan;
+    return 0;
+}
+
+int32_t PwrDataGet(uint32_t ulPwr2Addr, int xType)
+{
+    (void)ulPwr2Addr;
+    (void)xType;
+    return 0;
+}
+
+Status_t aht30_read_humiture(int *temperature, uint16_t *humidity)
+{
+    (void)temperature;
+    (void)humidity;
+    return STATUS_ERR;
+}
+
+int16_t StcGetTemp(StcDev_t xDev, StcTempNode_t xTempNode)
+{
+    (void)xDev;
+    (void)xTempNode;
+    return 0;
+}
+
+static uint64_t prvNs(void)
+{
+    struct timespec xTs;
+
+    clock_gettime(CLOCK_MONOTONIC, &xTs);
+    return (uint64_t)xTs.tv_sec * 1000000000ULL + xTs.tv_nsec;
+}
+
+/* Noise in -k..k, the same for the same second and channel */
+static int32_t prvNoise(uint32_t ulSec, uint8_t ucCh, int32_t k)
+{
+    uint32_t h = ulSec * 0x9E3779B1u ^ (ucCh + 1) * 0x85EBCA77u;
+
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    h *= 0x297A2D39u;
+    h ^= h >> 15;
+    return (int32_t)(h % (2 * k + 1)) - k;
+}
+
+/* -a..a over a day */
+static int32_t prvDayWave(uint32_t ulSec, uint32_t ulOfs, int32_t a)
+{
+    int32_t p = (ulSec + ulOfs) % DAY;
+    return (abs(p - DAY / 2) * 2 * a) / (DAY / 2) - a;
+}
+
+/* Lasers run 08:00 - 20:00, off for half an hour every two */
+static Bool_t prvLaserOn(uint32_t ulSec)
+{
+    uint32_t ulDay = ulSec % DAY;
+    return ((ulDay >= 8 * 3600) && (ulDay < 20 * 3600) && (((ulSec / 1800) % 4) != 3)) ? TRUE : FALSE;
+}
+
+static int32_t prvPlant(uint32_t ulSec, uint8_t ucCh)
+{
+    Bool_t bOn = prvLaserOn(ulSec);
+
+    if (ucCh <= HIST_CH_TEMP10) {
+        /* Raw AD, falls as the temperature rises */
+        return 2000 + ucCh * 20 + prvDayWave(ulSec, ucCh * 1800, 60) - (bOn ? 40 : 0) + prvNoise(ulSec, ucCh, 2);
+    }
+    if (ucCh <= HIST_CH_CUR3) {
+        return bOn ? (3000 + (ucCh - HIST_CH_CUR1) * 100 + prvNoise(ulSec, ucCh, 3)) : prvNoise(ulSec, ucCh, 1);
+    }
+    if (ucCh == HIST_CH_MPWR_VOL) {
+        return (bOn ? 470 : 480) + prvNoise(ulSec, ucCh, 1);
+    }
+    if (ucCh == HIST_CH_HUMI) {
+        return 45 + prvDayWave(ulSec, 0, 5);
+    }
+    return 25 + (bOn ? 3 : 0) + prvDayWave(ulSec, 6 * 3600, 2);
+}
+
+/* Channels due in a second, as prvHistTask picks them */
+static uint16_t prvMask(uint32_t ulSec)
+{
+    uint16_t usMask = 0;
+
+    for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+        if (s_usRateDef[ch] && ((ulSec % s_usRateDef[ch]) == 0)) {
+            usMask |= CH_BIT(ch);
+        }
+    }
+    return usMask;
+}
+
+static uint32_t prvPut(uint32_t ulNum)
+{
+    int32_t lVal[HIST_CH_NUM];
+
+    for (uint32_t n = 0; n < ulNum; n++, s_ulSec++) {
+        uint16_t usMask = prvMask(s_ulSec);
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            lVal[ch] = (usMask & CH_BIT(ch)) ? prvPlant(s_ulSec, ch) : 0x5A5A5A5A;
+        }
+        if (STATUS_OK != HistPut(T0 + s_ulSec, usMask, lVal)) {
+            printf("put failed at %u\n", s_ulSec);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void prvChkSample(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara)
+{
+    Chk_t *pxChk = (Chk_t *)pvPara;
+
+    if (pxChk->bPages && ((ulTime < pxChk->ulStart) || (ulTime > pxChk->ulEnd))) {
+        return;
+    }
+    if ((ulTime < pxChk->ulStart) || (ulTime > pxChk->ulEnd) || (ulTime < pxChk->ulLastTime) ||
+        (lVal != prvPlant(ulTime - T0, ucCh))) {
+        pxChk->ulBad++;
+    }
+    pxChk->ulLastTime = ulTime;
+    pxChk->ulCnt[ucCh]++;
+}
+
+/* Samples of a channel due in a window */
+static uint32_t prvDue(uint32_t ulStart, uint32_t ulEnd, uint8_t ucCh)
+{
+    uint32_t ulRate = s_usRateDef[ucCh];
+    uint32_t ulA    = ulStart - T0;
+    uint32_t ulB    = ulEnd - T0;
+
+    return ulB / ulRate - ((ulA == 0) ? 0 : ((ulA - 1) / ulRate + 1)) + 1;
+}
+
+/* The samples a query returns, pulLost taken off each channel */
+static int prvQuery(uint32_t ulStart, uint32_t ulEnd, uint16_t usMask, const uint32_t *pulLost)
+{
+    Chk_t xChk;
+
+    memset(&xChk, 0, sizeof(xChk));
+    xChk.ulStart = ulStart;
+    xChk.ulEnd   = ulEnd;
+    HistQuery(ulStart, ulEnd, usMask, prvChkSample, &xChk);
+    if (xChk.ulBad != 0) {
+        printf("query %u - %u: %u samples out of range, order or value\n", ulStart, ulEnd, xChk.ulBad);
+        return 1;
+    }
+    for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+        uint32_t ulWant = (usMask & CH_BIT(ch)) ? (prvDue(ulStart, ulEnd, ch) - (pulLost ? pulLost[ch] : 0)) : 0;
+        if (xChk.ulCnt[ch] != ulWant) {
+            printf("query %u - %u ch %u: %u samples, %u due\n", ulStart, ulEnd, ch, xChk.ulCnt[ch], ulWant);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* Oldest complete second, the first frame of the oldest page */
+static uint32_t prvOldest(void)
+{
+    HistPage_t xPage;
+
+    HistReadPage(s_ulFirstSeq, &xPage);
+    return xPage.xHead.ulTime;
+}
+
+static uint32_t prvRand(uint32_t ulMin, uint32_t ulMax)
+{
+    return ulMin + (uint32_t)(((uint64_t)rand() * RAND_MAX + rand()) % (ulMax - ulMin + 1));
+}
+
+static int prvChkQuery(void)
+{
+    uint32_t ulOldest = prvOldest();
+    uint32_t ulNewest = T0 + s_ulSec - 1;
+    uint64_t ullNs    = 0;
+
+    for (uint32_t n = 0; n < QRY_NUM; n++) {
+        uint32_t ulLen   = prvRand(60, 6 * 3600);
+        uint32_t ulStart = prvRand(ulOldest, ulNewest - ulLen);
+        uint16_t usMask  = (n == 0) ? CH_ALL : (uint16_t)prvRand(1, CH_ALL);
+        uint64_t ullAt   = prvNs();
+        if (0 != prvQuery(ulStart, ulStart + ulLen, usMask, NULL)) {
+            return 1;
+        }
+        ullNs += prvNs() - ullAt;
+    }
+    printf("    %u queries of 1 min - 6 h over %.1f days kept: all samples, %.0f us each\n",
+           QRY_NUM, (ulNewest - ulOldest) / (double)DAY, ullNs / 1000.0 / QRY_NUM);
+    return 0;
+}
+
+/* The head search against a walk over all heads */
+static int prvChkFind(void)
+{
+    HistPage_t     xPage;
+    FlashSimStat_t xStat;
+    uint32_t       ulEnd  = HistEnd();
+    uint32_t       ulNum  = ulEnd - s_ulFirstSeq;
+    uint32_t       ulLog  = 0;
+    uint32_t       ulMax  = 0;
+    uint64_t       ullSum = 0;
+    uint64_t       ullNs  = 0;
+
+    for (uint32_t ulSeq = s_ulFirstSeq; ulSeq < ulEnd; ulSeq++) {
+        if (STATUS_OK != HistReadPage(ulSeq, &xPage)) {
+            printf("page %u lost\n", ulSeq);
+            return 1;
+        }
+        s_ulHead[ulSeq - s_ulFirstSeq] = xPage.xHead.ulTime;
+    }
+    while ((1UL << ulLog) < (ulNum + 1)) {
+        ulLog++;
+    }
+
+    for (uint32_t n = 0; n < FIND_NUM; n++) {
+        uint32_t ulTime;
+        /* The edges, heads themselves, then anywhere around the ring */
+        if (n < 4) {
+            ulTime = (n == 0) ? 0 : (n == 1) ? s_ulHead[0] - 1 : (n == 2) ? s_ulHead[0] : 0xFFFFFFFF;
+        }
+        else if (n < 1000) {
+            ulTime = s_ulHead[prvRand(0, ulNum - 1)] - (n & 1);
+        }
+        else {
+            ulTime = prvRand(s_ulHead[0] - DAY, T0 + s_ulSec + DAY);
+        }
+
+        uint32_t ulWant = s_ulFirstSeq;
+        for (uint32_t m = 0; (m < ulNum) && (s_ulHead[m] <= ulTime); m++) {
+            ulWant = s_ulFirstSeq + m;
+        }
+
+        FlashSimStatClear();
+        uint64_t ullAt = prvNs();
+        uint32_t ulGot = HistFind(ulTime);
+        ullNs += prvNs() - ullAt;
+        FlashSimStat(&xStat);
+        uint32_t ulReads = xStat.ullReadByte / sizeof(HistHead_t);
+        if (ulGot != ulWant) {
+            printf("find %u: page %u, walk says %u\n", ulTime, ulGot, ulWant);
+            return 1;
+        }
+        if (ulReads > ulLog) {
+            printf("find %u: %u head reads, %u pages\n", ulTime, ulReads, ulNum);
+            return 1;
+        }
+        ullSum += ulReads;
+        ulMax   = (ulReads > ulMax) ? ulReads : ulMax;
+    }
+    printf("    %u finds over %u pages as a walk does: %.1f head reads mean, %u max, %.2f us each\n",
+           FIND_NUM, ulNum, (double)ullSum / FIND_NUM, ulMax, ullNs / 1000.0 / FIND_NUM);
+    return 0;
+}
+
+static void prvCntSample(uint32_t ulTime, uint8_t ucCh, int32_t lVal, void *pvPara)
+{
+    (void)ulTime;
+    (void)lVal;
+    ((uint32_t *)pvPara)[ucCh]++;
+}
+
+/* A page torn on its head takes its own samples and no others */
+static int prvChkLost(void)
+{
+    HistPage_t xPage;
+    uint32_t   ulLost[HIST_CH_NUM] = {0};
+    uint32_t   ulSeq  = s_ulFirstSeq + (HistEnd() - s_ulFirstSeq) / 2;
+    uint8_t   *pucImg = FlashSimImage() + PAGE_ADDR(ulSeq);
+    uint8_t    ucSave[HIST_PAGE];
+    int        lRet;
+
+    HistReadPage(ulSeq, &xPage);
+    HistDecode(&xPage, prvCntSample, ulLost);
+    memcpy(ucSave, pucImg, HIST_PAGE);
+    pucImg[0] &= 0x0F;
+
+    uint32_t ulStart = s_ulHead[ulSeq - s_ulFirstSeq - 2];
+    uint32_t ulEnd   = s_ulHead[ulSeq - s_ulFirstSeq + 2];
+    lRet = prvQuery(ulStart, ulEnd, CH_ALL, ulLost);
+    /* Starting inside the lost page too */
+    if (lRet == 0) {
+        uint32_t ulIn = xPage.xHead.ulTime + 1;
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            ulLost[ch] = 0;
+        }
+        HistQuery(ulIn, s_ulHead[ulSeq - s_ulFirstSeq + 1] - 1, CH_ALL, prvCntSample, ulLost);
+        for (uint8_t ch = 0; ch < HIST_CH_NUM; ch++) {
+            if (ulLost[ch] != 0) {
+                printf("lost page %u: samples of it returned\n", ulSeq);
+                lRet = 1;
+            }
+        }
+        memset(ulLost, 0, sizeof(ulLost));
+        lRet |= prvQuery(s_ulHead[ulSeq - s_ulFirstSeq + 1], ulEnd, CH_ALL, ulLost);
+    }
+    memcpy(pucImg, ucSave, HIST_PAGE);
+    if (lRet == 0) {
+        printf("    page %u torn: a query over it loses its samples only\n", ulSeq);
+    }
+    return lRet;
+}
+
+/* Flushed and booted again, the ring is found where it was left */
+static int prvChkReboot(void)
+{
+    uint32_t ulEnd, ulFirst, ulFind[16];
+
+    HistFlush();
+    ulEnd   = HistEnd();
+    ulFirst = s_ulFirstSeq;
+    srand(1);
+    for (uint32_t n = 0; n < 16; n++) {
+        ulFind[n] = HistFind(prvRand(prvOldest(), T0 + s_ulSec));
+    }
+
+    srand(1);
+    s_bInit = FALSE;
+    memset(&s_xPage, 0xA5, sizeof(s_xPage));
+    AppHistInit();
+    if ((HistEnd() != ulEnd) || (s_ulFirstSeq != ulFirst)) {
+        printf("reboot: pages %u - %u, were %u - %u\n", s_ulFirstSeq, HistEnd(), ulFirst, ulEnd);
+        return 1;
+    }
+    srand(1);
+    for (uint32_t n = 0; n < 16; n++) {
+        uint32_t ulGot = HistFind(prvRand(prvOldest(), T0 + s_ulSec));
+        if (ulGot != ulFind[n]) {
+            printf("reboot: find gives page %u, was %u\n", ulGot, ulFind[n]);
+            return 1;
+        }
+    }
+    printf("    reboot: pages %u - %u found in %u us\n", s_ulFirstSeq, HistEnd(), s_ulScanTime);
+
+    /* Another hour on, queries across the boot */
+    if ((0 != prvPut(3600)) || (0 != prvQuery(T0 + s_ulSec - 7200, T0 + s_ulSec - 1, CH_ALL, NULL))) {
+        return 1;
+    }
+    return 0;
+}
+
+/* The pages sent for the last hour hold what a query over it returns */
+static int prvChkExport(void)
+{
+    HistExpReq_t  xReq;
+    HistExpHead_t xHead;
+    HistPage_t    xPage;
+    Chk_t         xChk;
+    int           lSock[2];
+    int           lRet = 0;
+
+    if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, lSock)) {
+        printf("socketpair failed\n");
+        return 1;
+    }
+    xReq.ulStart = T0 + s_ulSec - 3600;
+    xReq.ulEnd   = T0 + s_ulSec - 1;
+    send(lSock[1], &xReq, sizeof(xReq), 0);
+    prvExport(lSock[0]);
+    close(lSock[0]);
+
+    memset(&xChk, 0, sizeof(xChk));
+    xChk.ulStart = xReq.ulStart;
+    xChk.ulEnd   = xReq.ulEnd;
+    xChk.bPages  = TRUE;
+    if ((recv(lSock[1], &xHead, sizeof(xHead), MSG_WAITALL) != sizeof(xHead)) || (xHead.ulMagic != HIST_EXP_MAGIC) ||
+        (xHead.usPage != HIST_PAGE) || (xHead.ucChNum != HIST_CH_NUM) || (xHead.ulSeq + xHead.ulNum != HistEnd())) {
+        printf("export: bad head\n");
+        lRet = 1;
+    }
+    for (uint32_t n = 0; (lRet == 0) && (n < xHead.ulNum); n++) {
+        if ((recv(lSock[1], &xPage, HIST_PAGE, MSG_WAITALL) != HIST_PAGE) ||
+            (STATUS_OK != HistDecode(&xPage, prvChkSample, &xChk))) {
+            printf("export: page %u of %u short or bad\n", n, xHead.ulNum);
+            lRet = 1;
+        }
+    }
+    close(lSock[1]);
+    for (uint8_t ch = 0; (lRet == 0) && (ch < HIST_CH_NUM); ch++) {
+        if ((xChk.ulBad != 0) || (xChk.ulCnt[ch] != prvDue(xReq.ulStart, xReq.ulEnd, ch))) {
+            printf("export ch %u: %u samples sent, %u due\n", ch, xChk.ulCnt[ch], prvDue(xReq.ulStart, xReq.ulEnd, ch));
+            lRet = 1;
+        }
+    }
+    if (lRet == 0) {
+        printf("    export of the last hour: %u pages from %u, every sample in it\n", xHead.ulNum, xHead.ulSeq);
+    }
+    return lRet;
+}
+
+int main(int argc, char **argv)
+{
+    const char    *pcImg = (argc > 1) ? argv[1] : "Hist.img";
+    uint32_t       ulDays = (argc > 2) ? atoi(argv[2]) : DAYS;
+    FlashSimStat_t xStat;
+    uint64_t       ullNs;
+
+    unlink(pcImg);
+    if (0 != FlashSimOpen(pcImg, HIST_ADDR + HIST_SECTOR * HIST_SECTOR_NUM)) {
+        printf("cannot open %s\n", pcImg);
+        return 1;
+    }
+    srand(1);
+    g_xData.ucTempNum = 10;
+    AppHistInit();
+
+    /* The benchmark, a day at a time */
+    printf("historian, %u channels at the default rates, %u days:\n", HIST_CH_NUM, ulDays);
+    ullNs = prvNs();
+    /* Until the ring is full, from there on a page in is a page out */
+    while ((s_ulFirstSeq == 0) && (s_ulSec < ulDays * DAY)) {
+        if (0 != prvPut(60)) {
+            return 1;
+        }
+    }
+    ullNs = prvNs() - ullNs;
+    FlashSimStat(&xStat);
+    double dDays = s_ulSec / (double)DAY;
+    double dByte = (double)xStat.ullProgByte / s_ulSampleCnt;
+    double dDay  = xStat.ullProgByte / dDays / 1024;
+    printf("    %.2f days to fill the ring, %u samples in %u frames, %u pages\n",
+           dDays, s_ulSampleCnt, s_ulFrameCnt, s_ulPageCnt);
+    printf("    %.2f bytes/sample programmed (2 raw), %.0f KB/day, the %u KB ring holds %.1f days\n",
+           dByte, dDay, HIST_SECTOR * HIST_SECTOR_NUM / 1024, HIST_SECTOR * HIST_SECTOR_NUM / 1024 / dDay);
+    printf("    %.0f ns per frame put, program max %u us with the erase\n", (double)ullNs / s_ulFrameCnt, s_ulProgMax);
+
+    /* Then wrapped for the rest */
+    FlashSimStatClear();
+    if ((s_ulSec < ulDays * DAY) && (0 != prvPut(ulDays * DAY - s_ulSec))) {
+        return 1;
+    }
+    FlashSimStat(&xStat);
+    printf("    %u days put, %u erases, %u per sector at most\n", ulDays, (uint32_t)xStat.ullEraseCnt,
+           (uint32_t)xStat.ullEraseMax);
+
+    if ((0 != prvChkQuery()) || (0 != prvChkFind()) || (0 != prvChkLost()) || (0 != prvChkReboot()) ||
+        (0 != prvChkExport())) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("historian: PASS\n");
+    FlashSimClose();
+    unlink(pcImg);
+    return 0;
+}
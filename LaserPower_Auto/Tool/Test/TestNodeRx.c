@@ -0,0 +1,486 @@
+/*
+    TestNodeRx.c
+
+    Host Test of the STC Node Frame Assembler Against a Scripted Byte Stream
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    The node main.c is compiled in here against StubC51/, so its statics are in
+    reach. Time is virtual (us). The master bytes reach UartRxIsrProc at 115200
+    baud, every S2BUF write puts a byte on the line and raises TI one byte time
+    later, TimerProc runs every ms and each adc conversion ends in AdcIsrProc.
+    The main loop runs one pass per LOOP_US and its EA accesses let the isrs in,
+    so it can wait in TxFrame as on the part.
+
+    Latency is from the isr of the last request byte to the first reply byte
+    written to S2BUF. The main loop pass cost is modelled, not measured, the
+    temp query answered by the isr does not depend on it.
+*/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "config.h"
+
+/* The node firmware, with the isr entry points and the main loop pieces */
+#define main NodeMain
+#include "main.c"
+#undef main
+#undef int8_t
+#undef int16_t
+#undef int32_t
+#undef uint8_t
+#undef uint16_t
+#undef uint32_t
+
+/* Local defines */
+#define BAUD            115200
+#define LOOP_US         50          /* Main loop pass, modelled */
+#define ADC_CONV_US     8
+#define RX_MAX          4096
+#define WIRE_MAX        (1 << 20)
+#define FUZZ_NUM        20000
+
+/* Local types */
+typedef struct {
+    uint64_t ullAt;
+    uint8_t  ucByte;
+}RxByte_t;
+
+/* Local variables */
+volatile uint8_t  P36;
+volatile uint8_t  TH0;
+volatile uint8_t  TL0;
+volatile uint8_t  TF0;
+volatile uint8_t  ADC_CONTR;
+volatile uint8_t  ADC_RES;
+volatile uint8_t  ADC_RESL;
+uint8_t           g_ucSimTx[WIRE_MAX];
+uint32_t          g_ulSimTxNum = 0;
+
+static volatile uint8_t s_ucEa = 0;
+static uint64_t  s_ullNow = 0;
+static uint8_t   s_bIsr = 0;
+static uint32_t  s_ulNodeBaud = BAUD;
+/* Master to node */
+static RxByte_t  s_xRx[RX_MAX];
+static uint32_t  s_ulRxHead = 0;
+static uint32_t  s_ulRxTail = 0;
+static uint64_t  s_ullRxLast = 0;   /* Isr time of the last byte taken */
+/* Node to master */
+static uint64_t  s_ullTxAt[WIRE_MAX];
+static uint32_t  s_ulTxSeen = 0;
+static uint64_t  s_ullTiAt = 0;
+/* Timer and adc */
+static uint64_t  s_ullTickAt = 0;
+static uint64_t  s_ullAdcAt = 0;
+static uint16_t  s_usAdcIn[16];
+
+/* Functions */
+
+static uint64_t prvByteUs(void)
+{
+    return (10 * 1000000ULL + s_ulNodeBaud - 1) / s_ulNodeBaud;
+}
+
+/* A byte written to S2BUF by the last isr or main loop step */
+static void prvTxChk(void)
+{
+    if (g_ulSimTxNum != s_ulTxSeen) {
+        s_ullTxAt[s_ulTxSeen] = s_ullNow;
+        s_ulTxSeen = g_ulSimTxNum;
+        s_ullTiAt  = s_ullNow + prvByteUs();
+    }
+    if ((ADC_CONTR & ADC_START) && (0 == s_ullAdcAt)) {
+        s_ullAdcAt = s_ullNow + ADC_CONV_US;
+    }
+}
+
+/* Line and isrs up to ullUs, the main loop is held meanwhile */
+static void prvSimRun(uint64_t ullUs)
+{
+    while (1) {
+        uint64_t ullNext = s_ullTickAt;
+
+        if ((s_ulRxTail != s_ulRxHead) && (s_xRx[s_ulRxTail % RX_MAX].ullAt < ullNext)) {
+            ullNext = s_xRx[s_ulRxTail % RX_MAX].ullAt;
+        }
+        if (s_ullTiAt && (s_ullTiAt < ullNext)) {
+            ullNext = s_ullTiAt;
+        }
+        if (s_ullAdcAt && (s_ullAdcAt < ullNext)) {
+            ullNext = s_ullAdcAt;
+        }
+        if (ullNext > ullUs) {
+            s_ullNow = ullUs;
+            return;
+        }
+        s_ullNow = ullNext;
+        s_bIsr   = 1;
+        if ((s_ulRxTail != s_ulRxHead) && (s_xRx[s_ulRxTail % RX_MAX].ullAt == s_ullNow)) {
+            s_ullRxLast = s_ullNow;
+            UartRxIsrProc(s_xRx[s_ulRxTail++ % RX_MAX].ucByte);
+        }
+        else if (s_ullTiAt == s_ullNow) {
+            s_ullTiAt = 0;
+            UartTxIsrProc();
+        }
+        else if (s_ullAdcAt == s_ullNow) {
+            uint16_t usAdc = s_usAdcIn[ADC_CONTR & 0x0F];
+            s_ullAdcAt = 0;
+            ADC_CONTR &= ~ADC_START;
+            ADC_RES    = usAdc >> 8;
+            ADC_RESL   = usAdc & 0xFF;
+            AdcIsrProc();
+        }
+        else {
+            s_ullTickAt += 1000;
+            TimerProc();
+        }
+        s_bIsr = 0;
+        prvTxChk();
+    }
+}
+
+volatile uint8_t *SimEa(void)
+{
+    if (!s_bIsr && s_ucEa) {
+        prvSimRun(s_ullNow + 1);
+    }
+    return &s_ucEa;
+}
+
+void SimSetTi2(void)
+{
+    /* Main loop waits right after it in TxFrame, let the frame go out */
+    s_bIsr = 1;
+    UartTxIsrProc();
+    s_bIsr = 0;
+    prvTxChk();
+    while (g_bTxReq || g_bTxBusy) {
+        prvSimRun(s_ullNow + 1);
+    }
+}
+
+void SimUartConfig(uint8_t ucUart, COMx_InitDefine *pxInit)
+{
+    if (UART2 == ucUart) {
+        s_ulNodeBaud = pxInit->UART_BaudRate;
+    }
+}
+
+void delay_ms(uint8_t ms)
+{
+    prvSimRun(s_ullNow + ms * 1000ULL);
+}
+
+static void prvNodePass(void)
+{
+    AdcProc();
+    UartProc();
+    SlotProc();
+    AlarmProc();
+    BaudProc();
+    prvSimRun(s_ullNow + LOOP_US);
+}
+
+static void prvNodeRun(uint64_t ullUs)
+{
+    while (s_ullNow < ullUs) {
+        prvNodePass();
+    }
+}
+
+static void prvNodeBoot(void)
+{
+    GpioConfig();
+    AdcConfig();
+    UartConfig();
+    TimerConfig();
+    for (uint8_t n = 0; n < 16; n++) {
+        s_usAdcIn[n] = 2000 + n;
+    }
+    s_ullTickAt = 1000 - 137;
+    s_ucEa      = 1;
+}
+
+/* Master side */
+static void prvSendRaw(const uint8_t *pucBuf, uint32_t ulLen)
+{
+    uint64_t ullAt = s_ullNow;
+
+    /* Behind what is still on the line */
+    if ((s_ulRxTail != s_ulRxHead) && (s_xRx[(s_ulRxHead - 1) % RX_MAX].ullAt > ullAt)) {
+        ullAt = s_xRx[(s_ulRxHead - 1) % RX_MAX].ullAt;
+    }
+    for (uint32_t n = 0; n < ulLen; n++) {
+        ullAt += prvByteUs();
+        s_xRx[s_ulRxHead % RX_MAX].ullAt  = ullAt;
+        s_xRx[s_ulRxHead % RX_MAX].ucByte = pucBuf[n];
+        s_ulRxHead++;
+    }
+}
+
+static uint8_t prvFrame(uint8_t *c, uint8_t ucCmd, uint8_t ucDst, const uint8_t *pucCont, uint8_t ucLen)
+{
+    uint8_t i = 0, sum = 0;
+
+    c[i++] = 0x7E;
+    c[i++] = 0x7E;
+    c[i++] = ucLen + 9;
+    c[i++] = ucCmd;
+    c[i++] = 0;
+    c[i++] = ucDst;
+    memcpy(&c[i], pucCont, ucLen);
+    i += ucLen;
+    c[i++] = 0;
+    c[i++] = 0x0A;
+    c[i++] = 0x0D;
+    for (uint8_t n = 0; n < i; n++) {
+        sum += c[n];
+    }
+    c[i - 3] = 0xFF - sum;
+    return i;
+}
+
+/* Replies since ulFrom, each must be whole and valid */
+static uint32_t prvReplies(uint32_t ulFrom, uint8_t *pucCmd, uint8_t *pucLen)
+{
+    uint32_t ulNum = 0;
+    uint32_t n     = ulFrom;
+
+    while (n < g_ulSimTxNum) {
+        uint8_t *c   = &g_ucSimTx[n];
+        uint8_t  sum = 0;
+        if (((g_ulSimTxNum - n) < 9) || (c[0] != 0x7E) || (c[1] != 0x7E) || (c[2] > (g_ulSimTxNum - n))) {
+            printf("node rx: broken reply at wire byte %u\n", n);
+            exit(1);
+        }
+        for (uint8_t k = 0; k < c[2]; k++) {
+            sum += c[k];
+        }
+        if ((sum != 0xFF) || (c[4] != DEV_ID) || (c[5] != 0) || (c[c[2] - 2] != 0x0A) || (c[c[2] - 1] != 0x0D)) {
+            printf("node rx: bad reply 0x%02X at wire byte %u\n", c[3], n);
+            exit(1);
+        }
+        if (pucCmd) {
+            *pucCmd = c[3];
+            *pucLen = c[2];
+        }
+        n += c[2];
+        ulNum++;
+    }
+    return ulNum;
+}
+
+/* One request, the node runs till the line is quiet again */
+typedef struct {
+    const char *pcName;
+    uint8_t     ucRsp;      /* Expected reply command, 0 for none */
+    uint8_t     ucRspLen;
+    uint64_t    ullLatMax;
+    uint64_t    ullLatSum;
+    uint32_t    ulNum;
+}Kind_t;
+
+static uint64_t prvExchange(const uint8_t *pucBuf, uint32_t ulLen, Kind_t *pxKind)
+{
+    uint32_t ulFrom = g_ulSimTxNum;
+    uint64_t ullLat;
+    uint8_t  ucCmd = 0, ucLen = 0;
+    uint32_t ulNum;
+
+    prvSendRaw(pucBuf, ulLen);
+    /* Wait as the master does, long enough for any reply */
+    prvNodeRun(s_ullNow + ulLen * prvByteUs() + 8000);
+    ulNum = prvReplies(ulFrom, &ucCmd, &ucLen);
+    if ((ulNum != (pxKind->ucRsp ? 1 : 0)) || (pxKind->ucRsp && ((ucCmd != pxKind->ucRsp) || (ucLen != pxKind->ucRspLen)))) {
+        printf("node rx: %s, %u replies, last 0x%02X of %u bytes: FAIL\n", pxKind->pcName, ulNum, ucCmd, ucLen);
+        exit(1);
+    }
+    if (0 == ulNum) {
+        return 0;
+    }
+    ullLat = s_ullTxAt[ulFrom] - s_ullRxLast;
+    /* The last byte taken may be a later noise byte, the reply time is what counts */
+    if (s_ullTxAt[ulFrom] < s_ullRxLast) {
+        ullLat = 0;
+    }
+    pxKind->ulNum++;
+    pxKind->ullLatSum += ullLat;
+    if (ullLat > pxKind->ullLatMax) {
+        pxKind->ullLatMax = ullLat;
+    }
+    return ullLat;
+}
+
+enum {
+    K_TEMP, K_DIAG, K_BAUD, K_ALMCFG, K_SYNC, K_OTHER, K_BCAST, K_BAD_SUM, K_BAD_TAIL, K_CUT, K_NUM
+};
+
+static Kind_t s_xKind[K_NUM] = {
+    [K_TEMP]     = {"temp query", rCmdTempInfo, TEMP_FRM_LEN},
+    [K_DIAG]     = {"diag query", rCmdDiagInfo, 21},
+    [K_BAUD]     = {"baud probe", rCmdBaudInfo, 11},
+    [K_ALMCFG]   = {"alarm cfg", rCmdAlarmInfo, 17},
+    [K_SYNC]     = {"sync broadcast", rCmdSyncTemp, SYNC_FRM_LEN},
+    [K_OTHER]    = {"other node", 0, 0},
+    [K_BCAST]    = {"broadcast query", 0, 0},
+    [K_BAD_SUM]  = {"corrupted byte", 0, 0},
+    [K_BAD_TAIL] = {"bad tail", 0, 0},
+    [K_CUT]      = {"cut short", 0, 0},
+};
+
+static uint8_t prvBuild(uint8_t ucKind, uint8_t *c)
+{
+    static const uint8_t ucAlmCfg[8] = {0x58, 0x02, 0xFF, 0x0F, 0xFF, 0x03, 0x0C, 0x00};
+    static const uint8_t ucSync[8]   = {0x11, 6, 12, 4, 0x03, 0x00, 0x03, 0x00};
+    uint8_t ucQ = rCmdTempInfo;
+    uint8_t ucB[2] = {BAUD_OP_PROBE, 0};
+    uint8_t ucLen;
+
+    switch (ucKind) {
+    case K_TEMP:
+        return prvFrame(c, iCmdQueryInfo, DEV_ID, &ucQ, 1);
+    case K_DIAG:
+        ucQ = rCmdDiagInfo;
+        return prvFrame(c, iCmdQueryInfo, DEV_ID, &ucQ, 1);
+    case K_BAUD:
+        return prvFrame(c, iCmdBaudCfg, DEV_ID, ucB, 2);
+    case K_ALMCFG:
+        return prvFrame(c, iCmdAlarmCfg, DEV_ID, ucAlmCfg, 8);
+    case K_SYNC:
+        return prvFrame(c, iCmdSyncSample, ADDR_BCAST, ucSync, 8);
+    case K_OTHER:
+        return prvFrame(c, iCmdQueryInfo, DEV_ID + 1, &ucQ, 1);
+    case K_BCAST:
+        return prvFrame(c, iCmdQueryInfo, ADDR_BCAST, &ucQ, 1);
+    case K_BAD_SUM:
+        ucLen = prvFrame(c, iCmdQueryInfo, DEV_ID, &ucQ, 1);
+        c[rand() % ucLen] ^= 1 << (rand() % 8);
+        return ucLen;
+    case K_BAD_TAIL:
+        ucLen = prvFrame(c, iCmdQueryInfo, DEV_ID, &ucQ, 1);
+        c[ucLen - 1] = 0x55;
+        c[ucLen - 3] -= 0x55 - 0x0D;
+        return ucLen;
+    default:
+        ucLen = prvFrame(c, iCmdQueryInfo, DEV_ID, &ucQ, 1);
+        return 3 + rand() % (ucLen - 4);
+    }
+}
+
+/* Noise before a frame, any bytes but head marks then at most two head marks */
+static uint8_t prvNoise(uint8_t *c)
+{
+    uint8_t ucLen = rand() % 4;
+    uint8_t n;
+
+    for (n = 0; n < ucLen; n++) {
+        do {
+            c[n] = rand();
+        } while (c[n] == 0x7E);
+    }
+    for (uint8_t k = rand() % 3; k; k--) {
+        c[n++] = 0x7E;
+    }
+    return n;
+}
+
+static void prvFail(const char *pcWhat)
+{
+    printf("node rx: %s: FAIL\n", pcWhat);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    uint8_t  c[64];
+    uint8_t  ucLen;
+    uint32_t ulFrom;
+    uint8_t  ucOvr;
+
+    (void)argc;
+    (void)argv;
+    setvbuf(stdout, NULL, _IONBF, 0);
+    srand(31);
+    prvNodeBoot();
+
+    /* Nothing staged before the first adc block, the query goes unanswered */
+    ucLen = prvBuild(K_TEMP, c);
+    ulFrom = g_ulSimTxNum;
+    prvSendRaw(c, ucLen);
+    prvNodeRun(5000);
+    if (prvReplies(ulFrom, NULL, NULL) != 0) {
+        prvFail("temp query before the first block");
+    }
+    prvNodeRun(30000);
+
+    /* Each kind on a clean line */
+    for (uint8_t k = 0; k < K_NUM; k++) {
+        ucLen = prvBuild(k, c);
+        prvExchange(c, ucLen, &s_xKind[k]);
+        if (k == K_CUT) {
+            /* The gap dropped the partial frame, the next one goes through */
+            ucLen = prvBuild(K_TEMP, c);
+            prvExchange(c, ucLen, &s_xKind[K_TEMP]);
+        }
+    }
+
+    /* Head marks in noise, the frame starts with the last two */
+    ucLen = 0;
+    c[ucLen++] = 0x7E;
+    c[ucLen++] = 0x7E;
+    ucLen += prvBuild(K_TEMP, &c[ucLen]);
+    prvExchange(c, ucLen, &s_xKind[K_TEMP]);
+    ucLen = 0;
+    c[ucLen++] = 0x7E;
+    c[ucLen++] = 0x7E;
+    c[ucLen++] = 0x0A;
+    c[ucLen++] = iCmdQueryInfo;
+    c[ucLen++] = 0;
+    ucLen += prvBuild(K_DIAG, &c[ucLen]);
+    prvExchange(c, ucLen, &s_xKind[K_DIAG]);
+
+    /* Random mix with noise, paced as the master polls */
+    for (uint32_t n = 0; n < FUZZ_NUM; n++) {
+        uint8_t k = rand() % K_NUM;
+        ucLen = prvNoise(c);
+        ucLen += prvBuild(k, &c[ucLen]);
+        prvExchange(c, ucLen, &s_xKind[k]);
+    }
+
+    /* Request ring, four pending requests fit and the fifth is dropped */
+    ucOvr  = s_ucReqOvr;
+    ulFrom = g_ulSimTxNum;
+    for (uint8_t n = 0; n < COM_REQ_NUM + 1; n++) {
+        ucLen = prvBuild(K_BAUD, c);
+        prvSendRaw(c, ucLen);
+    }
+    prvSimRun(s_ullNow + (COM_REQ_NUM + 1) * ucLen * prvByteUs() + 1000);
+    prvNodeRun(s_ullNow + 20000);
+    if ((prvReplies(ulFrom, NULL, NULL) != COM_REQ_NUM) || ((uint8_t)(s_ucReqOvr - ucOvr) != 1)) {
+        prvFail("request ring overflow");
+    }
+
+    for (uint8_t k = 0; k < K_NUM; k++) {
+        Kind_t *px = &s_xKind[k];
+        if (px->ucRsp) {
+            printf("node rx: %-15s %5u replies, latency %3llu us mean, %3llu us max\n", px->pcName, px->ulNum,
+                   (unsigned long long)(px->ulNum ? px->ullLatSum / px->ulNum : 0), (unsigned long long)px->ullLatMax);
+        }
+    }
+    printf("node rx: %u random frames with noise, line at %u baud, main loop pass %u us: PASS\n", FUZZ_NUM, BAUD,
+           LOOP_US);
+    return 0;
+}
@@ -0,0 +1,329 @@
+/*
+    TestNv.c
+
+    Host Test and Benchmark of the Persistent Counters on a File Backed RAM Image
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    Nv.c is compiled in here, the load is called as tNv would, the task never runs.
+    The DS1338 RAM is a file mapped by every boot, a boot is a forked child. The RAM
+    takes a byte on its I2C acknowledge, so a cut leaves whole bytes: the ones before
+    it are in, the rest of the slot is what was there.
+
+    The sweep cuts the write of each counter after 0 to 6 of its slot bytes, the next
+    boot must load the value before the write, or after it when all 6 got there.
+    Then random boots update random counters, each update flushed on its own, until
+    a cut at a random byte. A load must return for every counter the last flushed
+    value or the one cut, never anything else, and no counter may be lost.
+*/
+
+/* Includes */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "Include.h"
+#include "User/Nv.h"
+
+/* What prvTick needs, the task never runs on the host */
+typedef enum {
+    APWR1_CUR,
+    APWR2_CUR,
+    APWR3_CUR
+}AdcChan_t;
+
+#define PWR2_M1_ADDR    1
+#define PWR_OUTPUT_VOL  0
+#define ADC_TO_CUR(d)   ((d) * 0.01f)
+#define th_SysStatus    s_xSysStatus
+
+static struct {
+    uint8_t WORK_LASER;
+}s_xSysStatus;
+
+uint16_t AdcGet(AdcChan_t xChan);
+int32_t  PwrDataGet(uint32_t ulPwr2Addr, int xType);
+Status_t RtcDs1338ReadRam(uint8_t ucOffset, OUT uint8_t *pucData, uint8_t ucLength);
+Status_t RtcDs1338WriteRam(uint8_t ucOffset, IN uint8_t *pucData, uint8_t ucLength);
+
+/* The counters, with their statics */
+#include "User/Nv.c"
+
+/* Local defines */
+#define RAM_SIZE        56          /* DS1338_RAM_SIZE */
+#define BOOT_NUM        3000
+#define CUT_MAX         200         /* Bytes written at most before a cut */
+#define BENCH_NUM       1000000
+
+/* Local types */
+typedef struct {
+    uint32_t ulAcked[NV_NUM];       /* Last flush that returned */
+    uint32_t ulPending[NV_NUM];     /* Flush in progress */
+    Bool_t   bPending[NV_NUM];
+    uint32_t ulAckCnt;
+    uint32_t ulPendingHit;          /* Boots that found the cut write whole */
+    uint32_t ulVal;                 /* Sweep, loaded by the checking boot */
+    uint32_t ulLost;
+    uint32_t ulBenchNs;
+    uint32_t ulBenchBytes;
+    uint32_t ulLoadNs;
+}Shared_t;
+
+/* Local variables */
+static uint8_t  *s_pucRam  = NULL;
+static Shared_t *s_pxSh    = NULL;
+static uint32_t  s_ulCut   = 0;     /* Bytes left before the cut, 0 disarmed */
+static uint32_t  s_ulBytes = 0;     /* Written */
+
+/* Functions */
+uint16_t AdcGet(AdcChan_t xChan)
+{
+    (void)xChan;
+    return 0;
+}
+
+int32_t PwrDataGet(uint32_t ulPwr2Addr, int xType)
+{
+    (void)ulPwr2Addr;
+    (void)xType;
+    return 0;
+}
+
+Status_t RtcDs1338ReadRam(uint8_t ucOffset, OUT uint8_t *pucData, uint8_t ucLength)
+{
+    if ((ucOffset + ucLength) > RAM_SIZE) {
+        return STATUS_ERR;
+    }
+    memcpy(pucData, &s_pucRam[ucOffset], ucLength);
+    return STATUS_OK;
+}
+
+Status_t RtcDs1338WriteRam(uint8_t ucOffset, IN uint8_t *pucData, uint8_t ucLength)
+{
+    if ((ucOffset + ucLength) > RAM_SIZE) {
+        return STATUS_ERR;
+    }
+    for (uint8_t n = 0; n < ucLength; n++) {
+        if ((s_ulCut != 0) && (--s_ulCut == 0)) {
+            _exit(0);
+        }
+        s_pucRam[ucOffset + n] = pucData[n];
+        s_ulBytes++;
+    }
+    return STATUS_OK;
+}
+
+static int prvRamOpen(const char *pcPath)
+{
+    int fd = open(pcPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+    if ((fd < 0) || (ftruncate(fd, RAM_SIZE) != 0)) {
+        return -1;
+    }
+    s_pucRam = mmap(NULL, RAM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return (s_pucRam == MAP_FAILED) ? -1 : 0;
+}
+
+/* A boot to the point tNv has loaded */
+static void prvStart(void)
+{
+    AppNvInit();
+    prvLoad();
+}
+
+static int prvRun(int (*pfnBoot)(uint32_t), uint32_t ulArg)
+{
+    int   lStatus;
+    pid_t xPid = fork();
+
+    if (xPid == 0) {
+        _exit(pfnBoot(ulArg));
+    }
+    waitpid(xPid, &lStatus, 0);
+    return (WIFEXITED(lStatus) && (WEXITSTATUS(lStatus) == 0)) ? 0 : 1;
+}
+
+/* ulArg: counter << 8 | bytes of its slot let through */
+static int prvSweepCut(uint32_t ulArg)
+{
+    NvId_t xId = (NvId_t)(ulArg >> 8);
+
+    prvStart();
+    s_pxSh->ulVal = NvGet(xId);
+    /* Every byte of the value changes */
+    NvAdd(xId, 0x01010101);
+    s_ulCut = (ulArg & 0xFF) + 1;
+    NvFlush();
+    return 0;
+}
+
+static int prvSweepLoad(uint32_t ulArg)
+{
+    (void)ulArg;
+    prvStart();
+    s_pxSh->ulLost += s_ulLostCnt;
+    return 0;
+}
+
+static int prvSweepGet(uint32_t ulArg)
+{
+    prvStart();
+    s_pxSh->ulVal = NvGet((NvId_t)ulArg);
+    return 0;
+}
+
+static int prvSweep(void)
+{
+    uint32_t ulOld;
+
+    for (uint32_t n = 0; n < NV_NUM; n++) {
+        for (uint32_t ulIn = 0; ulIn <= sizeof(NvSlot_t); ulIn++) {
+            if (prvRun(prvSweepCut, (n << 8) | ulIn)) {
+                printf("sweep: counter %u, %u bytes: write boot failed\n", n, ulIn);
+                return 1;
+            }
+            ulOld = s_pxSh->ulVal;
+            if (prvRun(prvSweepLoad, 0) || prvRun(prvSweepGet, n)) {
+                printf("sweep: counter %u, %u bytes: load boot failed\n", n, ulIn);
+                return 1;
+            }
+            /* A torn slot fails its CRC, or carries the older sequence */
+            if ((s_pxSh->ulVal != ulOld) &&
+                ((ulIn < sizeof(NvSlot_t)) || (s_pxSh->ulVal != (ulOld + 0x01010101)))) {
+                printf("sweep: counter %u, %u bytes: %08x loaded, %08x before\n", n, ulIn, s_pxSh->ulVal, ulOld);
+                return 1;
+            }
+            if ((ulIn == sizeof(NvSlot_t)) && (s_pxSh->ulVal == ulOld)) {
+                printf("sweep: counter %u: whole write not loaded\n", n);
+                return 1;
+            }
+        }
+    }
+    if (s_pxSh->ulLost != 0) {
+        printf("sweep: %u counters lost\n", s_pxSh->ulLost);
+        return 1;
+    }
+    return 0;
+}
+
+static int prvBench(uint32_t ulArg)
+{
+    uint32_t ulCyc;
+
+    (void)ulArg;
+    ulCyc = TimeCycGet();
+    prvStart();
+    s_pxSh->ulLoadNs = TimeCycGet() - ulCyc;
+
+    s_ulBytes = 0;
+    ulCyc     = TimeCycGet();
+    for (uint32_t n = 0; n < BENCH_NUM; n++) {
+        NvId_t xId = (NvId_t)(n % NV_NUM);
+        NvAdd(xId, 1);
+        NvFlush();
+    }
+    s_pxSh->ulBenchNs    = TimeCycGet() - ulCyc;
+    s_pxSh->ulBenchBytes = s_ulBytes;
+    return 0;
+}
+
+static int prvBoot(uint32_t ulBoot)
+{
+    srand(ulBoot * 7919 + 1);
+    s_ulCut = 1 + rand() % CUT_MAX;
+    prvStart();
+
+    if (s_ulLostCnt != 0) {
+        printf("boot %u: %u counters lost\n", ulBoot, s_ulLostCnt);
+        return 1;
+    }
+    for (uint8_t n = 0; n < NV_NUM; n++) {
+        uint32_t ulVal = NvGet((NvId_t)n);
+        if (s_pxSh->bPending[n] && (ulVal == s_pxSh->ulPending[n])) {
+            s_pxSh->ulAcked[n] = ulVal;
+            s_pxSh->ulPendingHit++;
+        }
+        s_pxSh->bPending[n] = FALSE;
+        if (ulVal != s_pxSh->ulAcked[n]) {
+            printf("boot %u: counter %u is %u, last flushed %u\n", ulBoot, n, ulVal, s_pxSh->ulAcked[n]);
+            return 1;
+        }
+    }
+
+    while (1) {
+        NvId_t xId = (NvId_t)(rand() % NV_NUM);
+        if ((rand() % 16) == 0) {
+            NvSet(xId, rand());
+        }
+        else {
+            NvAdd(xId, 1 + rand() % 1000);
+        }
+        s_pxSh->ulPending[xId] = NvGet(xId);
+        s_pxSh->bPending[xId]  = TRUE;
+        if (STATUS_OK != NvFlush()) {
+            printf("boot %u: flush failed\n", ulBoot);
+            return 1;
+        }
+        s_pxSh->ulAcked[xId]  = s_pxSh->ulPending[xId];
+        s_pxSh->bPending[xId] = FALSE;
+        s_pxSh->ulAckCnt++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *pcImg = (argc > 1) ? argv[1] : "Nv.img";
+
+    /* A child leaves by _exit, nothing may wait in a buffer */
+    setvbuf(stdout, NULL, _IONBF, 0);
+    if (STORE_SIZE > RAM_SIZE) {
+        printf("store of %u bytes does not fit the ds1338 ram\n", (unsigned)STORE_SIZE);
+        return 1;
+    }
+    if (0 != prvRamOpen(pcImg)) {
+        printf("cannot open %s\n", pcImg);
+        return 1;
+    }
+    s_pxSh = mmap(NULL, sizeof(Shared_t), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    memset(s_pxSh, 0, sizeof(Shared_t));
+
+    if (0 != prvSweep()) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("nv: a write cut after each of 0 to %u slot bytes of %u counters loads the old or the new value: PASS\n",
+           (unsigned)sizeof(NvSlot_t), NV_NUM);
+
+    if (0 != prvRun(prvBench, 0)) {
+        printf("FAIL in the benchmark\n");
+        return 1;
+    }
+    printf("nv: %.3f us per update (add and flush of one counter), %.1f bytes written, load %.2f us\n",
+           s_pxSh->ulBenchNs / 1000.0 / BENCH_NUM, (double)s_pxSh->ulBenchBytes / BENCH_NUM,
+           s_pxSh->ulLoadNs / 1000.0);
+
+    /* From a blank RAM, the first boot formats */
+    memset(s_pucRam, 0, RAM_SIZE);
+    memset(s_pxSh, 0, sizeof(Shared_t));
+    for (uint32_t ulBoot = 0; ulBoot < BOOT_NUM; ulBoot++) {
+        if (0 != prvRun(prvBoot, ulBoot)) {
+            printf("FAIL at boot %u\n", ulBoot);
+            return 1;
+        }
+    }
+    printf("nv: %u boots cut at random, %u flushes returned, %u cut writes found whole: PASS\n",
+           BOOT_NUM, s_pxSh->ulAckCnt, s_pxSh->ulPendingHit);
+
+    munmap(s_pucRam, RAM_SIZE);
+    unlink(pcImg);
+    return 0;
+}
@@ -0,0 +1,252 @@
+/*
+    TestPwr2.c
+
+    Host Simulator for the Pwr2 Modules, tSys Loop Time Against the Refresh
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    The real Pwr2Prot.c and PwrTrans.c run in tPwr on the RtosSim clock, the
+    CAN bus carries one frame at a time at CAN_BIT_RATE and a module answers
+    MOD_TURN_US after the end of its request. tSys is the 1 ms loop of Sys.c
+    reading the module output voltage as prvChkMPwr does, its worst loop
+    period is measured as sys_loop_stat does.
+    The lock mode stands for the driver before the snapshot: the refresh sends
+    the registers one by one and holds the mutex Pwr2DataGet takes till the
+    last one is answered or timed out. The snapshot mode is the driver as it
+    is, the readers never block.
+*/
+
+/* Includes */
+#include "Include.h"
+#include "RtosSim.h"
+
+/* Pwr2Prot.c is included, the lock mode runs its transactions one by one */
+#include "User/Drv/Pwr/Pwr2Prot.c"
+
+/* Local defines */
+#define SYS_LOOP_MS     1           /* SYS_TASK_DELAY */
+#define PWR_PRD         200         /* PWR_UPDATE_PRD */
+#define FRM_US          (130 * 1000000 / CAN_BIT_RATE)  /* Extended frame of 8 bytes, some stuffing */
+#define MOD_TURN_US     500         /* Request end to response start */
+#define RSP_MAX         64
+#define RUN_US          10000000ULL
+#define OUT_VOL         700         /* 0.1V, reported by every present module */
+
+/* Local types */
+typedef enum {
+    MODE_LOCK,
+    MODE_SNAP
+}Mode_t;
+
+/* Local variables */
+static Mode_t       s_xMode;
+static Bool_t       s_bPresent[ADDR_MASK + 1];
+static TaskHandle_t s_xPwrTask;
+static uint64_t     s_ullBusFree = 0;
+static CanMsgRx_t   s_xRsp[RSP_MAX];    /* On the bus */
+static uint32_t     s_ulRspIdx = 0;
+static CanMsgRx_t   s_xRx[CAN_RX_RING]; /* Received */
+static uint32_t     s_ulRxHead = 0;
+static uint32_t     s_ulRxTail = 0;
+static uint32_t     s_ulLoopMax = 0;
+static uint32_t     s_ulLoopOverCnt = 0;
+static uint32_t     s_ulRefreshMax = 0;
+static int32_t      s_lVol[ADDR_MASK + 1];
+osMutexDef(OldMutex);
+
+/* Functions */
+/* Can.h, the bus model */
+Status_t CanSetFilter(uint8_t ucBank, uint32_t ulExtId, uint32_t ulMask, uint8_t ucFifo)
+{
+    return STATUS_OK;
+}
+
+static void prvRspEnd(void *pvPara)
+{
+    BaseType_t xWoken = pdFALSE;
+
+    if ((s_ulRxHead - s_ulRxTail) < CAN_RX_RING) {
+        s_xRx[s_ulRxHead++ % CAN_RX_RING] = *(CanMsgRx_t *)pvPara;
+    }
+    vTaskNotifyGiveFromISR(s_xPwrTask, &xWoken);
+}
+
+Status_t CanSend(IN CanMsgTx_t *pxMsg, uint16_t usWaitMs)
+{
+    uint64_t ullEnd = ((s_ullBusFree > RtosSimNow()) ? s_ullBusFree : RtosSimNow()) + FRM_US;
+
+    s_ullBusFree = ullEnd;
+    if (!s_bPresent[pxMsg->ExtId & ADDR_MASK]) {
+        return STATUS_OK;
+    }
+
+    /* Same register, the response id has the request bit cleared */
+    CanMsgRx_t *pxRsp = &s_xRsp[s_ulRspIdx++ % RSP_MAX];
+    memset(pxRsp, 0, sizeof(*pxRsp));
+    pxRsp->ExtId   = pxMsg->ExtId & ~0x01000000UL;
+    pxRsp->IDE     = CAN_ID_EXT;
+    pxRsp->DLC     = 8;
+    pxRsp->Data[0] = pxMsg->DLC ? pxMsg->Data[0] : 0;
+    pxRsp->Data[4] = OUT_VOL >> 8;
+    pxRsp->Data[5] = OUT_VOL & 0xFF;
+
+    uint64_t ullRsp = ullEnd + MOD_TURN_US;
+    if (ullRsp < s_ullBusFree) {
+        ullRsp = s_ullBusFree;
+    }
+    s_ullBusFree = ullRsp + FRM_US;
+    RtosSimAt(s_ullBusFree, prvRspEnd, pxRsp);
+    return STATUS_OK;
+}
+
+Status_t CanRead(OUT CanMsgRx_t *pxMsg, uint32_t ulId, uint32_t ulMask, uint16_t usWaitMs)
+{
+    if ((s_ulRxHead == s_ulRxTail) && usWaitMs) {
+        ulTaskNotifyTake(pdTRUE, usWaitMs);
+    }
+    if (s_ulRxHead == s_ulRxTail) {
+        return STATUS_ERR;
+    }
+    *pxMsg = s_xRx[s_ulRxTail++ % CAN_RX_RING];
+    return STATUS_OK;
+}
+
+/* EvtLog.h */
+void EvtLog(uint16_t usId, uint32_t ulArg0, uint32_t ulArg1, uint32_t ulArg2, uint32_t ulArg3)
+{
+}
+
+/* The refresh before the snapshot, request after request under the lock */
+static void prvOldUpdate(void)
+{
+    osMutexWait(osMutex(OldMutex), osWaitForever);
+    s_pxBuild = &s_xSnap[s_ulSnapVer & 1];
+    for (uint32_t n = 0; n < TRANS_NUM; n++) {
+        uint32_t ulDone = 0;
+        PwrTransRun(&s_xTrans[n], 1, WAIT_MS, &ulDone);
+        if (!ulDone && s_xMod[s_ucModIdx[s_xTrans[n].ucDev]].bZero) {
+            s_xTrans[n].pfnDone(s_xTrans[n].ucDev, s_ucZero, sizeof(s_ucZero));
+        }
+    }
+    osMutexRelease(osMutex(OldMutex));
+}
+
+static int32_t prvOldDataGet(uint32_t ulAddr, PwrDataType_t xType)
+{
+    osMutexWait(osMutex(OldMutex), osWaitForever);
+    int32_t r = Pwr2DataGet(ulAddr, xType);
+    osMutexRelease(osMutex(OldMutex));
+    return r;
+}
+
+/* Drv/Pwr.c prvPwrTask */
+static void prvPwrTask(void *pvPara)
+{
+    while (1) {
+        uint32_t ulStart = osKernelSysTick();
+        uint32_t ulCyc   = TimeCycGet();
+
+        if (s_xMode == MODE_LOCK) {
+            prvOldUpdate();
+        }
+        else {
+            Pwr2Update();
+        }
+        ulCyc = TimeCycToUs(TimeCycGet() - ulCyc);
+        if (ulCyc > s_ulRefreshMax) {
+            s_ulRefreshMax = ulCyc;
+        }
+
+        uint32_t ulUsed = osKernelSysTick() - ulStart;
+        osDelay((ulUsed < PWR_PRD) ? (PWR_PRD - ulUsed) : 1);
+    }
+}
+
+/* Sys.c prvSysTask, prvProc reduced to the prvChkMPwr read */
+static void prvSysTask(void *pvPara)
+{
+    uint32_t ulLoopCyc = TimeCycGet();
+
+    while (1) {
+        uint32_t ulCyc = TimeCycGet();
+
+        for (uint32_t a = PWR2_M1_ADDR; a <= PWR2_M3_ADDR; a++) {
+            s_lVol[a] = (s_xMode == MODE_LOCK) ? prvOldDataGet(a, PWR_OUTPUT_VOL) : Pwr2DataGet(a, PWR_OUTPUT_VOL);
+        }
+
+        uint32_t ulLoop = TimeCycToUs(ulCyc - ulLoopCyc);
+        ulLoopCyc       = ulCyc;
+        if (ulLoop > s_ulLoopMax) {
+            s_ulLoopMax = ulLoop;
+        }
+        if (ulLoop > (SYS_LOOP_MS + 1) * 1000) {
+            s_ulLoopOverCnt++;
+        }
+
+        osDelay(SYS_LOOP_MS);
+    }
+}
+
+static Bool_t prvRun(Mode_t xMode, Bool_t bM1)
+{
+    TaskHandle_t xSys;
+    Bool_t       bOk = TRUE;
+
+    RtosSimInit();
+    memset(s_xSnap, 0, sizeof(s_xSnap));
+    memset(s_lVol, 0, sizeof(s_lVol));
+    s_xMode         = xMode;
+    s_ullBusFree    = 0;
+    s_ulRxHead      = 0;
+    s_ulRxTail      = 0;
+    s_ulLoopMax     = 0;
+    s_ulLoopOverCnt = 0;
+    s_ulRefreshMax  = 0;
+    memset(s_bPresent, 0, sizeof(s_bPresent));
+    s_bPresent[PWR2_M1_ADDR] = bM1;
+    s_bPresent[PWR2_M2_ADDR] = TRUE;
+    s_bPresent[PWR2_M3_ADDR] = TRUE;
+
+    xTaskCreate(prvPwrTask, "tPwr", 256, NULL, 1, &s_xPwrTask);
+    xTaskCreate(prvSysTask, "tSys", 256, NULL, 1, &xSys);
+    RtosSimRun(RUN_US);
+
+    for (uint32_t a = PWR2_M1_ADDR; a <= PWR2_M3_ADDR; a++) {
+        if (s_lVol[a] != (s_bPresent[a] ? OUT_VOL : 0)) {
+            printf("pwr2: module %u reads %d\n", a, s_lVol[a]);
+            bOk = FALSE;
+        }
+    }
+    if ((xMode == MODE_SNAP) && (s_ulLoopMax > (SYS_LOOP_MS + 1) * 1000)) {
+        bOk = FALSE;
+    }
+
+    printf("    %-8s %-10s refresh %6u us, tSys worst loop %6u us, %5u loops over %u ms\n",
+           (xMode == MODE_LOCK) ? "lock" : "snapshot", bM1 ? "3 modules" : "M1 absent", s_ulRefreshMax, s_ulLoopMax,
+           s_ulLoopOverCnt, SYS_LOOP_MS + 1);
+    return bOk;
+}
+
+int main(void)
+{
+    Bool_t bOk = TRUE;
+
+    Pwr2ProtInit();
+
+    printf("pwr2: tSys against the module refresh, %u s each\n", (unsigned)(RUN_US / 1000000));
+    bOk &= prvRun(MODE_LOCK, TRUE);
+    bOk &= prvRun(MODE_SNAP, TRUE);
+    bOk &= prvRun(MODE_LOCK, FALSE);
+    bOk &= prvRun(MODE_SNAP, FALSE);
+
+    printf("pwr2: %s\n", bOk ? "PASS" : "FAIL");
+    return bOk ? 0 : 1;
+}
@@ -0,0 +1,468 @@
+/*
+    TestSpiFlash.c
+
+    Host Test of the Spi Flash Erase Write Against a Modelled Chip
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+*/
+
+/*
+    The real MemSpiFlash.c runs against the HAL stand-ins below and a GD25Q64 model
+    behind them: status, JEDEC id, read, fast read, page program, sector and chip
+    erase, with the write enable latch and a few busy status reads after a program
+    or an erase. Programming clears bits only, as on the part. DMA transfers complete
+    at once through the HAL callbacks, a semaphore wait nobody gave times out.
+
+    Spi_Flash_Erase_Write is given random writes over a few sectors: data already
+    there, data that only clears bits and any data. After each the range must hold
+    the data, a sector not erased must keep its bytes outside the range, an erased
+    one must be blank there. Data already there or only clearing bits must not erase.
+    Run with DMA as tasks see it, then polled as at boot.
+*/
+
+/* Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cmsis_os.h>
+#include "Mem/MemSpiFlash.h"
+
+/* Local defines */
+#define CHIP_SIZE       (8 * 1024 * 1024)   /* GD25Q64 */
+#define SECTOR          4096
+#define PAGE            256
+#define REGION_ADDR     (1024 * 1024)
+#define REGION_SECTOR   16
+#define REGION_SIZE     (REGION_SECTOR * SECTOR)
+#define WRITE_NUM       20000
+#define ERASE_BUSY      3                   /* Status reads busy after an erase */
+#define PROG_BUSY       1
+
+/* Local types */
+typedef enum {
+    MODE_SAME,
+    MODE_CLEAR,
+    MODE_ANY,
+    MODE_NUM
+}Mode_t;
+
+typedef struct {
+    uint32_t ulWrite[MODE_NUM];
+    uint32_t ulErase[MODE_NUM];
+    uint32_t ulSector;          /* Sectors the writes touched, the erases of the old erase write */
+    uint64_t ullByte;           /* Bytes written */
+    uint64_t ullProg;           /* Bytes the chip was given to program */
+}Run_t;
+
+/* Local variables */
+static uint8_t  s_ucChip[CHIP_SIZE];
+static uint32_t s_ulEraseCnt[CHIP_SIZE / SECTOR];
+static uint8_t  s_ucSr      = 0;
+static uint32_t s_ulBusy    = 0;
+static Bool_t   s_bSel      = FALSE;
+static uint8_t  s_ucHead[8];                /* Command and address of the frame */
+static uint32_t s_ulHeadLen = 0;
+static uint32_t s_ulAddr    = 0;            /* Next read or program byte */
+static uint32_t s_ulIdIdx   = 0;
+static uint8_t  s_ucPage[PAGE];             /* Program data, taken at the end of the frame */
+static Bool_t   s_bPageSet[PAGE];
+static uint64_t s_ullProgByte = 0;
+static uint32_t s_ulBadProg = 0;            /* Program without the latch or into set bits */
+static uint32_t s_ulDmaCnt  = 0;
+static uint32_t s_ulSemTimeout = 0;
+static int32_t  s_lKernel   = 0;
+static SPI_HandleTypeDef s_hSpi = {.Instance = SPI1};
+
+DWT_Type g_xSimDwt;
+
+/* Functions */
+/* The chip */
+static uint32_t prvAddr(void)
+{
+    return ((uint32_t)s_ucHead[1] << 16) | ((uint32_t)s_ucHead[2] << 8) | s_ucHead[3];
+}
+
+static void prvSelect(void)
+{
+    s_bSel      = TRUE;
+    s_ulHeadLen = 0;
+    s_ulIdIdx   = 0;
+    memset(s_bPageSet, 0, sizeof(s_bPageSet));
+}
+
+static void prvDeselect(void)
+{
+    uint8_t ucCmd = s_ucHead[0];
+
+    s_bSel = FALSE;
+    if (s_ulHeadLen == 0) {
+        return;
+    }
+    switch (ucCmd) {
+    case CMD_WRITE_ENABLE:
+        s_ucSr |= STATUS_REGISTER_WEL;
+        break;
+    case CMD_WRITE_DISABLE:
+        s_ucSr &= ~STATUS_REGISTER_WEL;
+        break;
+    case CMD_PAGE_PROGRAM:
+        if (!(s_ucSr & STATUS_REGISTER_WEL)) {
+            s_ulBadProg++;
+            break;
+        }
+        for (uint32_t n = 0; n < PAGE; n++) {
+            if (!s_bPageSet[n]) {
+                continue;
+            }
+            uint8_t *puc = &s_ucChip[(prvAddr() & ~(PAGE - 1)) + n];
+            if ((*puc & s_ucPage[n]) != s_ucPage[n]) {
+                s_ulBadProg++;
+            }
+            *puc &= s_ucPage[n];
+            s_ullProgByte++;
+        }
+        s_ucSr  &= ~STATUS_REGISTER_WEL;
+        s_ulBusy = PROG_BUSY;
+        break;
+    case 0x20:
+        if (!(s_ucSr & STATUS_REGISTER_WEL)) {
+            s_ulBadProg++;
+            break;
+        }
+        memset(&s_ucChip[prvAddr() & ~(SECTOR - 1)], 0xFF, SECTOR);
+        s_ulEraseCnt[prvAddr() / SECTOR]++;
+        s_ucSr  &= ~STATUS_REGISTER_WEL;
+        s_ulBusy = ERASE_BUSY;
+        break;
+    case CMD_ERASE_CHIP:
+        memset(s_ucChip, 0xFF, sizeof(s_ucChip));
+        for (uint32_t n = 0; n < CHIP_SIZE / SECTOR; n++) {
+            s_ulEraseCnt[n]++;
+        }
+        s_ucSr  &= ~STATUS_REGISTER_WEL;
+        s_ulBusy = ERASE_BUSY;
+        break;
+    default:
+        break;
+    }
+}
+
+static void prvMosi(uint8_t ucByte)
+{
+    if (!s_bSel) {
+        return;
+    }
+    if ((s_ulHeadLen > 0) && (s_ucHead[0] == CMD_PAGE_PROGRAM) && (s_ulHeadLen == 4)) {
+        /* Wraps within the page, as on the part */
+        uint32_t n = (prvAddr() + s_ulAddr++) % PAGE;
+        s_ucPage[n]   = ucByte;
+        s_bPageSet[n] = TRUE;
+        return;
+    }
+    if (s_ulHeadLen < sizeof(s_ucHead)) {
+        s_ucHead[s_ulHeadLen++] = ucByte;
+    }
+    s_ulAddr = 0;
+}
+
+static uint8_t prvMiso(void)
+{
+    static const uint8_t s_ucId[3] = {MF_ID_GIGADEVICE, 0x40, 0x17};
+
+    if (!s_bSel || (s_ulHeadLen == 0)) {
+        return 0xFF;
+    }
+    switch (s_ucHead[0]) {
+    case CMD_READ_STATUS_REGISTER:
+        if (s_ulBusy) {
+            s_ulBusy--;
+            return s_ucSr | STATUS_REGISTER_BUSY;
+        }
+        return s_ucSr;
+    case CMD_JEDEC_ID:
+        return (s_ulIdIdx < 3) ? s_ucId[s_ulIdIdx++] : 0xFF;
+    case CMD_READ_DATA:
+        return (s_ulHeadLen == 4) ? s_ucChip[(prvAddr() + s_ulAddr++) % CHIP_SIZE] : 0xFF;
+    case CMD_FAST_READ:
+        return (s_ulHeadLen == 5) ? s_ucChip[(prvAddr() + s_ulAddr++) % CHIP_SIZE] : 0xFF;
+    default:
+        return 0xFF;
+    }
+}
+
+/* The HAL */
+void HAL_Delay(uint32_t ms)
+{
+    (void)ms;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, int state)
+{
+    (void)port;
+    (void)pin;
+    if (state == GPIO_PIN_RESET) {
+        prvSelect();
+    }
+    else {
+        prvDeselect();
+    }
+}
+
+void HAL_NVIC_SetPriority(IRQn_Type irq, uint32_t pre, uint32_t sub)
+{
+    (void)irq;
+    (void)pre;
+    (void)sub;
+}
+
+void HAL_NVIC_EnableIRQ(IRQn_Type irq)
+{
+    (void)irq;
+}
+
+HAL_StatusTypeDef HAL_DMA_Init(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+    return HAL_OK;
+}
+
+void HAL_DMA_IRQHandler(DMA_HandleTypeDef *hdma)
+{
+    (void)hdma;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size, uint32_t ms)
+{
+    (void)hspi;
+    (void)ms;
+    for (uint32_t n = 0; n < size; n++) {
+        prvMosi(buf[n]);
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size, uint32_t ms)
+{
+    (void)hspi;
+    (void)ms;
+    for (uint32_t n = 0; n < size; n++) {
+        buf[n] = prvMiso();
+    }
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size)
+{
+    HAL_SPI_Transmit(hspi, buf, size, 0);
+    s_ulDmaCnt++;
+    HAL_SPI_TxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+/* A 2 line master receive runs as TransmitReceive, SPI_DMAReceiveCplt ends it with the Rx callback */
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi, uint8_t *buf, uint16_t size)
+{
+    HAL_SPI_Receive(hspi, buf, size, 0);
+    s_ulDmaCnt++;
+    HAL_SPI_RxCpltCallback(hspi);
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_SPI_DMAStop(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+    return HAL_OK;
+}
+
+/* The HAL's weak defaults */
+__attribute__((weak)) void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+__attribute__((weak)) void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+__attribute__((weak)) void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+__attribute__((weak)) void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+    (void)hspi;
+}
+
+/* The RTOS */
+int32_t osKernelRunning(void)
+{
+    return s_lKernel;
+}
+
+osStatus osDelay(uint32_t ms)
+{
+    (void)ms;
+    return osOK;
+}
+
+osSemaphoreId osSemaphoreCreate(const int *def, int32_t count)
+{
+    static osSemaphore_t s_xSem;
+
+    (void)def;
+    s_xSem.lCount = count;
+    return &s_xSem;
+}
+
+int32_t osSemaphoreWait(osSemaphoreId id, uint32_t ms)
+{
+    if (id->lCount > 0) {
+        id->lCount--;
+        return osOK;
+    }
+    if (ms != 0) {
+        s_ulSemTimeout++;
+    }
+    return osErrorOS;
+}
+
+osStatus osSemaphoreRelease(osSemaphoreId id)
+{
+    id->lCount = 1;
+    return osOK;
+}
+
+/* The test */
+static uint32_t prvRand(uint32_t ulMax)
+{
+    return (uint32_t)(((uint64_t)rand() * RAND_MAX + rand()) % ulMax);
+}
+
+static int prvRun(const char *pcName, Run_t *pxRun)
+{
+    static uint8_t s_ucWas[REGION_SIZE];
+    static uint8_t s_ucData[REGION_SIZE];
+    static uint32_t s_ulWasErase[REGION_SECTOR];
+    uint8_t *pucRegion = &s_ucChip[REGION_ADDR];
+
+    memset(pxRun, 0, sizeof(*pxRun));
+    for (uint32_t w = 0; w < WRITE_NUM; w++) {
+        /* Mostly records, now and then a block over a few sectors */
+        uint32_t ulSize = ((w % 8) == 0) ? (1 + prvRand(3 * SECTOR)) : (1 + prvRand(128));
+        uint32_t ulOfs  = prvRand(REGION_SIZE - ulSize + 1);
+        Mode_t   xMode  = (Mode_t)prvRand(MODE_NUM);
+        uint64_t ullProg = s_ullProgByte;
+
+        memcpy(s_ucWas, pucRegion, REGION_SIZE);
+        memcpy(s_ulWasErase, &s_ulEraseCnt[REGION_ADDR / SECTOR], sizeof(s_ulWasErase));
+        for (uint32_t n = 0; n < ulSize; n++) {
+            uint8_t ucOld = pucRegion[ulOfs + n];
+            s_ucData[n] = (xMode == MODE_SAME) ? ucOld : (xMode == MODE_CLEAR) ? (ucOld & rand()) : rand();
+        }
+
+        Flash_Err xErr = Spi_Flash_Erase_Write(REGION_ADDR + ulOfs, ulSize, s_ucData);
+        if (xErr != FLASH_SUCCESS) {
+            printf("%s: write %u of %u bytes at %u failed, error %u, %u semaphore waits timed out\n",
+                   pcName, w, ulSize, REGION_ADDR + ulOfs, xErr, s_ulSemTimeout);
+            return 1;
+        }
+        if (0 != memcmp(&pucRegion[ulOfs], s_ucData, ulSize)) {
+            printf("%s: write %u, range does not hold the data\n", pcName, w);
+            return 1;
+        }
+
+        uint32_t ulErase = 0;
+        for (uint32_t s = ulOfs / SECTOR; s <= (ulOfs + ulSize - 1) / SECTOR; s++) {
+            uint32_t ulErased = s_ulEraseCnt[REGION_ADDR / SECTOR + s] - s_ulWasErase[s];
+            for (uint32_t n = s * SECTOR; n < (s + 1) * SECTOR; n++) {
+                if ((n >= ulOfs) && (n < ulOfs + ulSize)) {
+                    continue;
+                }
+                if (pucRegion[n] != (ulErased ? 0xFF : s_ucWas[n])) {
+                    printf("%s: write %u, byte %u outside the range %s\n", pcName, w, n,
+                           ulErased ? "not blank in an erased sector" : "changed");
+                    return 1;
+                }
+            }
+            ulErase += ulErased;
+            pxRun->ulSector++;
+        }
+        /* Sectors outside the range are not touched */
+        uint32_t ulLo = ulOfs / SECTOR * SECTOR;
+        uint32_t ulHi = ((ulOfs + ulSize - 1) / SECTOR + 1) * SECTOR;
+        if ((0 != memcmp(pucRegion, s_ucWas, ulLo)) || (0 != memcmp(&pucRegion[ulHi], &s_ucWas[ulHi], REGION_SIZE - ulHi))) {
+            printf("%s: write %u, a sector outside the range changed\n", pcName, w);
+            return 1;
+        }
+        if ((xMode != MODE_ANY) && (ulErase != 0)) {
+            printf("%s: write %u, %u erases for data that %s\n", pcName, w, ulErase,
+                   (xMode == MODE_SAME) ? "is there" : "clears bits only");
+            return 1;
+        }
+        if ((xMode == MODE_SAME) && (s_ullProgByte != ullProg)) {
+            printf("%s: write %u, data already there programmed\n", pcName, w);
+            return 1;
+        }
+        if (s_ulBadProg != 0) {
+            printf("%s: write %u, program without the latch or over cleared bits\n", pcName, w);
+            return 1;
+        }
+        pxRun->ulWrite[xMode]++;
+        pxRun->ulErase[xMode] += ulErase;
+        pxRun->ullByte += ulSize;
+        pxRun->ullProg += s_ullProgByte - ullProg;
+    }
+
+    printf("spi flash %s: %u erase writes (%u same, %u clearing, %u any), %llu KB, %u sectors touched\n",
+           pcName, WRITE_NUM, pxRun->ulWrite[MODE_SAME], pxRun->ulWrite[MODE_CLEAR], pxRun->ulWrite[MODE_ANY],
+           (unsigned long long)(pxRun->ullByte / 1024), pxRun->ulSector);
+    printf("    %u sector erases, none for data there or clearing bits (%u by the old erase write), %llu KB programmed: PASS\n",
+           pxRun->ulErase[MODE_ANY], pxRun->ulSector, (unsigned long long)(pxRun->ullProg / 1024));
+    return 0;
+}
+
+int main(void)
+{
+    Run_t      xRun;
+    Flash_Stat xStat;
+
+    srand(1);
+    memset(s_ucChip, 0xFF, sizeof(s_ucChip));
+    for (uint32_t n = 0; n < REGION_SIZE; n++) {
+        s_ucChip[REGION_ADDR + n] = rand();
+    }
+    if ((FLASH_SUCCESS != Spi_Flash_Config(&s_hSpi, GPIOA, 4)) || (FLASH_SUCCESS != Spi_Flash_Init())) {
+        printf("spi flash init failed\n");
+        return 1;
+    }
+
+    /* As the tasks see it, reads of MEM_SPIFLASH_DMA_MIN bytes and more go by DMA */
+    s_lKernel = 1;
+    if (0 != prvRun("dma", &xRun)) {
+        return 1;
+    }
+    printf("    %u dma transfers, %u semaphore waits timed out\n", s_ulDmaCnt, s_ulSemTimeout);
+    if (s_ulSemTimeout != 0) {
+        return 1;
+    }
+
+    /* Polled, as before the scheduler starts */
+    Spi_Flash_Set_Dma(false);
+    s_ulDmaCnt = 0;
+    if ((0 != prvRun("polled", &xRun)) || (s_ulDmaCnt != 0)) {
+        return 1;
+    }
+
+    Spi_Flash_Get_Stat(&xStat);
+    printf("    driver counts: %u erased, %u erases avoided, %u bytes programmed, %u bytes in place\n",
+           xStat.erase_cnt, xStat.erase_skip_cnt, xStat.prog_bytes, xStat.skip_bytes);
+    return 0;
+}
@@ -0,0 +1,967 @@
+/*
+    TestStc.c
+
+    Host Simulator for the Stc Bus, the Master Against Modelled Nodes
+*/
+
+/* Copyright 2023 Shanghai Master Inc. */
+
+/*
+    modification history
+    --------------------
+    01a, 19Oct26, agent Created
+    01b, 19Oct26, agent Nodes latch the sync values and slot origin in the isr
+    01c, 19Oct26, agent Added the cycle time benchmark and the discovery test
+    01d, 19Oct26, agent The discovery test reads the late node through StcGetTempH and StcGetTempL
+    01e, 19Oct26, agent Stub uart handle is a pointer
+*/
+
+/*
+    The real Stc.c and Prot.c run in tStc on the RtosSim clock. The RS485 bus
+    carries every frame byte by byte at its baud, two transmitters at once are
+    counted as a collision and both frames are corrupted. The nodes follow the
+    C51 main.c: a 1 ms timer with its own phase, an 8 ms ADC block, the filter
+    and the alarm debounce on the block average, requests handled by the main
+    loop NODE_LOOP_US after the last byte, temp queries answered by the isr,
+    sync values and slot origin latched by the isr, slots counted down by the
+    timer and the rate reverting after 2 s of silence.
+    tSys is a 1 ms tick that reads StcGetAlarm() and the group aggregates as
+    prvChkAPwr does.
+*/
+
+/* Includes */
+#include "Include.h"
+#include "RtosSim.h"
+
+/* Local defines */
+#define NODE_NUM        STC_DEV_MAX
+#define NODE_CHAN       10
+#define NODE_LOOP_US    150         /* Main loop pass, request to reply */
+#define NODE_ISR_US     10          /* Temp query answered by the isr */
+#define NODE_ADC_OVS    8
+#define NODE_REVERT_MS  2000
+#define FRM_MAX         64
+#define FRM_POOL        256
+#define EVT_NUM         (EVT_DROP + 1)
+
+#define RAW_COOL        2000        /* Raw AD of a cool channel, hotter is lower */
+#define RAW_HOT         200
+#define RAW_PD_DARK     500
+#define RAW_PD_LEAK     3000
+#define OT_CUT_TH       600
+#define PD_WARN_TH      1490
+
+/* Local types */
+typedef struct {
+    uint8_t  ucBuf[FRM_MAX];
+    uint8_t  ucLen;
+    uint8_t  ucSrc;             /* 0 is the master */
+    uint32_t ulBaud;
+    Bool_t   bBad;
+}Frm_t;
+
+typedef struct {
+    Bool_t   bPresent;
+    Bool_t   bOldFw;            /* Firmware without alarms, iCmdAlarmCfg is unknown to it */
+    uint8_t  ucDropCfg;         /* iCmdAlarmCfg frames lost before it sees one */
+    uint8_t  ucAddr;
+    uint8_t  ucBaudMask;
+    uint8_t  ucBaudIdx;
+    uint8_t  ucBaudNext;        /* Taken 1 ms after the acknowledge is out */
+    uint32_t ulPhase;           /* Timer tick offset (us) */
+    uint32_t ulTick;
+    uint32_t ulIdle;
+    /* Rx assembly */
+    uint8_t  ucRx[17];
+    uint8_t  ucRxIdx;
+    uint8_t  ucReq[17];
+    uint64_t ullTxEnd;
+    /* Adc and filter */
+    uint16_t usSig[NODE_CHAN];
+    uint32_t ulAcc[NODE_CHAN];
+    uint8_t  ucOvs;
+    Bool_t   bFltInit;
+    uint16_t usMed[NODE_CHAN][2];
+    uint16_t usIir[NODE_CHAN];
+    int16_t  sTemp[NODE_CHAN];
+    Bool_t   bTemp;
+    /* Slots */
+    uint8_t  ucSyncSeq;
+    uint16_t usSlotCnt;
+    uint16_t usAlmSlotCnt;
+    uint8_t  ucSyncFrm[40];
+    int16_t  sSyncTemp[NODE_CHAN];  /* Latched by the isr with the slot origin */
+    uint32_t ulSyncOrg;
+    /* Alarms */
+    Bool_t   bAlmCfg;
+    uint64_t ullAlmCfgAt;       /* First iCmdAlarmCfg taken */
+    uint16_t usOtTh;
+    uint16_t usPdTh;
+    uint16_t usOtEn;
+    uint16_t usPdEn;
+    uint8_t  ucAlmCnt[NODE_CHAN];
+    uint16_t usAlmOt;
+    uint16_t usAlmPd;
+    uint8_t  ucAlmChan;
+    uint16_t usAlmVal;
+    uint8_t  ucAlmAge;
+    /* Seen by the test */
+    uint32_t ulCfgRx;
+    uint64_t ullCfgFirstAt;     /* First iCmdAlarmCfg on the wire, lost or not */
+}Node_t;
+
+/* Local variables */
+static Node_t    s_xNode[NODE_NUM];
+static Frm_t     s_xFrm[FRM_POOL];
+static uint32_t  s_ulFrmNext = 0;
+static uint32_t  s_ulMasterBaud = 115200;
+static UartProcRxFunc_t s_pxMasterRx = NULL;
+static void     *s_pvMasterRxPara = NULL;
+static uint64_t  s_ullBusEnd = 0;
+static Frm_t    *s_pxBusFrm = NULL;
+static uint32_t  s_ulCollision = 0;
+static uint32_t  s_ulEvtCnt[EVT_NUM];
+static const uint32_t s_ulBaudTbl[4] = {115200, 230400, 460800, 921600};
+/* tSys view */
+static uint8_t   s_ucSysAlarm = 0;
+static int16_t   s_sSysTemp1 = 0;
+static int16_t   s_sSysPd = 0;
+
+Data_t   g_xData;
+
+/* Functions */
+static uint64_t prvByteUs(uint32_t ulBaud, uint32_t ulBytes)
+{
+    return ((uint64_t)ulBytes * 10 * 1000000 + ulBaud - 1) / ulBaud;
+}
+
+static Frm_t *prvFrmNew(uint8_t ucSrc, const uint8_t *pucBuf, uint8_t ucLen, uint32_t ulBaud)
+{
+    Frm_t *pxFrm = &s_xFrm[s_ulFrmNext++ % FRM_POOL];
+
+    memcpy(pxFrm->ucBuf, pucBuf, ucLen);
+    pxFrm->ucLen  = ucLen;
+    pxFrm->ucSrc  = ucSrc;
+    pxFrm->ulBaud = ulBaud;
+    pxFrm->bBad   = FALSE;
+    return pxFrm;
+}
+
+static void prvFrmSum(uint8_t *pucBuf, uint8_t ucLen)
+{
+    uint8_t ucSum = 0;
+
+    pucBuf[ucLen - 3] = 0;
+    for (uint8_t n = 0; n < ucLen; n++) {
+        ucSum += pucBuf[n];
+    }
+    pucBuf[ucLen - 3] = 0xFF - ucSum;
+}
+
+/* Bus */
+static void prvNodeRx(Node_t *pxNode, uint8_t ucByte);
+
+static void prvBusByte(void *pvPara)
+{
+    uintptr_t ulArg = (uintptr_t)pvPara;
+    Frm_t    *pxFrm = &s_xFrm[ulArg >> 8];
+    uint8_t   ucByte = pxFrm->ucBuf[ulArg & 0xFF];
+
+    if (pxFrm->bBad) {
+        ucByte ^= 0x5A;
+    }
+    for (uint8_t n = 0; n < NODE_NUM; n++) {
+        if (s_xNode[n].bPresent && (s_ulBaudTbl[s_xNode[n].ucBaudIdx] == pxFrm->ulBaud)) {
+            prvNodeRx(&s_xNode[n], ucByte);
+        }
+    }
+}
+
+/* The master's DMA takes the frame, the idle line one byte later hands it over */
+static void prvBusMasterRx(void *pvPara)
+{
+    Frm_t  *pxFrm = pvPara;
+    uint8_t ucBuf[FRM_MAX];
+
+    if ((pxFrm->ulBaud != s_ulMasterBaud) || (NULL == s_pxMasterRx)) {
+        return;
+    }
+    for (uint8_t n = 0; n < pxFrm->ucLen; n++) {
+        ucBuf[n] = pxFrm->bBad ? (pxFrm->ucBuf[n] ^ 0x5A) : pxFrm->ucBuf[n];
+    }
+    s_pxMasterRx(ucBuf, pxFrm->ucLen, s_pvMasterRxPara);
+}
+
+static void prvBusStart(void *pvPara)
+{
+    Frm_t   *pxFrm = pvPara;
+    uint64_t ullNow = RtosSimNow();
+    uint64_t ullEnd = ullNow + prvByteUs(pxFrm->ulBaud, pxFrm->ucLen);
+
+    if ((ullNow < s_ullBusEnd) && s_pxBusFrm) {
+        s_ulCollision++;
+        s_pxBusFrm->bBad = TRUE;
+        pxFrm->bBad      = TRUE;
+    }
+    if (ullEnd > s_ullBusEnd) {
+        s_ullBusEnd = ullEnd;
+        s_pxBusFrm  = pxFrm;
+    }
+    if (pxFrm->ucSrc == 0) {
+        for (uint8_t n = 0; n < pxFrm->ucLen; n++) {
+            RtosSimAt(ullNow + prvByteUs(pxFrm->ulBaud, n + 1), prvBusByte,
+                      (void *)(uintptr_t)(((pxFrm - s_xFrm) << 8) | n));
+        }
+    }
+    else {
+        RtosSimAt(ullEnd + prvByteUs(pxFrm->ulBaud, 1), prvBusMasterRx, pxFrm);
+    }
+}
+
+/* Nodes */
+static void prvNodeTx(Node_t *pxNode, const uint8_t *pucBuf, uint8_t ucLen, uint64_t ullAt)
+{
+    uint32_t ulBaud = s_ulBaudTbl[pxNode->ucBaudIdx];
+    Frm_t   *pxFrm  = prvFrmNew(pxNode->ucAddr, pucBuf, ucLen, ulBaud);
+
+    /* Behind what the uart is still sending */
+    if (ullAt < pxNode->ullTxEnd) {
+        ullAt = pxNode->ullTxEnd;
+    }
+    pxNode->ullTxEnd = ullAt + prvByteUs(ulBaud, ucLen);
+    RtosSimAt(ullAt, prvBusStart, pxFrm);
+}
+
+static uint8_t prvNodeHead(Node_t *pxNode, uint8_t *c, uint8_t ucLen, uint8_t ucCmd)
+{
+    c[0] = 0x7E;
+    c[1] = 0x7E;
+    c[2] = ucLen;
+    c[3] = ucCmd;
+    c[4] = pxNode->ucAddr;
+    c[5] = 0;
+    c[ucLen - 2] = 0x0A;
+    c[ucLen - 1] = 0x0D;
+    return 6;
+}
+
+static uint8_t prvNodeTemps(const int16_t *psTemp, uint8_t *c, uint8_t i)
+{
+    for (uint8_t n = 0; n < NODE_CHAN; n++) {
+        c[i++] = psTemp[n] & 0xFF;
+        c[i++] = (psTemp[n] >> 8) & 0xFF;
+    }
+    for (uint8_t n = 0; n < NODE_CHAN; n++) {
+        c[i++] = 1;
+    }
+    return i;
+}
+
+static void prvNodeSendTemp(Node_t *pxNode, uint64_t ullAt)
+{
+    uint8_t c[39];
+
+    prvNodeTemps(pxNode->sTemp, c, prvNodeHead(pxNode, c, sizeof(c), 0x81));
+    prvFrmSum(c, sizeof(c));
+    prvNodeTx(pxNode, c, sizeof(c), ullAt);
+}
+
+static void prvNodeSendAlarm(Node_t *pxNode, uint64_t ullAt)
+{
+    uint8_t c[19];
+    uint8_t i = prvNodeHead(pxNode, c, sizeof(c), 0x86);
+
+    c[i++] = pxNode->ucSyncSeq;
+    c[i++] = (pxNode->usAlmOt ? STC_ALARM_OT : 0) | (pxNode->usAlmPd ? STC_ALARM_PD : 0);
+    c[i++] = pxNode->ucAlmAge;
+    c[i++] = pxNode->ucAlmChan;
+    c[i++] = pxNode->usAlmOt & 0xFF;
+    c[i++] = pxNode->usAlmOt >> 8;
+    c[i++] = pxNode->usAlmPd & 0xFF;
+    c[i++] = pxNode->usAlmPd >> 8;
+    c[i++] = pxNode->usAlmVal & 0xFF;
+    c[i++] = pxNode->usAlmVal >> 8;
+    prvFrmSum(c, sizeof(c));
+    pxNode->usAlmOt = 0;
+    pxNode->usAlmPd = 0;
+    prvNodeTx(pxNode, c, sizeof(c), ullAt);
+}
+
+static uint8_t prvNodeRank(const Node_t *pxNode, uint16_t usMask)
+{
+    uint8_t r = 0;
+
+    if (!(usMask & (1 << (pxNode->ucAddr - 1)))) {
+        return 0xFF;
+    }
+    for (uint8_t n = 0; n < (pxNode->ucAddr - 1); n++) {
+        if (usMask & (1 << n)) {
+            r++;
+        }
+    }
+    return r;
+}
+
+static void prvNodeSetBaud(void *pvPara)
+{
+    Node_t *pxNode = pvPara;
+
+    pxNode->ucBaudIdx = pxNode->ucBaudNext;
+    pxNode->ucRxIdx   = 0;
+}
+
+/* UartProc, a main loop pass after the request is in */
+static void prvNodeProc(void *pvPara)
+{
+    Node_t  *pxNode = pvPara;
+    uint8_t *b      = pxNode->ucReq;
+    uint64_t ullNow = RtosSimNow();
+    uint8_t  c[40];
+    uint8_t  i;
+    uint32_t ulAge = pxNode->ulTick - pxNode->ulSyncOrg;
+    uint32_t ulCnt;
+
+    switch (b[3]) {
+    case 0x01:
+        if (b[6] == 0x82) {
+            i = prvNodeHead(pxNode, c, 21, 0x82);
+            memset(&c[i], 0, 12);
+            prvFrmSum(c, 21);
+            prvNodeTx(pxNode, c, 21, ullNow);
+        }
+        else if ((b[6] == 0x81) && pxNode->bTemp) {
+            prvNodeSendTemp(pxNode, ullNow);
+        }
+        break;
+    case 0x03:
+        i = prvNodeHead(pxNode, c, 11, 0x83);
+        c[i++] = pxNode->ucBaudMask;
+        if ((b[6] == 1) && (b[7] < 4) && (pxNode->ucBaudMask & (1 << b[7]))) {
+            /* Acknowledged at the old rate, BaudProc switches 1 ms later */
+            c[i++] = b[7];
+            prvFrmSum(c, 11);
+            prvNodeTx(pxNode, c, 11, ullNow);
+            pxNode->ucBaudNext = b[7];
+            RtosSimAt(pxNode->ullTxEnd + 1000, prvNodeSetBaud, pxNode);
+        }
+        else {
+            c[i++] = pxNode->ucBaudIdx;
+            prvFrmSum(c, 11);
+            prvNodeTx(pxNode, c, 11, ullNow);
+        }
+        break;
+    case 0x04:
+        /* ProcCmdSyncSample, slots count from the isr latch */
+        pxNode->ucSyncSeq = b[6];
+        i = prvNodeHead(pxNode, pxNode->ucSyncFrm, 40, 0x84);
+        pxNode->ucSyncFrm[i++] = b[6];
+        prvNodeTemps(pxNode->sSyncTemp, pxNode->ucSyncFrm, i);
+        prvFrmSum(pxNode->ucSyncFrm, 40);
+        i = prvNodeRank(pxNode, b[10] | (b[11] << 8));
+        if (i != 0xFF) {
+            ulCnt = i * b[7];
+            if (ulCnt <= ulAge) {
+                prvNodeTx(pxNode, pxNode->ucSyncFrm, 40, ullNow);
+            }
+            else {
+                pxNode->usSlotCnt = ulCnt - ulAge;
+            }
+        }
+        i = prvNodeRank(pxNode, b[12] | (b[13] << 8));
+        if (b[9] && (i != 0xFF)) {
+            ulCnt = b[8] + i * b[9];
+            if (ulCnt <= ulAge) {
+                if (pxNode->usAlmOt || pxNode->usAlmPd) {
+                    prvNodeSendAlarm(pxNode, ullNow);
+                }
+            }
+            else {
+                pxNode->usAlmSlotCnt = ulCnt - ulAge;
+            }
+        }
+        break;
+    case 0x05:
+        if (pxNode->bOldFw) {
+            break;
+        }
+        pxNode->usOtTh = b[6] | (b[7] << 8);
+        pxNode->usPdTh = b[8] | (b[9] << 8);
+        pxNode->usOtEn = b[10] | (b[11] << 8);
+        pxNode->usPdEn = b[12] | (b[13] << 8);
+        pxNode->usAlmOt &= pxNode->usOtEn;
+        pxNode->usAlmPd &= pxNode->usPdEn;
+        if (!pxNode->bAlmCfg) {
+            pxNode->bAlmCfg     = TRUE;
+            pxNode->ullAlmCfgAt = ullNow;
+        }
+        i = prvNodeHead(pxNode, c, 17, 0x85);
+        memcpy(&c[i], &b[6], 8);
+        prvFrmSum(c, 17);
+        prvNodeTx(pxNode, c, 17, ullNow);
+        break;
+    default:
+        break;
+    }
+}
+
+/* UartRxIsrProc */
+static void prvNodeRx(Node_t *pxNode, uint8_t ucByte)
+{
+    uint8_t *b = pxNode->ucRx;
+    uint8_t  i = pxNode->ucRxIdx;
+    uint8_t  ucSum = 0;
+
+    if (i >= sizeof(pxNode->ucRx)) {
+        i = 0;
+    }
+    b[i++] = ucByte;
+    pxNode->ucRxIdx = i;
+    if (((i <= 2) && (ucByte != 0x7E)) || ((i == 3) && ((ucByte > 17) || (ucByte < 9))) ||
+        ((i == 5) && (ucByte != 0)) || ((i == 6) && (ucByte != pxNode->ucAddr) && (ucByte != 0xFF))) {
+        pxNode->ucRxIdx = 0;
+        return;
+    }
+    if ((i < 6) || (i < b[2])) {
+        return;
+    }
+    pxNode->ucRxIdx = 0;
+    for (uint8_t n = 0; n < i; n++) {
+        ucSum += b[n];
+    }
+    if ((ucSum != 0xFF) || ((b[5] == 0xFF) && (b[3] != 0x04))) {
+        return;
+    }
+    pxNode->ulIdle = 0;
+    if (b[3] == 0x04) {
+        pxNode->ulSyncOrg = pxNode->ulTick;
+        memcpy(pxNode->sSyncTemp, pxNode->sTemp, sizeof(pxNode->sSyncTemp));
+    }
+    if (b[3] == 0x05) {
+        if (pxNode->ulCfgRx++ == 0) {
+            pxNode->ullCfgFirstAt = RtosSimNow();
+        }
+        if (pxNode->ucDropCfg) {
+            pxNode->ucDropCfg--;
+            return;
+        }
+    }
+    if ((b[3] == 0x01) && (b[6] == 0x81) && pxNode->bTemp) {
+        prvNodeSendTemp(pxNode, RtosSimNow() + NODE_ISR_US);
+        return;
+    }
+    memcpy(pxNode->ucReq, b, i);
+    RtosSimAt(RtosSimNow() + NODE_LOOP_US, prvNodeProc, pxNode);
+}
+
+/* AlarmChk on the block average */
+static void prvNodeAlarmChk(Node_t *pxNode, uint8_t n, uint16_t x)
+{
+    uint16_t usBit = 1 << n;
+    Bool_t   bOt   = (pxNode->usOtEn & usBit) && (x <= pxNode->usOtTh);
+    Bool_t   bPd   = (pxNode->usPdEn & usBit) && (x >= pxNode->usPdTh);
+
+    if (!bOt && !bPd) {
+        pxNode->ucAlmCnt[n] = 0;
+        return;
+    }
+    if ((pxNode->ucAlmCnt[n] < 2) && (++pxNode->ucAlmCnt[n] < 2)) {
+        return;
+    }
+    if (!pxNode->usAlmOt && !pxNode->usAlmPd) {
+        pxNode->ucAlmAge  = 0;
+        pxNode->ucAlmChan = n;
+        pxNode->usAlmVal  = x;
+    }
+    if (bOt) {
+        pxNode->usAlmOt |= usBit;
+    }
+    if (bPd) {
+        pxNode->usAlmPd |= usBit;
+    }
+}
+
+static uint16_t prvMedian3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    return (c <= a) ? a : ((c >= b) ? b : c);
+}
+
+/* TimerProc with one adc scan, AdcProc once a block is in */
+static void prvNodeTick(void *pvPara)
+{
+    Node_t  *pxNode = pvPara;
+    uint64_t ullNow = RtosSimNow();
+
+    RtosSimAt(ullNow + 1000, prvNodeTick, pxNode);
+    pxNode->ulTick++;
+    if (pxNode->usSlotCnt && (--pxNode->usSlotCnt == 0)) {
+        prvNodeTx(pxNode, pxNode->ucSyncFrm, 40, ullNow + NODE_LOOP_US);
+    }
+    if (pxNode->usAlmSlotCnt && (--pxNode->usAlmSlotCnt == 0) && (pxNode->usAlmOt || pxNode->usAlmPd)) {
+        prvNodeSendAlarm(pxNode, ullNow + NODE_LOOP_US);
+    }
+    if (pxNode->ucAlmAge < 0xFF) {
+        pxNode->ucAlmAge++;
+    }
+    if ((pxNode->ucBaudIdx != 0) && (++pxNode->ulIdle >= NODE_REVERT_MS)) {
+        pxNode->ulIdle    = 0;
+        pxNode->ucBaudIdx = 0;
+        pxNode->ucRxIdx   = 0;
+    }
+
+    for (uint8_t n = 0; n < NODE_CHAN; n++) {
+        pxNode->ulAcc[n] += pxNode->usSig[n];
+    }
+    if (++pxNode->ucOvs < NODE_ADC_OVS) {
+        return;
+    }
+    pxNode->ucOvs = 0;
+    for (uint8_t n = 0; n < NODE_CHAN; n++) {
+        uint16_t x = pxNode->ulAcc[n] / NODE_ADC_OVS;
+        pxNode->ulAcc[n] = 0;
+        prvNodeAlarmChk(pxNode, n, x);
+        if (!pxNode->bFltInit) {
+            pxNode->usMed[n][0] = x;
+            pxNode->usMed[n][1] = x;
+            pxNode->usIir[n]    = x << 4;
+        }
+        uint16_t m = prvMedian3(pxNode->usMed[n][0], pxNode->usMed[n][1], x);
+        pxNode->usMed[n][0] = pxNode->usMed[n][1];
+        pxNode->usMed[n][1] = x;
+        pxNode->usIir[n]    = pxNode->usIir[n] - (pxNode->usIir[n] >> 2) + (m << 2);
+        pxNode->sTemp[n]    = (pxNode->usIir[n] + 8) >> 4;
+    }
+    pxNode->bFltInit = TRUE;
+    pxNode->bTemp    = TRUE;
+}
+
+static void prvNodeAdd(uint8_t ucAddr, uint8_t ucBaudMask)
+{
+    Node_t *pxNode = &s_xNode[ucAddr - 1];
+
+    memset(pxNode, 0, sizeof(Node_t));
+    pxNode->bPresent   = TRUE;
+    pxNode->ucAddr     = ucAddr;
+    pxNode->ucBaudMask = ucBaudMask | 1;
+    pxNode->ulPhase    = rand() % 1000;
+    pxNode->usPdTh     = 0xFFFF;
+    for (uint8_t n = 0; n < NODE_CHAN; n++) {
+        pxNode->usSig[n] = RAW_COOL;
+    }
+    /* PD1, PD2 and PD3 are channels 2 ~ 4 of the second board */
+    if (ucAddr == 2) {
+        pxNode->usSig[2] = RAW_PD_DARK;
+        pxNode->usSig[3] = RAW_PD_DARK;
+        pxNode->usSig[4] = RAW_PD_DARK;
+    }
+    RtosSimAt(RtosSimNow() + pxNode->ulPhase, prvNodeTick, pxNode);
+}
+
+/* tSys, prvChkAPwr every ms */
+static void prvSysTick(void *pvPara)
+{
+    (void)pvPara;
+    RtosSimAt(RtosSimNow() + 1000, prvSysTick, NULL);
+    s_ucSysAlarm = StcGetAlarm();
+    s_sSysTemp1  = StcGetTempHGrp(STC_GRP_TEMP1);
+    s_sSysPd     = StcGetPdHFrom();
+}
+
+/* Stand-ins, Uart */
+Status_t UartInit(void)
+{
+    return STATUS_OK;
+}
+
+UartHandle_t UartCreate(void)
+{
+    static uint8_t s_ucUart;
+
+    return &s_ucUart;
+}
+
+Status_t UartConfigCb(UartHandle_t xHandle, UartProcRxFunc_t CbRxProc, UartIsrFunc_t CbUartIsr, UartIsrFunc_t CbDmaRxIsr,
+                      UartIsrFunc_t CbDmaTxIsr, void *pIsrPara)
+{
+    (void)xHandle;
+    (void)CbUartIsr;
+    (void)CbDmaRxIsr;
+    (void)CbDmaTxIsr;
+    s_pxMasterRx     = CbRxProc;
+    s_pvMasterRxPara = pIsrPara;
+    return STATUS_OK;
+}
+
+Status_t UartConfigCom(UartHandle_t xHandle, USART_TypeDef *pxInstance, uint32_t ulBaudRate, IRQn_Type xIrq)
+{
+    (void)xHandle;
+    (void)pxInstance;
+    (void)xIrq;
+    s_ulMasterBaud = ulBaudRate;
+    return STATUS_OK;
+}
+
+Status_t UartConfigRxDma(UartHandle_t xHandle, DMA_Channel_TypeDef *pDmaChan, IRQn_Type Irq)
+{
+    (void)xHandle;
+    (void)pDmaChan;
+    (void)Irq;
+    return STATUS_OK;
+}
+
+Status_t UartConfigTxDma(UartHandle_t xHandle, DMA_Channel_TypeDef *pDmaChan, IRQn_Type Irq)
+{
+    (void)xHandle;
+    (void)pDmaChan;
+    (void)Irq;
+    return STATUS_OK;
+}
+
+Status_t UartStopIt(UartHandle_t xHandle)
+{
+    (void)xHandle;
+    return STATUS_OK;
+}
+
+/* Blocks till the last byte is out, as the DMA send with its wait does */
+Status_t UartBlkSend(UartHandle_t xHandle, uint8_t *pucBuf, uint16_t usLength, uint16_t usWaitMs)
+{
+    (void)xHandle;
+    (void)usWaitMs;
+    prvBusStart(prvFrmNew(0, pucBuf, usLength, s_ulMasterBaud));
+    RtosSimBusy(prvByteUs(s_ulMasterBaud, usLength));
+    return STATUS_OK;
+}
+
+void UartIsrCb(void *p)
+{
+    (void)p;
+}
+
+void UartDmaRxIsrCb(void *p)
+{
+    (void)p;
+}
+
+void UartDmaTxIsrCb(void *p)
+{
+    (void)p;
+}
+
+void UartIsr(UartHandle_t xHandle)
+{
+    (void)xHandle;
+}
+
+void UartDmaRxIsr(UartHandle_t xHandle)
+{
+    (void)xHandle;
+}
+
+void UartDmaTxIsr(UartHandle_t xHandle)
+{
+    (void)xHandle;
+}
+
+/* Stand-ins, the rest */
+Status_t GpioSetOutput(uint16_t usSeq, uint16_t usSw)
+{
+    (void)usSeq;
+    (void)usSw;
+    return STATUS_OK;
+}
+
+void EvtLog(uint16_t usId, uint32_t ulArg0, uint32_t ulArg1, uint32_t ulArg2, uint32_t ulArg3)
+{
+    (void)ulArg0;
+    (void)ulArg1;
+    (void)ulArg2;
+    (void)ulArg3;
+    if (usId < EVT_NUM) {
+        s_ulEvtCnt[usId]++;
+    }
+}
+
+/* Cli output kept for the checks */
+static char     s_cCli[4096];
+static uint32_t s_ulCliLen = 0;
+
+static void prvCliPrintf(const char *pcFmt, ...)
+{
+    va_list xArgs;
+
+    va_start(xArgs, pcFmt);
+    s_ulCliLen += vsnprintf(s_cCli + s_ulCliLen, sizeof(s_cCli) - s_ulCliLen, pcFmt, xArgs);
+    va_end(xArgs);
+    if (s_ulCliLen >= sizeof(s_cCli)) {
+        s_ulCliLen = sizeof(s_cCli) - 1;
+    }
+}
+
+extern void (*const g_pfnCli_stc_alarm)(cli_printf cliprintf, int argc, char **argv);
+
+static const char *prvCli(void (*const pxCmd)(cli_printf, int, char **))
+{
+    char *pcArgv[] = {"cmd"};
+
+    s_ulCliLen = 0;
+    s_cCli[0]  = 0;
+    pxCmd(prvCliPrintf, 1, pcArgv);
+    return s_cCli;
+}
+
+/* One boot of the master with the given nodes */
+static void prvBoot(uint32_t ulNodeMask, uint8_t ucBaudMask)
+{
+    RtosSimInit();
+    memset(s_xNode, 0, sizeof(s_xNode));
+    memset(s_ulEvtCnt, 0, sizeof(s_ulEvtCnt));
+    s_ulCollision = 0;
+    s_ullBusEnd   = 0;
+    s_pxBusFrm    = NULL;
+    memset(&g_xData, 0, sizeof(g_xData));
+    th_OtCutTh       = OT_CUT_TH;
+    th_PdWarnL1      = PD_WARN_TH;
+    th_TempNum       = 12;
+    th_ModEnAll      = 0;
+    th_ModEn.TEMP1   = 1;
+    th_ModEn.TEMP2   = 1;
+    th_ModEn.PD      = 1;
+    for (uint8_t n = 0; n < NODE_NUM; n++) {
+        if (ulNodeMask & (1UL << n)) {
+            prvNodeAdd(n + 1, ucBaudMask);
+        }
+    }
+    DrvStcInit();
+    RtosSimAt(1000, prvSysTick, NULL);
+}
+
+static int prvCmpU32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+    An over temperature on STC-1 T4 or a PD leak on STC-2 PD1, at a random time.
+    Latency is from the step on the sensor to the first tSys tick that sees it,
+    through the pushed alarm and through the polled values.
+*/
+#define ALARM_NUM       200
+#define ALARM_BOUND_MS  60
+#define RETRY_BOUND_MS  100         /* A few cycles, the refresh period was 1000 ms */
+
+static int prvAlarmBench(const char *pcName, uint8_t ucBaudMask)
+{
+    static uint32_t ulPush[ALARM_NUM];
+    static uint32_t ulPoll[ALARM_NUM];
+    StcLinkStat_t   xLink;
+    uint64_t        ullSum[2] = {0, 0};
+
+    srand(ucBaudMask);
+    prvBoot(0x3, ucBaudMask);
+    RtosSimRun(3000000);
+
+    for (uint32_t k = 0; k < ALARM_NUM; k++) {
+        Bool_t   bPd   = (k & 1);
+        Node_t  *pxNode = &s_xNode[bPd ? 1 : 0];
+        uint8_t  ucChan = bPd ? 2 : 3;
+        uint64_t ullT0;
+
+        RtosSimRun(RtosSimNow() + 200000 + rand() % 20000);
+        if (s_ucSysAlarm) {
+            printf("%s: alarm %u raised with no cause\n", pcName, k);
+            return 1;
+        }
+        ullT0 = RtosSimNow();
+        pxNode->usSig[ucChan] = bPd ? RAW_PD_LEAK : RAW_HOT;
+        ulPush[k] = 0;
+        ulPoll[k] = 0;
+        while ((0 == ulPush[k]) || (0 == ulPoll[k])) {
+            RtosSimRun(RtosSimNow() + 1000);
+            uint32_t ulMs = (RtosSimNow() - ullT0 + 999) / 1000;
+            if ((0 == ulPush[k]) && (s_ucSysAlarm & (bPd ? STC_ALARM_PD : STC_ALARM_OT))) {
+                ulPush[k] = ulMs;
+            }
+            if ((0 == ulPoll[k]) && (bPd ? (s_sSysPd >= PD_WARN_TH) : (s_sSysTemp1 <= OT_CUT_TH))) {
+                ulPoll[k] = ulMs;
+            }
+            if (ulMs > 1000) {
+                printf("%s: alarm %u not seen, push %u ms, poll %u ms\n", pcName, k, ulPush[k], ulPoll[k]);
+                return 1;
+            }
+        }
+        pxNode->usSig[ucChan] = bPd ? RAW_PD_DARK : RAW_COOL;
+        ullSum[0] += ulPush[k];
+        ullSum[1] += ulPoll[k];
+    }
+    /* Held STC_ALARM_HOLD_MS after the last frame, then gone */
+    RtosSimRun(RtosSimNow() + 500000);
+    StcGetLinkStat(&xLink);
+    qsort(ulPush, ALARM_NUM, sizeof(uint32_t), prvCmpU32);
+    qsort(ulPoll, ALARM_NUM, sizeof(uint32_t), prvCmpU32);
+    printf("stc alarm %s, %u baud, cycle %u us: pushed %llu/%u/%u ms, polled %llu/%u/%u ms (mean/p99/max)\n",
+           pcName, xLink.ulBaud, xLink.ulCycLast, (unsigned long long)(ullSum[0] / ALARM_NUM), ulPush[ALARM_NUM * 99 / 100],
+           ulPush[ALARM_NUM - 1], (unsigned long long)(ullSum[1] / ALARM_NUM), ulPoll[ALARM_NUM * 99 / 100], ulPoll[ALARM_NUM - 1]);
+    if (s_ucSysAlarm || s_ulCollision || (ulPush[ALARM_NUM - 1] > ALARM_BOUND_MS)) {
+        printf("%s: alarm 0x%02X left, %u collisions, max %u ms over %u ms: FAIL\n", pcName, s_ucSysAlarm,
+               s_ulCollision, ulPush[ALARM_NUM - 1], ALARM_BOUND_MS);
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    Thresholds are pending till a node answers. STC-1 loses the first push and
+    must have them a few cycles later, not a refresh period later. STC-3 runs
+    firmware without alarms, it must stay pending and be asked ever less often.
+*/
+static int prvAlarmCfg(void)
+{
+    const char *pcOut;
+    uint32_t    ulLate;
+
+    srand(3);
+    prvBoot(0x7, 0x1);
+    s_xNode[0].ucDropCfg = 1;
+    s_xNode[2].bOldFw    = TRUE;
+    RtosSimRun(10000000);
+
+    if (!s_xNode[0].bAlmCfg || !s_xNode[1].bAlmCfg) {
+        printf("stc alarm cfg: STC-1 %d, STC-2 %d never got the thresholds: FAIL\n", s_xNode[0].bAlmCfg,
+               s_xNode[1].bAlmCfg);
+        return 1;
+    }
+    ulLate = (s_xNode[0].ullAlmCfgAt - s_xNode[0].ullCfgFirstAt) / 1000;
+    pcOut  = prvCli(g_pfnCli_stc_alarm);
+    pcOut  = strstr(pcOut, "STC-3");
+    printf("stc alarm cfg: lost push retried after %u ms, STC-2 pushed %u times, old STC-3 %u times in 10 s\n",
+           ulLate, s_xNode[1].ulCfgRx, s_xNode[2].ulCfgRx);
+    if ((ulLate > RETRY_BOUND_MS) || (NULL == pcOut) ||
+        (NULL == strstr(pcOut, "Pending")) || (s_xNode[2].ulCfgRx > 30) || s_ulCollision) {
+        printf("stc alarm cfg: %u collisions, STC-3 %s: FAIL\n", s_ulCollision, pcOut ? pcOut : "missing");
+        return 1;
+    }
+    return 0;
+}
+
+/*
+    Poll cycle time and refresh rate against the number of nodes on the bus, all
+    at weight 1, after the rate is negotiated. Cycle is ulCycLast, the padding
+    up to STC_QUERY_TEMP_PRD excluded.
+*/
+static int prvCycBench(const char *pcName, uint8_t ucBaudMask)
+{
+    static const uint8_t ucNum[] = {1, 2, 3, 4, 6, 8, 12, 16};
+    StcLinkStat_t  xLink;
+    StcDevInfo_t   xInfo;
+
+    for (uint32_t k = 0; k < (sizeof(ucNum) / sizeof(ucNum[0])); k++) {
+        uint32_t ulMask = (1UL << ucNum[k]) - 1;
+        uint32_t ulMax  = 0;
+        uint64_t ullSum = 0;
+        uint32_t ulCnt  = 0;
+
+        srand(ucNum[k]);
+        prvBoot(ulMask, ucBaudMask);
+        RtosSimRun(3000000);
+        for (uint32_t n = 0; n < 2000; n++) {
+            RtosSimRun(RtosSimNow() + 1000);
+            StcGetLinkStat(&xLink);
+            ullSum += xLink.ulCycLast;
+            ulCnt++;
+            if (xLink.ulCycLast > ulMax) {
+                ulMax = xLink.ulCycLast;
+            }
+        }
+        StcGetDevInfo(ucNum[k] - 1, &xInfo);
+        printf("stc cycle %s, %2u nodes, %u baud: %5llu us mean, %5u us max, %3u Hz per node\n", pcName,
+               ucNum[k], xLink.ulBaud, (unsigned long long)(ullSum / ulCnt), ulMax, xInfo.usRate);
+        if ((StcGetDevMask() != ulMask) || s_ulCollision || (0 == xInfo.usRate)) {
+            printf("stc cycle %s: mask 0x%04X, %u collisions: FAIL\n", pcName, StcGetDevMask(), s_ulCollision);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+    The boot scan finds the nodes on the bus and nothing else. A node powered up
+    later is found by the round robin probe within the bound in Stc.h, the bus
+    drops to the default rate for it and is negotiated up again with it. Its
+    channels count in StcGetTempH and StcGetTempL, the PDs of STC-2 do not.
+*/
+#define LATE_ADDR       12
+
+static int prvDiscovery(void)
+{
+    const uint32_t ulBoot  = 0x113;     /* STC-1, STC-2, STC-5, STC-9 */
+    const uint32_t ulBound = (STC_DEV_MAX - 4) * STC_SCAN_PRD + STC_QUERY_TEMP_PRD * 10;
+    StcLinkStat_t  xLink;
+    StcDevInfo_t   xInfo;
+    uint64_t       ullOn;
+    uint32_t       ulFound = 0;
+
+    srand(34);
+    prvBoot(ulBoot, 0xF);
+    RtosSimRun(2000000);
+    if (StcGetDevMask() != ulBoot) {
+        printf("stc discovery: boot scan found 0x%04X, not 0x%04X: FAIL\n", StcGetDevMask(), ulBoot);
+        return 1;
+    }
+
+    /* Late node, the worst case is it just missed its probe */
+    ullOn = RtosSimNow();
+    prvNodeAdd(LATE_ADDR, 0xF);
+    while (!(StcGetDevMask() & (1UL << (LATE_ADDR - 1)))) {
+        RtosSimRun(RtosSimNow() + 1000);
+        ulFound = (RtosSimNow() - ullOn) / 1000;
+        if (ulFound > ulBound) {
+            printf("stc discovery: STC-%u not found in %u ms: FAIL\n", LATE_ADDR, ulBound);
+            return 1;
+        }
+    }
+    RtosSimRun(RtosSimNow() + 3000000);
+    StcGetLinkStat(&xLink);
+    StcGetDevInfo(LATE_ADDR - 1, &xInfo);
+    printf("stc discovery: boot scan 0x%04X, late STC-%u found after %u ms (bound %u ms), %u nodes at %u baud, "
+           "%u Hz\n", ulBoot, LATE_ADDR, ulFound, ulBound, xLink.ucDevNum, xLink.ulBaud, xInfo.usRate);
+    if ((xLink.ucDevNum != 5) || (xLink.ulBaud != 921600) || (0 == xInfo.usRate) || s_ulCollision) {
+        printf("stc discovery: %u collisions: FAIL\n", s_ulCollision);
+        return 1;
+    }
+
+    /* Lower is hotter and StcGetTempH starts at 687, a PD taken for a temperature would be below */
+    if ((StcGetTempH() != 687) || (StcGetTempL() != RAW_COOL)) {
+        printf("stc discovery: all cool, highest %d, lowest %d: FAIL\n", StcGetTempH(), StcGetTempL());
+        return 1;
+    }
+    s_xNode[LATE_ADDR - 1].usSig[7] = RAW_HOT;
+    RtosSimRun(RtosSimNow() + 2000000);
+    if (StcGetTempH() != RAW_HOT) {
+        printf("stc discovery: STC-%u T8 hot, highest %d: FAIL\n", LATE_ADDR, StcGetTempH());
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argc;
+    (void)argv;
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    if ((0 != prvAlarmBench("nodes up to 921600", 0xF)) || (0 != prvAlarmBench("nodes at 115200", 0x1)) ||
+        (0 != prvAlarmCfg()) || (0 != prvCycBench("up to 921600", 0xF)) || (0 != prvCycBench("at 115200", 0x1)) ||
+        (0 != prvDiscovery())) {
+        return 1;
+    }
+    printf("stc: PASS\n");
+    return 0;
+}